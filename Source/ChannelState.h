@@ -17,6 +17,9 @@
  */
 #pragma once
 
+#include "NoteHeat.h"
+#include "NoteSpans.h"
+
 namespace showmidi
 {
     struct TimedValue
@@ -243,6 +246,8 @@ namespace showmidi
         int number_ { -1 };
         Time time_;
         Notes notes_;
+        NoteSpans noteSpans_;
+        NoteHeat noteHeat_;
         ControlChanges controlChanges_;
         ProgramChange programChange_;
         ChannelPressure channelPressure_;
@@ -262,6 +267,8 @@ namespace showmidi
         {
             time_ = Time();
             notes_.reset();
+            noteSpans_.reset();
+            noteHeat_.reset();
             controlChanges_.reset();
             programChange_.reset();
             channelPressure_.reset();
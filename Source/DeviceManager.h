@@ -30,6 +30,10 @@ namespace showmidi
         
         virtual bool isPaused() = 0;
         virtual void togglePaused() = 0;
+        /** How far back the paused devices can be looked at, in milliseconds. */
+        virtual int64 getScrubLength() = 0;
+        /** Shows the paused devices as they were a number of milliseconds before the pause. */
+        virtual void scrubTo(int64 offset) = 0;
         virtual DeviceListeners& getDeviceListeners() = 0;
         virtual void resetChannelData() = 0;
     };
@@ -0,0 +1,62 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "DpiScaling.h"
+
+namespace showmidi
+{
+    /**
+     * The scaled metrics of a device view, computed once per display scale so that
+     * the layout and paint loops don't query the displays or construct fonts.
+     *
+     * The positions in LayoutConstants.h are used as logical units by the device view,
+     * only the values that are scaled for the display are held here.
+     */
+    struct DeviceMetrics
+    {
+        DeviceMetrics() = default;
+        
+        DeviceMetrics(float scale) :
+        scale_(scale),
+        standardWidth_(scaledInt(layout::STANDARD_WIDTH, scale)),
+        widthSeparator_(standardWidth_ - scaledInt(layout::WIDTH_SEPARATOR, scale)),
+        fontLabel_((float)scaledInt(layout::FONT_SIZE, scale), Font::bold),
+        fontData_((float)scaledInt(layout::FONT_SIZE, scale), Font::italic),
+        labelHeight_((int)fontLabel_.getHeight()),
+        dataHeight_((int)fontData_.getHeight())
+        {
+        }
+        
+        /** Truncates like sm::scaled does for integers, keeps the values identical to the theme's. */
+        static int scaledInt(int value, float scale)
+        {
+            return static_cast<int>(value * scale);
+        }
+        
+        float scale_ { 0.0f };
+        int standardWidth_ { 0 };
+        int widthSeparator_ { 0 };
+        Font fontLabel_;
+        Font fontData_;
+        int labelHeight_ { 0 };
+        int dataHeight_ { 0 };
+    };
+}
@@ -0,0 +1,294 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "FramePacer.h"
+
+#if JUCE_MAC
+#include <objc/message.h>
+#include <objc/runtime.h>
+#endif
+
+namespace showmidi
+{
+namespace
+{
+    /** Whether the window of a component is entirely covered by other windows, only macOS reports this. */
+    bool isOccluded(Component* component)
+    {
+#if JUCE_MAC
+        // NSWindowOcclusionStateVisible
+        static constexpr unsigned long OCCLUSION_STATE_VISIBLE = 1UL << 1;
+        
+        auto peer = component->getPeer();
+        if (peer == nullptr)
+        {
+            return false;
+        }
+        
+        auto view = (id)peer->getNativeHandle();
+        auto window = ((id (*)(id, SEL))objc_msgSend)(view, sel_registerName("window"));
+        if (window == nullptr)
+        {
+            return false;
+        }
+        
+        auto state = ((unsigned long (*)(id, SEL))objc_msgSend)(window, sel_registerName("occlusionState"));
+        return (state & OCCLUSION_STATE_VISIBLE) == 0;
+#else
+        ignoreUnused(component);
+        return false;
+#endif
+    }
+}
+
+struct FramePacer::Pimpl : public AsyncUpdater, public Timer, public ComponentListener
+{
+    // keep following the vertical blank for a little while after the last change,
+    // this avoids attaching and detaching for every burst of MIDI data
+    static constexpr double IDLE_GRACE_MS = 250.0;
+    // allow for vertical blank jitter when limiting the frame rate
+    static constexpr double FRAME_TOLERANCE_MS = 1.0;
+    // there's no notification when a covered window is uncovered, look again at this interval
+    static constexpr int OCCLUSION_POLL_MS = 250;
+    
+    Pimpl(Component* host, SettingsManager* manager, std::function<int()> render) :
+    host_(host),
+    manager_(manager),
+    render_(std::move(render))
+    {
+        host_->addComponentListener(this);
+        trackTopLevelComponent();
+        
+        wake();
+    }
+    
+    ~Pimpl()
+    {
+        cancelPendingUpdate();
+        stopTimer();
+        vblank_.reset();
+        
+        host_->removeComponentListener(this);
+        if (topLevel_ != nullptr)
+        {
+            topLevel_->removeComponentListener(this);
+        }
+    }
+    
+    void wake()
+    {
+        pending_ = true;
+        if (!running_ && !hidden_)
+        {
+            triggerAsyncUpdate();
+        }
+    }
+    
+    void handleAsyncUpdate() override
+    {
+        startFrames();
+    }
+    
+    void startFrames()
+    {
+        stopTimer();
+        
+        if (!isVisible())
+        {
+            return;
+        }
+        
+        lastActive_ = Time::getMillisecondCounterHiRes();
+        if (vblank_ == nullptr)
+        {
+            vblank_ = std::make_unique<VBlankAttachment>(host_, [this] { verticalBlank(); });
+        }
+        running_ = true;
+    }
+    
+    void verticalBlank()
+    {
+        auto now = Time::getMillisecondCounterHiRes();
+        
+        auto limit = manager_->getSettings().getFrameRateLimit();
+        if (limit > 0 && now - lastFrame_ < 1000.0 / limit - FRAME_TOLERANCE_MS)
+        {
+            return;
+        }
+        lastFrame_ = now;
+        
+        renderFrame(now);
+    }
+    
+    void timerCallback() override
+    {
+        stopTimer();
+        
+        renderFrame(Time::getMillisecondCounterHiRes());
+    }
+    
+    void renderFrame(double now)
+    {
+        if (!isVisible())
+        {
+            return;
+        }
+        
+        auto woken = pending_.exchange(false);
+        auto next_frame = render_();
+        if (woken || next_frame == 0)
+        {
+            lastActive_ = now;
+        }
+        
+        if (now - lastActive_ < IDLE_GRACE_MS)
+        {
+            if (vblank_ == nullptr)
+            {
+                startFrames();
+            }
+            return;
+        }
+        
+        goIdle(false);
+        if (next_frame > 0)
+        {
+            startTimer(next_frame);
+        }
+        
+        // MIDI data that arrived while going idle would otherwise go unnoticed
+        if (pending_)
+        {
+            startFrames();
+        }
+    }
+    
+    /** Goes idle when nothing of the host can be seen, a covered window keeps looking whether it's uncovered. */
+    bool isVisible()
+    {
+        if (!host_->isShowing())
+        {
+            goIdle(true);
+            return false;
+        }
+        
+        if (isOccluded(host_))
+        {
+            goIdle(true);
+            startTimer(OCCLUSION_POLL_MS);
+            return false;
+        }
+        
+        return true;
+    }
+    
+    void goIdle(bool hidden)
+    {
+        vblank_.reset();
+        stopTimer();
+        hidden_ = hidden;
+        running_ = false;
+    }
+    
+    void trackTopLevelComponent()
+    {
+        auto top_level = host_->getTopLevelComponent();
+        if (top_level == topLevel_.getComponent())
+        {
+            return;
+        }
+        
+        if (topLevel_ != nullptr)
+        {
+            topLevel_->removeComponentListener(this);
+        }
+        
+        topLevel_ = top_level;
+        
+        // the host itself is already being listened to
+        if (top_level != host_)
+        {
+            top_level->addComponentListener(this);
+        }
+        else
+        {
+            topLevel_ = nullptr;
+        }
+    }
+    
+    void reveal()
+    {
+        hidden_ = false;
+        wake();
+    }
+    
+    // minimising and restoring a window is reported as a visibility change of the top level component
+    void componentVisibilityChanged(Component&) override
+    {
+        reveal();
+    }
+    
+    void componentParentHierarchyChanged(Component&) override
+    {
+        trackTopLevelComponent();
+        reveal();
+    }
+    
+    void componentBeingDeleted(Component& component) override
+    {
+        if (&component == topLevel_.getComponent())
+        {
+            component.removeComponentListener(this);
+            topLevel_ = nullptr;
+        }
+    }
+    
+    Component* const host_;
+    SettingsManager* const manager_;
+    std::function<int()> render_;
+    
+    Component::SafePointer<Component> topLevel_;
+    std::unique_ptr<VBlankAttachment> vblank_;
+    
+    std::atomic_bool pending_ { false };
+    std::atomic_bool running_ { false };
+    std::atomic_bool hidden_ { false };
+    
+    double lastFrame_ { 0.0 };
+    double lastActive_ { 0.0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+FramePacer::FramePacer(Component* host, SettingsManager* manager, std::function<int()> render) : pimpl_(new Pimpl(host, manager, std::move(render))) {}
+FramePacer::~FramePacer() = default;
+
+void FramePacer::wake() { pimpl_->wake(); }
+
+int FramePacer::earliest(int a, int b)
+{
+    if (a == IDLE)
+    {
+        return b;
+    }
+    if (b == IDLE)
+    {
+        return a;
+    }
+    return std::min(a, b);
+}
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SettingsManager.h"
+
+namespace showmidi
+{
+    /**
+     * Drives the rendering of a component.
+     *
+     * While there's activity, frames follow the display's vertical blank, limited by the
+     * frame rate setting. When activity stops, the pacer falls back to a one-shot timer for
+     * the next scheduled change, or to no timer at all until it's woken up again.
+     * Nothing is rendered while the component isn't showing, for instance when minimised,
+     * or while its window is covered by other windows, which only macOS reports.
+     */
+    class FramePacer
+    {
+    public:
+        /** Returned by the render callback when no frame is needed until the next wake up. */
+        static constexpr int IDLE = -1;
+
+        /**
+         * The render callback returns the number of milliseconds until it needs another frame,
+         * 0 to keep rendering every frame, or IDLE.
+         */
+        FramePacer(Component*, SettingsManager*, std::function<int()>);
+        ~FramePacer();
+
+        /** Requests frames to start again, can be called from any thread. */
+        void wake();
+
+        /** Combines the results of several render callbacks. */
+        static int earliest(int, int);
+
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FramePacer)
+    };
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "LatencyComponent.h"
+
+#include "DpiScaling.h"
+#include "LatencyProbe.h"
+#include "LayoutConstants.h"
+#include "MidiDeviceState.h"
+
+namespace showmidi
+{
+struct LatencyComponent::Pimpl : public Timer
+{
+    static constexpr int REFRESH_HZ = 10;
+    
+    Pimpl(LatencyComponent* owner, SettingsManager* manager, MidiDeviceState& state, const MidiDeviceInfo& output) :
+    owner_(owner),
+    manager_(manager),
+    state_(state),
+    probe_(output)
+    {
+        state_.setLatencyProbe(&probe_);
+        startTimerHz(REFRESH_HZ);
+    }
+    
+    ~Pimpl()
+    {
+        stopTimer();
+        // the input callback mustn't see the probe anymore once it's destroyed
+        state_.setLatencyProbe(nullptr);
+    }
+    
+    void timerCallback() override
+    {
+        statistics_ = probe_.getStatistics();
+        owner_->repaint();
+    }
+    
+    void reset()
+    {
+        probe_.reset();
+        timerCallback();
+    }
+    
+    void paint(Graphics& g)
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        
+        g.fillAll(theme.colorBackground);
+        
+        auto margin = sm::scaled(layout::LATENCY_MARGIN, *owner_);
+        auto x = margin;
+        auto y = margin;
+        auto width = owner_->getWidth() - 2 * margin;
+        auto label_height = theme.labelHeight();
+        
+        // status
+        String status;
+        if (!probe_.isSending())
+        {
+            status = "FAILED TO OPEN " + probe_.getOutputInfo().name;
+        }
+        else
+        {
+            status = "VIA " + probe_.getOutputInfo().name + ", " + String(statistics_.received_) + " OF " + String(statistics_.sent_) + " RECEIVED";
+        }
+        g.setFont(theme.fontLabel());
+        g.setColour(theme.colorLabel);
+        g.drawText(status, x, y, width, label_height, Justification::centredLeft);
+        y += label_height + margin;
+        
+        // statistics
+        y = paintValue(g, "MIN", statistics_.minimumMs_, x, y, width);
+        y = paintValue(g, "MEAN", statistics_.meanMs_, x, y, width);
+        y = paintValue(g, "P99", statistics_.p99Ms_, x, y, width);
+        y = paintValue(g, "MAX", statistics_.maximumMs_, x, y, width);
+        y = paintValue(g, "JITTER", statistics_.jitterMs_, x, y, width);
+        y += margin;
+        
+        // histogram
+        auto histogram_height = owner_->getHeight() - y - label_height - margin;
+        if (histogram_height > 0)
+        {
+            paintHistogram(g, { x, y, width, histogram_height });
+        }
+    }
+    
+    int paintValue(Graphics& g, const String& label, double valueMs, int x, int y, int width)
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        auto x_value = sm::scaled(layout::LATENCY_X_VALUE, *owner_);
+        auto height = theme.dataHeight();
+        
+        g.setFont(theme.fontLabel());
+        g.setColour(theme.colorLabel);
+        g.drawText(label, x, y, x_value, height, Justification::centredLeft);
+        
+        g.setFont(theme.fontData());
+        g.setColour(theme.colorData);
+        g.drawText(statistics_.received_ > 0 ? String(valueMs, 3) + " ms" : String("-"), x + x_value, y, width - x_value, height, Justification::centredLeft);
+        
+        return y + height;
+    }
+    
+    void paintHistogram(Graphics& g, Rectangle<int> area)
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        
+        auto peak = 0;
+        for (auto count : statistics_.histogram_)
+        {
+            peak = std::max(peak, count);
+        }
+        
+        auto bar_width = (float)area.getWidth() / LatencyProbe::HISTOGRAM_BINS;
+        for (auto i = 0; i < LatencyProbe::HISTOGRAM_BINS; ++i)
+        {
+            auto bar_x = (float)area.getX() + i * bar_width;
+            g.setColour(theme.colorTrack);
+            g.fillRect(bar_x, (float)area.getY(), bar_width - 1.0f, (float)area.getHeight());
+            
+            if (peak > 0 && statistics_.histogram_[i] > 0)
+            {
+                // at least a pixel, a single late probe shouldn't disappear
+                auto bar_height = std::max(1.0f, area.getHeight() * (float)statistics_.histogram_[i] / peak);
+                g.setColour(i == LatencyProbe::HISTOGRAM_BINS - 1 ? theme.colorNegative : theme.colorPositive);
+                g.fillRect(bar_x, area.getBottom() - bar_height, bar_width - 1.0f, bar_height);
+            }
+        }
+        
+        // the scale, the last bin holds everything beyond its start
+        auto label_height = theme.labelHeight();
+        auto label_y = area.getBottom();
+        g.setFont(theme.fontLabel());
+        g.setColour(theme.colorLabel);
+        g.drawText("0 ms", area.getX(), label_y, area.getWidth() / 2, label_height, Justification::centredLeft);
+        g.drawText("> " + String((LatencyProbe::HISTOGRAM_BINS - 1) * LatencyProbe::HISTOGRAM_BIN_MS, 2) + " ms",
+                   area.getCentreX(), label_y, area.getWidth() / 2, label_height, Justification::centredRight);
+    }
+    
+    LatencyComponent* const owner_;
+    SettingsManager* const manager_;
+    MidiDeviceState& state_;
+    LatencyProbe probe_;
+    LatencyProbe::Statistics statistics_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+LatencyComponent::LatencyComponent(SettingsManager* m, MidiDeviceState& s, const MidiDeviceInfo& o) : pimpl_(new Pimpl(this, m, s, o)) {}
+LatencyComponent::~LatencyComponent() = default;
+
+void LatencyComponent::paint(Graphics& g)                       { pimpl_->paint(g); }
+void LatencyComponent::mouseDoubleClick(const MouseEvent&)      { pimpl_->reset(); }
+
+LatencyWindow::LatencyWindow(SettingsManager* manager, MidiDeviceState& state, const MidiDeviceInfo& output, Component* deviceView, std::function<void()> onClose) :
+    DocumentWindow(state.getDeviceInfo().name + " - Latency", manager->getSettings().getTheme().colorBackground, DocumentWindow::closeButton),
+    onClose_(std::move(onClose))
+{
+    setUsingNativeTitleBar(true);
+    setContentOwned(new LatencyComponent(manager, state, output), false);
+    setResizable(true, false);
+    
+    auto width = sm::scaled(layout::LATENCY_WIDTH);
+    auto height = sm::scaled(layout::LATENCY_HEIGHT);
+    if (deviceView != nullptr && deviceView->isShowing())
+    {
+        auto view = deviceView->getScreenBounds();
+        setBoundsConstrained({ view.getRight() + sm::scaled(layout::MIDI_DEVICE_SPACING), view.getY(), width, height });
+    }
+    else
+    {
+        centreWithSize(width, height);
+    }
+    setVisible(true);
+}
+
+LatencyWindow::~LatencyWindow() = default;
+
+void LatencyWindow::closeButtonPressed()
+{
+    // the callback deletes this window, keep it alive until it returns
+    auto on_close = onClose_;
+    on_close();
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SettingsManager.h"
+
+namespace showmidi
+{
+    class MidiDeviceState;
+    
+    /**
+     * Measures the round trip latency from an output back to the input of a device.
+     *
+     * The component owns the probe and attaches it to the device state for as long as it
+     * exists, the statistics and the histogram of the latencies are refreshed a few times
+     * per second. Double-clicking starts the measurement over.
+     */
+    class LatencyComponent : public Component
+    {
+    public:
+        LatencyComponent(SettingsManager*, MidiDeviceState&, const MidiDeviceInfo& output);
+        ~LatencyComponent() override;
+        
+        void paint(Graphics&) override;
+        void mouseDoubleClick(const MouseEvent&) override;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyComponent)
+    };
+    
+    /** A window with the latency measurement of a device, placed next to its view. */
+    class LatencyWindow : public DocumentWindow
+    {
+    public:
+        /** The close callback is responsible for deleting the window. */
+        LatencyWindow(SettingsManager*, MidiDeviceState&, const MidiDeviceInfo& output, Component* deviceView, std::function<void()>);
+        ~LatencyWindow() override;
+        
+        void closeButtonPressed() override;
+        
+    private:
+        std::function<void()> onClose_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyWindow)
+    };
+}
@@ -0,0 +1,164 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "LatencyProbe.h"
+
+namespace showmidi
+{
+struct LatencyProbe::Pimpl : public Thread
+{
+    static constexpr int PROBE_INTERVAL_MS = 10;
+    // probes that don't return within this many sequence numbers are considered lost
+    static constexpr int SEQUENCE_WINDOW = 1024;
+    static constexpr int MAX_SAMPLES = 8192;
+    
+    // a sysex with the non-commercial manufacturer ID, followed by "SM" and a 21-bit sequence number
+    static constexpr uint8 PROBE_HEADER[] = { 0xf0, 0x7d, 'S', 'M' };
+    static constexpr int PROBE_SIZE = 8;
+    
+    Pimpl(const MidiDeviceInfo& output) :
+    Thread("MIDI latency probe"),
+    outputInfo_(output)
+    {
+        startThread(Thread::Priority::high);
+    }
+    
+    ~Pimpl()
+    {
+        stopThread(PROBE_INTERVAL_MS * 50);
+    }
+    
+    void run() override
+    {
+        // opening the output can take a while, it's done here rather than on the message thread
+        auto output = MidiOutput::openDevice(outputInfo_.identifier);
+        if (output == nullptr)
+        {
+            sending_ = false;
+            return;
+        }
+        
+        while (!threadShouldExit())
+        {
+            auto sequence = nextSequence_++ & 0x1fffff;
+            const uint8 probe[PROBE_SIZE] = {
+                PROBE_HEADER[0], PROBE_HEADER[1], PROBE_HEADER[2], PROBE_HEADER[3],
+                (uint8)((sequence >> 14) & 0x7f), (uint8)((sequence >> 7) & 0x7f), (uint8)(sequence & 0x7f),
+                0xf7 };
+            
+            sentTicks_[sequence % SEQUENCE_WINDOW] = Time::getHighResolutionTicks();
+            output->sendMessageNow(MidiMessage(probe, PROBE_SIZE));
+            ++sent_;
+            
+            wait(PROBE_INTERVAL_MS);
+        }
+    }
+    
+    bool handleIncomingMidiMessage(const MidiMessage& msg, int64 ticks)
+    {
+        auto data = msg.getRawData();
+        if (msg.getRawDataSize() != PROBE_SIZE || memcmp(data, PROBE_HEADER, sizeof(PROBE_HEADER)) != 0)
+        {
+            return false;
+        }
+        
+        auto sequence = (data[4] << 14) | (data[5] << 7) | data[6];
+        auto latest = (nextSequence_.load() - 1) & 0x1fffff;
+        if (((latest - sequence) & 0x1fffff) >= SEQUENCE_WINDOW)
+        {
+            // too late, the slot was reused by a newer probe
+            return true;
+        }
+        
+        auto latency_ms = Time::highResolutionTicksToSeconds(ticks - sentTicks_[sequence % SEQUENCE_WINDOW].load()) * 1000.0;
+        
+        const SpinLock::ScopedLockType lock(samplesLock_);
+        samples_[received_ % MAX_SAMPLES] = latency_ms;
+        ++received_;
+        histogram_[jlimit(0, HISTOGRAM_BINS - 1, (int)(latency_ms / HISTOGRAM_BIN_MS))]++;
+        return true;
+    }
+    
+    /** The statistics are computed over the most recent samples, the histogram over all of them. */
+    Statistics getStatistics()
+    {
+        Statistics statistics;
+        std::vector<double> samples;
+        {
+            const SpinLock::ScopedLockType lock(samplesLock_);
+            statistics.sent_ = sent_;
+            statistics.received_ = received_;
+            std::copy(std::begin(histogram_), std::end(histogram_), std::begin(statistics.histogram_));
+            samples.assign(samples_, samples_ + std::min(received_, MAX_SAMPLES));
+        }
+        
+        if (samples.empty())
+        {
+            return statistics;
+        }
+        
+        std::sort(samples.begin(), samples.end());
+        auto count = (double)samples.size();
+        auto sum = std::accumulate(samples.begin(), samples.end(), 0.0);
+        statistics.meanMs_ = sum / count;
+        
+        auto squares = 0.0;
+        for (auto sample : samples)
+        {
+            squares += (sample - statistics.meanMs_) * (sample - statistics.meanMs_);
+        }
+        statistics.jitterMs_ = std::sqrt(squares / count);
+        
+        statistics.minimumMs_ = samples.front();
+        statistics.maximumMs_ = samples.back();
+        statistics.p99Ms_ = samples[(size_t)(0.99 * (count - 1))];
+        
+        return statistics;
+    }
+    
+    void reset()
+    {
+        const SpinLock::ScopedLockType lock(samplesLock_);
+        sent_ = 0;
+        received_ = 0;
+        std::fill(std::begin(histogram_), std::end(histogram_), 0);
+    }
+    
+    const MidiDeviceInfo outputInfo_;
+    std::atomic_bool sending_ { true };
+    
+    std::atomic<int> nextSequence_ { 0 };
+    std::atomic<int64> sentTicks_[SEQUENCE_WINDOW] {};
+    std::atomic<int> sent_ { 0 };
+    
+    SpinLock samplesLock_;
+    double samples_[MAX_SAMPLES] {};
+    int received_ { 0 };
+    int histogram_[HISTOGRAM_BINS] {};
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+LatencyProbe::LatencyProbe(const MidiDeviceInfo& o) : pimpl_(new Pimpl(o)) {}
+LatencyProbe::~LatencyProbe() = default;
+
+const MidiDeviceInfo& LatencyProbe::getOutputInfo() const                       { return pimpl_->outputInfo_; }
+bool LatencyProbe::isSending() const                                            { return pimpl_->sending_; }
+bool LatencyProbe::handleIncomingMidiMessage(const MidiMessage& m, int64 t)     { return pimpl_->handleIncomingMidiMessage(m, t); }
+LatencyProbe::Statistics LatencyProbe::getStatistics()                          { return pimpl_->getStatistics(); }
+void LatencyProbe::reset()                                                      { pimpl_->reset(); }
+}
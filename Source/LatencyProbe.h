@@ -0,0 +1,71 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Measures the round trip from an output back to an input.
+     *
+     * Probes are small sysex messages with a sequence number, sent at a steady rate on a
+     * thread of their own. The input they come back on hands them to the probe with the
+     * high resolution time they arrived, which is matched with the time they were sent.
+     */
+    class LatencyProbe
+    {
+    public:
+        static constexpr int HISTOGRAM_BINS = 40;
+        static constexpr double HISTOGRAM_BIN_MS = 0.25;
+        
+        struct Statistics
+        {
+            int sent_ { 0 };
+            int received_ { 0 };
+            double minimumMs_ { 0.0 };
+            double meanMs_ { 0.0 };
+            double p99Ms_ { 0.0 };
+            double maximumMs_ { 0.0 };
+            /** The standard deviation of the latency. */
+            double jitterMs_ { 0.0 };
+            /** The number of probes per bin of HISTOGRAM_BIN_MS, the last bin counts everything beyond. */
+            int histogram_[HISTOGRAM_BINS] {};
+        };
+        
+        /** Starts sending probes to the output right away. */
+        LatencyProbe(const MidiDeviceInfo& output);
+        ~LatencyProbe();
+        
+        const MidiDeviceInfo& getOutputInfo() const;
+        /** False when the output couldn't be opened. */
+        bool isSending() const;
+        
+        /** Called from the input callback, returns true when the message was a probe and should be ignored otherwise. */
+        bool handleIncomingMidiMessage(const MidiMessage&, int64 highResolutionTicks);
+        
+        Statistics getStatistics();
+        void reset();
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyProbe)
+    };
+}
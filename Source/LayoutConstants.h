@@ -155,6 +155,53 @@ namespace showmidi::layout
     /** Spacing between MIDI device components. */
     static constexpr int MIDI_DEVICE_SPACING = 2;
 
+    // =================================================================
+    // MESSAGE LOG WINDOW
+    // =================================================================
+    
+    /** Default size of a message log window. */
+    static constexpr int MESSAGE_LOG_WIDTH = 420;
+    static constexpr int MESSAGE_LOG_HEIGHT = 600;
+    
+    /** Margin around the search field and the rows. */
+    static constexpr int MESSAGE_LOG_MARGIN = 12;
+    
+    /** Horizontal positions of the columns of a row. */
+    static constexpr int MESSAGE_LOG_X_CHANNEL = 84;
+    static constexpr int MESSAGE_LOG_X_TYPE = 124;
+    static constexpr int MESSAGE_LOG_X_DATA = 204;
+
+    // =================================================================
+    // LATENCY WINDOW
+    // =================================================================
+    
+    /** Default size of a latency window. */
+    static constexpr int LATENCY_WIDTH = 320;
+    static constexpr int LATENCY_HEIGHT = 360;
+    
+    /** Margin around the statistics and the histogram. */
+    static constexpr int LATENCY_MARGIN = 12;
+    
+    /** Horizontal position of the statistic values. */
+    static constexpr int LATENCY_X_VALUE = 84;
+
+    // =================================================================
+    // SCRUB BAR
+    // =================================================================
+    
+    /** Height of the scrub bar below the paused devices. */
+    static constexpr int SCRUB_BAR_HEIGHT = 24;
+    
+    /** Margin around the time and the track. */
+    static constexpr int SCRUB_BAR_MARGIN = 8;
+    
+    /** Horizontal position of the track, the time is shown before it. */
+    static constexpr int SCRUB_BAR_X_TRACK = 64;
+    
+    /** Thickness of the track and width of the playhead. */
+    static constexpr int SCRUB_BAR_TRACK_HEIGHT = 4;
+    static constexpr int SCRUB_BAR_PLAYHEAD_WIDTH = 2;
+
     // =================================================================
     // POPUP WINDOWS
     // =================================================================
@@ -316,6 +363,15 @@ namespace showmidi::layout
     /** Horizontal position for note data display. */
     static constexpr int X_NOTE_DATA = X_MID - 6;
 
+    /** Height of the piano roll that replaces the note list. */
+    static constexpr int PIANO_ROLL_HEIGHT = 96;
+
+    /** Height of each octave row of the key heatmap. */
+    static constexpr int KEY_HEATMAP_ROW_HEIGHT = 6;
+
+    /** Height of the velocity histogram below the key heatmap. */
+    static constexpr int VELOCITY_HISTOGRAM_HEIGHT = 24;
+
     // =================================================================
     // POLYPHONIC PRESSURE DISPLAY
     // =================================================================
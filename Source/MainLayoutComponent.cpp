@@ -18,6 +18,7 @@
 #include "MainLayoutComponent.h"
 
 #include "MidiDeviceComponent.h"
+#include "ScrubBarComponent.h"
 #include "SidebarComponent.h"
 #include "ShowMidiApplication.h"
 #include "LayoutConstants.h"
@@ -25,10 +26,14 @@
 
 namespace showmidi
 {
-struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener
+struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener, public DeviceListener
 {
     static constexpr int DEFAULT_WINDOW_HEIGHT = layout::DEFAULT_WINDOW_HEIGHT;
     
+    // the arrow keys scrub through a paused timeline a second at a time, or a frame of the graphs with shift
+    static constexpr int64 SCRUB_STEP_MS = 1000;
+    static constexpr int64 SCRUB_FINE_STEP_MS = 50;
+    
     Pimpl(MainLayoutComponent* owner, SettingsManager* settings, DeviceManager* deviceManager, MainLayoutType type, Component* content) :
     owner_(owner),
     settingsManager_(settings),
@@ -58,13 +63,29 @@ struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener
         viewport_->setViewedComponent(content, false);
         viewport_->setBounds(sidebar_->getWidth(), 0, default_width, sm::scaled(showmidi::layout::DEFAULT_WINDOW_HEIGHT, *owner_));
         owner_->addAndMakeVisible(viewport_.get());
+        
+        scrubBar_ = std::make_unique<ScrubBarComponent>(settingsManager_, deviceManager_);
+        owner_->addChildComponent(scrubBar_.get());
+        deviceManager_->getDeviceListeners().add(this);
     }
     
     ~Pimpl()
     {
+        deviceManager_->getDeviceListeners().remove(this);
         owner_->removeKeyListener(this);
     }
     
+    void pauseChanged(bool paused) override
+    {
+        if (paused)
+        {
+            scrubBar_->reset();
+        }
+        // the plugin doesn't keep a timeline to scrub through
+        scrubBar_->setVisible(paused && deviceManager_->getScrubLength() > 0);
+        resized();
+    }
+    
     bool keyPressed(const KeyPress& key, Component*) override
     {
         if (key.getKeyCode() == KeyPress::spaceKey)
@@ -77,6 +98,12 @@ struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener
             deviceManager_->resetChannelData();
             return true;
         }
+        else if (scrubBar_->isVisible() && (key.getKeyCode() == KeyPress::leftKey || key.getKeyCode() == KeyPress::rightKey))
+        {
+            auto step = key.getModifiers().isShiftDown() ? SCRUB_FINE_STEP_MS : SCRUB_STEP_MS;
+            scrubBar_->step(key.getKeyCode() == KeyPress::leftKey ? -step : step);
+            return true;
+        }
         else if (key.getModifiers().isCommandDown() && key.getKeyCode() == 'w')
         {
             JUCEApplication::getInstance()->systemRequestedQuit();
@@ -129,7 +156,10 @@ struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener
     void resized()
     {
         sidebar_->setBounds(0, 0, getSidebarWidth(), owner_->getHeight());
-        viewport_->setBounds(getSidebarWidth(), 0, owner_->getWidth() - getSidebarWidth(), owner_->getHeight());
+        
+        auto scrub_height = scrubBar_->isVisible() ? sm::scaled(showmidi::layout::SCRUB_BAR_HEIGHT, *owner_) : 0;
+        viewport_->setBounds(getSidebarWidth(), 0, owner_->getWidth() - getSidebarWidth(), owner_->getHeight() - scrub_height);
+        scrubBar_->setBounds(getSidebarWidth(), viewport_->getBottom(), viewport_->getWidth(), scrub_height);
     }
     
     int getSidebarWidth()
@@ -154,6 +184,7 @@ struct MainLayoutComponent::Pimpl : public SidebarListener, public KeyListener
     
     std::unique_ptr<SidebarComponent> sidebar_;
     std::unique_ptr<Viewport> viewport_;
+    std::unique_ptr<ScrubBarComponent> scrubBar_;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
 };
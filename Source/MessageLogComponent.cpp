@@ -0,0 +1,455 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MessageLogComponent.h"
+
+#include "DpiScaling.h"
+#include "LayoutConstants.h"
+#include "MidiDeviceState.h"
+#include "MidiEventLog.h"
+#include "ValueFormatter.h"
+
+namespace showmidi
+{
+struct MessageLogComponent::Pimpl : public Timer, public ScrollBar::Listener, public TextEditor::Listener
+{
+    static constexpr int REFRESH_HZ = 30;
+    // time spent searching per refresh, the rest of the frame is left to the interface
+    static constexpr double SEARCH_BUDGET_MS = 8.0;
+    static constexpr int SEARCH_CHUNK = 1024;
+    
+    /** The formatted columns of a row. */
+    struct RowText
+    {
+        String time_;
+        String channel_;
+        String type_;
+        String data_;
+        
+        String toString() const
+        {
+            return time_ + " " + channel_ + " " + type_ + " " + data_;
+        }
+    };
+    
+    Pimpl(MessageLogComponent* owner, SettingsManager* manager, MidiDeviceState& state) :
+    owner_(owner),
+    manager_(manager),
+    log_(state.getEventLog())
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        
+        searchField_.setTextToShowWhenEmpty("search", theme.colorLabel);
+        searchField_.setFont(theme.fontLabel());
+        searchField_.setColour(TextEditor::backgroundColourId, theme.colorTrack);
+        searchField_.setColour(TextEditor::textColourId, theme.colorData);
+        searchField_.addListener(this);
+        owner_->addAndMakeVisible(searchField_);
+        
+        scrollBar_.setAutoHide(false);
+        scrollBar_.addListener(this);
+        owner_->addAndMakeVisible(scrollBar_);
+        
+        searchBuffer_.resize(SEARCH_CHUNK);
+        
+        refresh();
+        startTimerHz(REFRESH_HZ);
+    }
+    
+    ~Pimpl()
+    {
+        stopTimer();
+        scrollBar_.removeListener(this);
+        searchField_.removeListener(this);
+    }
+    
+    bool isFiltered() const
+    {
+        return filter_.isNotEmpty();
+    }
+    
+    uint64 getNumRows() const
+    {
+        return isFiltered() ? (uint64)matches_.size() : end_ - begin_;
+    }
+    
+    uint64 getSequence(uint64 row) const
+    {
+        return isFiltered() ? matches_[(size_t)row] : begin_ + row;
+    }
+    
+    /** The first row at or after a sequence number. */
+    uint64 getRow(uint64 sequence) const
+    {
+        if (isFiltered())
+        {
+            return (uint64)(std::lower_bound(matches_.begin(), matches_.end(), sequence) - matches_.begin());
+        }
+        return sequence < begin_ ? 0 : sequence - begin_;
+    }
+    
+    int getRowHeight() const
+    {
+        return manager_->getSettings().getTheme().labelHeight();
+    }
+    
+    uint64 getNumVisibleRows() const
+    {
+        return (uint64)std::max(1, rowsArea_.getHeight() / getRowHeight());
+    }
+    
+    uint64 getTopRow() const
+    {
+        auto rows = getNumRows();
+        auto visible = getNumVisibleRows();
+        if (following_)
+        {
+            return rows > visible ? rows - visible : 0;
+        }
+        return std::min(getRow(topSequence_), rows > 0 ? rows - 1 : 0);
+    }
+    
+    void timerCallback() override
+    {
+        refresh();
+    }
+    
+    /** Picks up the events that arrived or were overwritten since the last refresh. */
+    void refresh()
+    {
+        auto begin = log_.getBegin();
+        auto end = log_.getEnd();
+        auto changed = begin != begin_ || end != end_;
+        begin_ = begin;
+        end_ = end;
+        
+        if (isFiltered())
+        {
+            while (!matches_.empty() && matches_.front() < begin_)
+            {
+                matches_.pop_front();
+            }
+            
+            auto searching = scanned_ < end_;
+            changed = search() || changed || searching;
+        }
+        
+        if (changed)
+        {
+            updateScrollBar();
+        }
+    }
+    
+    /** Scans the next slice of the log for the filter, returns true when rows were added. */
+    bool search()
+    {
+        auto matched = false;
+        auto started = Time::getMillisecondCounterHiRes();
+        auto formatter = ValueFormatter::fromSettings(manager_->getSettings());
+        
+        scanned_ = std::max(scanned_, begin_);
+        while (scanned_ < end_ && Time::getMillisecondCounterHiRes() - started < SEARCH_BUDGET_MS)
+        {
+            auto first = scanned_;
+            auto count = log_.read(first, searchBuffer_.data(), SEARCH_CHUNK);
+            if (count == 0)
+            {
+                break;
+            }
+            
+            for (auto i = 0; i < count; ++i)
+            {
+                if (format(formatter, searchBuffer_[(size_t)i]).toString().containsIgnoreCase(filter_))
+                {
+                    matches_.push_back(first + (uint64)i);
+                    matched = true;
+                }
+            }
+            scanned_ = first + (uint64)count;
+        }
+        
+        return matched;
+    }
+    
+    void updateScrollBar()
+    {
+        auto rows = getNumRows();
+        scrollBar_.setRangeLimits(0.0, (double)rows, dontSendNotification);
+        scrollBar_.setCurrentRange((double)getTopRow(), (double)getNumVisibleRows(), dontSendNotification);
+        owner_->repaint();
+    }
+    
+    void scrollBarMoved(ScrollBar*, double newRangeStart) override
+    {
+        auto rows = getNumRows();
+        auto top = (uint64)std::max(0.0, newRangeStart);
+        
+        // scrolling to the end follows the new events again
+        following_ = top + getNumVisibleRows() >= rows;
+        topSequence_ = rows > 0 ? getSequence(std::min(top, rows - 1)) : end_;
+        
+        owner_->repaint();
+    }
+    
+    void textEditorTextChanged(TextEditor&) override
+    {
+        filter_ = searchField_.getText().trim();
+        matches_.clear();
+        scanned_ = begin_;
+        following_ = true;
+        
+        search();
+        updateScrollBar();
+    }
+    
+    void textEditorEscapeKeyPressed(TextEditor&) override
+    {
+        searchField_.clear();
+    }
+    
+    void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel)
+    {
+        scrollBar_.mouseWheelMove(event, wheel);
+    }
+    
+    void resized()
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        
+        auto margin = sm::scaled(layout::MESSAGE_LOG_MARGIN, *owner_);
+        auto thickness = sm::scaled(layout::SCROLLBAR_THICKNESS, *owner_);
+        auto width = owner_->getWidth();
+        auto height = owner_->getHeight();
+        
+        searchField_.setBounds(margin, margin, width - 2 * margin, theme.lineHeight());
+        statusY_ = searchField_.getBottom() + margin / 2;
+        
+        auto rows_y = statusY_ + theme.labelHeight() + margin / 2;
+        scrollBar_.setBounds(width - thickness, rows_y, thickness, height - rows_y);
+        rowsArea_ = { margin, rows_y, width - thickness - 2 * margin, height - rows_y };
+        
+        updateScrollBar();
+    }
+    
+    void paint(Graphics& g)
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        
+        g.fillAll(theme.colorBackground);
+        g.setFont(theme.fontLabel());
+        
+        auto rows = getNumRows();
+        
+        // status
+        String status;
+        if (isFiltered())
+        {
+            status = String(rows) + " of " + String(end_ - begin_) + " events";
+            if (scanned_ < end_ && end_ > begin_)
+            {
+                status += ", searching " + String((int)(100 * (scanned_ - begin_) / (end_ - begin_))) + "%";
+            }
+        }
+        else
+        {
+            status = String(rows) + " events";
+        }
+        g.setColour(theme.colorLabel);
+        g.drawText(status, rowsArea_.getX(), statusY_, rowsArea_.getWidth(), theme.labelHeight(), Justification::centredLeft);
+        
+        // only the rows in view are read and formatted
+        auto row_height = getRowHeight();
+        auto top = getTopRow();
+        auto visible = getNumVisibleRows();
+        auto formatter = ValueFormatter::fromSettings(manager_->getSettings());
+        
+        g.saveState();
+        g.reduceClipRegion(rowsArea_);
+        for (uint64 i = 0; i < visible && top + i < rows; ++i)
+        {
+            auto sequence = getSequence(top + i);
+            auto first = sequence;
+            LoggedEvent event;
+            if (log_.read(first, &event, 1) == 1 && first == sequence)
+            {
+                paintRow(g, format(formatter, event), rowsArea_.getY() + (int)i * row_height);
+            }
+        }
+        g.restoreState();
+    }
+    
+    void paintRow(Graphics& g, const RowText& row, int y)
+    {
+        auto& theme = manager_->getSettings().getTheme();
+        auto x = rowsArea_.getX();
+        auto x_channel = x + sm::scaled(layout::MESSAGE_LOG_X_CHANNEL, *owner_);
+        auto x_type = x + sm::scaled(layout::MESSAGE_LOG_X_TYPE, *owner_);
+        auto x_data = x + sm::scaled(layout::MESSAGE_LOG_X_DATA, *owner_);
+        auto height = getRowHeight();
+        
+        g.setColour(theme.colorLabel);
+        g.drawText(row.time_, x, y, x_channel - x, height, Justification::centredLeft);
+        g.drawText(row.channel_, x_channel, y, x_type - x_channel, height, Justification::centredLeft);
+        g.setColour(theme.colorData);
+        g.drawText(row.type_, x_type, y, x_data - x_type, height, Justification::centredLeft);
+        g.drawText(row.data_, x_data, y, rowsArea_.getRight() - x_data, height, Justification::centredLeft);
+    }
+    
+    RowText format(const ValueFormatter& formatter, const LoggedEvent& event)
+    {
+        RowText row;
+        row.time_ = Time(event.time_).formatted("%H:%M:%S.") + String(event.time_ % 1000).paddedLeft('0', 3);
+        
+        if (event.isSysEx())
+        {
+            row.type_ = "SYSEX";
+            row.data_ = ValueFormatter::output7BitAsHex(event.data_[1]) + " " + ValueFormatter::output7BitAsHex(event.data_[2]) + " (" + String(event.length_) + " bytes)";
+            return row;
+        }
+        
+        auto msg = event.toMidiMessage();
+        if (msg.getChannel() != 0)
+        {
+            row.channel_ = "CH " + String(msg.getChannel());
+        }
+        
+        if (msg.isNoteOn())
+        {
+            row.type_ = "NOTE ON";
+            row.data_ = formatter.outputNote(msg.getNoteNumber()) + " " + formatter.output7Bit(msg.getVelocity());
+        }
+        else if (msg.isNoteOff())
+        {
+            row.type_ = "NOTE OFF";
+            row.data_ = formatter.outputNote(msg.getNoteNumber()) + " " + formatter.output7Bit(msg.getVelocity());
+        }
+        else if (msg.isAftertouch())
+        {
+            row.type_ = "PP";
+            row.data_ = formatter.outputNote(msg.getNoteNumber()) + " " + formatter.output7Bit(msg.getAfterTouchValue());
+        }
+        else if (msg.isController())
+        {
+            row.type_ = "CC " + formatter.output7Bit(msg.getControllerNumber());
+            row.data_ = formatter.output7Bit(msg.getControllerValue());
+        }
+        else if (msg.isProgramChange())
+        {
+            row.type_ = "PRGM";
+            row.data_ = formatter.output7Bit(msg.getProgramChangeNumber());
+        }
+        else if (msg.isChannelPressure())
+        {
+            row.type_ = "CP";
+            row.data_ = formatter.output7Bit(msg.getChannelPressureValue());
+        }
+        else if (msg.isPitchWheel())
+        {
+            row.type_ = "PB";
+            row.data_ = formatter.output14Bit(msg.getPitchWheelValue());
+        }
+        else if (msg.isMidiClock())
+        {
+            row.type_ = "CLOCK";
+        }
+        else if (msg.isMidiStart())
+        {
+            row.type_ = "START";
+        }
+        else if (msg.isMidiContinue())
+        {
+            row.type_ = "CONTINUE";
+        }
+        else if (msg.isMidiStop())
+        {
+            row.type_ = "STOP";
+        }
+        else if (msg.isActiveSense())
+        {
+            row.type_ = "SENSING";
+        }
+        else if (msg.isSongPositionPointer())
+        {
+            row.type_ = "SPP";
+            row.data_ = formatter.output14Bit(msg.getSongPositionPointerMidiBeat());
+        }
+        else if (msg.isQuarterFrame())
+        {
+            row.type_ = "MTC";
+            row.data_ = formatter.output7Bit(msg.getQuarterFrameSequenceNumber()) + " " + formatter.output7Bit(msg.getQuarterFrameValue());
+        }
+        else
+        {
+            for (auto i = 0; i < event.size_; ++i)
+            {
+                row.data_ += ValueFormatter::output7BitAsHex(event.data_[i]) + " ";
+            }
+            row.data_ = row.data_.trimEnd();
+        }
+        
+        return row;
+    }
+    
+    MessageLogComponent* const owner_;
+    SettingsManager* const manager_;
+    MidiEventLog& log_;
+    
+    TextEditor searchField_;
+    ScrollBar scrollBar_ { true };
+    Rectangle<int> rowsArea_;
+    int statusY_ { 0 };
+    
+    uint64 begin_ { 0 };
+    uint64 end_ { 0 };
+    bool following_ { true };
+    uint64 topSequence_ { 0 };
+    
+    String filter_;
+    std::deque<uint64> matches_;
+    uint64 scanned_ { 0 };
+    std::vector<LoggedEvent> searchBuffer_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MessageLogComponent::MessageLogComponent(SettingsManager* m, MidiDeviceState& s) : pimpl_(new Pimpl(this, m, s)) {}
+MessageLogComponent::~MessageLogComponent() = default;
+
+void MessageLogComponent::paint(Graphics& g)                                                { pimpl_->paint(g); }
+void MessageLogComponent::resized()                                                         { pimpl_->resized(); }
+void MessageLogComponent::mouseWheelMove(const MouseEvent& e, const MouseWheelDetails& w)   { pimpl_->mouseWheelMove(e, w); }
+
+MessageLogWindow::MessageLogWindow(SettingsManager* manager, MidiDeviceState& state, std::function<void()> onClose) :
+    DocumentWindow(state.getDeviceInfo().name + " - Messages", manager->getSettings().getTheme().colorBackground, DocumentWindow::closeButton),
+    onClose_(std::move(onClose))
+{
+    setUsingNativeTitleBar(true);
+    setContentOwned(new MessageLogComponent(manager, state), false);
+    setResizable(true, false);
+    centreWithSize(sm::scaled(layout::MESSAGE_LOG_WIDTH), sm::scaled(layout::MESSAGE_LOG_HEIGHT));
+    setVisible(true);
+}
+
+MessageLogWindow::~MessageLogWindow() = default;
+
+void MessageLogWindow::closeButtonPressed()
+{
+    // the callback deletes this window, keep it alive until it returns
+    auto on_close = onClose_;
+    on_close();
+}
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SettingsManager.h"
+
+namespace showmidi
+{
+    class MidiDeviceState;
+    
+    /**
+     * A scrolling chronological list of the messages in the event log of a device.
+     *
+     * Only the rows in view are read from the log and formatted. The search field filters
+     * the rows on their formatted text, the log is searched a slice at a time so that the
+     * view stays responsive with millions of buffered events.
+     */
+    class MessageLogComponent : public Component
+    {
+    public:
+        MessageLogComponent(SettingsManager*, MidiDeviceState&);
+        ~MessageLogComponent() override;
+        
+        void paint(Graphics&) override;
+        void resized() override;
+        void mouseWheelMove(const MouseEvent&, const MouseWheelDetails&) override;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageLogComponent)
+    };
+    
+    /** A window with the message log of a device. */
+    class MessageLogWindow : public DocumentWindow
+    {
+    public:
+        /** The close callback is responsible for deleting the window. */
+        MessageLogWindow(SettingsManager*, MidiDeviceState&, std::function<void()>);
+        ~MessageLogWindow() override;
+        
+        void closeButtonPressed() override;
+        
+    private:
+        std::function<void()> onClose_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageLogWindow)
+    };
+}
@@ -0,0 +1,222 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiCapture.h"
+
+namespace showmidi
+{
+int MidiCapture::writeVarint(uint8* destination, uint64 value)
+{
+    auto size = 0;
+    while (value >= 0x80)
+    {
+        destination[size++] = (uint8)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    destination[size++] = (uint8)value;
+    return size;
+}
+
+bool MidiCapture::readVarint(const uint8*& data, const uint8* end, uint64& value)
+{
+    value = 0;
+    for (auto shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        auto byte = *data++;
+        value |= (uint64)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void writeString(MemoryOutputStream& out, const String& text)
+{
+    uint8 size[10];
+    auto utf8 = text.toUTF8();
+    auto length = utf8.sizeInBytes() - 1;
+    out.write(size, (size_t)MidiCapture::writeVarint(size, (uint64)length));
+    out.write(utf8.getAddress(), length);
+}
+
+static bool readString(const uint8*& data, const uint8* end, String& text)
+{
+    uint64 size;
+    if (!MidiCapture::readVarint(data, end, size) || size > (uint64)(end - data))
+    {
+        return false;
+    }
+    
+    text = String::fromUTF8((const char*)data, (int)size);
+    data += size;
+    return true;
+}
+
+MemoryBlock MidiCapture::createHeader(const MidiDeviceInfo& info, int64 startTime)
+{
+    MemoryOutputStream strings;
+    writeString(strings, info.identifier);
+    writeString(strings, info.name);
+    
+    MemoryOutputStream header;
+    header.write(MAGIC, MAGIC_SIZE);
+    header.writeInt((int)VERSION);
+    header.writeInt(MAGIC_SIZE + 4 + 4 + 8 + (int)strings.getDataSize());
+    header.writeInt64(startTime);
+    header << strings.getMemoryBlock();
+    return header.getMemoryBlock();
+}
+
+struct MidiCaptureReader::Pimpl
+{
+    Pimpl(const File& file) :
+    mapped_(file, MemoryMappedFile::readOnly)
+    {
+        if (mapped_.getData() == nullptr || mapped_.getSize() < (size_t)MidiCapture::MAGIC_SIZE + 16)
+        {
+            return;
+        }
+        
+        auto begin = static_cast<const uint8*>(mapped_.getData());
+        end_ = begin + mapped_.getSize();
+        if (memcmp(begin, MidiCapture::MAGIC, MidiCapture::MAGIC_SIZE) != 0 ||
+            ByteOrder::littleEndianInt(begin + MidiCapture::MAGIC_SIZE) != MidiCapture::VERSION)
+        {
+            return;
+        }
+        
+        auto events = ByteOrder::littleEndianInt(begin + MidiCapture::MAGIC_SIZE + 4);
+        startTime_ = (int64)ByteOrder::littleEndianInt64(begin + MidiCapture::MAGIC_SIZE + 8);
+        
+        auto strings = begin + MidiCapture::MAGIC_SIZE + 16;
+        if (events > mapped_.getSize() ||
+            !readString(strings, begin + events, info_.identifier) ||
+            !readString(strings, begin + events, info_.name))
+        {
+            return;
+        }
+        
+        begin_ = begin + events;
+        data_ = begin_;
+        time_ = startTime_;
+        valid_ = true;
+    }
+    
+    bool next(MidiMessage& msg, int64& time)
+    {
+        if (!valid_ || data_ >= end_ || *data_ == 0)
+        {
+            return false;
+        }
+        
+        auto data = data_;
+        uint64 tag;
+        if (!MidiCapture::readVarint(data, end_, tag) || data >= end_)
+        {
+            truncated_ = true;
+            return false;
+        }
+        
+        auto status = *data;
+        if (status >= 0x80)
+        {
+            ++data;
+            if (status < 0xf0)
+            {
+                runningStatus_ = status;
+            }
+        }
+        else if (runningStatus_ != 0)
+        {
+            status = runningStatus_;
+        }
+        else
+        {
+            truncated_ = true;
+            return false;
+        }
+        
+        if (status == 0xf0)
+        {
+            uint64 size;
+            if (!MidiCapture::readVarint(data, end_, size) || size > (uint64)(end_ - data))
+            {
+                truncated_ = true;
+                return false;
+            }
+            msg = MidiMessage::createSysExMessage(data, (int)size);
+            data += size;
+        }
+        else
+        {
+            auto size = MidiMessage::getMessageLengthFromFirstByte(status);
+            if (size - 1 > end_ - data)
+            {
+                truncated_ = true;
+                return false;
+            }
+            uint8 bytes[3] = { status, 0, 0 };
+            memcpy(bytes + 1, data, (size_t)(size - 1));
+            msg = MidiMessage(bytes, size);
+            data += size - 1;
+        }
+        
+        delta_ += MidiCapture::unzigzag(tag - 1);
+        time_ += delta_;
+        msg.setTimeStamp((double)time_ * 0.001);
+        time = time_;
+        data_ = data;
+        return true;
+    }
+    
+    double getProgress() const
+    {
+        if (!valid_ || end_ <= begin_)
+        {
+            return 1.0;
+        }
+        return (double)(data_ - begin_) / (double)(end_ - begin_);
+    }
+    
+    MemoryMappedFile mapped_;
+    MidiDeviceInfo info_;
+    int64 startTime_ { 0 };
+    bool valid_ { false };
+    bool truncated_ { false };
+    
+    const uint8* begin_ { nullptr };
+    const uint8* data_ { nullptr };
+    const uint8* end_ { nullptr };
+    int64 time_ { 0 };
+    int64 delta_ { 0 };
+    uint8 runningStatus_ { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiCaptureReader::MidiCaptureReader(const File& f) : pimpl_(new Pimpl(f)) {}
+MidiCaptureReader::~MidiCaptureReader() = default;
+
+bool MidiCaptureReader::isValid() const                                         { return pimpl_->valid_; }
+const MidiDeviceInfo& MidiCaptureReader::getDeviceInfo() const                  { return pimpl_->info_; }
+int64 MidiCaptureReader::getStartTime() const                                   { return pimpl_->startTime_; }
+bool MidiCaptureReader::next(MidiMessage& m, int64& t)                          { return pimpl_->next(m, t); }
+bool MidiCaptureReader::isTruncated() const                                     { return pimpl_->truncated_; }
+double MidiCaptureReader::getProgress() const                                   { return pimpl_->getProgress(); }
+}
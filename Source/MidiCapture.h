@@ -0,0 +1,82 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * The binary format of the MIDI captures.
+     *
+     * A capture starts with a header: the magic bytes, the version and the offset of the first
+     * event as 32-bit little endian integers, the time the capture started in milliseconds since
+     * the epoch as a 64-bit little endian integer, and the identifier and name of the device as
+     * varint sized UTF-8. Each event that follows is:
+     *
+     *  - the delta-of-delta of its time in milliseconds, zigzag encoded plus one as a varint,
+     *    so the first byte of an event is never zero
+     *  - the status byte, left out when it repeats the status of the previous channel message
+     *  - the data bytes, or for sysex the size of the data as a varint followed by the raw data
+     *
+     * The events end at the first zero byte or at the end of the file, so that a capture that
+     * was never closed is read up to the last event that was completely written.
+     */
+    class MidiCapture
+    {
+    public:
+        static constexpr const char* MAGIC = "SMIDICAP";
+        static constexpr int MAGIC_SIZE = 8;
+        static constexpr uint32 VERSION = 1;
+        static constexpr const char* FILE_EXTENSION = ".smcap";
+        
+        static int writeVarint(uint8* destination, uint64 value);
+        static bool readVarint(const uint8*& data, const uint8* end, uint64& value);
+        
+        static uint64 zigzag(int64 value)       { return ((uint64)value << 1) ^ (uint64)(value >> 63); }
+        static int64 unzigzag(uint64 value)     { return (int64)(value >> 1) ^ -(int64)(value & 1); }
+        
+        static MemoryBlock createHeader(const MidiDeviceInfo&, int64 startTime);
+    };
+    
+    /** Reads the events of a capture in the order they were recorded. */
+    class MidiCaptureReader
+    {
+    public:
+        MidiCaptureReader(const File&);
+        ~MidiCaptureReader();
+        
+        /** False when the file isn't a capture this version knows. */
+        bool isValid() const;
+        const MidiDeviceInfo& getDeviceInfo() const;
+        int64 getStartTime() const;
+        
+        /** Decodes the next event, returns false at the end of the capture. */
+        bool next(MidiMessage&, int64& time);
+        /** True when the capture ended in the middle of an event, for instance after a crash. */
+        bool isTruncated() const;
+        /** How much of the capture was read, from 0 to 1. */
+        double getProgress() const;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiCaptureReader)
+    };
+}
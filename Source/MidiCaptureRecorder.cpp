@@ -0,0 +1,400 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiCaptureRecorder.h"
+
+#include "MidiCapture.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SHOWMIDI_CAPTURE 1
+#else
+#define SHOWMIDI_CAPTURE 0
+#endif
+
+namespace showmidi
+{
+const String MidiCaptureRecorder::COMMAND_LINE_OPTION = { "--record" };
+
+/**
+ * A memory-mapped capture, the input thread appends to it and the recording thread keeps
+ * enough of it allocated ahead and flushes what was written.
+ */
+class CaptureFile
+{
+public:
+    CaptureFile(const File& file, const MidiDeviceInfo& info) :
+    file_(file)
+    {
+#if SHOWMIDI_CAPTURE
+        fd_ = open(file_.getFullPathName().toRawUTF8(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd_ < 0)
+        {
+            return;
+        }
+        
+        // the whole size is reserved up front, so the mapping never moves while the file grows
+        auto memory = mmap(nullptr, (size_t)MidiCaptureRecorder::MAX_CAPTURE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (memory == MAP_FAILED)
+        {
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+        data_ = static_cast<uint8*>(memory);
+        
+        if (!extend(MidiCaptureRecorder::CHUNK_SIZE))
+        {
+            munmap(data_, (size_t)MidiCaptureRecorder::MAX_CAPTURE_SIZE);
+            data_ = nullptr;
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+        
+        time_ = Time::currentTimeMillis();
+        auto header = MidiCapture::createHeader(info, time_);
+        memcpy(data_, header.getData(), header.getSize());
+        written_ = (int64)header.getSize();
+#else
+        ignoreUnused(info);
+#endif
+    }
+    
+    ~CaptureFile()
+    {
+#if SHOWMIDI_CAPTURE
+        if (data_ != nullptr)
+        {
+            // the preallocated space that wasn't used is given back
+            auto written = written_.load();
+            flush(written);
+            munmap(data_, (size_t)MidiCaptureRecorder::MAX_CAPTURE_SIZE);
+            ignoreUnused(ftruncate(fd_, written));
+            close(fd_);
+        }
+#endif
+    }
+    
+    bool isOpen() const
+    {
+        return data_ != nullptr;
+    }
+    
+    void add(const MidiMessage& msg, Time t)
+    {
+        auto raw = msg.getRawData();
+        auto raw_size = msg.getRawDataSize();
+        if (data_ == nullptr || raw_size == 0)
+        {
+            return;
+        }
+        
+        auto time = t.toMilliseconds();
+        auto delta = time - time_;
+        
+        uint8 event[32];
+        auto size = MidiCapture::writeVarint(event, MidiCapture::zigzag(delta - delta_) + 1);
+        
+        auto status = raw[0];
+        const uint8* payload = nullptr;
+        auto payload_size = 0;
+        if (msg.isSysEx())
+        {
+            payload = msg.getSysExData();
+            payload_size = msg.getSysExDataSize();
+            event[size++] = 0xf0;
+            size += MidiCapture::writeVarint(event + size, (uint64)payload_size);
+        }
+        else
+        {
+            if (status < 0x80 || status >= 0xf0 || status != runningStatus_)
+            {
+                event[size++] = status;
+            }
+            for (auto i = 1; i < jmin(raw_size, 3); ++i)
+            {
+                event[size++] = raw[i];
+            }
+        }
+        
+        auto written = written_.load(std::memory_order_relaxed);
+        auto end = written + size + payload_size;
+        if (end > allocated_.load(std::memory_order_acquire))
+        {
+            ++dropped_;
+            return;
+        }
+        
+        // the first byte is written last, readers stop at a zero byte and never see half an event
+        memcpy(data_ + written + 1, event + 1, (size_t)(size - 1));
+        if (payload_size > 0)
+        {
+            memcpy(data_ + written + size, payload, (size_t)payload_size);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        data_[written] = event[0];
+        written_.store(end, std::memory_order_release);
+        
+        time_ = time;
+        delta_ = delta;
+        if (status >= 0x80 && status < 0xf0)
+        {
+            runningStatus_ = status;
+        }
+    }
+    
+    /** Called on the recording thread. */
+    void maintain()
+    {
+        auto written = written_.load(std::memory_order_acquire);
+        if (written + MidiCaptureRecorder::CHUNK_SIZE / 2 > allocated_.load(std::memory_order_relaxed))
+        {
+            extend(allocated_.load(std::memory_order_relaxed) + MidiCaptureRecorder::CHUNK_SIZE);
+        }
+        flush(written);
+    }
+    
+    const File file_;
+    std::atomic<int64> dropped_ { 0 };
+    
+private:
+    /** Grows the file and faults the new pages in, before the input thread is allowed to write to them. */
+    bool extend(int64 size)
+    {
+#if SHOWMIDI_CAPTURE
+        size = jmin(size, MidiCaptureRecorder::MAX_CAPTURE_SIZE);
+        auto allocated = allocated_.load(std::memory_order_relaxed);
+        if (size <= allocated)
+        {
+            return false;
+        }
+        
+#if JUCE_LINUX
+        if (posix_fallocate(fd_, allocated, size - allocated) != 0)
+#else
+        if (ftruncate(fd_, size) != 0)
+#endif
+        {
+            return false;
+        }
+        
+        auto page_size = (int64)getpagesize();
+        for (auto offset = allocated; offset < size; offset += page_size)
+        {
+            reinterpret_cast<volatile uint8*>(data_)[offset] = 0;
+        }
+        
+        allocated_.store(size, std::memory_order_release);
+        return true;
+#else
+        ignoreUnused(size);
+        return false;
+#endif
+    }
+    
+    void flush(int64 written)
+    {
+#if SHOWMIDI_CAPTURE
+        if (written <= synced_)
+        {
+            return;
+        }
+        
+        // msync needs a page aligned start, the last page is flushed again once it's complete
+        auto page_size = (int64)getpagesize();
+        auto begin = synced_ - synced_ % page_size;
+        msync(data_ + begin, (size_t)(written - begin), MS_SYNC);
+        synced_ = written;
+#else
+        ignoreUnused(written);
+#endif
+    }
+    
+    int fd_ { -1 };
+    uint8* data_ { nullptr };
+    std::atomic<int64> allocated_ { 0 };
+    std::atomic<int64> written_ { 0 };
+    int64 synced_ { 0 };
+    
+    // only used by the input thread
+    int64 time_ { 0 };
+    int64 delta_ { 0 };
+    uint8 runningStatus_ { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureFile)
+};
+
+/** The directory that is recorded into and the thread that maintains the open captures. */
+class CaptureSession : public ReferenceCountedObject, private Thread
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<CaptureSession>;
+    
+    CaptureSession(const File& directory) :
+    Thread("MIDI capture"),
+    directory_(directory)
+    {
+        startThread();
+    }
+    
+    ~CaptureSession() override
+    {
+        stopThread(MidiCaptureRecorder::FLUSH_INTERVAL_MS * 10);
+    }
+    
+    std::unique_ptr<CaptureFile> open(const MidiDeviceInfo& info)
+    {
+        auto name = File::createLegalFileName(info.name) + Time::getCurrentTime().formatted("-%Y%m%d-%H%M%S");
+        auto capture = std::make_unique<CaptureFile>(directory_.getChildFile(name + MidiCapture::FILE_EXTENSION).getNonexistentSibling(), info);
+        if (!capture->isOpen())
+        {
+            return nullptr;
+        }
+        
+        const ScopedLock lock(filesLock_);
+        files_.add(capture.get());
+        return capture;
+    }
+    
+    void close(CaptureFile* capture)
+    {
+        const ScopedLock lock(filesLock_);
+        files_.removeFirstMatchingValue(capture);
+    }
+    
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            wait(MidiCaptureRecorder::FLUSH_INTERVAL_MS);
+            
+            const ScopedLock lock(filesLock_);
+            for (auto capture : files_)
+            {
+                capture->maintain();
+            }
+        }
+    }
+    
+    static Ptr& getStarted()
+    {
+        static Ptr started;
+        return started;
+    }
+    
+    static CriticalSection& getStartedLock()
+    {
+        static CriticalSection lock;
+        return lock;
+    }
+    
+private:
+    const File directory_;
+    CriticalSection filesLock_;
+    Array<CaptureFile*> files_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureSession)
+};
+
+bool MidiCaptureRecorder::start(const File& directory)
+{
+    if (!SHOWMIDI_CAPTURE || !directory.createDirectory().wasOk())
+    {
+        return false;
+    }
+    
+    CaptureSession::Ptr session = new CaptureSession(directory);
+    const ScopedLock lock(CaptureSession::getStartedLock());
+    CaptureSession::getStarted() = session;
+    return true;
+}
+
+void MidiCaptureRecorder::stop()
+{
+    const ScopedLock lock(CaptureSession::getStartedLock());
+    CaptureSession::getStarted() = nullptr;
+}
+
+bool MidiCaptureRecorder::startFromCommandLine(const StringArray& arguments)
+{
+    for (auto& argument : arguments)
+    {
+        if (argument == COMMAND_LINE_OPTION)
+        {
+            return start(getDefaultDirectory());
+        }
+        if (argument.startsWith(COMMAND_LINE_OPTION + "="))
+        {
+            return start(File::getCurrentWorkingDirectory().getChildFile(argument.fromFirstOccurrenceOf("=", false, false).unquoted()));
+        }
+    }
+    return true;
+}
+
+File MidiCaptureRecorder::getDefaultDirectory()
+{
+    return File::getSpecialLocation(File::userDocumentsDirectory).getChildFile("ShowMIDI Captures");
+}
+
+struct MidiCaptureRecorder::Track::Pimpl
+{
+    Pimpl(const MidiDeviceInfo& info)
+    {
+        {
+            const ScopedLock lock(CaptureSession::getStartedLock());
+            session_ = CaptureSession::getStarted();
+        }
+        
+        if (session_ != nullptr)
+        {
+            capture_ = session_->open(info);
+        }
+    }
+    
+    ~Pimpl()
+    {
+        if (capture_ != nullptr)
+        {
+            session_->close(capture_.get());
+        }
+    }
+    
+    void add(const MidiMessage& msg, Time t)
+    {
+        if (capture_ != nullptr)
+        {
+            capture_->add(msg, t);
+        }
+    }
+    
+    CaptureSession::Ptr session_;
+    std::unique_ptr<CaptureFile> capture_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiCaptureRecorder::Track::Track(const MidiDeviceInfo& i) : pimpl_(new Pimpl(i)) {}
+MidiCaptureRecorder::Track::~Track() = default;
+
+bool MidiCaptureRecorder::Track::isRecording() const                            { return pimpl_->capture_ != nullptr; }
+File MidiCaptureRecorder::Track::getFile() const                                { return pimpl_->capture_ != nullptr ? pimpl_->capture_->file_ : File(); }
+int64 MidiCaptureRecorder::Track::getDroppedEvents() const                      { return pimpl_->capture_ != nullptr ? pimpl_->capture_->dropped_.load() : 0; }
+void MidiCaptureRecorder::Track::add(const MidiMessage& m, Time t)              { pimpl_->add(m, t); }
+}
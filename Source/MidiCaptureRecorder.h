@@ -0,0 +1,71 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Records every message the devices ingest into a capture file per device, see MidiCapture.
+     *
+     * The files are memory-mapped and preallocated ahead of the writes by a background thread, which
+     * also flushes them to disk, so adding an event never blocks or makes a system call. A capture
+     * survives a crash of the app, only events that weren't flushed yet are lost when the system
+     * goes down. Recording is off until it's started, the devices that are created after that record.
+     */
+    class MidiCaptureRecorder
+    {
+    public:
+        static const String COMMAND_LINE_OPTION;
+        static constexpr int FLUSH_INTERVAL_MS = 20;
+        static constexpr int64 CHUNK_SIZE = 4 * 1024 * 1024;
+        /** A capture stops recording when it reaches this size, the dropped events are counted. */
+        static constexpr int64 MAX_CAPTURE_SIZE = (int64)1024 * 1024 * 1024;
+        
+        /** Records into a directory, returns false when it can't be created or captures aren't supported. */
+        static bool start(const File& directory);
+        /** The captures are closed as their devices go away. */
+        static void stop();
+        /** Starts recording when the option is present, optionally followed by =directory, returns false when that failed. */
+        static bool startFromCommandLine(const StringArray& arguments);
+        static File getDefaultDirectory();
+        
+        /** The capture of a device, it does nothing when recording isn't started. */
+        class Track
+        {
+        public:
+            Track(const MidiDeviceInfo&);
+            ~Track();
+            
+            bool isRecording() const;
+            File getFile() const;
+            /** The events that didn't fit in the preallocated part of the file. */
+            int64 getDroppedEvents() const;
+            
+            /** Appends a message, only to be called from a single thread. */
+            void add(const MidiMessage&, Time);
+            
+            struct Pimpl;
+        private:
+            std::unique_ptr<Pimpl> pimpl_;
+            
+            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Track)
+        };
+    };
+}
@@ -23,12 +23,17 @@
  *
  * Displays live MIDI channel activity, controls, and system messages in a single DPI-aware view.
  */
-// TODO: Refactor header underline drawing into a helper function!
 
 #include "MidiDeviceComponent.h"
 #include "ChannelState.h"
+#include "DeviceMetrics.h"
 #include "DpiScaling.h"
+#include "FramePacer.h"
 #include "LayoutConstants.h"
+#include "MidiDeviceState.h"
+#include "RenderWorkers.h"
+#include "ValueFormatter.h"
+#include "VisualizationKernels.h"
 
 namespace showmidi
 {
@@ -39,7 +44,7 @@ enum ParamType
     PARAM_NRPN
 };
 
-struct MidiDeviceComponent::Pimpl : public MidiInputCallback
+struct MidiDeviceComponent::Pimpl
 {
     /** Layout constants aliases */
     static constexpr int WIDTH_SEPARATOR = showmidi::layout::WIDTH_SEPARATOR;
@@ -84,568 +89,654 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
     static constexpr int Y_CC = showmidi::layout::Y_CC;
     static constexpr int X_CC_DATA = showmidi::layout::X_CC_DATA;
     
-    Pimpl(MidiDeviceComponent* owner, SettingsManager* manager, const String& name) :
+    Pimpl(MidiDeviceComponent* owner, SettingsManager* manager, MidiDeviceState& state) :
     owner_(owner),
     settingsManager_(manager),
-    theme_(manager->getSettings().getTheme()),
-    deviceInfo_({ name, ""})
+    paintSettings_(makePaintSettings()),
+    theme_(paintSettings_.theme_),
+    format_(paintSettings_.format_),
+    state_(state),
+    metrics_(sm::dpiScale())
     {
     }
     
-    Pimpl(MidiDeviceComponent* owner, SettingsManager* manager, const MidiDeviceInfo info) :
-    owner_(owner),
-    settingsManager_(manager),
-    theme_(manager->getSettings().getTheme()),
-    deviceInfo_(info)
-    {
-        auto midi_input = MidiInput::openDevice(info.identifier, this);
-        if (midi_input != nullptr)
-        {
-            midi_input->start();
-            midiIn_.swap(midi_input);
-        }
-#if SHOW_TEST_DATA
-        showTestData();
-#endif
-    }
-    
-    void showTestData()
-    {
-        const auto t = Time::getCurrentTime();
-        
-        deviceInfo_ = {"MIDI Instrument Name", deviceInfo_.identifier};
-        
-        auto& sysex = channels_.sysex_;
-        sysex.time_ = t;
-        sysex.length_ = 0xC;
-        uint8_t data[Sysex::MAX_SYSEX_DATA] = {
-            0x1, 0x2, 0xA, 0x7F, 0x0, 0xFE, 0x0, 0xAA, 0x1, 0x7E,
-            0x1, 0x2, 0xA, 0x7F, 0x0, 0xFE, 0x0, 0xAA, 0x1, 0x7E};
-        memcpy(sysex.data_, data, Sysex::MAX_SYSEX_DATA);
-        
-        auto& clock = channels_.clock_;
-        clock.bpm_ = 111.1;
-        clock.timeBpm_ = t;
-        clock.timeStart_ = t;
-        clock.timeContinue_ = t;
-        clock.timeStop_ = t;
-        
-        auto& channel1 = channels_.channel_[0];
-        channel1.mpeManager_ = true;
-        channel1.mpeMember_ = MpeMember::mpeLower;
-        channel1.time_ = t;
-        channel1.programChange_.current_.value_ = 0;
-        channel1.programChange_.current_.time_ = t;
-        channel1.pitchBend_.current_.value_ = 9256;
-        channel1.pitchBend_.current_.time_ = t;
-        channel1.notes_.time_ = t;
-        channel1.notes_.noteOn_[61].current_.value_ = 127;
-        channel1.notes_.noteOn_[61].current_.time_ = t;
-        channel1.notes_.noteOn_[61].polyPressure_.current_.value_ = 0;
-        channel1.notes_.noteOn_[79].current_.value_ = 38;
-        channel1.notes_.noteOn_[79].current_.time_ = t;
-        channel1.notes_.noteOn_[79].polyPressure_.current_.value_ = 120;
-        channel1.notes_.noteOn_[79].polyPressure_.current_.time_ = t;
-        channel1.channelPressure_.current_.value_ = 76;
-        channel1.channelPressure_.current_.time_ = t;
-        channel1.controlChanges_.time_ = t;
-        channel1.controlChanges_.controlChange_[74].current_.value_ = 127;
-        channel1.controlChanges_.controlChange_[74].current_.time_ = t;
-        auto& cc74_history = channel1.controlChanges_.controlChange_[74].history_;
-        auto cc74_t = t.toMilliseconds();
-        cc74_history.push_back({Time(cc74_t -= 100), 100});
-        cc74_history.push_back({Time(cc74_t -= 100), 99});
-        cc74_history.push_back({Time(cc74_t -= 100), 95});
-        cc74_history.push_back({Time(cc74_t -= 700), 90});
-        cc74_history.push_back({Time(cc74_t -= 1000), 80});
-        cc74_history.push_back({Time(cc74_t -= 3000), 30});
-        channel1.controlChanges_.controlChange_[7].current_.value_ = 64;
-        channel1.controlChanges_.controlChange_[7].current_.time_ = Time(t.toMilliseconds() - 500);
-        channel1.controlChanges_.controlChange_[39].current_.value_ = 32;
-        channel1.controlChanges_.controlChange_[39].current_.time_ = t;
-        channel1.rpns_.time_ = t;
-        channel1.rpns_.param_[0].current_.time_ = t;
-        channel1.rpns_.param_[0].current_.value_ = (96 << 7) + 50;
-        channel1.rpns_.param_[1].current_.time_ = t;
-        channel1.rpns_.param_[1].current_.value_ = (127 << 7) + 127;
-        channel1.rpns_.param_[2].current_.time_ = t;
-        channel1.rpns_.param_[2].current_.value_ = (127 << 7) + 127;
-        channel1.rpns_.param_[6].current_.time_ = t;
-        channel1.rpns_.param_[6].current_.value_ = 10;
-        channel1.hrccs_.time_ = t;
-        channel1.hrccs_.param_[7].current_.time_ = t;
-        channel1.hrccs_.param_[7].current_.value_ = 64 << 7 | 32 ;
-        
-        auto& channel16 = channels_.channel_[15];
-        channel16.time_ = t;
-        channel16.programChange_.current_.value_ = 127;
-        channel16.programChange_.current_.time_ = t;
-        channel16.pitchBend_.current_.value_ = 0;
-        channel16.pitchBend_.current_.time_ = t;
-        channel16.notes_.time_ = t;
-        channel16.notes_.noteOn_[61].current_.value_ = 127;
-        channel16.notes_.noteOn_[61].current_.time_ = t;
-        channel16.notes_.noteOn_[61].polyPressure_.current_.value_ = 73;
-        channel16.notes_.noteOn_[61].polyPressure_.current_.time_ = t;
-        channel16.notes_.noteOn_[79].current_.value_ = 127;
-        channel16.notes_.noteOn_[79].current_.time_ = t;
-        channel16.notes_.noteOn_[79].polyPressure_.current_.value_ = 0;
-        channel16.notes_.noteOff_[79].current_.value_ = 127;
-        channel16.notes_.noteOff_[79].current_.time_ = t;
-        channel16.channelPressure_.current_.value_ = 76;
-        channel16.channelPressure_.current_.time_ = t;
-        channel16.controlChanges_.time_ = t;
-        channel16.controlChanges_.controlChange_[1].current_.value_ = 124;
-        channel16.controlChanges_.controlChange_[1].current_.time_ = t;
-        channel16.controlChanges_.controlChange_[45].current_.value_ = 89;
-        channel16.controlChanges_.controlChange_[45].current_.time_ = t;
-        channel16.controlChanges_.controlChange_[127].current_.value_ = 100;
-        channel16.controlChanges_.controlChange_[127].current_.time_ = t;
+    ~Pimpl()
+    {
+        // the raster job paints with this pimpl, wait for it to finish
+        if (renderWorkers_ != nullptr)
+        {
+            renderWorkers_->removeJob(&rasterJob_, true, -1);
+        }
     }
     
-    ~Pimpl()
+    /** Rasterizes the view on the render workers from now on, nullptr paints on the message thread. */
+    void setRenderWorkers(RenderWorkers* workers)
     {
-        midiIn_ = nullptr;
+        renderWorkers_ = workers;
     }
     
-    /** Handles incoming MIDI messages and updates state. */
-    void handleIncomingMidiMessage(MidiInput*, const MidiMessage& msg)
+    /**
+     * Repaints when the state changed since the last frame.
+     * Returns the number of milliseconds until another frame is needed, 0 right after a change,
+     * or FramePacer::IDLE when nothing will change until new MIDI data arrives.
+     */
+    int render()
     {
-        const auto t = Time::getCurrentTime();
+        // a replay runs on a clock of its own, graphs scroll and values expire with it
+        const auto t = state_.getCurrentTime();
         
-        if (msg.isSysEx())
+        // composite the image that a render worker finished since the last frame
+        if (rasterReady_.exchange(false))
         {
-            auto& sysex = channels_.sysex_;
-            sysex.time_ = t;
-            sysex.length_ = msg.getSysExDataSize();
-            memset(sysex.data_, 0, Sysex::MAX_SYSEX_DATA);
-            memcpy(sysex.data_, msg.getSysExData(), std::min(msg.getSysExDataSize(), Sysex::MAX_SYSEX_DATA));
-            dirty_ = true;
-            return;
+            owner_->repaint();
         }
+        if (rasterAgain_ && !rasterBusy_)
+        {
+            rasterAgain_ = false;
+            rasterize();
+        }
+        
+        auto relayout = updateLayout(t);
         
-        if (msg.isMidiClock())
+        if (state_.consumeChange() || relayout)
         {
-            auto ts_secs = msg.getTimeStamp();
-            
-            // keep a queue of MIDI clock timestamps, never exceeding TIMESTAMP_QUEUE_SIZE
-            midiTimeStamps_.push_front(ts_secs);
-            while (midiTimeStamps_.size() > TIMESTAMP_QUEUE_SIZE)
-            {
-                midiTimeStamps_.pop_back();
-            }
-            
-            // calculate the average across all the queued timestamps
-            // this will be used to filter out outliers
-            auto avg_ts = 0.0;
-            for (size_t i = 0; i < midiTimeStamps_.size(); i++)
-            {
-                avg_ts += midiTimeStamps_[i];
-            }
-            avg_ts /= midiTimeStamps_.size();
-            
-            // only keep timestamps that are within 1% deviation of the average
-            std::vector<double> keep;
-            for (size_t i = 0; i < midiTimeStamps_.size(); i++)
-            {
-                if (fabs(avg_ts - midiTimeStamps_[i]) < avg_ts * 0.01)
-                {
-                    keep.push_back(midiTimeStamps_[i]);
-                }
-            }
-            
-            // if we have at least four valid timestamps, calculate the bpm
-            if (keep.size() > 4)
+            lastChange_ = t;
+            lastRender_ = t;
+            invalidate();
+            return 0;
+        }
+        
+        if (state_.isPaused())
+        {
+            return FramePacer::IDLE;
+        }
+        
+        auto next_frame = FramePacer::IDLE;
+        
+        // graphs scroll by one pixel per render time unit, until the last change has scrolled out,
+        // piano rolls and heatmaps keep moving for as long as the layout determined
+        if ((layoutKey_.visualization_ == Visualization::visualizationGraph &&
+             (t - lastChange_).inMilliseconds() < (layoutKey_.standardWidth_ + 1) * RENDER_TIME_UNIT_MS) ||
+            t.toMilliseconds() < animatedUntil_)
+        {
+            auto elapsed = (int)(t - lastRender_).inMilliseconds();
+            if (elapsed >= RENDER_TIME_UNIT_MS)
             {
-                auto sum = 0.0;
-                auto size = (int) keep.size() - 1;
-                for (auto i = 0; i < size; i++)
-                {
-                    sum += fabs(keep[i] - keep[i + 1]);
-                }
-                sum /= size;
-                
-                auto bpm = int((600.0 / sum / 24.0) + 0.5) / 10.0;
-                bpm = std::min(std::max(bpm, BPM_MIN), BPM_MAX);
-                
-                if (keep.size() > TIMESTAMP_QUEUE_SIZE / 2)
-                {
-                    auto& clock = channels_.clock_;
-                    if ((t - clock.timeBpm_).inSeconds() > 0.5)
-                    {
-                        clock.timeBpm_ = t;
-                        if (fabs(clock.bpm_ - bpm) >= 0.1)
-                        {
-                            clock.bpm_ = bpm;
-                            dirty_ = true;
-                        }
-                    }
-                }
+                lastRender_ = t;
+                invalidate();
+                elapsed = 0;
             }
-            return;
+            next_frame = RENDER_TIME_UNIT_MS - elapsed;
         }
-        else if (msg.isMidiStart())
+        
+        // lay out again as soon as the first visible item times out
+        if (nextExpiry_ != NO_EXPIRY)
         {
-            channels_.clock_.timeStart_ = t;
-            midiTimeStamps_.clear();
-            return;
+            next_frame = FramePacer::earliest(next_frame, (int)std::max<int64>(1, nextExpiry_ - t.toMilliseconds() + 1));
         }
-        else if (msg.isMidiContinue())
+        
+        return next_frame;
+    }
+    
+    static constexpr int RENDER_TIME_UNIT_MS = 50;
+    
+    static constexpr int SYSEX_DATA_PER_ROW = 5;
+    
+    static constexpr int HEATMAP_OCTAVES = 11;
+    // heat levels are quantized, this keeps the number of colours in the batch low
+    static constexpr int HEAT_LEVELS = 8;
+    
+    static constexpr int64 NO_EXPIRY = std::numeric_limits<int64>::max();
+    
+    int getStandardWidth() const { return metrics_.standardWidth_; }
+    int getWidthSeparator() const { return metrics_.widthSeparator_; }
+    
+    /** Kinds of entries that the layout pass emits into the display list. */
+    enum DisplayKind : uint8
+    {
+        displayPortName,
+        displaySeparator,
+        displayClockHeader,
+        displayClockBpm,
+        displayClockTransport,
+        displaySysexHeader,
+        displaySysexData,
+        displayChannelHeader,
+        displayProgramChange,
+        displayPitchBend,
+        displayParameter,
+        displayNoteName,
+        displayNoteOn,
+        displayNoteOff,
+        displayPolyPressure,
+        displayChannelPressure,
+        displayControlChange,
+        displayPianoRoll,
+        displayKeyHeatmap,
+        displayVelocityHistogram
+    };
+    
+    /** A positioned display list entry, referencing the state slot that provides its values. */
+    struct DisplayItem
+    {
+        Rectangle<int> bounds_;
+        DisplayKind kind_;
+        int8 channel_;
+        uint8 paramType_;
+        int16 number_;
+    };
+    
+    /** Everything outside the MIDI state that influences the geometry of the display list. */
+    struct LayoutKey
+    {
+        int timeoutDelay_ { -1 };
+        Visualization visualization_ { Visualization::visualizationBar };
+        int controlGraphHeight_ { 0 };
+        NotesView notesView_ { NotesView::notesViewList };
+        int labelHeight_ { 0 };
+        int standardWidth_ { 0 };
+        int width_ { 0 };
+        
+        bool operator==(const LayoutKey& other) const
         {
-            channels_.clock_.timeContinue_ = t;
-            midiTimeStamps_.clear();
-            return;
+            return timeoutDelay_ == other.timeoutDelay_ &&
+                   visualization_ == other.visualization_ &&
+                   controlGraphHeight_ == other.controlGraphHeight_ &&
+                   notesView_ == other.notesView_ &&
+                   labelHeight_ == other.labelHeight_ &&
+                   standardWidth_ == other.standardWidth_ &&
+                   width_ == other.width_;
         }
-        else if (msg.isMidiStop())
+        
+        bool operator!=(const LayoutKey& other) const { return !(*this == other); }
+    };
+    
+    /** The theme and the settings that the values are painted with. */
+    struct PaintSettings
+    {
+        Theme theme_;
+        Visualization visualization_ { Visualization::visualizationBar };
+        int timeoutDelay_ { 0 };
+        ValueFormatter format_;
+        
+        bool operator==(const PaintSettings& other) const
         {
-            channels_.clock_.timeStop_ = t;
-            midiTimeStamps_.clear();
-            return;
+            return theme_ == other.theme_ &&
+                   visualization_ == other.visualization_ &&
+                   timeoutDelay_ == other.timeoutDelay_ &&
+                   format_ == other.format_;
         }
         
-        if (msg.getChannel() <= 0)
+        bool operator!=(const PaintSettings& other) const { return !(*this == other); }
+    };
+    
+    /**
+     * Rebuilds the display list when the set of visible items may have changed:
+     * a slot was revived by incoming MIDI, a visible item timed out, or the
+     * settings that drive the geometry changed.
+     * Returns true when a new display list was produced.
+     */
+    bool updateLayout(const Time& t)
+    {
+        updateMetrics();
+        
+        updatePaintSettings();
+        
+        auto key = makeLayoutKey();
+        
+        state_.setTimeoutDelay(key.timeoutDelay_);
+        
+        // both need to be consumed
+        auto revived = state_.consumeLayoutChange();
+        revived = std::exchange(layoutDirty_, false) || revived;
+        if (!revived && key == layoutKey_ && t.toMilliseconds() <= nextExpiry_)
         {
-            return;
+            return false;
         }
         
-        ChannelMessage* channel_message = nullptr;
+        layoutKey_ = key;
+        layout(t);
+        
+        return true;
+    }
+    
+    LayoutKey makeLayoutKey()
+    {
+        auto& settings = settingsManager_->getSettings();
         
-        auto& channel = channels_.channel_[msg.getChannel() - 1];
-        if (msg.isNoteOn())
+        LayoutKey key;
+        key.timeoutDelay_ = settings.getTimeoutDelay();
+        key.visualization_ = settings.getVisualization();
+        key.controlGraphHeight_ = settings.getControlGraphHeight();
+        key.notesView_ = settings.getNotesView();
+        key.labelHeight_ = metrics_.labelHeight_;
+        key.standardWidth_ = getStandardWidth();
+        key.width_ = owner_->getWidth();
+        return key;
+    }
+    
+    /** Rebuilds the metrics when the display scale changed, or the view moved to another window. */
+    void updateMetrics()
+    {
+        // the raster job paints with the metrics, they're only replaced while it's idle
+        auto scale = sm::dpiScale();
+        if ((metricsDirty_ || scale != metrics_.scale_) && !rasterBusy_)
         {
-            auto& notes = channel.notes_;
-            notes.time_ = t;
+            metrics_ = DeviceMetrics(scale);
+            metricsDirty_ = false;
             
-            auto& note_off = notes.noteOff_[msg.getNoteNumber()];
-            note_off.current_.time_ = Time();
-            
-            auto& note_on = notes.noteOn_[msg.getNoteNumber()];
-            note_on.current_.value_ = msg.getVelocity();
-            channel_message = &note_on;
+            // no graph or piano roll is wider than the view, plus the time unit each side rounds to
+            state_.setTimelineHistory((int64)(metrics_.standardWidth_ + 2) * RENDER_TIME_UNIT_MS);
         }
-        else if (msg.isNoteOff())
+    }
+    
+    PaintSettings makePaintSettings()
+    {
+        auto& settings = settingsManager_->getSettings();
+        
+        PaintSettings paint_settings;
+        paint_settings.theme_ = settings.getTheme();
+        paint_settings.visualization_ = settings.getVisualization();
+        paint_settings.timeoutDelay_ = settings.getTimeoutDelay();
+        paint_settings.format_ = ValueFormatter::fromSettings(settings);
+        return paint_settings;
+    }
+    
+    /** Copies the theme and settings to paint with, frames are rasterized again when they changed. */
+    void updatePaintSettings()
+    {
+        // the raster job paints with these, they're only replaced while it's idle
+        if (rasterBusy_)
         {
-            auto& notes = channel.notes_;
-            notes.time_ = t;
-            
-            auto& note_off = notes.noteOff_[msg.getNoteNumber()];
-            note_off.current_.value_ = msg.getVelocity();
-            channel_message = &note_off;
+            return;
         }
-        else if (msg.isAftertouch())
+        
+        auto paint_settings = makePaintSettings();
+        if (paint_settings != paintSettings_)
         {
-            auto& notes = channel.notes_;
-            notes.time_ = t;
-            
-            auto& note_on = notes.noteOn_[msg.getNoteNumber()];
-            channel_message = &note_on.polyPressure_;
-            collectHistory(channel_message);
-            channel_message->current_.value_ = msg.getAfterTouchValue();
+            paintSettings_ = paint_settings;
+            layoutDirty_ = true;
+        }
+    }
+    
+    /** Lays out all visible items and emits them into the display list. */
+    void layout(const Time& t)
+    {
+        auto channels = &state_.getChannels();
+        
+        displayList_.clear();
+        nextExpiry_ = NO_EXPIRY;
+        animatedUntil_ = 0;
+        
+        // MIDI port name
+        addItem(displayPortName, { X_PORT, Y_PORT, owner_->getWidth(), metrics_.labelHeight_ });
+        if (state_.getDeviceStatus() == DeviceStatus::deviceOpening)
+        {
+            // show that the device doesn't respond once it timed out
+            nextExpiry_ = std::min(nextExpiry_, state_.getOpenDeadline());
         }
-        else if (msg.isController())
+        
+        auto offset = Y_PORT + metrics_.labelHeight_;
+        
+        offset = layoutClock(t, offset, channels->clock_);
+        
+        if (isLive(t, channels->sysex_.time_))
         {
-            auto& control_changes = channel.controlChanges_;
-            control_changes.time_ = t;
-            
-            auto number = msg.getControllerNumber();
-            auto value = msg.getControllerValue();
+            offset = layoutSysex(offset, channels->sysex_);
+        }
+        
+        // newly active channels are shown first
+        for (auto channel_index = 0; channel_index < 16; ++channel_index)
+        {
+            auto& channel = channels->channel_[channel_index];
             
-            switch (number)
+            auto live = isLive(t, channel.time_) || MidiDeviceState::hasHeldNotes(channel) || isPianoRollLive(t, channel);
+            if (live != channelVisible_[channel_index])
             {
-                case 98:
-                    channel.lastNrpnLsb_ = value;
-                    break;
-                case 99:
-                    channel.lastNrpnMsb_ = value;
-                    break;
-                case 100:
-                    channel.lastRpnLsb_ = value;
-                    // resetting RPN numbers also resets NRPN numbers
-                    if (channel.lastRpnLsb_ == 127 && channel.lastRpnMsb_ == 127)
-                    {
-                        channel.lastNrpnLsb_ = 127;
-                        channel.lastNrpnMsb_ = 127;
-                    }
-                    break;
-                case 101:
-                    channel.lastRpnMsb_ = value;
-                    break;
-                default:
-                    // Support for 14-bit high resolution control changes as per MIDI 1.0 Detailed Specification v4.2.1:
-                    // 1. both MSB and LSB need to be transmitted initially
-                    // 2. subsequent fine adjustment can use only the LSB value and reuse the previous MSB value
-                    // 3. subsequent major adjustment must retransmit MSB, upon MSB reception the concept of LSB should be set to 0
-                    // Additional personal interpretations:
-                    // 4. for bullet 3: LSB is only set to 0 when MSB value is different
-                    // 5. for bullet 3: if previous MSB value was lower, then LSB is 0, otherwise LSB is 127
-                    if (number >= 0 && number < 32)
-                    {
-                        auto msb_number = number;
-                        auto lsb_number = msb_number + 32;
-                        auto& msb_tv = control_changes.controlChange_[msb_number].current_;
-                        auto& lsb_tv = control_changes.controlChange_[lsb_number].current_;
-                        // see bullet 1 above
-                        if (msb_tv.time_.toMilliseconds() > 0 &&
-                            lsb_tv.time_.toMilliseconds() > 0)
-                        {
-                            // see bullet 4 above
-                            if (msb_tv.value_ != value)
-                            {
-                                auto msb_value = value;
-                                // see bullet 5 above
-                                auto lsb_value = 0;
-                                if (msb_tv.value_ > msb_value)
-                                {
-                                    lsb_value = 127;
-                                }
-                                
-                                // see bullets 3, 4, 5 above
-                                handle14BitControlChangeValue(t, channel, msb_number, msb_value, lsb_value);
-                            }
-                        }
-                        // we also handle the data entry control change for NRPN and RPN here
-                        // since it can potentially be used only as MSB data entry only
-                        else if (number == 6)
-                        {
-                            handleDataEntryControlChange(t, channel, value, 0);
-                        }
-                    }
-                    else if (number >= 32 && number < 64)
-                    {
-                        auto msb_number = number - 32;
-                        auto& msb_tv = control_changes.controlChange_[msb_number].current_;
-                        // see bullet 1 above
-                        if (msb_tv.time_.toMilliseconds() > 0)
-                        {
-                            // see bullet 2 above
-                            auto msb_value = msb_tv.value_;
-                            auto lsb_value = value;
-                            handle14BitControlChangeValue(t, channel, msb_number, msb_value, lsb_value);
-                        }
-                    }
-                    break;
+                if (live)
+                {
+                    channelOrder_.insert(channelOrder_.begin(), channel_index);
+                }
+                else
+                {
+                    channelOrder_.erase(std::find(channelOrder_.begin(), channelOrder_.end(), channel_index));
+                }
+                channelVisible_[channel_index] = live;
             }
             
-            channel_message = &control_changes.controlChange_[number];
-            collectHistory(channel_message);
-            channel_message->current_.value_ = value;
+            pruneParameters(t, channel.hrccs_);
+            pruneParameters(t, channel.rpns_);
+            pruneParameters(t, channel.nrpns_);
+        }
+        
+        for (auto channel_index : channelOrder_)
+        {
+            offset = layoutChannel(t, offset, channels->channel_[channel_index]);
+        }
+        
+        layoutHeight_ = offset;
+    }
+    
+    void addItem(DisplayKind kind, Rectangle<int> bounds, int channel = -1, int paramType = 0, int number = -1)
+    {
+        displayList_.push_back({ bounds, kind, (int8)channel, (uint8)paramType, (int16)number });
+    }
+    
+    /** Height of the value indicator below a label row, for the active visualization. */
+    int visualizationHeight(int rowSpacing, int graphRows)
+    {
+        if (layoutKey_.visualization_ == Visualization::visualizationBar)
+        {
+            return HEIGHT_INDICATOR;
         }
-        else if (msg.isProgramChange())
+        
+        return HEIGHT_INDICATOR + (rowSpacing + metrics_.labelHeight_ + HEIGHT_INDICATOR) * graphRows;
+    }
+    
+    int layoutSeparator(int offset)
+    {
+        offset += Y_SEPARATOR;
+        addItem(displaySeparator, { X_CHANNEL + X_SEPARATOR, offset,
+                                    getStandardWidth() - X_PARAM_DATA - X_CHANNEL, HEIGHT_SEPARATOR });
+        return offset + HEIGHT_SEPARATOR;
+    }
+    
+    int layoutClock(const Time& t, int offset, Clock& clock)
+    {
+        auto show_bpm = isLive(t, clock.timeBpm_);
+        auto show_start = isLive(t, clock.timeStart_);
+        auto show_continue = isLive(t, clock.timeContinue_);
+        auto show_stop = isLive(t, clock.timeStop_);
+        auto show_transport = show_start || show_continue || show_stop;
+        if (!show_bpm && !show_transport)
         {
-            channel_message = &channel.programChange_;
-            channel_message->current_.value_ = msg.getProgramChangeNumber();
+            return offset;
         }
-        else if (msg.isChannelPressure())
+        
+        offset += Y_CLOCK;
+        
+        int clock_width = getStandardWidth() - X_PARAM - X_CLOCK_BPM;
+        
+        addItem(displayClockHeader, { X_CLOCK, offset, getStandardWidth() - X_CLOCK, metrics_.labelHeight_ });
+        
+        // the BPM shares its row with the clock header
+        if (show_bpm)
         {
-            channel_message = &channel.channelPressure_;
-            collectHistory(channel_message);
-            channel_message->current_.value_ = msg.getChannelPressureValue();
+            addItem(displayClockBpm, { X_PARAM, offset, clock_width, metrics_.labelHeight_ });
+            offset += metrics_.labelHeight_;
         }
-        else if (msg.isPitchWheel())
+        
+        if (show_transport)
         {
-            channel_message = &channel.pitchBend_;
-            collectHistory(channel_message);
-            channel_message->current_.value_ = msg.getPitchWheelValue();
+            addItem(displayClockTransport, { X_PARAM, offset, clock_width, metrics_.labelHeight_ });
+            offset += metrics_.labelHeight_;
         }
         
-        if (channel_message != nullptr)
+        return layoutSeparator(offset) + Y_CLOCK_PADDING;
+    }
+    
+    int layoutSysex(int offset, Sysex& sysex)
+    {
+        offset += Y_SYSEX;
+        
+        addItem(displaySysexHeader, { X_SYSEX, offset, getStandardWidth() - X_SYSEX, metrics_.labelHeight_ });
+        offset += metrics_.labelHeight_;
+        
+        for (int i = 0, row = 0; i < Sysex::MAX_SYSEX_DATA && i < sysex.length_; i += SYSEX_DATA_PER_ROW, ++row)
         {
-            channel_message->current_.time_ = t;
-            channel.time_ = t;
-            dirty_ = true;
+            addItem(displaySysexData, { X_SYSEX_DATA, offset, X_SYSEX_DATA_WIDTH * SYSEX_DATA_PER_ROW, metrics_.labelHeight_ }, -1, 0, row);
+            offset += metrics_.labelHeight_;
         }
+        
+        return layoutSeparator(offset) + Y_SYSEX_PADDING;
     }
     
-    void handle14BitControlChangeValue(const Time& t, ActiveChannel& channel, int number, int msbValue, int lsbValue)
+    int layoutChannel(const Time& t, int offset, ActiveChannel& channel)
     {
-        auto was_rpn_or_nrpn = false;
-        // handle RPN or NRPN
-        if (number == 6)
+        auto number = channel.number_;
+        auto graph_rows = layoutKey_.controlGraphHeight_;
+        
+        // channel header, the program change shares its row
+        offset += Y_CHANNEL;
+        addItem(displayChannelHeader, { X_CHANNEL, offset, getStandardWidth() - X_CHANNEL, metrics_.labelHeight_ }, number);
+        if (isLive(t, channel.programChange_.current_.time_))
         {
-            was_rpn_or_nrpn = handleDataEntryControlChange(t, channel, msbValue, lsbValue);
+            addItem(displayProgramChange, { 0, offset, getStandardWidth() - X_PRGM, metrics_.labelHeight_ }, number);
         }
+        offset += metrics_.labelHeight_;
+        offset = layoutSeparator(offset) + Y_CHANNEL_PADDING;
         
-        // handle Hi-Res Control Change
-        if (!was_rpn_or_nrpn)
+        // pitch bend and parameters
+        if (isLive(t, channel.pitchBend_.current_.time_))
         {
-            const std::lock_guard<std::mutex> lock(paramsLock_);
-            
-            auto& hrcc = channel.hrccs_;
-            collectHistory(&hrcc.param_[number]);
-            
-            hrcc.time_ = t;
-            hrcc.param_[number].current_.time_ = t;
-            // see bullet 2 above
-            hrcc.param_[number].current_.value_ = (msbValue << 7) + lsbValue;
+            offset += Y_PB;
+            auto height = metrics_.labelHeight_ + visualizationHeight(Y_PB, std::max(2, graph_rows));
+            addItem(displayPitchBend, { X_PB, offset, getStandardWidth() - X_PB - X_PB_DATA, height }, number);
+            offset += height;
         }
+        
+        offset = layoutParameters(t, offset, number, PARAM_HRCC, channel.hrccs_);
+        offset = layoutParameters(t, offset, number, PARAM_RPN, channel.rpns_);
+        offset = layoutParameters(t, offset, number, PARAM_NRPN, channel.nrpns_);
+        
+        // notes and control changes are laid out side by side
+        auto notes_bottom = layoutNotes(t, offset, channel);
+        auto control_changes_bottom = layoutControlChanges(t, offset, channel);
+        
+        return std::max(offset, std::max(notes_bottom, control_changes_bottom)) + Y_CHANNEL_MARGIN;
     }
     
-    bool handleDataEntryControlChange(const Time& t, ActiveChannel& channel, int msbValue, int lsbValue)
+    int layoutParameters(const Time& t, int offset, int channel, ParamType type, Parameters& parameters)
     {
-        const std::lock_guard<std::mutex> lock(paramsLock_);
+        if (!isLive(t, parameters.time_))
+        {
+            return offset;
+        }
+        
+        const std::lock_guard<std::mutex> lock(state_.getParamsLock());
         
-        if (channel.lastRpnMsb_ != 127 || channel.lastRpnLsb_ != 127)
+        auto height = metrics_.labelHeight_ + visualizationHeight(Y_PARAM, std::max(2, layoutKey_.controlGraphHeight_));
+        for (auto& [number, param] : parameters.param_)
         {
-            auto rpn_number = (channel.lastRpnMsb_ << 7) + channel.lastRpnLsb_;
-            auto rpn_value = (msbValue << 7) + lsbValue;
-            auto& rpns = channel.rpns_;
-            collectHistory(&rpns.param_[rpn_number]);
-            
-            rpns.time_ = t;
-            rpns.param_[rpn_number].current_.time_ = t;
-            rpns.param_[rpn_number].current_.value_ = rpn_value;
-            
-            // handle MPE activation message
-            if (rpn_number == 6 && msbValue <= 0xf)
+            if (isLive(t, param.current_.time_))
             {
-                channels_.handleMpeActivation(t, channel, msbValue);
+                offset += Y_PARAM;
+                addItem(displayParameter, { X_PARAM, offset, getStandardWidth() - X_PARAM - X_PARAM_DATA, height }, channel, type, number);
+                offset += height;
             }
-            
-            return true;
         }
-        // handle NRPN
-        else if (channel.lastNrpnMsb_ != 127 || channel.lastNrpnLsb_ != 127)
+        
+        return offset;
+    }
+    
+    int layoutNotes(const Time& t, int offset, ActiveChannel& channel)
+    {
+        if (layoutKey_.notesView_ == NotesView::notesViewPianoRoll)
+        {
+            return layoutPianoRoll(t, offset, channel);
+        }
+        
+        if (layoutKey_.notesView_ == NotesView::notesViewHeatmap)
         {
-            auto nrpn_number = (channel.lastNrpnMsb_ << 7) + channel.lastNrpnLsb_;
-            auto nrpn_value = (msbValue << 7) + lsbValue;
-            auto& nrpns = channel.nrpns_;
-            collectHistory(&nrpns.param_[nrpn_number]);
+            return layoutHeatmap(t, offset, channel);
+        }
+        
+        auto& notes = channel.notes_;
+        if (!isLive(t, notes.time_) && !MidiDeviceState::hasHeldNotes(channel))
+        {
+            return offset;
+        }
+        
+        auto number = channel.number_;
+        auto name_width = X_NOTE_DATA - X_NOTE;
+        auto note_width = X_NOTE_DATA - X_ON_OFF;
+        auto note_height = metrics_.labelHeight_ + HEIGHT_INDICATOR;
+        auto pp_height = metrics_.labelHeight_ + visualizationHeight(Y_PP, layoutKey_.controlGraphHeight_);
+        
+        for (int i = 0; i < 128; ++i)
+        {
+            auto& note_on = notes.noteOn_[i];
+            auto& note_off = notes.noteOff_[i];
             
-            nrpns.time_ = t;
-            nrpns.param_[nrpn_number].current_.time_ = t;
-            nrpns.param_[nrpn_number].current_.value_ = nrpn_value;
+            // held notes never time out
+            auto note_on_live = MidiDeviceState::isHeld(note_on, note_off) || isLive(t, note_on.current_.time_);
+            auto note_off_live = isLive(t, note_off.current_.time_);
+            auto polypressure_live = isLive(t, note_on.polyPressure_.current_.time_);
             
-            return true;
+            if (note_on_live || polypressure_live)
+            {
+                offset += Y_NOTE;
+                addItem(displayNoteName, { X_NOTE, offset, name_width, metrics_.labelHeight_ }, number, 0, i);
+                
+                if (note_on_live)
+                {
+                    addItem(displayNoteOn, { X_ON_OFF, offset, note_width, note_height }, number, 0, i);
+                    offset += note_height;
+                }
+                
+                if (polypressure_live)
+                {
+                    if (note_on_live)
+                    {
+                        offset += Y_PP;
+                    }
+                    
+                    addItem(displayPolyPressure, { X_PP, offset, X_PP_DATA - X_PP, pp_height }, number, 0, i);
+                    offset += pp_height;
+                }
+            }
+            
+            if (note_off_live)
+            {
+                offset += Y_NOTE;
+                if (!note_on_live)
+                {
+                    addItem(displayNoteName, { X_NOTE, offset, name_width, metrics_.labelHeight_ }, number, 0, i);
+                }
+                
+                addItem(displayNoteOff, { X_ON_OFF, offset, note_width, note_height }, number, 0, i);
+                offset += note_height;
+            }
         }
         
-        return false;
+        return offset;
     }
     
-    /** Collects value history for smooth graphing. */
-    void collectHistory(ChannelMessage* message)
+    int getPianoRollWidth() const
     {
-        if (message->current_.time_.toMilliseconds() > 0)
-        {
-            const std::lock_guard<std::mutex> lock(historyLock_);
-            message->history_.insert(message->history_.begin(), message->current_);
-        }
+        return getStandardWidth() - X_NOTE - X_CC_DATA;
     }
     
-    void render()
+    /** The piano roll covers as much time as its width scrolls through. */
+    int64 getPianoRollWindowMs() const
     {
-        const auto t = Time::getCurrentTime();
+        return (int64)getPianoRollWidth() * RENDER_TIME_UNIT_MS;
+    }
+    
+    /** The piano roll stays while notes are held, or until the last released note has scrolled out. */
+    bool isPianoRollLive(const Time& t, ActiveChannel& channel)
+    {
+        if (layoutKey_.notesView_ != NotesView::notesViewPianoRoll)
+        {
+            return false;
+        }
+        
+        const std::lock_guard<std::mutex> lock(state_.getHistoryLock());
         
-        bool expected = true;
-        if (dirty_.compare_exchange_strong(expected, false) || (t - lastRender_).inMilliseconds() >= RENDER_TIME_UNIT_MS)
+        auto& spans = channel.noteSpans_;
+        if (spans.hasHeldNotes())
         {
-            lastRender_ = t;
-            owner_->repaint();
+            return true;
         }
+        
+        auto scrolled_out = spans.getLastEnd() + getPianoRollWindowMs();
+        if (spans.getLastEnd() == 0 || scrolled_out < t.toMilliseconds())
+        {
+            return false;
+        }
+        
+        nextExpiry_ = std::min(nextExpiry_, scrolled_out);
+        return true;
     }
     
-    static constexpr int RENDER_TIME_UNIT_MS = 50;
-    
-    static constexpr int TIMESTAMP_QUEUE_SIZE = 48;
-    static constexpr double BPM_MIN = 20.0;
-    static constexpr double BPM_MAX = 360.0;
-    
-    static constexpr int SYSEX_DATA_PER_ROW = 5;
-    
-    int getStandardWidth() const { return sm::getStandardWidth(); }
-    int getWidthSeparator() const { return sm::getStandardWidth() - sm::scaled(WIDTH_SEPARATOR); }
-    
-    struct ChannelPaintState
+    int layoutPianoRoll(const Time& t, int offset, ActiveChannel& channel)
     {
-        Time time_;
-        int offset_ { 0 };
-    };
+        if (!isPianoRollLive(t, channel))
+        {
+            return offset;
+        }
+        
+        offset += Y_NOTE;
+        addItem(displayPianoRoll, { X_NOTE, offset, getPianoRollWidth(), PIANO_ROLL_HEIGHT }, channel.number_);
+        // removed by a new layout once it has scrolled out
+        animatedUntil_ = NO_EXPIRY;
+        offset += PIANO_ROLL_HEIGHT;
+        
+        return offset;
+    }
     
-    /** Main paint routine for the MIDI device view. */
-    void paint(Graphics& g)
+    int layoutHeatmap(const Time& t, int offset, ActiveChannel& channel)
     {
-        g.fillAll(theme_.colorBackground);
-        
-        auto t = Time::getCurrentTime();
-        auto channels = &channels_;
-        if (paused_)
+        if (!isLive(t, channel.notes_.time_) && !MidiDeviceState::hasHeldNotes(channel))
         {
-            t = pausedTime_;
-            channels = &pausedChannels_;
+            return offset;
         }
         
-        // draw the data for each channel
-        ChannelPaintState state = { t, 0 };
-        
-        // draw MIDI port name
-        auto port_name = deviceInfo_.name;
-        if (midiIn_.get() == nullptr)
+        int64 last_update;
         {
-            port_name = port_name + String(paused_ ? " (paused)": "");
+            const std::lock_guard<std::mutex> lock(state_.getHistoryLock());
+            last_update = channel.noteHeat_.getLastUpdate();
         }
-        g.setFont(theme_.fontLabel());
-        g.setColour(theme_.colorData);
-        g.drawText(port_name,
-                   X_PORT, Y_PORT,
-                   owner_->getWidth(), theme_.labelHeight(),
-                   Justification::centredLeft);
         
-        state.offset_ = Y_PORT + theme_.labelHeight();
+        // after a few half-lives the quantized levels don't visibly change anymore
+        animatedUntil_ = std::max(animatedUntil_, last_update + (int64)(NoteHeat::HALF_LIFE_MS * 4));
+        
+        auto width = getPianoRollWidth();
+        
+        offset += Y_NOTE;
+        addItem(displayKeyHeatmap, { X_NOTE, offset, width, HEATMAP_OCTAVES * KEY_HEATMAP_ROW_HEIGHT }, channel.number_);
+        offset += HEATMAP_OCTAVES * KEY_HEATMAP_ROW_HEIGHT;
         
-        paintClock(g, state, channels->clock_);
+        offset += Y_NOTE;
+        addItem(displayVelocityHistogram, { X_NOTE, offset, width, VELOCITY_HISTOGRAM_HEIGHT }, channel.number_);
+        offset += VELOCITY_HISTOGRAM_HEIGHT;
+        
+        return offset;
+    }
+    
+    int layoutControlChanges(const Time& t, int offset, ActiveChannel& channel)
+    {
+        auto number = channel.number_;
+        auto cc_width = getStandardWidth() - X_CC - X_CC_DATA;
+        auto height = metrics_.labelHeight_ + visualizationHeight(Y_CC, layoutKey_.controlGraphHeight_);
         
-        if (!isExpired(t, channels->sysex_.time_)) {
-            paintSysex(g, state, channels->sysex_);
+        if (isLive(t, channel.channelPressure_.current_.time_))
+        {
+            offset += Y_CC;
+            addItem(displayChannelPressure, { X_CC, offset, cc_width, height }, number);
+            offset += height;
         }
         
-        for (auto channel_index = 0; channel_index < 16; ++channel_index)
+        auto& control_changes = channel.controlChanges_;
+        if (isLive(t, control_changes.time_))
         {
-            auto& channel_messages = channels->channel_[channel_index];
-            if (isExpired(t, channel_messages.time_))
+            for (int i = 0; i < 128; ++i)
             {
-                auto existing = std::find(channelOrder_.begin(), channelOrder_.end(), channel_index);
-                if (existing != channelOrder_.end())
+                if (isLive(t, control_changes.controlChange_[i].current_.time_))
                 {
-                    channelOrder_.erase(existing);
+                    offset += Y_CC;
+                    addItem(displayControlChange, { X_CC, offset, cc_width, height }, number, 0, i);
+                    offset += height;
                 }
             }
-            else {
-                auto existing = std::find(channelOrder_.begin(), channelOrder_.end(), channel_index);
-                if (existing == channelOrder_.end())
-                {
-                    channelOrder_.insert(channelOrder_.begin(), channel_index);
-                }
-            }
-            
-            pruneParameters(t, channel_messages.hrccs_);
-            pruneParameters(t, channel_messages.rpns_);
-            pruneParameters(t, channel_messages.nrpns_);
         }
         
-        for (auto channel_index : channelOrder_)
-        {
-            auto& channel_messages = channels->channel_[channel_index];
-            
-            paintChannelHeader(g, state, channel_messages);
-            
-            paintProgramChange(g, state, channel_messages);
-            state.offset_ = paintPitchBend(g, state, channel_messages);
-            state.offset_ = paintParameters(g, state, PARAM_HRCC, channel_messages.hrccs_);
-            state.offset_ = paintParameters(g, state, PARAM_RPN, channel_messages.rpns_);
-            state.offset_ = paintParameters(g, state, PARAM_NRPN, channel_messages.nrpns_);
-            int notes_bottom = paintNotes(g, state, channel_messages);
-            int control_changes_bottom = paintControlChanges(g, state, channel_messages);
-            
-            state.offset_ = std::max(state.offset_, std::max(notes_bottom, control_changes_bottom));
-            
-            state.offset_ += Y_CHANNEL_MARGIN;
-        }
-        
-        lastHeight_ = state.offset_;
+        return offset;
     }
     
     void pruneParameters(Time t, Parameters& params)
     {
-        const std::lock_guard<std::mutex> lock(paramsLock_);
+        const std::lock_guard<std::mutex> lock(state_.getParamsLock());
         
         auto it_param = params.param_.begin();
         while (it_param != params.param_.end())
@@ -663,168 +754,314 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
     
     int getVisibleHeight() const
     {
-        return lastHeight_;
+        return layoutHeight_;
     }
     
-    void paintClock(Graphics& g, ChannelPaintState& state, Clock& clock)
+    /** Paints the view on the message thread, or composites the image of the last rasterized frame. */
+    void invalidate()
     {
-        auto show_bpm = !isExpired(state.time_, clock.timeBpm_);
-        auto show_start = !isExpired(state.time_, clock.timeStart_);
-        auto show_continue = !isExpired(state.time_, clock.timeContinue_);
-        auto show_stop = !isExpired(state.time_, clock.timeStop_);
-        auto show_transport = show_start || show_continue || show_stop;
-        auto show_clock = show_bpm || show_transport;
-        if (!show_clock)
+        if (renderWorkers_ == nullptr)
+        {
+            owner_->repaint();
+        }
+        else
         {
+            rasterize();
+        }
+    }
+    
+    /** Hands a frame to the render workers, frames that are requested while one is in flight are coalesced. */
+    void rasterize()
+    {
+        if (rasterBusy_)
+        {
+            rasterAgain_ = true;
             return;
         }
         
-        state.offset_ += Y_CLOCK;
-        
-        int clock_width = getStandardWidth() - X_PARAM - X_CLOCK_BPM;
-        
-        // draw clock header
-        g.setColour(theme_.colorData);
-        g.setFont(theme_.fontLabel());
-        g.drawText(String("CLOCK"),
-                   X_CLOCK, state.offset_,
-                   getStandardWidth() - X_CLOCK, theme_.labelHeight(),
-                   Justification::centredLeft);
+        // the job only reads these while it's in flight, they're not touched again until it's done
+        rasterTime_ = state_.getCurrentTime();
+        rasterDisplayList_ = displayList_;
+        rasterWidth_ = owner_->getWidth();
+        rasterHeight_ = owner_->getHeight();
+        rasterScale_ = Component::getApproximateScaleFactorForComponent(owner_);
+        state_.copyChannels(rasterChannels_);
         
-        // draw BPM
-        if (show_bpm)
+        rasterBusy_ = true;
+        renderWorkers_->addJob(&rasterJob_, false);
+    }
+    
+    /** Runs on a render worker, paints a snapshot of the state into an image. */
+    void rasterizeFrame()
+    {
+        auto width = roundToInt(rasterWidth_ * rasterScale_);
+        auto height = roundToInt(rasterHeight_ * rasterScale_);
+        if (width > 0 && height > 0)
         {
-            g.setColour(theme_.colorController);
-            g.setFont(theme_.fontLabel());
-            g.drawText("BPM",
-                       X_PARAM, state.offset_,
-                       clock_width, theme_.labelHeight(),
-                       Justification::centredLeft);
+            // reuse the previous image when the message thread has let go of it
+            Image image;
+            if (spareImage_.isValid() && spareImage_.getWidth() == width && spareImage_.getHeight() == height &&
+                spareImage_.getReferenceCount() == 1)
+            {
+                image = spareImage_;
+            }
+            else
+            {
+                image = Image(Image::RGB, width, height, false);
+            }
+            spareImage_ = Image();
             
-            g.setColour(theme_.colorData);
-            g.setFont(theme_.fontData());
-            g.drawText(outputBpm(clock.bpm_),
-                       X_PARAM, state.offset_,
-                       clock_width, theme_.dataHeight(),
-                       Justification::centredRight);
+            {
+                Graphics g(image);
+                g.addTransform(AffineTransform::scale(rasterScale_));
+                paintDisplayList(g, rasterBatch_, rasterTime_, rasterChannels_, false, rasterDisplayList_);
+            }
             
-            state.offset_ += theme_.labelHeight();
+            {
+                const SpinLock::ScopedLockType lock(rasterLock_);
+                spareImage_ = rasterImage_;
+                rasterImage_ = image;
+                rasterImageScale_ = rasterScale_;
+            }
+            rasterReady_ = true;
         }
         
-        // draw transport
-        if (show_transport)
+        rasterBusy_ = false;
+        state_.requestFrame();
+    }
+    
+    /** Main paint routine for the MIDI device view, replays the display list with the current values. */
+    void paint(Graphics& g)
+    {
+        auto t = state_.getCurrentTime();
+        
+        // paint only replays the display list, settings and theme changes are picked up by the next frame
+        if (makeLayoutKey() != layoutKey_ || makePaintSettings() != paintSettings_)
         {
-            if (show_start)
+            state_.requestFrame();
+        }
+        
+        if (renderWorkers_ != nullptr)
+        {
+            Image image;
+            float scale;
             {
-                g.setColour(theme_.colorPositive);
-                g.setFont(theme_.fontLabel());
-                g.drawText("START",
-                           X_PARAM, state.offset_,
-                           clock_width, theme_.labelHeight(),
-                           Justification::centredLeft);
+                const SpinLock::ScopedLockType lock(rasterLock_);
+                image = rasterImage_;
+                scale = rasterImageScale_;
             }
             
-            if (show_continue)
+            if (image.isValid())
             {
-                g.setColour(theme_.colorPositive);
-                g.setFont(theme_.fontLabel());
-                g.drawText("CONT",
-                           X_PARAM, state.offset_,
-                           clock_width, theme_.labelHeight(),
-                           Justification::centred);
+                g.fillAll(theme_.colorBackground);
+                g.drawImageTransformed(image, AffineTransform::scale(1.0f / scale));
+                return;
             }
-            
-            if (show_stop)
+        }
+        
+        paintDisplayList(g, paintBatch_, t, state_.getChannels(), true, displayList_);
+    }
+    
+    /**
+     * Replays a display list with the values of the channels, the indicators and graphs are filled in one go at the end.
+     * Shared channels are the live ones, a snapshot that only this pass reads is painted without the locks of the state.
+     */
+    void paintDisplayList(Graphics& g, RectangleBatch& batch, const Time& t, ActiveChannels& channelsRef, bool shared, const std::vector<DisplayItem>& displayList)
+    {
+        g.fillAll(theme_.colorBackground);
+        
+        batch.clear();
+        
+        auto channels = &channelsRef;
+        for (auto& item : displayList)
+        {
+            switch (item.kind_)
             {
-                g.setColour(theme_.colorNegative);
-                g.setFont(theme_.fontLabel());
-                g.drawText("STOP",
-                           X_PARAM, state.offset_,
-                           clock_width, theme_.dataHeight(),
-                           Justification::centredRight);
+                case displayPortName:           paintPortName(g, item); break;
+                case displaySeparator:          paintSeparator(g, item); break;
+                case displayClockHeader:        paintClockHeader(g, item); break;
+                case displayClockBpm:           paintClockBpm(g, item, channels->clock_); break;
+                case displayClockTransport:     paintClockTransport(g, t, item, channels->clock_); break;
+                case displaySysexHeader:        paintSysexHeader(g, item, channels->sysex_); break;
+                case displaySysexData:          paintSysexData(g, item, channels->sysex_); break;
+                case displayChannelHeader:      paintChannelHeader(g, item, channels->channel_[item.channel_]); break;
+                case displayProgramChange:      paintProgramChange(g, item, channels->channel_[item.channel_]); break;
+                case displayPitchBend:          paintPitchBend(g, batch, t, item, channels->channel_[item.channel_], shared); break;
+                case displayParameter:          paintParameter(g, batch, t, item, channels->channel_[item.channel_], shared); break;
+                case displayNoteName:           paintNoteName(g, t, item, channels->channel_[item.channel_]); break;
+                case displayNoteOn:             paintNoteOn(g, batch, item, channels->channel_[item.channel_]); break;
+                case displayNoteOff:            paintNoteOff(g, batch, item, channels->channel_[item.channel_]); break;
+                case displayPolyPressure:       paintPolyPressure(g, batch, t, item, channels->channel_[item.channel_], shared); break;
+                case displayChannelPressure:    paintControlChange(g, batch, t, item, String("CP"), channels->channel_[item.channel_].channelPressure_, shared); break;
+                case displayControlChange:      paintControlChange(g, batch, t, item, String("CC ") + format_.output7Bit(item.number_),
+                                                                   channels->channel_[item.channel_].controlChanges_.controlChange_[item.number_], shared); break;
+                case displayPianoRoll:          paintPianoRoll(batch, t, item, channels->channel_[item.channel_], shared); break;
+                case displayKeyHeatmap:         paintKeyHeatmap(batch, t, item, channels->channel_[item.channel_], shared); break;
+                case displayVelocityHistogram:  paintVelocityHistogram(batch, t, item, channels->channel_[item.channel_], shared); break;
             }
-            
-            state.offset_ += theme_.labelHeight();
         }
         
-        // draw seperator
-        g.setColour(theme_.colorSeperator);
-        state.offset_ += Y_SEPARATOR;
-        g.drawRect(X_CHANNEL + X_SEPARATOR, state.offset_,
-                   getStandardWidth() - X_PARAM_DATA - X_CHANNEL, HEIGHT_SEPARATOR);
-        state.offset_ += HEIGHT_SEPARATOR + Y_CLOCK_PADDING;
+        batch.fill(g);
+    }
+    
+    /** Paints a label on the left and its data on the right of the first row of an item. */
+    void paintLabelAndData(Graphics& g, const Rectangle<int>& bounds, Colour labelColour, const String& label, const String& data)
+    {
+        g.setColour(labelColour);
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(label,
+                   bounds.getX(), bounds.getY(),
+                   bounds.getWidth(), metrics_.labelHeight_,
+                   Justification::centredLeft);
+        
+        g.setColour(theme_.colorData);
+        g.setFont(metrics_.fontData_);
+        g.drawText(data,
+                   bounds.getX(), bounds.getY(),
+                   bounds.getWidth(), metrics_.dataHeight_,
+                   Justification::centredRight);
+    }
+    
+    void paintPortName(Graphics& g, const DisplayItem& item)
+    {
+        auto port_name = state_.getDeviceInfo().name;
+        auto status = state_.getDeviceStatus();
+        if (status == DeviceStatus::deviceFed)
+        {
+            port_name = port_name + String(state_.isPaused() ? " (paused)": "");
+        }
+        
+        // the device views exist while their devices are opened in the background
+        String status_label;
+        auto status_colour = theme_.colorNegative;
+        switch (status)
+        {
+            case DeviceStatus::deviceOpening:
+                status_label = "OPENING";
+                status_colour = theme_.colorLabel;
+                break;
+            case DeviceStatus::deviceFailed:
+                status_label = "FAILED TO OPEN";
+                break;
+            case DeviceStatus::deviceTimedOut:
+                status_label = "NOT RESPONDING";
+                break;
+            case DeviceStatus::deviceOpen:
+            {
+                // the time the thru adds to the input, to keep an eye on while it's inline
+                auto thru = state_.getThruLatency();
+                if (thru.active_)
+                {
+                    status_label = "THRU " + String(roundToInt(thru.averageUs_)) + "/" + String(roundToInt(thru.maximumUs_)) + "us";
+                    status_colour = theme_.colorLabel;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        
+        g.setFont(metrics_.fontLabel_);
+        
+        auto bounds = item.bounds_.withTrimmedRight(2 * X_PORT);
+        if (status_label.isNotEmpty())
+        {
+            g.setColour(status_colour);
+            g.drawText(status_label, bounds, Justification::centredRight);
+            bounds.removeFromRight(metrics_.fontLabel_.getStringWidth(status_label + " "));
+        }
+        
+        g.setColour(theme_.colorData);
+        g.drawText(port_name, bounds, Justification::centredLeft);
+    }
+    
+    void paintSeparator(Graphics& g, const DisplayItem& item)
+    {
+        g.setColour(theme_.colorSeperator);
+        g.drawRect(item.bounds_);
+    }
+    
+    void paintClockHeader(Graphics& g, const DisplayItem& item)
+    {
+        g.setColour(theme_.colorData);
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(String("CLOCK"), item.bounds_, Justification::centredLeft);
+    }
+    
+    void paintClockBpm(Graphics& g, const DisplayItem& item, Clock& clock)
+    {
+        paintLabelAndData(g, item.bounds_, theme_.colorController, "BPM", ValueFormatter::outputBpm(clock.bpm_));
+    }
+    
+    void paintClockTransport(Graphics& g, const Time& t, const DisplayItem& item, Clock& clock)
+    {
+        g.setFont(metrics_.fontLabel_);
+        
+        if (!isExpired(t, clock.timeStart_))
+        {
+            g.setColour(theme_.colorPositive);
+            g.drawText("START", item.bounds_, Justification::centredLeft);
+        }
+        
+        if (!isExpired(t, clock.timeContinue_))
+        {
+            g.setColour(theme_.colorPositive);
+            g.drawText("CONT", item.bounds_, Justification::centred);
+        }
+        
+        if (!isExpired(t, clock.timeStop_))
+        {
+            g.setColour(theme_.colorNegative);
+            g.drawText("STOP", item.bounds_.withHeight(metrics_.dataHeight_), Justification::centredRight);
+        }
     }
     
-    /** Paints Sysex section. */
-    void paintSysex(Graphics& g, ChannelPaintState& state, Sysex& sysex)
+    void paintSysexHeader(Graphics& g, const DisplayItem& item, Sysex& sysex)
     {
-        state.offset_ += Y_SYSEX;
-        
         int sysex_width = getStandardWidth() - X_SYSEX - X_SYSEX_LENGTH;
         
-        // draw syxex header and length
         g.setColour(theme_.colorData);
-        g.setFont(theme_.fontLabel());
-        g.drawText(String("SYSEX"),
-                   X_SYSEX, state.offset_,
-                   getStandardWidth() - X_SYSEX, theme_.labelHeight(),
-                   Justification::centredLeft);
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(String("SYSEX"), item.bounds_, Justification::centredLeft);
         
         g.setColour(theme_.colorLabel);
-        g.setFont(theme_.fontLabel());
-        g.drawText(output14Bit(sysex.length_),
-                   X_SYSEX, state.offset_,
-                   sysex_width, theme_.dataHeight(),
+        g.drawText(format_.output14Bit(sysex.length_),
+                   item.bounds_.getX(), item.bounds_.getY(),
+                   sysex_width, metrics_.dataHeight_,
                    Justification::centredRight);
-        
-        state.offset_ += theme_.labelHeight();
-        
-        // draw sysex data
+    }
+    
+    void paintSysexData(Graphics& g, const DisplayItem& item, Sysex& sysex)
+    {
         g.setColour(theme_.colorData);
-        g.setFont(theme_.fontLabel());
+        g.setFont(metrics_.fontLabel_);
         
-        int data_x = 0;
-        
-        for (int i = 0; i < Sysex::MAX_SYSEX_DATA && i < sysex.length_;) {
-            int i_row = i + SYSEX_DATA_PER_ROW;
-            
-            data_x = X_SYSEX_DATA;
-            for (; i < i_row && i < sysex.length_; ++i) {
-                g.drawText(output7Bit(sysex.data_[i]),
-                           data_x, state.offset_,
-                           X_SYSEX_DATA_WIDTH, theme_.dataHeight(),
-                           Justification::centredRight);
-                data_x += X_SYSEX_DATA_WIDTH;
-            }
-            
-            state.offset_ += theme_.labelHeight();
+        auto data_x = item.bounds_.getX();
+        auto first = item.number_ * SYSEX_DATA_PER_ROW;
+        for (int i = first; i < first + SYSEX_DATA_PER_ROW && i < Sysex::MAX_SYSEX_DATA && i < sysex.length_; ++i)
+        {
+            g.drawText(format_.output7Bit(sysex.data_[i]),
+                       data_x, item.bounds_.getY(),
+                       X_SYSEX_DATA_WIDTH, metrics_.dataHeight_,
+                       Justification::centredRight);
+            data_x += X_SYSEX_DATA_WIDTH;
         }
-        
-        // draw seperator
-        g.setColour(theme_.colorSeperator);
-        state.offset_ += Y_SEPARATOR;
-        g.drawRect(X_CHANNEL + X_SEPARATOR, state.offset_,
-                   getStandardWidth() - X_PARAM_DATA - X_CHANNEL, HEIGHT_SEPARATOR);
-        state.offset_ += HEIGHT_SEPARATOR + Y_SYSEX_PADDING;
     }
     
-    /** Paints channel header and separator. */
-    void paintChannelHeader(Graphics& g, ChannelPaintState& state, ActiveChannel& channel)
+    void paintChannelHeader(Graphics& g, const DisplayItem& item, ActiveChannel& channel)
     {
+        auto y = item.bounds_.getY();
+        
         g.setColour(theme_.colorData);
-        g.setFont(theme_.fontLabel());
-        state.offset_ += Y_CHANNEL;
-        g.drawText(String("CH ") + output7Bit(channel.number_ + 1),
-                   X_CHANNEL, state.offset_,
-                   getStandardWidth() - X_CHANNEL, theme_.labelHeight(),
-                   Justification::centredLeft);
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(String("CH ") + format_.output7Bit(channel.number_ + 1), item.bounds_, Justification::centredLeft);
         
         if (channel.mpeMember_ != MpeMember::mpeNone)
         {
             g.setColour(theme_.colorLabel);
             g.drawText("MPE",
-                       X_CHANNEL_MPE, state.offset_,
-                       getStandardWidth() - X_CHANNEL_MPE, theme_.labelHeight(),
+                       X_CHANNEL_MPE, y,
+                       getStandardWidth() - X_CHANNEL_MPE, metrics_.labelHeight_,
                        Justification::centredLeft);
             auto mpe_label = String("");
             
@@ -840,432 +1077,318 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
             {
                 mpe_label = "UZ";
             }
-            g.setColour(theme_.colorLabel);
             g.drawText(mpe_label,
-                       X_CHANNEL_MPE_TYPE, state.offset_,
-                       getStandardWidth() - X_CHANNEL_MPE, theme_.labelHeight(),
+                       X_CHANNEL_MPE_TYPE, y,
+                       getStandardWidth() - X_CHANNEL_MPE, metrics_.labelHeight_,
                        Justification::centredLeft);
         }
-        state.offset_ += theme_.labelHeight();
-        
-        g.setColour(theme_.colorSeperator);
-        state.offset_ += Y_SEPARATOR;
-        g.drawRect(X_CHANNEL + X_SEPARATOR, state.offset_,
-                   getStandardWidth() - X_PARAM_DATA - X_CHANNEL, HEIGHT_SEPARATOR);
-        state.offset_ += HEIGHT_SEPARATOR + Y_CHANNEL_PADDING;
     }
     
-    /** Paints Program Change row. */
-    void paintProgramChange(Graphics& g, ChannelPaintState& state, ActiveChannel& channel)
+    void paintProgramChange(Graphics& g, const DisplayItem& item, ActiveChannel& channel)
     {
-        auto& program_change = channel.programChange_;
-        if (!isExpired(state.time_, program_change.current_.time_))
-        {
-            // write the texts
-            
-            g.setColour(theme_.colorLabel);
-            g.setFont(theme_.fontLabel());
-            g.drawText(String("PRGM ") + output7Bit(program_change.current_.value_),
-                       0, state.offset_ - Y_CHANNEL_PADDING - Y_SEPARATOR - HEIGHT_SEPARATOR - theme_.labelHeight(),
-                       getStandardWidth() - X_PRGM, theme_.labelHeight(),
-                       Justification::centredRight);
-        }
+        g.setColour(theme_.colorLabel);
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(String("PRGM ") + format_.output7Bit(channel.programChange_.current_.value_), item.bounds_, Justification::centredRight);
     }
     
-    /** Paints Pitch Bend row and visualization. */
-    int paintPitchBend(Graphics& g, ChannelPaintState& state, ActiveChannel& channel)
+    void paintPitchBend(Graphics& g, RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
     {
-        int y_offset = state.offset_;
-        
         auto& pitch_bend = channel.pitchBend_;
-        if (!isExpired(state.time_, pitch_bend.current_.time_))
+        
+        Colour pb_color = theme_.colorLabel;
+        if (pitch_bend.current_.value_ > 0x2000)
         {
-            y_offset += Y_PB;
-            
-            Colour pb_color = theme_.colorLabel;
-            if (pitch_bend.current_.value_ > 0x2000)
-            {
-                pb_color = theme_.colorPositive;
-            }
-            else if (pitch_bend.current_.value_ < 0x2000)
-            {
-                pb_color = theme_.colorNegative;
-            }
-            
-            int pb_width = getStandardWidth() - X_PB - X_PB_DATA;
-            
-            // draw the pitch bend text
-            g.setColour(pb_color);
-            g.setFont(theme_.fontLabel());
-            g.drawText("PB",
-                       X_PB, y_offset,
-                       pb_width, theme_.labelHeight(),
-                       Justification::centredLeft);
-            
-            g.setColour(theme_.colorData);
-            g.setFont(theme_.fontData());
-            g.drawText(output14Bit(pitch_bend.current_.value_),
-                       X_PB, y_offset,
-                       pb_width, theme_.dataHeight(),
-                       Justification::centredRight);
-            
-            y_offset += theme_.labelHeight();
-            
-            // draw pitchbend indicator
-            paintVisualization(g, state, y_offset, pitch_bend, 0x2000, 0x3FFF,
-                               true, theme_.colorPositive, theme_.colorNegative,
-                               X_PB, y_offset,
-                               pb_width, HEIGHT_INDICATOR + (Y_PB + theme_.labelHeight() + HEIGHT_INDICATOR) * std::max(2, settingsManager_->getSettings().getControlGraphHeight()));
-            
+            pb_color = theme_.colorPositive;
+        }
+        else if (pitch_bend.current_.value_ < 0x2000)
+        {
+            pb_color = theme_.colorNegative;
         }
         
-        return y_offset;
+        paintLabelAndData(g, item.bounds_, pb_color, "PB", format_.output14Bit(pitch_bend.current_.value_));
+        
+        paintVisualization(batch, t, pitch_bend, 0x2000, 0x3FFF,
+                           true, theme_.colorPositive, theme_.colorNegative,
+                           item.bounds_.withTrimmedTop(metrics_.labelHeight_), shared);
     }
     
-    /** Paints RPN, NRPN, or HRCC parameter rows and visualizations. */
-    int paintParameters(Graphics& g, ChannelPaintState& state, ParamType type, Parameters& parameters)
+    Parameters& getParameters(ActiveChannel& channel, ParamType type)
     {
-        int y_offset = state.offset_;
-        
-        if (!isExpired(state.time_, parameters.time_))
+        switch (type)
         {
-            const std::lock_guard<std::mutex> lock(paramsLock_);
-            
-            for (auto& [number, param] : parameters.param_)
-            {
-                if (!isExpired(state.time_, param.current_.time_))
-                {
-                    y_offset += Y_PARAM;
-                    
-                    int param_width = getStandardWidth() - X_PARAM - X_PARAM_DATA;
-                    
-                    // draw the parameter text
-                    g.setColour(theme_.colorController);
-                    g.setFont(theme_.fontLabel());
-                    String name;
-                    switch (type)
-                    {
-                        case PARAM_HRCC: name = "HRCC"; break;
-                        case PARAM_RPN: name = "RPN"; break;
-                        case PARAM_NRPN: name = "NRPN"; break;
-                    }
-                    g.drawText(name + String(" ") + output14Bit(number),
-                               X_PARAM, y_offset,
-                               param_width, theme_.labelHeight(),
-                               Justification::centredLeft);
-                    
-                    // draw the parameter value
-                    g.setColour(theme_.colorData);
-                    g.setFont(theme_.fontData());
-                    auto colourPositive = theme_.colorController;
-                    auto colourNegative = theme_.colorController;
-                    auto bidirectional = false;
-                    auto param_text = output14Bit(param.current_.value_);
-                    // handle standard RPN numbers and provide meaningful output for them
-                    if (type == PARAM_RPN)
-                    {
-                        auto msb_only = (param.current_.value_ >> 7) & 0x7F;
-                        if (number == 0)
-                        {
-                            auto param_cents = String();
-                            auto cents = param.current_.value_ & 0x7f;
-                            if (cents > 0)
-                            {
-                                param_cents = String(" ") + String(param.current_.value_ & 0x7F);
-                            }
-                            param_text = String("PB SNS ") + String(msb_only) + param_cents;
-                        }
-                        else if (number == 1)
-                        {
-                            param_text = String("FTUN ") + String(((param.current_.value_ - 8192) * 100.0) / 8192.0, 2);
-                            bidirectional = true;
-                            colourPositive = theme_.colorPositive;
-                            colourNegative = theme_.colorNegative;
-                        }
-                        else if (number == 2)
-                        {
-                            param_text = String("CTUN ") + String(msb_only - 64);
-                            bidirectional = true;
-                            colourPositive = theme_.colorPositive;
-                            colourNegative = theme_.colorNegative;
-                        }
-                        else if (number == 3)
-                        {
-                            param_text = String("TUN PC ") + String(msb_only);
-                        }
-                        else if (number == 4)
-                        {
-                            param_text = String("TUN BS ") + String(msb_only);
-                        }
-                        else if (number == 6 && msb_only <= 0xF)
-                        {
-                            if (param.current_.value_ == 0)
-                            {
-                                param_text = String("MPE OFF");
-                            }
-                            else
-                            {
-                                param_text = String("MPE RANGE ") + String(msb_only);
-                            }
-                        }
-                    }
-                    
-                    g.drawText(param_text,
-                               X_PARAM, y_offset,
-                               param_width, theme_.dataHeight(),
-                               Justification::centredRight);
-                    
-                    y_offset += theme_.labelHeight();
-                    
-                    // draw value indicator
-                    paintVisualization(g, state, y_offset, param, 0x2000, 0x3FFF,
-                                       bidirectional, colourPositive, colourNegative,
-                                       X_PARAM, y_offset,
-                                       param_width, HEIGHT_INDICATOR + (Y_PARAM + theme_.labelHeight() + HEIGHT_INDICATOR) * std::max(2, settingsManager_->getSettings().getControlGraphHeight()));
-                }
-            }
+            case PARAM_RPN: return channel.rpns_;
+            case PARAM_NRPN: return channel.nrpns_;
+            case PARAM_HRCC: break;
         }
-        
-        return y_offset;
+        return channel.hrccs_;
     }
     
-    /** Paints Note On/Off and Poly Pressure rows. */
-    int paintNotes(Graphics& g, ChannelPaintState& state, ActiveChannel& channel)
+    /** Paints an RPN, NRPN, or HRCC parameter row and its visualization. */
+    void paintParameter(Graphics& g, RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
     {
-        int y_offset = -1;
+        auto type = (ParamType)item.paramType_;
+        auto number = (int)item.number_;
         
-        auto& notes = channel.notes_;
-        if (!isExpired(state.time_, notes.time_))
+        auto lock = lockShared(state_.getParamsLock(), shared);
+        
+        auto& params = getParameters(channel, type).param_;
+        auto it_param = params.find(number);
+        if (it_param == params.end())
         {
-            for (int i = 0; i < 128; ++i)
+            return;
+        }
+        auto& param = it_param->second;
+        
+        String name;
+        switch (type)
+        {
+            case PARAM_HRCC: name = "HRCC"; break;
+            case PARAM_RPN: name = "RPN"; break;
+            case PARAM_NRPN: name = "NRPN"; break;
+        }
+        
+        auto colourPositive = theme_.colorController;
+        auto colourNegative = theme_.colorController;
+        auto bidirectional = false;
+        auto param_text = format_.output14Bit(param.current_.value_);
+        // handle standard RPN numbers and provide meaningful output for them
+        if (type == PARAM_RPN)
+        {
+            auto msb_only = (param.current_.value_ >> 7) & 0x7F;
+            if (number == 0)
             {
-                auto& note_on = notes.noteOn_[i];
-                auto& note_off = notes.noteOff_[i];
-                
-                auto note_on_expired = isExpired(state.time_, note_on.current_.time_);
-                auto note_off_expired = isExpired(state.time_, note_off.current_.time_);
-                auto polypressure_expired = isExpired(state.time_, note_on.polyPressure_.current_.time_);
-                if (!note_on_expired || !polypressure_expired)
+                auto param_cents = String();
+                auto cents = param.current_.value_ & 0x7f;
+                if (cents > 0)
                 {
-                    if (!note_on_expired && note_off_expired)
-                    {
-                        channel.time_ = state.time_;
-                        note_on.current_.time_ = state.time_;
-                        notes.time_ = state.time_;
-                    }
-                    
-                    if (y_offset == -1)
-                    {
-                        y_offset = state.offset_;
-                    }
-                    
-                    y_offset += Y_NOTE;
-                    
-                    // draw note text
-                    
-                    auto note_color = !isExpired(state.time_, note_off.current_.time_) ? theme_.colorNegative : theme_.colorPositive;
-                    g.setColour(note_color);
-                    g.setFont(theme_.fontLabel());
-                    g.drawText(outputNote(i),
-                               X_NOTE, y_offset,
-                               X_NOTE_DATA - X_NOTE, theme_.labelHeight(),
-                               Justification::centredLeft);
-                    
-                    if (!note_on_expired)
-                    {
-                        int note_width = X_NOTE_DATA - X_ON_OFF;
-                        g.setColour(theme_.colorLabel);
-                        g.setFont(theme_.fontLabel());
-                        g.drawText("ON",
-                                   X_ON_OFF, y_offset,
-                                   note_width, theme_.labelHeight(),
-                                   Justification::centredLeft);
-                        
-                        g.setColour(theme_.colorData);
-                        g.setFont(theme_.fontData());
-                        g.drawText(output7Bit(note_on.current_.value_),
-                                   X_ON_OFF, y_offset,
-                                   note_width, theme_.dataHeight(),
-                                   Justification::centredRight);
-                        
-                        y_offset += theme_.labelHeight();
-                        
-                        // draw velocity indicator
-                        g.setColour(theme_.colorTrack);
-                        g.fillRect(X_ON_OFF, y_offset,
-                                   note_width, HEIGHT_INDICATOR);
-                        
-                        auto velocity_color = theme_.colorPositive;
-                        
-                        g.setColour(velocity_color);
-                        g.fillRect(X_ON_OFF, y_offset,
-                                   (note_width * note_on.current_.value_) / 127, HEIGHT_INDICATOR);
-                        
-                        y_offset += HEIGHT_INDICATOR;
-                    }
-                    
-                    if (!polypressure_expired)
-                    {
-                        // draw polypressure text
-                        if (!note_on_expired)
-                        {
-                            y_offset += Y_PP;
-                        }
-                        
-                        int pp_width = X_PP_DATA - X_PP;
-                        g.setColour(theme_.colorLabel);
-                        g.setFont(theme_.fontLabel());
-                        g.drawText("PP",
-                                   X_PP, y_offset,
-                                   pp_width, theme_.labelHeight(),
-                                   Justification::centredLeft);
-                        
-                        g.setColour(theme_.colorData);
-                        g.setFont(theme_.fontData());
-                        g.drawText(output7Bit(note_on.polyPressure_.current_.value_),
-                                   X_PP, y_offset,
-                                   pp_width, theme_.dataHeight(),
-                                   Justification::centredRight);
-                        
-                        y_offset += theme_.labelHeight();
-                        
-                        // draw polypressure indicator
-                        paintVisualization(g, state, y_offset, note_on.polyPressure_, 0x40, 0x7f,
-                                           false, note_color, note_color,
-                                           X_PP, y_offset,
-                                           pp_width, HEIGHT_INDICATOR + (Y_PP + theme_.labelHeight() + HEIGHT_INDICATOR) * settingsManager_->getSettings().getControlGraphHeight());
-                        
-                    }
+                    param_cents = String(" ") + String(param.current_.value_ & 0x7F);
                 }
-                
-                if (!isExpired(state.time_, note_off.current_.time_))
+                param_text = String("PB SNS ") + String(msb_only) + param_cents;
+            }
+            else if (number == 1)
+            {
+                param_text = String("FTUN ") + String(((param.current_.value_ - 8192) * 100.0) / 8192.0, 2);
+                bidirectional = true;
+                colourPositive = theme_.colorPositive;
+                colourNegative = theme_.colorNegative;
+            }
+            else if (number == 2)
+            {
+                param_text = String("CTUN ") + String(msb_only - 64);
+                bidirectional = true;
+                colourPositive = theme_.colorPositive;
+                colourNegative = theme_.colorNegative;
+            }
+            else if (number == 3)
+            {
+                param_text = String("TUN PC ") + String(msb_only);
+            }
+            else if (number == 4)
+            {
+                param_text = String("TUN BS ") + String(msb_only);
+            }
+            else if (number == 6 && msb_only <= 0xF)
+            {
+                if (param.current_.value_ == 0)
                 {
-                    if (y_offset == -1)
-                    {
-                        y_offset = state.offset_;
-                    }
-                    
-                    y_offset += Y_NOTE;
-                    
-                    // draw note text
-                    auto note_color = theme_.colorNegative;
-                    
-                    if (isExpired(state.time_, note_on.current_.time_))
-                    {
-                        g.setColour(note_color);
-                        g.setFont(theme_.fontLabel());
-                        g.drawText(outputNote(i),
-                                   X_NOTE, y_offset,
-                                   X_NOTE_DATA - X_NOTE, theme_.labelHeight(),
-                                   Justification::centredLeft);
-                    }
-                    
-                    int note_width = X_NOTE_DATA - X_ON_OFF;
-                    g.setColour(theme_.colorLabel);
-                    g.setFont(theme_.fontLabel());
-                    g.drawText("OFF",
-                               X_ON_OFF, y_offset,
-                               note_width, theme_.labelHeight(),
-                               Justification::centredLeft);
-                    
-                    g.setColour(theme_.colorData);
-                    g.setFont(theme_.fontData());
-                    g.drawText(output7Bit(note_off.current_.value_),
-                               X_ON_OFF, y_offset,
-                               note_width, theme_.dataHeight(),
-                               Justification::centredRight);
-                    
-                    y_offset += theme_.labelHeight();
-                    
-                    // draw velocity indicator
-                    
-                    g.setColour(theme_.colorTrack);
-                    g.fillRect(X_ON_OFF, y_offset,
-                               note_width, HEIGHT_INDICATOR);
-                    
-                    auto velocity_color = theme_.colorNegative;
-                    
-                    g.setColour(velocity_color);
-                    g.fillRect(X_ON_OFF, y_offset,
-                               (note_width * note_off.current_.value_) / 127, HEIGHT_INDICATOR);
-                    
-                    y_offset += HEIGHT_INDICATOR;
+                    param_text = String("MPE OFF");
+                }
+                else
+                {
+                    param_text = String("MPE RANGE ") + String(msb_only);
                 }
             }
         }
         
-        return y_offset;
+        paintLabelAndData(g, item.bounds_, theme_.colorController, name + String(" ") + format_.output14Bit(number), param_text);
+        
+        paintVisualization(batch, t, param, 0x2000, 0x3FFF,
+                           bidirectional, colourPositive, colourNegative,
+                           item.bounds_.withTrimmedTop(metrics_.labelHeight_), shared);
+    }
+    
+    /** The colour of a note follows its most recent on or off. */
+    Colour getNoteColour(const Time& t, NoteOff& noteOff)
+    {
+        return !isExpired(t, noteOff.current_.time_) ? theme_.colorNegative : theme_.colorPositive;
+    }
+    
+    void paintNoteName(Graphics& g, const Time& t, const DisplayItem& item, ActiveChannel& channel)
+    {
+        g.setColour(getNoteColour(t, channel.notes_.noteOff_[item.number_]));
+        g.setFont(metrics_.fontLabel_);
+        g.drawText(format_.outputNote(item.number_), item.bounds_, Justification::centredLeft);
+    }
+    
+    /** Paints a note velocity row with its indicator. */
+    void paintVelocity(Graphics& g, RectangleBatch& batch, const DisplayItem& item, const String& label, int velocity, Colour velocityColour)
+    {
+        auto& bounds = item.bounds_;
+        
+        paintLabelAndData(g, bounds, theme_.colorLabel, label, format_.output7Bit(velocity));
+        
+        auto indicator_y = bounds.getY() + metrics_.labelHeight_;
+        batch.add(RectangleBatch::layerTrack, theme_.colorTrack, bounds.getX(), indicator_y,
+                  bounds.getWidth(), HEIGHT_INDICATOR);
+        batch.add(RectangleBatch::layerIndicator, velocityColour, bounds.getX(), indicator_y,
+                  (bounds.getWidth() * velocity) / 127, HEIGHT_INDICATOR);
+    }
+    
+    void paintNoteOn(Graphics& g, RectangleBatch& batch, const DisplayItem& item, ActiveChannel& channel)
+    {
+        paintVelocity(g, batch, item, "ON", channel.notes_.noteOn_[item.number_].current_.value_, theme_.colorPositive);
+    }
+    
+    void paintNoteOff(Graphics& g, RectangleBatch& batch, const DisplayItem& item, ActiveChannel& channel)
+    {
+        paintVelocity(g, batch, item, "OFF", channel.notes_.noteOff_[item.number_].current_.value_, theme_.colorNegative);
     }
     
-    /** Paints CC (control change) rows and visualizations. */
-    int paintControlChanges(Graphics& g, ChannelPaintState& state, ActiveChannel& channel)
+    /**
+     * Paints the notes that overlap the scrolled time window as bars, one row per key,
+     * over the range of keys that was played within the window.
+     */
+    void paintPianoRoll(RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
     {
-        int y_offset = -1;
+        static constexpr int MIN_KEYS = 12;
+        static constexpr int VELOCITY_LEVELS = 4;
+        
+        auto& bounds = item.bounds_;
+        batch.add(RectangleBatch::layerTrack, theme_.colorTrack.withAlpha(0.3f), bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight());
+        
+        auto lock = lockShared(state_.getHistoryLock(), shared);
+        
+        auto now = t.toMilliseconds();
+        auto from = now - (int64)bounds.getWidth() * RENDER_TIME_UNIT_MS;
+        auto& spans = channel.noteSpans_;
         
-        if (!isExpired(state.time_, channel.channelPressure_.current_.time_))
+        auto lowest = 127;
+        auto highest = 0;
+        spans.forEachInWindow(from, now, [&lowest, &highest] (const NoteSpan& span)
         {
-            paintControlChangeEntry(g, state, y_offset, String("CP"), channel.channelPressure_);
+            lowest = std::min(lowest, (int)span.number_);
+            highest = std::max(highest, (int)span.number_);
+        });
+        if (lowest > highest)
+        {
+            return;
         }
         
-        auto& control_changes = channel.controlChanges_;
-        if (!isExpired(state.time_, control_changes.time_))
+        // keep a minimum range centred on the played keys
+        if (highest - lowest + 1 < MIN_KEYS)
         {
-            for (int i = 0; i < 128; ++i)
-            {
-                auto& cc = control_changes.controlChange_[i];
-                if (!isExpired(state.time_, cc.current_.time_))
-                {
-                    paintControlChangeEntry(g, state, y_offset, String("CC ") + output7Bit(cc.number_), cc);
-                }
-            }
+            lowest = jlimit(0, 128 - MIN_KEYS, (lowest + highest + 1 - MIN_KEYS) / 2);
+            highest = lowest + MIN_KEYS - 1;
         }
         
-        return y_offset;
+        auto keys = highest - lowest + 1;
+        auto key_height = std::max(1, bounds.getHeight() / keys);
+        auto right = bounds.getRight();
+        
+        spans.forEachInWindow(from, now, [&] (const NoteSpan& span)
+        {
+            auto x_start = right - (int)((now - span.start_) / RENDER_TIME_UNIT_MS);
+            auto x_end = right - (int)((now - span.end_) / RENDER_TIME_UNIT_MS);
+            x_start = std::max(x_start, bounds.getX());
+            x_end = std::max(std::min(x_end, right), x_start + 1);
+            
+            // higher keys at the top
+            auto y = bounds.getY() + (highest - span.number_) * bounds.getHeight() / keys;
+            
+            auto level = (float)(1 + span.velocity_ * VELOCITY_LEVELS / 128) / VELOCITY_LEVELS;
+            batch.add(RectangleBatch::layerIndicator, theme_.colorTrack.interpolatedWith(theme_.colorPositive, level),
+                      x_start, y, x_end - x_start, key_height);
+        });
     }
     
-    /** Paints a single CC or Pressure row. */
-    void paintControlChangeEntry(Graphics& g, ChannelPaintState& state, int& yOffset, const String& label, ChannelMessage& message)
+    /** The colour of a level, anything above zero is visibly different from an unplayed key. */
+    Colour getHeatColour(float level)
+    {
+        auto quantized = std::min(HEAT_LEVELS, (int)std::ceil(level * HEAT_LEVELS));
+        return theme_.colorTrack.interpolatedWith(theme_.colorPositive, (float)quantized / HEAT_LEVELS);
+    }
+    
+    /** The levels are painted from the render workers too, so they're computed into local arrays. */
+    void getHeatLevels(const Time& t, ActiveChannel& channel, bool shared, float* keyLevels, float* velocityLevels)
     {
-        if (yOffset == -1)
+        auto lock = lockShared(state_.getHistoryLock(), shared);
+        channel.noteHeat_.getLevels(t.toMilliseconds(), keyLevels, velocityLevels);
+    }
+    
+    /** Paints the keys as a grid with one octave per row, the lowest octave at the bottom. */
+    void paintKeyHeatmap(RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
+    {
+        float key_levels[NoteHeat::NUM_BINS];
+        float velocity_levels[NoteHeat::NUM_BINS];
+        getHeatLevels(t, channel, shared, key_levels, velocity_levels);
+        
+        auto& bounds = item.bounds_;
+        for (auto key = 0; key < NoteHeat::NUM_BINS; ++key)
         {
-            yOffset = state.offset_;
+            auto octave = key / 12;
+            auto semitone = key % 12;
+            auto x = bounds.getX() + semitone * bounds.getWidth() / 12;
+            auto x_next = bounds.getX() + (semitone + 1) * bounds.getWidth() / 12;
+            auto y = bounds.getBottom() - (octave + 1) * KEY_HEATMAP_ROW_HEIGHT;
+            
+            // leave a gap between the cells
+            batch.add(RectangleBatch::layerIndicator, getHeatColour(key_levels[key]), x, y, x_next - x - 1, KEY_HEATMAP_ROW_HEIGHT - 1);
         }
+    }
+    
+    /** Paints one bar per velocity value, thinner than a pixel bars are merged and show their loudest value. */
+    void paintVelocityHistogram(RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
+    {
+        float key_levels[NoteHeat::NUM_BINS];
+        float velocity_levels[NoteHeat::NUM_BINS];
+        getHeatLevels(t, channel, shared, key_levels, velocity_levels);
         
-        yOffset += Y_CC;
+        auto& bounds = item.bounds_;
+        batch.add(RectangleBatch::layerTrack, theme_.colorTrack, bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight());
         
-        // write label text
-        int cc_width = getStandardWidth() - X_CC - X_CC_DATA;
-        g.setColour(theme_.colorController);
-        g.setFont(theme_.fontLabel());
-        g.drawText(label,
-                   X_CC, yOffset,
-                   cc_width, theme_.labelHeight(),
-                   Justification::centredLeft);
+        auto width = bounds.getWidth();
+        auto velocity = 0;
+        for (auto x = 0; x < width && velocity < NoteHeat::NUM_BINS; ++x)
+        {
+            auto velocity_end = std::max(velocity + 1, (x + 1) * NoteHeat::NUM_BINS / width);
+            auto level = FloatVectorOperations::findMaximum(velocity_levels + velocity, velocity_end - velocity);
+            velocity = velocity_end;
+            
+            auto height = (int)std::ceil(level * bounds.getHeight());
+            batch.add(RectangleBatch::layerIndicator, theme_.colorPositive, bounds.getX() + x, bounds.getBottom() - height, 1, height);
+        }
+    }
+    
+    void paintPolyPressure(Graphics& g, RectangleBatch& batch, const Time& t, const DisplayItem& item, ActiveChannel& channel, bool shared)
+    {
+        auto& poly_pressure = channel.notes_.noteOn_[item.number_].polyPressure_;
+        auto note_color = getNoteColour(t, channel.notes_.noteOff_[item.number_]);
         
-        g.setColour(theme_.colorData);
-        g.setFont(theme_.fontData());
-        g.drawText(output7Bit(message.current_.value_),
-                   X_CC, yOffset,
-                   cc_width, theme_.dataHeight(),
-                   Justification::centredRight);
+        paintLabelAndData(g, item.bounds_, theme_.colorLabel, "PP", format_.output7Bit(poly_pressure.current_.value_));
         
-        yOffset += theme_.labelHeight();
+        paintVisualization(batch, t, poly_pressure, 0x40, 0x7f,
+                           false, note_color, note_color,
+                           item.bounds_.withTrimmedTop(metrics_.labelHeight_), shared);
+    }
+    
+    /** Paints a single CC or Pressure row. */
+    void paintControlChange(Graphics& g, RectangleBatch& batch, const Time& t, const DisplayItem& item, const String& label, ChannelMessage& message, bool shared)
+    {
+        paintLabelAndData(g, item.bounds_, theme_.colorController, label, format_.output7Bit(message.current_.value_));
         
-        // draw value indicator
-        paintVisualization(g, state, yOffset, message, 0x40, 0x7f,
+        paintVisualization(batch, t, message, 0x40, 0x7f,
                            false, theme_.colorController, theme_.colorController,
-                           X_CC, yOffset,
-                           cc_width, HEIGHT_INDICATOR + (Y_CC + theme_.labelHeight() + HEIGHT_INDICATOR) * settingsManager_->getSettings().getControlGraphHeight());
+                           item.bounds_.withTrimmedTop(metrics_.labelHeight_), shared);
     }
     
-    /** Paints mini-graph/bar for current value/history. */
-    void paintVisualization(Graphics& g, ChannelPaintState& state, int& yOffset, ChannelMessage& message, int centerValue, int maxValue,
-                            bool bidirectional, Colour colourPositive, Colour colourNegative, int graphLeft, int graphTop, int graphWidth, int graphHeight)
+    /** Batches the mini-graph/bar for the current value/history, filled at the end of the frame. */
+    void paintVisualization(RectangleBatch& batch, const Time& t, ChannelMessage& message, int centerValue, int maxValue,
+                            bool bidirectional, Colour colourPositive, Colour colourNegative, const Rectangle<int>& area, bool shared)
     {
         // purge expired history entries
-        const std::lock_guard<std::mutex> lock(historyLock_);
-        const int64 graph_t = ((state.time_.toMilliseconds() + RENDER_TIME_UNIT_MS) / RENDER_TIME_UNIT_MS) * RENDER_TIME_UNIT_MS;
-        const int64 graph_expire = graph_t - graphWidth * RENDER_TIME_UNIT_MS - RENDER_TIME_UNIT_MS;
+        auto lock = lockShared(state_.getHistoryLock(), shared);
+        const int64 graph_t = ((t.toMilliseconds() + RENDER_TIME_UNIT_MS) / RENDER_TIME_UNIT_MS) * RENDER_TIME_UNIT_MS;
+        const int64 graph_expire = graph_t - area.getWidth() * RENDER_TIME_UNIT_MS - RENDER_TIME_UNIT_MS;
         TimedValue last;
         while (!message.history_.empty() && message.history_.back().time_.toMilliseconds() < graph_expire)
         {
@@ -1278,112 +1401,46 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
             message.history_.push_back({Time(graph_expire), last.value_});
         }
         
-        // draw bar
-        if (settingsManager_->getSettings().getVisualization() == Visualization::visualizationBar)
+        VisualizationStyle style { centerValue, maxValue, colourPositive, colourNegative,
+                                   theme_.colorTrack, theme_.colorSeperator, RENDER_TIME_UNIT_MS };
+        
+        if (paintSettings_.visualization_ == Visualization::visualizationBar)
         {
-            g.setColour(theme_.colorTrack);
-            g.fillRect(graphLeft, yOffset,
-                       graphWidth, HEIGHT_INDICATOR);
-            
-            int indicator_x = graphLeft;
-            int indicator_width = (graphWidth * message.current_.value_) / maxValue;
-            int indicator_range = graphWidth / 2;
             if (bidirectional)
             {
-                indicator_x = graphLeft + indicator_range + 1;
-                indicator_width = (indicator_range * (message.current_.value_ - centerValue)) / centerValue;
-            }
-            
-            if (message.current_.value_ >= centerValue)
-            {
-                g.setColour(colourPositive);
+                BarKernel<true>::batch(batch, style, area, message.current_.value_);
             }
             else
             {
-                g.setColour(colourNegative);
-                if (bidirectional)
-                {
-                    indicator_x = graphLeft + indicator_range + indicator_width;
-                    indicator_width = abs(indicator_width);
-                }
+                BarKernel<false>::batch(batch, style, area, message.current_.value_);
             }
-            
-            g.fillRect(indicator_x, yOffset,
-                       indicator_width, HEIGHT_INDICATOR);
-            
-            yOffset += HEIGHT_INDICATOR;
         }
-        // draw graph
         else
         {
-            g.setColour(theme_.colorTrack);
-            g.fillRect(graphLeft, graphTop,
-                       graphWidth, graphHeight);
-            
-            auto graph_total_width = 0;
-            
-            paintGraphEntry(g, message.current_, graph_t, graph_total_width, centerValue, maxValue,
-                            bidirectional, colourPositive, colourNegative, graphLeft, graphTop, graphWidth, graphHeight);
-            for (auto& tv : message.history_)
-            {
-                paintGraphEntry(g, tv, graph_t, graph_total_width, centerValue, maxValue,
-                                bidirectional, colourPositive, colourNegative, graphLeft, graphTop, graphWidth, graphHeight);
-            }
-            
-            yOffset += graphHeight;
-        }
-    }
-    
-    void paintGraphEntry(Graphics& g, TimedValue& tv, int64 graph_t, int& graphTotalWidth, int centerValue, int maxValue,
-                         bool bidirectional, Colour colourPositive, Colour colourNegative, int graphLeft, int graphTop, int graphWidth, int graphHeight)
-    {
-        auto graph_right = graphLeft + graphWidth;
-        auto graph_entry_width = std::min(graphWidth - graphTotalWidth, int(graph_t - tv.time_.toMilliseconds()) / RENDER_TIME_UNIT_MS- graphTotalWidth);
-        if (graph_entry_width > 0)
-        {
-            auto graph_entry_left = graph_right - graph_entry_width - graphTotalWidth;
-            auto graph_entry_height = (graphHeight * tv.value_) / maxValue;
-            auto graph_entry_top = graphTop + graphHeight - graph_entry_height;
-            int graph_entry_range = graphHeight / 2;
             if (bidirectional)
             {
-                g.setColour(theme_.colorSeperator);
-                g.fillRect(graphLeft, graphTop + graph_entry_range,
-                           graphWidth, HEIGHT_INDICATOR);
-                
-                graph_entry_height = abs(graphHeight * (tv.value_ - centerValue)) / (maxValue - 1);
-            }
-            
-            if (tv.value_ >= centerValue)
-            {
-                g.setColour(colourPositive);
-                if (bidirectional)
-                {
-                    graph_entry_top = graphTop + graph_entry_range - graph_entry_height;
-                }
+                GraphKernel<true>::batch(batch, style, area, graph_t, message.current_, message.history_);
             }
             else
             {
-                g.setColour(colourNegative);
-                if (bidirectional)
-                {
-                    graph_entry_top = graphTop + graph_entry_range + 1;
-                }
+                GraphKernel<false>::batch(batch, style, area, graph_t, message.current_, message.history_);
             }
-            
-            g.fillRect(graph_entry_left, graph_entry_top,
-                       graph_entry_width, graph_entry_height);
-            graphTotalWidth += graph_entry_width;
         }
     }
     
+    /** Locks the live channels, which the MIDI thread writes to, a snapshot isn't shared and needs no lock. */
+    static std::unique_lock<std::mutex> lockShared(std::mutex& mutex, bool shared)
+    {
+        return shared ? std::unique_lock<std::mutex>(mutex) : std::unique_lock<std::mutex>();
+    }
+    
     bool isExpired(const Time& currentTime, Time& messageTime)
     {
         if (messageTime.toMilliseconds() == 0)
         {
             return true;
         }
-        auto delay = settingsManager_->getSettings().getTimeoutDelay();
+        auto delay = paintSettings_.timeoutDelay_;
         if (delay == 0)
         {
             return false;
@@ -1391,83 +1448,32 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
         return (currentTime - messageTime).inSeconds() > delay;
     }
     
-    String output7BitAsHex(int v)
-    {
-        return String::toHexString(v).paddedLeft('0', 2).toUpperCase() + "H";
-    }
-    
-    String output7Bit(int v)
-    {
-        if (settingsManager_->getSettings().getNumberFormat() == NumberFormat::formatHexadecimal)
-        {
-            return output7BitAsHex(v);
-        }
-        else
-        {
-            return String(v);
-        }
-    }
-    
-    String output14BitAsHex(int v)
+    /** Same as !isExpired, also tracks when the display list has to be laid out again. */
+    bool isLive(const Time& currentTime, Time& messageTime)
     {
-        return String::toHexString(v).paddedLeft('0', 4).toUpperCase() + "H";
-    }
-    
-    String output14Bit(int v)
-    {
-        if (settingsManager_->getSettings().getNumberFormat() == NumberFormat::formatHexadecimal)
-        {
-            return output14BitAsHex(v);
-        }
-        else
-        {
-            return String(v);
-        }
-    }
-    
-    String outputNote(int noteNumber)
-    {
-        if (settingsManager_->getSettings().getNoteFormat() == NoteFormat::formatNumber)
+        if (isExpired(currentTime, messageTime))
         {
-            return output7Bit(noteNumber);
+            return false;
         }
-        else
+        
+        if (layoutKey_.timeoutDelay_ != 0)
         {
-            auto octave = settingsManager_->getSettings().getOctaveMiddleC();
-            return MidiMessage::getMidiNoteName(noteNumber, true, true, octave);
+            nextExpiry_ = std::min(nextExpiry_, messageTime.toMilliseconds() + layoutKey_.timeoutDelay_ * 1000);
         }
-    }
-    
-    String outputBpm(double bpm)
-    {
-        return String(bpm, 1);
+        
+        return true;
     }
     
     void resized()
     {
-        dirty_ = true;
-    }
-    
-    void setPaused(bool paused)
-    {
-        if (paused)
-        {
-            const std::lock_guard<std::mutex> lock1(paramsLock_);
-            const std::lock_guard<std::mutex> lock2(historyLock_);
-            pausedTime_ = Time::getCurrentTime();
-            pausedChannels_ = channels_;
-        }
-        
-        dirty_ = true;
-        paused_ = paused;
+        layoutDirty_ = true;
     }
     
-    void resetChannelData()
+    void parentHierarchyChanged()
     {
-        const std::lock_guard<std::mutex> lock1(paramsLock_);
-        const std::lock_guard<std::mutex> lock2(historyLock_);
-        channels_.reset();
-        pausedChannels_.reset();
+        metricsDirty_ = true;
+        layoutDirty_ = true;
+        state_.requestFrame();
     }
     
     bool isInterestedInFileDrag(const StringArray& files)
@@ -1487,7 +1493,7 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
     {
         for (auto file : files)
         {
-            theme_.parseXml(File(file).loadFileAsString());
+            settingsManager_->getSettings().getTheme().parseXml(File(file).loadFileAsString());
         }
         
         owner_->getParentComponent()->repaint();
@@ -1498,23 +1504,57 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
     MidiDeviceComponent* const owner_;
     
     SettingsManager* const settingsManager_;
-    Theme& theme_;
-    MidiDeviceInfo deviceInfo_;
+    // the raster job paints with a copy of the settings, render workers never read the settings themselves
+    PaintSettings paintSettings_;
+    const Theme& theme_;
+    const ValueFormatter& format_;
+    MidiDeviceState& state_;
     std::vector<int> channelOrder_;
-    std::unique_ptr<MidiInput> midiIn_;
-    std::atomic_bool dirty_ { true };
     Time lastRender_;
-    bool paused_ { false };
+    Time lastChange_;
+    
+    DeviceMetrics metrics_;
+    bool metricsDirty_ { false };
+    bool layoutDirty_ { true };
+    LayoutKey layoutKey_;
+    int64 nextExpiry_ { NO_EXPIRY };
+    std::vector<DisplayItem> displayList_;
+    int64 animatedUntil_ { 0 };
+    bool channelVisible_[16] {};
+    int layoutHeight_ { 0 };
+    RectangleBatch paintBatch_;
+    
+    struct RasterJob : public ThreadPoolJob
+    {
+        RasterJob(Pimpl& owner) : ThreadPoolJob("ShowMIDI Raster"), owner_(owner) {}
+        
+        JobStatus runJob() override
+        {
+            owner_.rasterizeFrame();
+            return jobHasFinished;
+        }
+        
+        Pimpl& owner_;
+    };
     
-    ActiveChannels channels_;
-    std::deque<double> midiTimeStamps_;
-    std::mutex paramsLock_;
-    std::mutex historyLock_;
+    RenderWorkers* renderWorkers_ { nullptr };
+    RasterJob rasterJob_ { *this };
+    std::atomic_bool rasterBusy_ { false };
+    std::atomic_bool rasterReady_ { false };
+    bool rasterAgain_ { false };
     
-    Time pausedTime_;
-    ActiveChannels pausedChannels_;
+    Time rasterTime_;
+    std::vector<DisplayItem> rasterDisplayList_;
+    ActiveChannels rasterChannels_;
+    RectangleBatch rasterBatch_;
+    int rasterWidth_ { 0 };
+    int rasterHeight_ { 0 };
+    float rasterScale_ { 1.0f };
+    Image spareImage_;
     
-    int lastHeight_ { 0 };
+    SpinLock rasterLock_;
+    Image rasterImage_;
+    float rasterImageScale_ { 1.0f };
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
 };
@@ -1524,10 +1564,8 @@ struct MidiDeviceComponent::Pimpl : public MidiInputCallback
  * @brief UI component for a single MIDI device.
  */
 
-/** Constructor for a virtual or named MIDI device. */
-MidiDeviceComponent::MidiDeviceComponent(SettingsManager* manager, const String& name) : pimpl_(new Pimpl(this, manager, name)) {}
-/** Constructor for a MIDI device with detailed info. */
-MidiDeviceComponent::MidiDeviceComponent(SettingsManager* manager, const MidiDeviceInfo& info) : pimpl_(new Pimpl(this, manager, info)) {}
+/** Constructor for a view of the state of a MIDI device. */
+MidiDeviceComponent::MidiDeviceComponent(SettingsManager* manager, MidiDeviceState& state) : pimpl_(new Pimpl(this, manager, state)) {}
 /** Destructor. */
 MidiDeviceComponent::~MidiDeviceComponent() = default;
 
@@ -1536,19 +1574,17 @@ int MidiDeviceComponent::getStandardWidth() const   { return pimpl_->getStandard
 /** Returns visible height of this device's UI. */
 int MidiDeviceComponent::getVisibleHeight() const   { return pimpl_->getVisibleHeight(); }
 
-/** Repaints the device UI. */
-void MidiDeviceComponent::render()            { pimpl_->render(); }
+/** Repaints the device UI when needed, returns the delay until the next frame. */
+int MidiDeviceComponent::render()             { return pimpl_->render(); }
 /** Paints the UI for this device. */
 void MidiDeviceComponent::paint(Graphics& g)  { pimpl_->paint(g); }
 /** Handles component resize. */
 void MidiDeviceComponent::resized()           { pimpl_->resized(); }
-/** Pause/resume display updates. */
-void MidiDeviceComponent::setPaused(bool p)   { pimpl_->setPaused(p); }
-/** Clears all channel/controller data. */
-void MidiDeviceComponent::resetChannelData()  { pimpl_->resetChannelData(); }
+/** Rebuilds the metrics when the device UI is placed in another window. */
+void MidiDeviceComponent::parentHierarchyChanged()  { pimpl_->parentHierarchyChanged(); }
+/** Rasterizes the device UI on render workers, or on the message thread when nullptr. */
+void MidiDeviceComponent::setRenderWorkers(RenderWorkers* w)  { pimpl_->setRenderWorkers(w); }
 
-/** Handles incoming MIDI message. */
-void MidiDeviceComponent::handleIncomingMidiMessage(const MidiMessage& m)   { pimpl_->handleIncomingMidiMessage(nullptr, m); };
 /** Accepts drag-and-drop for SVG themes. */
 bool MidiDeviceComponent::isInterestedInFileDrag(const StringArray& f)      { return pimpl_->isInterestedInFileDrag(f); }
 /** Handles dropped files (e.g. SVG theme import). */
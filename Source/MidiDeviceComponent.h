@@ -24,23 +24,24 @@
 
 namespace showmidi
 {
+    class MidiDeviceState;
+    class RenderWorkers;
+    
+    /** Displays the state of a MIDI device, the state itself is owned elsewhere and outlives the view. */
     class MidiDeviceComponent : public Component, public FileDragAndDropTarget
     {
     public:
-        MidiDeviceComponent(SettingsManager*, const String&);
-        MidiDeviceComponent(SettingsManager*, const MidiDeviceInfo&);
+        MidiDeviceComponent(SettingsManager*, MidiDeviceState&);
         ~MidiDeviceComponent() override;
         
         int getStandardWidth() const;
         int getVisibleHeight() const;
 
-        void render();
+        int render();
         void paint(Graphics&) override;
         void resized() override;
-        void setPaused(bool);
-        void resetChannelData();
-
-        void handleIncomingMidiMessage(const MidiMessage&);
+        void parentHierarchyChanged() override;
+        void setRenderWorkers(RenderWorkers*);
         
         bool isInterestedInFileDrag(const StringArray&) override;
         void filesDropped(const StringArray&, int, int) override;
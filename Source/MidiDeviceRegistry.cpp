@@ -0,0 +1,252 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiDeviceRegistry.h"
+
+#include "MidiDeviceInfoComparator.h"
+#include "MidiDeviceState.h"
+#include "MidiFileReplay.h"
+#include "RawMidiInput.h"
+#include "StateStreamViewer.h"
+
+#if JUCE_LINUX && JUCE_ALSA
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#endif
+
+namespace showmidi
+{
+#if JUCE_LINUX && JUCE_ALSA
+/** Listens to the port announcements of the ALSA sequencer on a background thread. */
+class AlsaAnnounceWatcher : public Thread
+{
+public:
+    static constexpr int POLL_TIMEOUT_MS = 200;
+    
+    AlsaAnnounceWatcher(std::function<void()> onChange) : Thread("MIDI device watcher"), onChange_(onChange)
+    {
+    }
+    
+    ~AlsaAnnounceWatcher()
+    {
+        stopThread(POLL_TIMEOUT_MS * 5);
+        if (seq_ != nullptr)
+        {
+            snd_seq_close(seq_);
+        }
+    }
+    
+    bool start()
+    {
+        if (snd_seq_open(&seq_, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0)
+        {
+            seq_ = nullptr;
+            return false;
+        }
+        
+        snd_seq_set_client_name(seq_, "ShowMIDI device watcher");
+        auto port = snd_seq_create_simple_port(seq_, "announce",
+                                               SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_NO_EXPORT,
+                                               SND_SEQ_PORT_TYPE_APPLICATION);
+        if (port < 0 || snd_seq_connect_from(seq_, port, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE) < 0)
+        {
+            snd_seq_close(seq_);
+            seq_ = nullptr;
+            return false;
+        }
+        
+        startThread();
+        return true;
+    }
+    
+    void run() override
+    {
+        std::vector<pollfd> descriptors((size_t)snd_seq_poll_descriptors_count(seq_, POLLIN));
+        snd_seq_poll_descriptors(seq_, descriptors.data(), (unsigned int)descriptors.size(), POLLIN);
+        
+        while (!threadShouldExit())
+        {
+            // the timeout only serves to notice that the thread should exit
+            if (poll(descriptors.data(), (nfds_t)descriptors.size(), POLL_TIMEOUT_MS) <= 0)
+            {
+                continue;
+            }
+            
+            auto changed = false;
+            snd_seq_event_t* event = nullptr;
+            int result;
+            while ((result = snd_seq_event_input(seq_, &event)) >= 0 || result == -ENOSPC)
+            {
+                // an overrun lost announcements, so whatever they were the devices have to be checked
+                if (result == -ENOSPC || event == nullptr)
+                {
+                    changed = true;
+                    continue;
+                }
+                
+                switch (event->type)
+                {
+                    case SND_SEQ_EVENT_CLIENT_START:
+                    case SND_SEQ_EVENT_CLIENT_EXIT:
+                    case SND_SEQ_EVENT_CLIENT_CHANGE:
+                    case SND_SEQ_EVENT_PORT_START:
+                    case SND_SEQ_EVENT_PORT_EXIT:
+                    case SND_SEQ_EVENT_PORT_CHANGE:
+                        changed = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            
+            if (changed)
+            {
+                onChange_();
+            }
+        }
+    }
+    
+private:
+    snd_seq_t* seq_ { nullptr };
+    std::function<void()> onChange_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AlsaAnnounceWatcher)
+};
+#endif
+
+struct MidiDeviceRegistry::Pimpl : public AsyncUpdater, public Timer
+{
+    static constexpr int POLL_FREQUENCY_HZ = 5;
+    
+    Pimpl() = default;
+    
+    ~Pimpl()
+    {
+        stopWatching();
+    }
+    
+    void startWatching()
+    {
+        // the devices of a state stream come and go with the stream
+        StateStreamViewer::setDevicesChangedCallback([this] { triggerAsyncUpdate(); });
+        update();
+        
+#if JUCE_LINUX && JUCE_ALSA
+        // the announcements arrive on the watcher thread, enumerating is left to the message thread
+        // so that a burst of announcements for a single device results in a single update
+        watcher_ = std::make_unique<AlsaAnnounceWatcher>([this] { triggerAsyncUpdate(); });
+        if (watcher_->start())
+        {
+            return;
+        }
+        watcher_.reset();
+#endif
+        
+        startTimerHz(POLL_FREQUENCY_HZ);
+    }
+    
+    void stopWatching()
+    {
+        StateStreamViewer::setDevicesChangedCallback(nullptr);
+        stopTimer();
+#if JUCE_LINUX && JUCE_ALSA
+        watcher_.reset();
+#endif
+        cancelPendingUpdate();
+    }
+    
+    void handleAsyncUpdate() override
+    {
+        update();
+    }
+    
+    void timerCallback() override
+    {
+        update();
+    }
+    
+    void update()
+    {
+        auto devices = MidiInput::getAvailableDevices();
+        devices.addArray(RawMidiInput::getAvailableDevices());
+        devices.addArray(StateStreamViewer::getAvailableDevices());
+        devices.addArray(MidiFileReplay::getAvailableDevices());
+        if (MidiDeviceState::hasVirtualInput())
+        {
+            devices.add({ MidiDeviceState::VIRTUAL_INPUT_NAME, MidiDeviceState::VIRTUAL_INPUT_IDENTIFIER });
+        }
+        
+        MidiDeviceInfoComparator comparator;
+        devices.sort(comparator);
+        
+        MidiDevicesChange change;
+        {
+            ScopedLock g(devicesLock_);
+            
+            for (auto& device : devices)
+            {
+                if (!devices_.contains(device))
+                {
+                    change.added_.add(device);
+                }
+            }
+            for (auto& device : devices_)
+            {
+                if (!devices.contains(device))
+                {
+                    change.removed_.add(device);
+                }
+            }
+            
+            if (change.isEmpty())
+            {
+                return;
+            }
+            
+            devices_.swapWith(devices);
+        }
+        
+        listeners_.broadcast(change);
+    }
+    
+    Array<MidiDeviceInfo> getDevices() const
+    {
+        ScopedLock g(devicesLock_);
+        return devices_;
+    }
+    
+    CriticalSection devicesLock_;
+    Array<MidiDeviceInfo> devices_;
+    MidiDevicesListeners listeners_;
+    
+#if JUCE_LINUX && JUCE_ALSA
+    std::unique_ptr<AlsaAnnounceWatcher> watcher_;
+#endif
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiDeviceRegistry::MidiDeviceRegistry() : pimpl_(new Pimpl()) {}
+MidiDeviceRegistry::~MidiDeviceRegistry() = default;
+
+void MidiDeviceRegistry::startWatching()                            { pimpl_->startWatching(); }
+void MidiDeviceRegistry::stopWatching()                             { pimpl_->stopWatching(); }
+Array<MidiDeviceInfo> MidiDeviceRegistry::getDevices() const        { return pimpl_->getDevices(); }
+void MidiDeviceRegistry::addListener(MidiDevicesListener* l)        { pimpl_->listeners_.add(l); }
+void MidiDeviceRegistry::removeListener(MidiDevicesListener* l)     { pimpl_->listeners_.remove(l); }
+void MidiDeviceRegistry::refreshListeners()                         { pimpl_->listeners_.broadcast(); }
+}
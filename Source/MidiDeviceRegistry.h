@@ -0,0 +1,59 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "MidiDevicesListener.h"
+
+namespace showmidi
+{
+    /**
+     * Keeps the sorted list of MIDI input devices and tells the listeners when it changes.
+     *
+     * On Linux the ALSA sequencer announces ports coming and going, the devices are only
+     * enumerated again after such an announcement. Elsewhere the devices are polled, but
+     * the listeners are still only called when the list actually changed. The raw MIDI
+     * devices and the virtual input of the app are listed next to the sequencer ports.
+     */
+    class MidiDeviceRegistry
+    {
+    public:
+        MidiDeviceRegistry();
+        ~MidiDeviceRegistry();
+        
+        /** Enumerates the devices and starts following their changes. */
+        void startWatching();
+        void stopWatching();
+        
+        /** The devices sorted by name, as of the last change. */
+        Array<MidiDeviceInfo> getDevices() const;
+        
+        /** Listeners are called on the message thread. */
+        void addListener(MidiDevicesListener*);
+        void removeListener(MidiDevicesListener*);
+        /** Asks the listeners to look at the devices again without them having changed. */
+        void refreshListeners();
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiDeviceRegistry)
+    };
+}
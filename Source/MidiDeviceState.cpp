@@ -0,0 +1,1346 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiDeviceState.h"
+
+// the terminal front end shares this state without any of the GUI modules
+#if !SHOWMIDI_HEADLESS
+#include "FramePacer.h"
+#endif
+#include "LatencyProbe.h"
+#include "MidiCaptureRecorder.h"
+#include "MidiFileReplay.h"
+#include "MidiTimeline.h"
+#include "RawMidiInput.h"
+#include "Settings.h"
+#include "SharedStatePublisher.h"
+#include "StateStreamServer.h"
+#include "StateStreamViewer.h"
+
+namespace showmidi
+{
+/** Opens the MIDI input devices away from the message thread. */
+class MidiDeviceOpener : public ThreadPool
+{
+public:
+    // the drivers aren't guaranteed to be thread-safe, a single thread keeps their calls serialized
+    MidiDeviceOpener() : ThreadPool(1)
+    {
+    }
+};
+
+/** Builds the keyframes of the timelines, the threads that ingest the messages only ask for them. */
+class MidiTimelineBuilder : private Thread
+{
+public:
+    // seeks start from the keyframe before until the one that was asked for is built
+    static constexpr int BUILD_INTERVAL_MS = 50;
+    
+    MidiTimelineBuilder() : Thread("MIDI timeline")
+    {
+        startThread(Thread::Priority::low);
+    }
+    
+    ~MidiTimelineBuilder() override
+    {
+        stopThread(BUILD_INTERVAL_MS * 20);
+    }
+    
+    void add(MidiDeviceState::Pimpl* state)
+    {
+        const std::lock_guard<std::mutex> lock(statesLock_);
+        states_.add(state);
+    }
+    
+    /** Only waits when the keyframes of this state are being built, the others are built without the lock. */
+    void remove(MidiDeviceState::Pimpl* state)
+    {
+        std::unique_lock<std::mutex> lock(statesLock_);
+        states_.removeFirstMatchingValue(state);
+        built_.wait(lock, [this, state] { return building_ != state; });
+    }
+    
+    void run() override;
+    
+private:
+    std::mutex statesLock_;
+    std::condition_variable built_;
+    Array<MidiDeviceState::Pimpl*> states_;
+    MidiDeviceState::Pimpl* building_ { nullptr };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiTimelineBuilder)
+};
+
+struct MidiDeviceState::Pimpl : public MidiInputCallback, public RawMidiInputCallback, public StateStreamCallback, public MidiFileReplayCallback, public MidiTimelineCallback
+{
+    static constexpr int TIMESTAMP_QUEUE_SIZE = 48;
+    static constexpr double BPM_MIN = 20.0;
+    static constexpr double BPM_MAX = 360.0;
+    
+    // longer than any control graph is able to show
+    static constexpr int64 MAX_HISTORY_MS = 60000;
+    
+    // the thru latency is averaged over roughly the last hundred messages
+    static constexpr double THRU_AVERAGE_WEIGHT = 0.01;
+    
+    // the plugin and the replicas don't keep a timeline, the audio thread never logs or allocates for it
+    Pimpl(const String& name) :
+    deviceInfo_({ name, ""})
+    {
+    }
+    
+    Pimpl(const MidiDeviceInfo info) :
+    deviceInfo_(info),
+    status_(DeviceStatus::deviceOpening),
+    openDeadline_(Time::currentTimeMillis() + OPEN_TIMEOUT_MS),
+    sharedState_(std::make_unique<SharedStatePublisher::Slot>(info)),
+    streamTap_(std::make_unique<StateStreamServer::Tap>(info)),
+    capture_(std::make_unique<MidiCaptureRecorder::Track>(info)),
+    timeline_(std::make_unique<MidiTimeline>(eventLog_))
+    {
+        startTimeline();
+        opener_->addJob(new OpenJob(opening_, info.identifier), true);
+#if SHOW_TEST_DATA
+        showTestData();
+#endif
+    }
+    
+    void showTestData()
+    {
+        const auto t = Time::getCurrentTime();
+        
+        deviceInfo_ = {"MIDI Instrument Name", deviceInfo_.identifier};
+        
+        auto& sysex = channels_.sysex_;
+        sysex.time_ = t;
+        sysex.length_ = 0xC;
+        uint8_t data[Sysex::MAX_SYSEX_DATA] = {
+            0x1, 0x2, 0xA, 0x7F, 0x0, 0xFE, 0x0, 0xAA, 0x1, 0x7E,
+            0x1, 0x2, 0xA, 0x7F, 0x0, 0xFE, 0x0, 0xAA, 0x1, 0x7E};
+        memcpy(sysex.data_, data, Sysex::MAX_SYSEX_DATA);
+        
+        auto& clock = channels_.clock_;
+        clock.bpm_ = 111.1;
+        clock.timeBpm_ = t;
+        clock.timeStart_ = t;
+        clock.timeContinue_ = t;
+        clock.timeStop_ = t;
+        
+        auto& channel1 = channels_.channel_[0];
+        channel1.mpeManager_ = true;
+        channel1.mpeMember_ = MpeMember::mpeLower;
+        channel1.time_ = t;
+        channel1.programChange_.current_.value_ = 0;
+        channel1.programChange_.current_.time_ = t;
+        channel1.pitchBend_.current_.value_ = 9256;
+        channel1.pitchBend_.current_.time_ = t;
+        channel1.notes_.time_ = t;
+        channel1.notes_.noteOn_[61].current_.value_ = 127;
+        channel1.notes_.noteOn_[61].current_.time_ = t;
+        channel1.notes_.noteOn_[61].polyPressure_.current_.value_ = 0;
+        channel1.notes_.noteOn_[79].current_.value_ = 38;
+        channel1.notes_.noteOn_[79].current_.time_ = t;
+        channel1.notes_.noteOn_[79].polyPressure_.current_.value_ = 120;
+        channel1.notes_.noteOn_[79].polyPressure_.current_.time_ = t;
+        channel1.channelPressure_.current_.value_ = 76;
+        channel1.channelPressure_.current_.time_ = t;
+        channel1.controlChanges_.time_ = t;
+        channel1.controlChanges_.controlChange_[74].current_.value_ = 127;
+        channel1.controlChanges_.controlChange_[74].current_.time_ = t;
+        auto& cc74_history = channel1.controlChanges_.controlChange_[74].history_;
+        auto cc74_t = t.toMilliseconds();
+        cc74_history.push_back({Time(cc74_t -= 100), 100});
+        cc74_history.push_back({Time(cc74_t -= 100), 99});
+        cc74_history.push_back({Time(cc74_t -= 100), 95});
+        cc74_history.push_back({Time(cc74_t -= 700), 90});
+        cc74_history.push_back({Time(cc74_t -= 1000), 80});
+        cc74_history.push_back({Time(cc74_t -= 3000), 30});
+        channel1.controlChanges_.controlChange_[7].current_.value_ = 64;
+        channel1.controlChanges_.controlChange_[7].current_.time_ = Time(t.toMilliseconds() - 500);
+        channel1.controlChanges_.controlChange_[39].current_.value_ = 32;
+        channel1.controlChanges_.controlChange_[39].current_.time_ = t;
+        channel1.rpns_.time_ = t;
+        channel1.rpns_.param_[0].current_.time_ = t;
+        channel1.rpns_.param_[0].current_.value_ = (96 << 7) + 50;
+        channel1.rpns_.param_[1].current_.time_ = t;
+        channel1.rpns_.param_[1].current_.value_ = (127 << 7) + 127;
+        channel1.rpns_.param_[2].current_.time_ = t;
+        channel1.rpns_.param_[2].current_.value_ = (127 << 7) + 127;
+        channel1.rpns_.param_[6].current_.time_ = t;
+        channel1.rpns_.param_[6].current_.value_ = 10;
+        channel1.hrccs_.time_ = t;
+        channel1.hrccs_.param_[7].current_.time_ = t;
+        channel1.hrccs_.param_[7].current_.value_ = 64 << 7 | 32 ;
+        
+        auto& channel16 = channels_.channel_[15];
+        channel16.time_ = t;
+        channel16.programChange_.current_.value_ = 127;
+        channel16.programChange_.current_.time_ = t;
+        channel16.pitchBend_.current_.value_ = 0;
+        channel16.pitchBend_.current_.time_ = t;
+        channel16.notes_.time_ = t;
+        channel16.notes_.noteOn_[61].current_.value_ = 127;
+        channel16.notes_.noteOn_[61].current_.time_ = t;
+        channel16.notes_.noteOn_[61].polyPressure_.current_.value_ = 73;
+        channel16.notes_.noteOn_[61].polyPressure_.current_.time_ = t;
+        channel16.notes_.noteOn_[79].current_.value_ = 127;
+        channel16.notes_.noteOn_[79].current_.time_ = t;
+        channel16.notes_.noteOn_[79].polyPressure_.current_.value_ = 0;
+        channel16.notes_.noteOff_[79].current_.value_ = 127;
+        channel16.notes_.noteOff_[79].current_.time_ = t;
+        channel16.channelPressure_.current_.value_ = 76;
+        channel16.channelPressure_.current_.time_ = t;
+        channel16.controlChanges_.time_ = t;
+        channel16.controlChanges_.controlChange_[1].current_.value_ = 124;
+        channel16.controlChanges_.controlChange_[1].current_.time_ = t;
+        channel16.controlChanges_.controlChange_[45].current_.value_ = 89;
+        channel16.controlChanges_.controlChange_[45].current_.time_ = t;
+        channel16.controlChanges_.controlChange_[127].current_.value_ = 100;
+        channel16.controlChanges_.controlChange_[127].current_.time_ = t;
+    }
+    
+    ~Pimpl()
+    {
+        if (timeline_ != nullptr)
+        {
+            timelineBuilder_->remove(this);
+        }
+        // jobs that are still opening keep running without waiting for them, they close what they open
+        {
+            const ScopedLock lock(opening_->lock_);
+            opening_->owner_ = nullptr;
+        }
+        midiIn_ = nullptr;
+        rawIn_ = nullptr;
+        streamIn_ = nullptr;
+        timeSource_ = nullptr;
+        replay_ = nullptr;
+    }
+    
+    /**
+     * Shared by the pimpl and its opener jobs, which may outlive it.
+     * Devices are only handed over while the owner is held, and never after it's gone.
+     */
+    struct Opening
+    {
+        Opening(Pimpl* owner) : owner_(owner)
+        {
+        }
+        
+        CriticalSection lock_;
+        Pimpl* owner_;
+    };
+    
+    struct OpenJob : public ThreadPoolJob
+    {
+        OpenJob(std::shared_ptr<Opening> opening, const String& identifier) :
+        ThreadPoolJob("Open MIDI device"),
+        opening_(opening),
+        identifier_(identifier)
+        {
+        }
+        
+        JobStatus runJob() override
+        {
+            openDevice(*opening_, identifier_);
+            return jobHasFinished;
+        }
+        
+        const std::shared_ptr<Opening> opening_;
+        const String identifier_;
+    };
+    
+    struct ThruJob : public ThreadPoolJob
+    {
+        ThruJob(std::shared_ptr<Opening> opening) :
+        ThreadPoolJob("Open MIDI thru output"),
+        opening_(opening)
+        {
+        }
+        
+        JobStatus runJob() override
+        {
+            openThruOutput(*opening_);
+            return jobHasFinished;
+        }
+        
+        const std::shared_ptr<Opening> opening_;
+    };
+    
+    /** Runs on the opener thread, the owner may be destroyed while the driver is opening. */
+    static void openDevice(Opening& opening, const String& identifier)
+    {
+        if (MidiFileReplay::isReplayDevice(identifier) || StateStreamViewer::isStreamDevice(identifier))
+        {
+            // these deliver as soon as they exist and don't wait on a driver, they're opened with the owner held
+            const ScopedLock lock(opening.lock_);
+            if (opening.owner_ != nullptr)
+            {
+                opening.owner_->openInProcessDevice(identifier);
+            }
+            return;
+        }
+        
+        Pimpl* owner;
+        {
+            const ScopedLock lock(opening.lock_);
+            owner = opening.owner_;
+        }
+        if (owner == nullptr)
+        {
+            return;
+        }
+        
+        // the inputs don't call back before they're started, which is left to the owner
+        std::unique_ptr<RawMidiInput> raw_input;
+        std::unique_ptr<MidiInput> midi_input;
+        if (RawMidiInput::isRawMidiDevice(identifier))
+        {
+            raw_input = RawMidiInput::openDevice(identifier, owner);
+        }
+        else
+        {
+            // the virtual input is a sequencer port that other applications send to directly
+            midi_input = identifier == VIRTUAL_INPUT_IDENTIFIER ? MidiInput::createNewDevice(VIRTUAL_INPUT_NAME, owner)
+                                                                : MidiInput::openDevice(identifier, owner);
+        }
+        
+        // when the owner is gone, the inputs are closed here without ever having been started
+        const ScopedLock lock(opening.lock_);
+        if (opening.owner_ != nullptr)
+        {
+            opening.owner_->adoptInput(std::move(raw_input), std::move(midi_input));
+        }
+    }
+    
+    void openInProcessDevice(const String& identifier)
+    {
+        if (MidiFileReplay::isReplayDevice(identifier))
+        {
+            // the replay plays on its own clock, the channels are looked at with it
+            auto replay = MidiFileReplay::openDevice(identifier, this);
+            status_ = replay != nullptr ? DeviceStatus::deviceOpen : DeviceStatus::deviceFailed;
+            timeSource_ = replay.get();
+            replay_.swap(replay);
+        }
+        else
+        {
+            auto stream_input = StateStreamViewer::openDevice(identifier, this);
+            status_ = stream_input != nullptr ? DeviceStatus::deviceOpen : DeviceStatus::deviceFailed;
+            streamIn_.swap(stream_input);
+        }
+        markDirty();
+    }
+    
+    /** Starts the input that was opened for this state, it's only touched again by the destructor. */
+    void adoptInput(std::unique_ptr<RawMidiInput> rawInput, std::unique_ptr<MidiInput> midiInput)
+    {
+        if (rawInput != nullptr)
+        {
+            rawInput->start();
+            rawIn_.swap(rawInput);
+            status_ = DeviceStatus::deviceOpen;
+        }
+        else if (midiInput != nullptr)
+        {
+            midiInput->start();
+            midiIn_.swap(midiInput);
+            status_ = DeviceStatus::deviceOpen;
+        }
+        else
+        {
+            status_ = DeviceStatus::deviceFailed;
+        }
+        markDirty();
+    }
+    
+    void setThruOutput(const String& identifier)
+    {
+        {
+            const SpinLock::ScopedLockType lock(thruLock_);
+            thruIdentifier_ = identifier;
+        }
+        
+        // a job that is still opening picks the new output up before it finishes
+        if (!thruOpening_.exchange(true))
+        {
+            opener_->addJob(new ThruJob(opening_), true);
+        }
+    }
+    
+    String getThruOutput()
+    {
+        const SpinLock::ScopedLockType lock(thruLock_);
+        return thruIdentifier_;
+    }
+    
+    /** Runs on the opener thread, opens outputs until the one that was asked for last is open. */
+    static void openThruOutput(Opening& opening)
+    {
+        auto finished = false;
+        while (!finished)
+        {
+            String identifier;
+            {
+                const ScopedLock lock(opening.lock_);
+                if (opening.owner_ == nullptr)
+                {
+                    return;
+                }
+                identifier = opening.owner_->getThruOutput();
+            }
+            
+            std::unique_ptr<MidiOutput> output;
+            if (identifier.isNotEmpty())
+            {
+                output = MidiOutput::openDevice(identifier);
+            }
+            
+            // the output that was replaced, or the one nobody is left to use, is closed here
+            const ScopedLock lock(opening.lock_);
+            if (opening.owner_ == nullptr)
+            {
+                return;
+            }
+            finished = opening.owner_->adoptThruOutput(identifier, output);
+        }
+    }
+    
+    /** Swaps in the output that was opened, returns true when it's the one that was asked for last. */
+    bool adoptThruOutput(const String& identifier, std::unique_ptr<MidiOutput>& output)
+    {
+        auto finished = false;
+        {
+            const SpinLock::ScopedLockType lock(thruLock_);
+            thruOutput_.swap(output);
+            thruActive_ = thruOutput_ != nullptr;
+            thruAverageUs_ = 0.0;
+            thruMaximumUs_ = 0.0;
+            
+            // a later request either still sees the job running, or comes after it finished
+            finished = identifier == thruIdentifier_;
+            if (finished)
+            {
+                thruOpening_ = false;
+            }
+        }
+        markDirty();
+        return finished;
+    }
+    
+    /** Sends the message on before anything else is done with it, and measures how long that takes. */
+    void forward(const MidiMessage& msg)
+    {
+        if (!thruActive_)
+        {
+            return;
+        }
+        
+        const SpinLock::ScopedLockType lock(thruLock_);
+        if (thruOutput_ == nullptr)
+        {
+            return;
+        }
+        
+        auto start = Time::getHighResolutionTicks();
+        thruOutput_->sendMessageNow(msg);
+        auto elapsed_us = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000000.0;
+        
+        auto average = thruAverageUs_.load();
+        thruAverageUs_ = average == 0.0 ? elapsed_us : average + (elapsed_us - average) * THRU_AVERAGE_WEIGHT;
+        thruMaximumUs_ = std::max(thruMaximumUs_.load(), elapsed_us);
+    }
+    
+    MidiDeviceState::ThruLatency getThruLatency() const
+    {
+        return { thruActive_, thruAverageUs_, thruMaximumUs_ };
+    }
+    
+    void setLatencyProbe(LatencyProbe* probe)
+    {
+        const SpinLock::ScopedLockType lock(probeLock_);
+        probe_ = probe;
+    }
+    
+    /** Hands the message to the latency probe, probes are neither forwarded nor shown. */
+    bool isProbe(const MidiMessage& msg, int64 ticks)
+    {
+        if (!msg.isSysEx())
+        {
+            return false;
+        }
+        
+        const SpinLock::ScopedLockType lock(probeLock_);
+        return probe_ != nullptr && probe_->handleIncomingMidiMessage(msg, ticks);
+    }
+    
+    /** Handles incoming MIDI messages and updates state. */
+    void handleIncomingMidiMessage(MidiInput*, const MidiMessage& msg) override
+    {
+        if (isProbe(msg, Time::getHighResolutionTicks()))
+        {
+            return;
+        }
+        
+        forward(msg);
+        handleMessage(msg, Time::getCurrentTime());
+    }
+    
+    void handleRawMidiMessage(const MidiMessage& msg, Time t) override
+    {
+        if (isProbe(msg, Time::getHighResolutionTicks()))
+        {
+            return;
+        }
+        
+        forward(msg);
+        handleMessage(msg, t);
+    }
+    
+    /** The changes of a remote device are handled like the messages of a local one. */
+    void handleStreamedMessage(const MidiMessage& msg, Time t) override
+    {
+        handleMessage(msg, t);
+    }
+    
+    void handleReplayedMessage(const MidiMessage& msg, Time t) override
+    {
+        forward(msg);
+        handleMessage(msg, t);
+    }
+    
+    void handleStreamedTempo(double bpm, Time t) override
+    {
+        // the tempo doesn't arrive as a message, the timeline keeps it next to them
+        if (timeline_ != nullptr)
+        {
+            timeline_->addTempo(bpm, t.toMilliseconds());
+        }
+        applyTempo(bpm, t);
+    }
+    
+    void applyTempo(double bpm, const Time& t)
+    {
+        auto& clock = channels_.clock_;
+        reviveSlot(t, clock.timeBpm_);
+        clock.timeBpm_ = t;
+        clock.bpm_ = bpm;
+        markDirty();
+    }
+    
+    void handleStreamedReset() override
+    {
+        resetChannelData();
+    }
+    
+    void handleMessage(const MidiMessage& msg, const Time t)
+    {
+        // the timeline keeps what the log doesn't at the position the message is about to get
+        if (timeline_ != nullptr)
+        {
+            timeline_->add(msg, t.toMilliseconds());
+        }
+        eventLog_.add(msg, t.toMilliseconds());
+        if (capture_ != nullptr)
+        {
+            capture_->add(msg, t);
+        }
+        if (streamTap_ != nullptr)
+        {
+            streamTap_->add(msg, t);
+        }
+        
+        applyMessage(msg, t);
+    }
+    
+    /** The log that the timeline reads is kept from the start, the message log shows it too. */
+    void startTimeline()
+    {
+        eventLog_.setEnabled(true);
+        timelineBuilder_->add(this);
+    }
+    
+    /** Only called from the timeline builder, the keyframes are replayed into a replica. */
+    void buildKeyframes()
+    {
+        if (keyframer_ == nullptr)
+        {
+            // a state that's fed by nothing but the timeline, the past is ingested with the same code as the present
+            keyframer_ = std::make_unique<Pimpl>(deviceInfo_.name);
+        }
+        timeline_->buildKeyframes(keyframer_->channels_, keyframer_->midiTimeStamps_, *keyframer_);
+    }
+    
+    void handleTimelineMessage(const MidiMessage& msg, Time t) override
+    {
+        applyMessage(msg, t);
+    }
+    
+    void handleTimelineSysex(const uint8* data, int size, Time t) override
+    {
+        handleSysex(data, size, t);
+    }
+    
+    void handleTimelineTempo(double bpm, Time t) override
+    {
+        applyTempo(bpm, t);
+    }
+    
+    void handleSysex(const uint8* data, int size, const Time& t)
+    {
+        auto& sysex = channels_.sysex_;
+        sysex.time_ = t;
+        sysex.length_ = size;
+        memset(sysex.data_, 0, Sysex::MAX_SYSEX_DATA);
+        memcpy(sysex.data_, data, (size_t)std::min(size, Sysex::MAX_SYSEX_DATA));
+        // the number of data rows follows the length, always lay out again
+        layoutDirty_ = true;
+        markDirty();
+    }
+    
+    /** Updates the channels with a message. */
+    void applyMessage(const MidiMessage& msg, const Time t)
+    {
+        if (msg.isSysEx())
+        {
+            handleSysex(msg.getSysExData(), msg.getSysExDataSize(), t);
+            return;
+        }
+        
+        if (msg.isMidiClock())
+        {
+            auto ts_secs = msg.getTimeStamp();
+            
+            // keep a queue of MIDI clock timestamps, never exceeding TIMESTAMP_QUEUE_SIZE
+            midiTimeStamps_.push_front(ts_secs);
+            while (midiTimeStamps_.size() > TIMESTAMP_QUEUE_SIZE)
+            {
+                midiTimeStamps_.pop_back();
+            }
+            
+            // calculate the average across all the queued timestamps
+            // this will be used to filter out outliers
+            auto avg_ts = 0.0;
+            for (size_t i = 0; i < midiTimeStamps_.size(); i++)
+            {
+                avg_ts += midiTimeStamps_[i];
+            }
+            avg_ts /= midiTimeStamps_.size();
+            
+            // only keep timestamps that are within 1% deviation of the average
+            std::vector<double> keep;
+            for (size_t i = 0; i < midiTimeStamps_.size(); i++)
+            {
+                if (fabs(avg_ts - midiTimeStamps_[i]) < avg_ts * 0.01)
+                {
+                    keep.push_back(midiTimeStamps_[i]);
+                }
+            }
+            
+            // if we have at least four valid timestamps, calculate the bpm
+            if (keep.size() > 4)
+            {
+                auto sum = 0.0;
+                auto size = (int) keep.size() - 1;
+                for (auto i = 0; i < size; i++)
+                {
+                    sum += fabs(keep[i] - keep[i + 1]);
+                }
+                sum /= size;
+                
+                auto bpm = int((600.0 / sum / 24.0) + 0.5) / 10.0;
+                bpm = std::min(std::max(bpm, BPM_MIN), BPM_MAX);
+                
+                if (keep.size() > TIMESTAMP_QUEUE_SIZE / 2)
+                {
+                    auto& clock = channels_.clock_;
+                    if ((t - clock.timeBpm_).inSeconds() > 0.5)
+                    {
+                        reviveSlot(t, clock.timeBpm_);
+                        clock.timeBpm_ = t;
+                        if (fabs(clock.bpm_ - bpm) >= 0.1)
+                        {
+                            clock.bpm_ = bpm;
+                            markDirty();
+                            
+                            if (sharedState_ != nullptr)
+                            {
+                                sharedState_->publishTempo(bpm);
+                            }
+                            if (streamTap_ != nullptr)
+                            {
+                                streamTap_->addTempo(bpm, t);
+                            }
+                        }
+                    }
+                }
+            }
+            return;
+        }
+        else if (msg.isMidiStart())
+        {
+            reviveSlot(t, channels_.clock_.timeStart_);
+            channels_.clock_.timeStart_ = t;
+            midiTimeStamps_.clear();
+            markDirty();
+            return;
+        }
+        else if (msg.isMidiContinue())
+        {
+            reviveSlot(t, channels_.clock_.timeContinue_);
+            channels_.clock_.timeContinue_ = t;
+            midiTimeStamps_.clear();
+            markDirty();
+            return;
+        }
+        else if (msg.isMidiStop())
+        {
+            reviveSlot(t, channels_.clock_.timeStop_);
+            channels_.clock_.timeStop_ = t;
+            midiTimeStamps_.clear();
+            markDirty();
+            return;
+        }
+        
+        if (msg.getChannel() <= 0)
+        {
+            return;
+        }
+        
+        ChannelMessage* channel_message = nullptr;
+        
+        auto& channel = channels_.channel_[msg.getChannel() - 1];
+        if (msg.isNoteOn())
+        {
+            auto& notes = channel.notes_;
+            notes.time_ = t;
+            
+            auto& note_off = notes.noteOff_[msg.getNoteNumber()];
+            if (note_off.current_.time_.toMilliseconds() != 0)
+            {
+                // the note off row disappears again
+                layoutDirty_ = true;
+            }
+            note_off.current_.time_ = Time();
+            
+            auto& note_on = notes.noteOn_[msg.getNoteNumber()];
+            note_on.current_.value_ = msg.getVelocity();
+            channel_message = &note_on;
+            
+            const std::lock_guard<std::mutex> lock(historyLock_);
+            channel.noteSpans_.noteOn(msg.getNoteNumber(), msg.getVelocity(), t.toMilliseconds());
+            channel.noteHeat_.noteOn(msg.getNoteNumber(), msg.getVelocity(), t.toMilliseconds());
+        }
+        else if (msg.isNoteOff())
+        {
+            auto& notes = channel.notes_;
+            notes.time_ = t;
+            
+            auto& note_off = notes.noteOff_[msg.getNoteNumber()];
+            auto& note_on = notes.noteOn_[msg.getNoteNumber()];
+            if (isHeld(note_on, note_off))
+            {
+                // a released note lingers for the timeout delay, starting now
+                note_on.current_.time_ = t;
+            }
+            note_off.current_.value_ = msg.getVelocity();
+            channel_message = &note_off;
+            
+            const std::lock_guard<std::mutex> lock(historyLock_);
+            channel.noteSpans_.noteOff(msg.getNoteNumber(), t.toMilliseconds());
+        }
+        else if (msg.isAftertouch())
+        {
+            auto& notes = channel.notes_;
+            notes.time_ = t;
+            
+            auto& note_on = notes.noteOn_[msg.getNoteNumber()];
+            channel_message = &note_on.polyPressure_;
+            collectHistory(channel_message);
+            channel_message->current_.value_ = msg.getAfterTouchValue();
+        }
+        else if (msg.isController())
+        {
+            auto& control_changes = channel.controlChanges_;
+            control_changes.time_ = t;
+            
+            auto number = msg.getControllerNumber();
+            auto value = msg.getControllerValue();
+            
+            switch (number)
+            {
+                case 98:
+                    channel.lastNrpnLsb_ = value;
+                    break;
+                case 99:
+                    channel.lastNrpnMsb_ = value;
+                    break;
+                case 100:
+                    channel.lastRpnLsb_ = value;
+                    // resetting RPN numbers also resets NRPN numbers
+                    if (channel.lastRpnLsb_ == 127 && channel.lastRpnMsb_ == 127)
+                    {
+                        channel.lastNrpnLsb_ = 127;
+                        channel.lastNrpnMsb_ = 127;
+                    }
+                    break;
+                case 101:
+                    channel.lastRpnMsb_ = value;
+                    break;
+                default:
+                    // Support for 14-bit high resolution control changes as per MIDI 1.0 Detailed Specification v4.2.1:
+                    // 1. both MSB and LSB need to be transmitted initially
+                    // 2. subsequent fine adjustment can use only the LSB value and reuse the previous MSB value
+                    // 3. subsequent major adjustment must retransmit MSB, upon MSB reception the concept of LSB should be set to 0
+                    // Additional personal interpretations:
+                    // 4. for bullet 3: LSB is only set to 0 when MSB value is different
+                    // 5. for bullet 3: if previous MSB value was lower, then LSB is 0, otherwise LSB is 127
+                    if (number >= 0 && number < 32)
+                    {
+                        auto msb_number = number;
+                        auto lsb_number = msb_number + 32;
+                        auto& msb_tv = control_changes.controlChange_[msb_number].current_;
+                        auto& lsb_tv = control_changes.controlChange_[lsb_number].current_;
+                        // see bullet 1 above
+                        if (msb_tv.time_.toMilliseconds() > 0 &&
+                            lsb_tv.time_.toMilliseconds() > 0)
+                        {
+                            // see bullet 4 above
+                            if (msb_tv.value_ != value)
+                            {
+                                auto msb_value = value;
+                                // see bullet 5 above
+                                auto lsb_value = 0;
+                                if (msb_tv.value_ > msb_value)
+                                {
+                                    lsb_value = 127;
+                                }
+                                
+                                // see bullets 3, 4, 5 above
+                                handle14BitControlChangeValue(t, channel, msb_number, msb_value, lsb_value);
+                            }
+                        }
+                        // we also handle the data entry control change for NRPN and RPN here
+                        // since it can potentially be used only as MSB data entry only
+                        else if (number == 6)
+                        {
+                            handleDataEntryControlChange(t, channel, value, 0);
+                        }
+                    }
+                    else if (number >= 32 && number < 64)
+                    {
+                        auto msb_number = number - 32;
+                        auto& msb_tv = control_changes.controlChange_[msb_number].current_;
+                        // see bullet 1 above
+                        if (msb_tv.time_.toMilliseconds() > 0)
+                        {
+                            // see bullet 2 above
+                            auto msb_value = msb_tv.value_;
+                            auto lsb_value = value;
+                            handle14BitControlChangeValue(t, channel, msb_number, msb_value, lsb_value);
+                        }
+                    }
+                    break;
+            }
+            
+            channel_message = &control_changes.controlChange_[number];
+            collectHistory(channel_message);
+            channel_message->current_.value_ = value;
+        }
+        else if (msg.isProgramChange())
+        {
+            channel_message = &channel.programChange_;
+            channel_message->current_.value_ = msg.getProgramChangeNumber();
+        }
+        else if (msg.isChannelPressure())
+        {
+            channel_message = &channel.channelPressure_;
+            collectHistory(channel_message);
+            channel_message->current_.value_ = msg.getChannelPressureValue();
+        }
+        else if (msg.isPitchWheel())
+        {
+            channel_message = &channel.pitchBend_;
+            collectHistory(channel_message);
+            channel_message->current_.value_ = msg.getPitchWheelValue();
+        }
+        
+        if (channel_message != nullptr)
+        {
+            reviveSlot(t, channel_message->current_.time_);
+            channel_message->current_.time_ = t;
+            channel.time_ = t;
+            markDirty();
+            
+            publishChannel(channel, msg);
+        }
+    }
+    
+    void publishChannel(const ActiveChannel& channel, const MidiMessage& msg)
+    {
+        if (sharedState_ == nullptr)
+        {
+            return;
+        }
+        
+        // the MPE configuration message changes the zone of the other channels too
+        auto number = msg.isController() ? msg.getControllerNumber() : -1;
+        if ((number == 6 || number == 38) && channel.lastRpnMsb_ == 0 && channel.lastRpnLsb_ == 6)
+        {
+            for (auto& other : channels_.channel_)
+            {
+                sharedState_->stageChannel(other);
+            }
+        }
+        else
+        {
+            sharedState_->stageChannel(channel);
+        }
+    }
+    
+    void handle14BitControlChangeValue(const Time& t, ActiveChannel& channel, int number, int msbValue, int lsbValue)
+    {
+        auto was_rpn_or_nrpn = false;
+        // handle RPN or NRPN
+        if (number == 6)
+        {
+            was_rpn_or_nrpn = handleDataEntryControlChange(t, channel, msbValue, lsbValue);
+        }
+        
+        // handle Hi-Res Control Change
+        if (!was_rpn_or_nrpn)
+        {
+            const std::lock_guard<std::mutex> lock(paramsLock_);
+            
+            auto& hrcc = channel.hrccs_;
+            collectHistory(&hrcc.param_[number]);
+            reviveSlot(t, hrcc.param_[number].current_.time_);
+            
+            hrcc.time_ = t;
+            hrcc.param_[number].current_.time_ = t;
+            // see bullet 2 above
+            hrcc.param_[number].current_.value_ = (msbValue << 7) + lsbValue;
+        }
+    }
+    
+    bool handleDataEntryControlChange(const Time& t, ActiveChannel& channel, int msbValue, int lsbValue)
+    {
+        const std::lock_guard<std::mutex> lock(paramsLock_);
+        
+        if (channel.lastRpnMsb_ != 127 || channel.lastRpnLsb_ != 127)
+        {
+            auto rpn_number = (channel.lastRpnMsb_ << 7) + channel.lastRpnLsb_;
+            auto rpn_value = (msbValue << 7) + lsbValue;
+            auto& rpns = channel.rpns_;
+            collectHistory(&rpns.param_[rpn_number]);
+            reviveSlot(t, rpns.param_[rpn_number].current_.time_);
+            
+            rpns.time_ = t;
+            rpns.param_[rpn_number].current_.time_ = t;
+            rpns.param_[rpn_number].current_.value_ = rpn_value;
+            
+            // handle MPE activation message
+            if (rpn_number == 6 && msbValue <= 0xf)
+            {
+                channels_.handleMpeActivation(t, channel, msbValue);
+                layoutDirty_ = true;
+            }
+            
+            return true;
+        }
+        // handle NRPN
+        else if (channel.lastNrpnMsb_ != 127 || channel.lastNrpnLsb_ != 127)
+        {
+            auto nrpn_number = (channel.lastNrpnMsb_ << 7) + channel.lastNrpnLsb_;
+            auto nrpn_value = (msbValue << 7) + lsbValue;
+            auto& nrpns = channel.nrpns_;
+            collectHistory(&nrpns.param_[nrpn_number]);
+            reviveSlot(t, nrpns.param_[nrpn_number].current_.time_);
+            
+            nrpns.time_ = t;
+            nrpns.param_[nrpn_number].current_.time_ = t;
+            nrpns.param_[nrpn_number].current_.value_ = nrpn_value;
+            
+            return true;
+        }
+        
+        return false;
+    }
+    
+    /** Collects value history for smooth graphing. */
+    void collectHistory(ChannelMessage* message)
+    {
+        if (message->current_.time_.toMilliseconds() > 0)
+        {
+            const std::lock_guard<std::mutex> lock(historyLock_);
+            auto& history = message->history_;
+            history.insert(history.begin(), message->current_);
+            
+            // views only purge the history they paint, bound it for devices that aren't shown
+            auto horizon = message->current_.time_.toMilliseconds() - MAX_HISTORY_MS;
+            while (!history.empty() && history.back().time_.toMilliseconds() < horizon)
+            {
+                history.pop_back();
+            }
+        }
+    }
+    
+    void setFramePacer(FramePacer* pacer)
+    {
+        framePacer_ = pacer;
+        layoutDirty_ = true;
+        markDirty();
+    }
+    
+    /** Flags the state as changed and makes sure a frame will be rendered, can be called from any thread. */
+    void markDirty()
+    {
+        dirty_ = true;
+        wakeFramePacer();
+    }
+    
+    void wakeFramePacer()
+    {
+#if !SHOWMIDI_HEADLESS
+        auto pacer = framePacer_.load();
+        if (pacer != nullptr)
+        {
+            pacer->wake();
+        }
+#endif
+    }
+    
+    const MidiDeviceInfo& getDeviceInfo() const
+    {
+        return deviceInfo_;
+    }
+    
+    bool isOpen() const
+    {
+        return status_ == DeviceStatus::deviceOpen;
+    }
+    
+    DeviceStatus getDeviceStatus() const
+    {
+        auto status = status_.load();
+        if (status == DeviceStatus::deviceOpening && Time::currentTimeMillis() >= openDeadline_)
+        {
+            return DeviceStatus::deviceTimedOut;
+        }
+        return status;
+    }
+    
+    bool isPaused() const
+    {
+        return paused_;
+    }
+    
+    Time getCurrentTime() const
+    {
+        return paused_ ? pausedTime_ : getSourceTime();
+    }
+    
+    Time getSourceTime() const
+    {
+        auto source = timeSource_.load();
+        return source != nullptr ? source->getCurrentTime() : Time::getCurrentTime();
+    }
+    
+    ActiveChannels& getChannels()
+    {
+        return paused_ ? pausedChannels_ : channels_;
+    }
+    
+    void copyChannels(ActiveChannels& target)
+    {
+        const std::lock_guard<std::mutex> lock1(paramsLock_);
+        const std::lock_guard<std::mutex> lock2(historyLock_);
+        target.deepCopy(paused_ ? pausedChannels_ : channels_);
+    }
+    
+    void setTimeoutDelay(int delay)
+    {
+        timeoutDelay_ = delay;
+    }
+    
+    bool consumeChange()
+    {
+        bool expected = true;
+        return dirty_.compare_exchange_strong(expected, false);
+    }
+    
+    bool consumeLayoutChange()
+    {
+        bool expected = true;
+        return layoutDirty_.compare_exchange_strong(expected, false);
+    }
+    
+    /** Flags a new layout when a slot that is about to be updated currently isn't visible. */
+    void reviveSlot(const Time& t, const Time& slotTime)
+    {
+        auto delay = timeoutDelay_.load();
+        if (slotTime.toMilliseconds() == 0 ||
+            (delay != 0 && (t - slotTime).inSeconds() > delay))
+        {
+            layoutDirty_ = true;
+            wakeFramePacer();
+        }
+    }
+    
+    static bool isHeld(const NoteOn& noteOn, const NoteOff& noteOff)
+    {
+        return noteOn.current_.time_.toMilliseconds() != 0 && noteOff.current_.time_.toMilliseconds() == 0;
+    }
+    
+    static bool hasHeldNotes(const ActiveChannel& channel)
+    {
+        for (int i = 0; i < 128; ++i)
+        {
+            if (isHeld(channel.notes_.noteOn_[i], channel.notes_.noteOff_[i]))
+            {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    void setPaused(bool paused)
+    {
+        if (paused)
+        {
+            const std::lock_guard<std::mutex> lock1(paramsLock_);
+            const std::lock_guard<std::mutex> lock2(historyLock_);
+            pausedTime_ = getSourceTime();
+            pausedAt_ = pausedTime_;
+            pausedEnd_ = timeline_ != nullptr ? timeline_->getEnd() : 0;
+            pausedChannels_ = channels_;
+        }
+        
+        layoutDirty_ = true;
+        markDirty();
+        paused_ = paused;
+    }
+    
+    /** How far before the pause the timeline reaches, in milliseconds. */
+    int64 getTimelineLength() const
+    {
+        if (!paused_ || timeline_ == nullptr)
+        {
+            return 0;
+        }
+        
+        auto begin = timeline_->getBeginTime();
+        return begin == 0 ? 0 : std::max(pausedAt_.toMilliseconds() - begin, (int64)0);
+    }
+    
+    void setTimelineHistory(int64 history)
+    {
+        if (timeline_ != nullptr)
+        {
+            timeline_->setHistory(history);
+        }
+    }
+    
+    /** Only called from the message thread, like pausing. */
+    void scrubTo(int64 offset)
+    {
+        if (!paused_ || timeline_ == nullptr)
+        {
+            return;
+        }
+        
+        if (scrubber_ == nullptr)
+        {
+            scrubber_ = std::make_unique<Pimpl>(deviceInfo_.name);
+        }
+        
+        auto time = pausedAt_.toMilliseconds() + jlimit(-getTimelineLength(), (int64)0, offset);
+        auto& scrubbed = scrubber_->channels_;
+        if (!timeline_->seek(time, pausedEnd_, scrubbed, scrubber_->midiTimeStamps_, *scrubber_))
+        {
+            return;
+        }
+        
+        {
+            const std::lock_guard<std::mutex> lock1(paramsLock_);
+            const std::lock_guard<std::mutex> lock2(historyLock_);
+            pausedTime_ = Time(time);
+            pausedChannels_.deepCopy(scrubbed);
+        }
+        
+        layoutDirty_ = true;
+        markDirty();
+    }
+    
+    void resetChannelData()
+    {
+        const std::lock_guard<std::mutex> lock1(paramsLock_);
+        const std::lock_guard<std::mutex> lock2(historyLock_);
+        channels_.reset();
+        pausedChannels_.reset();
+        eventLog_.clear();
+        if (timeline_ != nullptr)
+        {
+            timeline_->clear();
+        }
+        if (sharedState_ != nullptr)
+        {
+            sharedState_->publishReset();
+        }
+        if (streamTap_ != nullptr)
+        {
+            streamTap_->reset();
+        }
+        layoutDirty_ = true;
+        markDirty();
+    }
+    
+    MidiDeviceInfo deviceInfo_;
+    std::unique_ptr<MidiInput> midiIn_;
+    std::unique_ptr<RawMidiInput> rawIn_;
+    std::unique_ptr<StateStreamViewer::Input> streamIn_;
+    std::unique_ptr<MidiFileReplay> replay_;
+    std::atomic<const TimeSource*> timeSource_ { nullptr };
+    std::atomic<DeviceStatus> status_ { DeviceStatus::deviceFed };
+    const int64 openDeadline_ { 0 };
+    SharedResourcePointer<MidiDeviceOpener> opener_;
+    const std::shared_ptr<Opening> opening_ { std::make_shared<Opening>(this) };
+    
+    SpinLock thruLock_;
+    String thruIdentifier_;
+    std::unique_ptr<MidiOutput> thruOutput_;
+    std::atomic_bool thruActive_ { false };
+    std::atomic<double> thruAverageUs_ { 0.0 };
+    std::atomic<double> thruMaximumUs_ { 0.0 };
+    std::atomic_bool thruOpening_ { false };
+    
+    SpinLock probeLock_;
+    LatencyProbe* probe_ { nullptr };
+    
+    std::unique_ptr<SharedStatePublisher::Slot> sharedState_;
+    std::unique_ptr<StateStreamServer::Tap> streamTap_;
+    std::unique_ptr<MidiCaptureRecorder::Track> capture_;
+    
+    std::atomic_bool dirty_ { true };
+    std::atomic_bool layoutDirty_ { true };
+    std::atomic<int> timeoutDelay_ { Settings::DEFAULT_TIMEOUT_DELAY };
+    std::atomic<FramePacer*> framePacer_ { nullptr };
+    std::atomic_bool paused_ { false };
+    
+    ActiveChannels channels_;
+    std::deque<double> midiTimeStamps_;
+    std::mutex paramsLock_;
+    std::mutex historyLock_;
+    MidiEventLog eventLog_;
+    std::unique_ptr<MidiTimeline> timeline_;
+    SharedResourcePointer<MidiTimelineBuilder> timelineBuilder_;
+    std::unique_ptr<Pimpl> keyframer_;
+    
+    Time pausedTime_;
+    ActiveChannels pausedChannels_;
+    Time pausedAt_;
+    uint64 pausedEnd_ { 0 };
+    std::unique_ptr<Pimpl> scrubber_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+void MidiTimelineBuilder::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(BUILD_INTERVAL_MS);
+        
+        Array<MidiDeviceState::Pimpl*> states;
+        {
+            const std::lock_guard<std::mutex> lock(statesLock_);
+            states = states_;
+        }
+        
+        for (auto state : states)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(statesLock_);
+                if (!states_.contains(state))
+                {
+                    continue;
+                }
+                building_ = state;
+            }
+            
+            state->buildKeyframes();
+            
+            {
+                const std::lock_guard<std::mutex> lock(statesLock_);
+                building_ = nullptr;
+            }
+            built_.notify_all();
+        }
+    }
+}
+
+MidiDeviceState::MidiDeviceState(const String& name) : pimpl_(new Pimpl(name)) {}
+MidiDeviceState::MidiDeviceState(const MidiDeviceInfo& info) : pimpl_(new Pimpl(info)) {}
+MidiDeviceState::~MidiDeviceState() = default;
+
+const MidiDeviceInfo& MidiDeviceState::getDeviceInfo() const                { return pimpl_->getDeviceInfo(); }
+bool MidiDeviceState::isOpen() const                                        { return pimpl_->isOpen(); }
+DeviceStatus MidiDeviceState::getDeviceStatus() const                       { return pimpl_->getDeviceStatus(); }
+int64 MidiDeviceState::getOpenDeadline() const                              { return pimpl_->openDeadline_; }
+void MidiDeviceState::handleIncomingMidiMessage(const MidiMessage& m)       { pimpl_->handleIncomingMidiMessage(nullptr, m); }
+void MidiDeviceState::handleIncomingMidiMessage(const MidiMessage& m, Time t) { pimpl_->handleReplayedMessage(m, t); }
+
+bool MidiDeviceState::isPaused() const                                      { return pimpl_->isPaused(); }
+void MidiDeviceState::setPaused(bool p)                                     { pimpl_->setPaused(p); }
+void MidiDeviceState::resetChannelData()                                    { pimpl_->resetChannelData(); }
+
+Time MidiDeviceState::getCurrentTime() const                                { return pimpl_->getCurrentTime(); }
+void MidiDeviceState::setTimeSource(const TimeSource* s)                    { pimpl_->timeSource_ = s; }
+ActiveChannels& MidiDeviceState::getChannels()                              { return pimpl_->getChannels(); }
+void MidiDeviceState::copyChannels(ActiveChannels& c)                       { pimpl_->copyChannels(c); }
+std::mutex& MidiDeviceState::getParamsLock()                                { return pimpl_->paramsLock_; }
+std::mutex& MidiDeviceState::getHistoryLock()                               { return pimpl_->historyLock_; }
+MidiEventLog& MidiDeviceState::getEventLog()                                { return pimpl_->eventLog_; }
+int64 MidiDeviceState::getTimelineLength() const                            { return pimpl_->getTimelineLength(); }
+void MidiDeviceState::scrubTo(int64 o)                                      { pimpl_->scrubTo(o); }
+void MidiDeviceState::setTimelineHistory(int64 h)                           { pimpl_->setTimelineHistory(h); }
+File MidiDeviceState::getCaptureFile() const                                { return pimpl_->capture_ != nullptr ? pimpl_->capture_->getFile() : File(); }
+
+void MidiDeviceState::setTimeoutDelay(int d)                                { pimpl_->setTimeoutDelay(d); }
+bool MidiDeviceState::consumeChange()                                       { return pimpl_->consumeChange(); }
+bool MidiDeviceState::consumeLayoutChange()                                 { return pimpl_->consumeLayoutChange(); }
+void MidiDeviceState::setFramePacer(FramePacer* p)                          { pimpl_->setFramePacer(p); }
+void MidiDeviceState::requestFrame()                                        { pimpl_->wakeFramePacer(); }
+
+bool MidiDeviceState::hasVirtualInput()
+{
+#if (JUCE_LINUX && JUCE_ALSA) || JUCE_MAC
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MidiDeviceState::setThruOutput(const String& i)                        { pimpl_->setThruOutput(i); }
+String MidiDeviceState::getThruOutput() const                               { return pimpl_->getThruOutput(); }
+MidiDeviceState::ThruLatency MidiDeviceState::getThruLatency() const        { return pimpl_->getThruLatency(); }
+void MidiDeviceState::setLatencyProbe(LatencyProbe* p)                      { pimpl_->setLatencyProbe(p); }
+
+bool MidiDeviceState::isHeld(const NoteOn& on, const NoteOff& off)          { return Pimpl::isHeld(on, off); }
+bool MidiDeviceState::hasHeldNotes(const ActiveChannel& c)                  { return Pimpl::hasHeldNotes(c); }
+}
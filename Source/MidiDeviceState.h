@@ -0,0 +1,134 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ChannelState.h"
+#include "MidiEventLog.h"
+
+namespace showmidi
+{
+    class FramePacer;
+    class LatencyProbe;
+    class TimeSource;
+
+    enum DeviceStatus
+    {
+        deviceFed = 1,
+        deviceOpening,
+        deviceOpen,
+        deviceFailed,
+        deviceTimedOut
+    };
+
+    /**
+     * Ingests the MIDI data of a single device into its channel state.
+     *
+     * The state keeps being updated whether a view is attached or not, views only
+     * read it when they render.
+     */
+    class MidiDeviceState
+    {
+    public:
+        /** Creates a state that is fed through handleIncomingMidiMessage. */
+        MidiDeviceState(const String&);
+        /** Creates a state that opens the MIDI input device in the background and listens to it. */
+        MidiDeviceState(const MidiDeviceInfo&);
+        ~MidiDeviceState();
+
+        static constexpr int OPEN_TIMEOUT_MS = 5000;
+        static constexpr const char* VIRTUAL_INPUT_IDENTIFIER = "showmidi:virtual-input";
+        static constexpr const char* VIRTUAL_INPUT_NAME = "ShowMIDI In";
+
+        /** Whether the platform lets the app publish its own input port for other applications to send to. */
+        static bool hasVirtualInput();
+
+        const MidiDeviceInfo& getDeviceInfo() const;
+        bool isOpen() const;
+        /** Reports a device as timed out while it's still opening after OPEN_TIMEOUT_MS, it can still open later. */
+        DeviceStatus getDeviceStatus() const;
+        /** The time in milliseconds at which a device that is still opening times out. */
+        int64 getOpenDeadline() const;
+
+        void handleIncomingMidiMessage(const MidiMessage&);
+        /** Feeds a message with the time it's due, on the clock of the time source. */
+        void handleIncomingMidiMessage(const MidiMessage&, Time);
+
+        bool isPaused() const;
+        void setPaused(bool);
+        void resetChannelData();
+
+        /** The time the channels should be looked at, frozen while paused. */
+        Time getCurrentTime() const;
+        /** Looks at the channels with another clock than the system time, nullptr goes back to the system time. */
+        void setTimeSource(const TimeSource*);
+        /** The channels to display, a snapshot while paused. Only use from the message thread. */
+        ActiveChannels& getChannels();
+        /** Copies the channels to display while holding the locks, can be called from any thread. */
+        void copyChannels(ActiveChannels&);
+        std::mutex& getParamsLock();
+        std::mutex& getHistoryLock();
+        /** Every message that arrives at a device, in order, which the timeline replays. The plugin doesn't keep one. */
+        MidiEventLog& getEventLog();
+        /** How many milliseconds before the pause the channels can be looked at, 0 when not paused. */
+        int64 getTimelineLength() const;
+        /** While paused, shows the channels as they were a number of milliseconds before the pause, 0 is the pause itself. */
+        void scrubTo(int64 offset);
+        /** How much graph and piano roll history the view paints, in milliseconds, the timeline keeps as much. */
+        void setTimelineHistory(int64);
+        /** The capture the messages are recorded into, none when recording isn't started. */
+        File getCaptureFile() const;
+
+        void setTimeoutDelay(int);
+        /** Returns true once after any of the values changed. */
+        bool consumeChange();
+        /** Returns true once after a hidden item was revived, or the state was reset. */
+        bool consumeLayoutChange();
+        /** Sets the frame pacer to wake up when the state changes, nullptr when not displayed. */
+        void setFramePacer(FramePacer*);
+        /** Wakes up the frame pacer without marking the state as changed. */
+        void requestFrame();
+
+        struct ThruLatency
+        {
+            bool active_ { false };
+            double averageUs_ { 0.0 };
+            double maximumUs_ { 0.0 };
+        };
+
+        /** Forwards the input to an output before it's processed, an empty identifier turns the thru off. */
+        void setThruOutput(const String&);
+        String getThruOutput() const;
+        /** How long forwarding takes in the input callback, in microseconds. */
+        ThruLatency getThruLatency() const;
+
+        /** Probe messages that arrive are handed to the probe and otherwise ignored, nullptr detaches it. */
+        void setLatencyProbe(LatencyProbe*);
+
+        /** A note is held from its note on until its note off arrives. */
+        static bool isHeld(const NoteOn&, const NoteOff&);
+        static bool hasHeldNotes(const ActiveChannel&);
+
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiDeviceState)
+    };
+}
@@ -22,8 +22,18 @@ namespace showmidi
     MidiDevicesListener::MidiDevicesListener()  { }
     MidiDevicesListener::~MidiDevicesListener() { }
 
+    void MidiDevicesListener::midiDevicesChanged(const MidiDevicesChange&)
+    {
+        refreshMidiDevices();
+    }
+
     void MidiDevicesListeners::broadcast()
     {
         call([] (MidiDevicesListener& l) { l.refreshMidiDevices(); });
     }
+
+    void MidiDevicesListeners::broadcast(const MidiDevicesChange& change)
+    {
+        call([&change] (MidiDevicesListener& l) { l.midiDevicesChanged(change); });
+    }
 }
@@ -21,18 +21,31 @@
 
 namespace showmidi
 {
+    /** The devices that appeared and disappeared since the previous change. */
+    struct MidiDevicesChange
+    {
+        Array<MidiDeviceInfo> added_;
+        Array<MidiDeviceInfo> removed_;
+        
+        bool isEmpty() const { return added_.isEmpty() && removed_.isEmpty(); }
+    };
+    
     class MidiDevicesListener
     {
     public:
         MidiDevicesListener();
         virtual ~MidiDevicesListener();
         
+        /** Called when the devices should be looked at again, for instance after their visibility changed. */
         virtual void refreshMidiDevices() = 0;
+        /** Called when devices were plugged in or out, refreshes everything by default. */
+        virtual void midiDevicesChanged(const MidiDevicesChange&);
     };
     
     class MidiDevicesListeners : public ListenerList<MidiDevicesListener>
     {
     public:
         void broadcast();
+        void broadcast(const MidiDevicesChange&);
     };
 }
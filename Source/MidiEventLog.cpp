@@ -0,0 +1,148 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiEventLog.h"
+
+namespace showmidi
+{
+MidiMessage LoggedEvent::toMidiMessage() const
+{
+    if (isSysEx() || size_ == 0)
+    {
+        return {};
+    }
+    return MidiMessage(data_, size_);
+}
+
+struct MidiEventLog::Pimpl
+{
+    Pimpl() = default;
+    
+    void setEnabled(bool enabled)
+    {
+        enabled_ = enabled;
+    }
+    
+    bool isEnabled() const
+    {
+        return enabled_;
+    }
+    
+    void add(const MidiMessage& msg, int64 time)
+    {
+        if (!enabled_)
+        {
+            return;
+        }
+        
+        LoggedEvent event;
+        event.time_ = time;
+        
+        auto raw = msg.getRawData();
+        auto size = std::min(msg.getRawDataSize(), 3);
+        if (msg.isSysEx())
+        {
+            // keep the bytes that identify the manufacturer
+            auto sysex = msg.getSysExData();
+            event.length_ = (uint32)msg.getSysExDataSize();
+            event.data_[0] = 0xf0;
+            event.data_[1] = event.length_ > 0 ? sysex[0] : 0;
+            event.data_[2] = event.length_ > 1 ? sysex[1] : 0;
+            event.size_ = 3;
+        }
+        else
+        {
+            memcpy(event.data_, raw, (size_t)size);
+            event.size_ = (uint8)size;
+        }
+        
+        auto slot = written_.load() % CAPACITY;
+        auto& block = blocks_[slot / BLOCK_SIZE];
+        
+        // only the writer installs blocks, so the allocation happens outside of the lock
+        if (block == nullptr)
+        {
+            auto allocated = std::make_unique<LoggedEvent[]>(BLOCK_SIZE);
+            const SpinLock::ScopedLockType lock(lock_);
+            block = std::move(allocated);
+        }
+        
+        const SpinLock::ScopedLockType lock(lock_);
+        block[slot % BLOCK_SIZE] = event;
+        ++written_;
+    }
+    
+    void clear()
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        cleared_ = written_.load();
+    }
+    
+    uint64 getBegin() const
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        return getBeginLocked();
+    }
+    
+    uint64 getBeginLocked() const
+    {
+        auto end = written_.load();
+        return std::max(cleared_, end - std::min(end, CAPACITY));
+    }
+    
+    uint64 getEnd() const
+    {
+        return written_;
+    }
+    
+    int read(uint64& first, LoggedEvent* destination, int count) const
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        
+        first = std::max(first, getBeginLocked());
+        auto end = std::min(first + (uint64)std::max(count, 0), written_.load());
+        
+        auto copied = 0;
+        for (auto sequence = first; sequence < end; ++sequence)
+        {
+            auto slot = sequence % CAPACITY;
+            destination[copied++] = blocks_[slot / BLOCK_SIZE][slot % BLOCK_SIZE];
+        }
+        
+        return copied;
+    }
+    
+    std::atomic_bool enabled_ { false };
+    std::atomic<uint64> written_ { 0 };
+    uint64 cleared_ { 0 };
+    std::unique_ptr<LoggedEvent[]> blocks_[NUM_BLOCKS];
+    mutable SpinLock lock_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiEventLog::MidiEventLog() : pimpl_(new Pimpl()) {}
+MidiEventLog::~MidiEventLog() = default;
+
+void MidiEventLog::setEnabled(bool e)                                       { pimpl_->setEnabled(e); }
+bool MidiEventLog::isEnabled() const                                        { return pimpl_->isEnabled(); }
+void MidiEventLog::add(const MidiMessage& m, int64 t)                       { pimpl_->add(m, t); }
+void MidiEventLog::clear()                                                  { pimpl_->clear(); }
+uint64 MidiEventLog::getBegin() const                                       { return pimpl_->getBegin(); }
+uint64 MidiEventLog::getEnd() const                                         { return pimpl_->getEnd(); }
+int MidiEventLog::read(uint64& f, LoggedEvent* d, int c) const              { return pimpl_->read(f, d, c); }
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /** A MIDI message as it's kept in the event log, sysex messages only keep their first bytes and their length. */
+    struct LoggedEvent
+    {
+        int64 time_ { 0 };
+        uint32 length_ { 0 };
+        uint8 data_[3] {};
+        uint8 size_ { 0 };
+        
+        /** Recreates the message, sysex messages are left out. */
+        MidiMessage toMidiMessage() const;
+        bool isSysEx() const { return data_[0] == 0xf0; }
+    };
+    
+    /**
+     * A bounded ring of the MIDI events of a device, in the order they arrived.
+     *
+     * Events are addressed by a sequence number that keeps increasing, once the memory budget
+     * is used up the oldest events are overwritten. The memory is allocated block by block as
+     * the ring fills up, so a quiet device never claims its whole budget.
+     */
+    class MidiEventLog
+    {
+    public:
+        static constexpr int BLOCK_SIZE = 65536;
+        static constexpr int NUM_BLOCKS = 32;
+        static constexpr uint64 CAPACITY = (uint64)BLOCK_SIZE * NUM_BLOCKS;
+        
+        MidiEventLog();
+        ~MidiEventLog();
+        
+        /** Nothing is recorded until the log is enabled. */
+        void setEnabled(bool);
+        bool isEnabled() const;
+        
+        /** Appends a message, only to be called from a single thread. */
+        void add(const MidiMessage&, int64 time);
+        /** Drops all the events, the sequence numbers keep increasing. */
+        void clear();
+        
+        /** The sequence number of the oldest event that is still available. */
+        uint64 getBegin() const;
+        /** The sequence number the next event will get. */
+        uint64 getEnd() const;
+        
+        /**
+         * Copies up to count events, starting at a sequence number.
+         * The first sequence number moves forward when the oldest requested events are gone,
+         * returns the number of events that were copied.
+         */
+        int read(uint64& first, LoggedEvent* destination, int count) const;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiEventLog)
+    };
+}
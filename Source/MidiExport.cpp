@@ -0,0 +1,453 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiExport.h"
+
+#include "MidiCapture.h"
+#include "MidiEventLog.h"
+
+namespace showmidi
+{
+namespace
+{
+    // the progress is reported and cancelling is checked this often
+    constexpr int PROGRESS_INTERVAL = 4096;
+    constexpr int LOG_BATCH = 4096;
+    constexpr int64 MAX_DELTA = 0x0fffffff;
+    
+    class LogSource : public MidiExport::Source
+    {
+    public:
+        LogSource(const MidiEventLog& log) :
+        log_(log),
+        begin_(log.getBegin()),
+        end_(log.getEnd()),
+        next_(begin_)
+        {
+            buffer_.resize(LOG_BATCH);
+        }
+        
+        bool next(MidiMessage& msg, int64& time) override
+        {
+            while (true)
+            {
+                if (index_ >= count_)
+                {
+                    if (next_ >= end_)
+                    {
+                        return false;
+                    }
+                    
+                    // events that were overwritten in the meantime are skipped
+                    index_ = 0;
+                    count_ = log_.read(next_, buffer_.data(), (int)jmin((uint64)LOG_BATCH, end_ - next_));
+                    if (count_ == 0)
+                    {
+                        return false;
+                    }
+                    next_ += (uint64)count_;
+                }
+                
+                auto& event = buffer_[(size_t)index_++];
+                if (!event.isSysEx() && event.size_ > 0)
+                {
+                    msg = event.toMidiMessage();
+                    time = event.time_;
+                    return true;
+                }
+            }
+        }
+        
+        double getProgress() const override
+        {
+            return end_ > begin_ ? jlimit(0.0, 1.0, (double)(next_ - begin_) / (double)(end_ - begin_)) : 1.0;
+        }
+        
+    private:
+        const MidiEventLog& log_;
+        const uint64 begin_;
+        const uint64 end_;
+        uint64 next_;
+        std::vector<LoggedEvent> buffer_;
+        int count_ { 0 };
+        int index_ { 0 };
+    };
+    
+    class CaptureSource : public MidiExport::Source
+    {
+    public:
+        CaptureSource(const File& file) :
+        reader_(file)
+        {
+        }
+        
+        bool next(MidiMessage& msg, int64& time) override
+        {
+            return reader_.next(msg, time);
+        }
+        
+        double getProgress() const override
+        {
+            return reader_.getProgress();
+        }
+        
+    private:
+        MidiCaptureReader reader_;
+    };
+    
+    class EventWriter
+    {
+    public:
+        virtual ~EventWriter() = default;
+        
+        /** The time is in milliseconds since the first event. */
+        virtual void write(const MidiMessage&, int64 time) = 0;
+        virtual void finish() = 0;
+    };
+    
+    /**
+     * Writes a format 1 file, the length of a track is filled in when it ends. Very large exports
+     * continue in another track, which starts counting its time from the start of the file again.
+     */
+    class StandardMidiFileWriter : public EventWriter
+    {
+    public:
+        StandardMidiFileWriter(FileOutputStream& out, int64 maxTrackSize) :
+        out_(out),
+        maxTrackSize_(maxTrackSize)
+        {
+            out_.write("MThd", 4);
+            out_.writeIntBigEndian(6);
+            out_.writeShortBigEndian(1);
+            tracksPosition_ = out_.getPosition();
+            out_.writeShortBigEndian(0);
+            out_.writeShortBigEndian(MidiExport::TICKS_PER_QUARTER);
+            
+            beginTrack();
+            
+            // a quarter note per second, a tick is a millisecond
+            const uint8 tempo[] = { 0x00, 0xff, 0x51, 0x03, 0x0f, 0x42, 0x40 };
+            out_.write(tempo, sizeof(tempo));
+        }
+        
+        void write(const MidiMessage& msg, int64 time) override
+        {
+            if (out_.getPosition() - trackStart_ > maxTrackSize_)
+            {
+                endTrack();
+                beginTrack();
+            }
+            
+            // deltas have at most 28 bits, longer gaps are bridged with empty text events, which cancel the running status
+            auto delta = jmax((int64)0, time - lastTime_);
+            while (delta > MAX_DELTA)
+            {
+                writeVariableLength((uint32)MAX_DELTA);
+                const uint8 empty_text[] = { 0xff, 0x01, 0x00 };
+                out_.write(empty_text, sizeof(empty_text));
+                runningStatus_ = 0;
+                delta -= MAX_DELTA;
+            }
+            writeVariableLength((uint32)delta);
+            lastTime_ = jmax(lastTime_, time);
+            
+            auto raw = msg.getRawData();
+            auto size = msg.getRawDataSize();
+            auto status = raw[0];
+            if (msg.isSysEx())
+            {
+                out_.writeByte((char)0xf0);
+                writeVariableLength((uint32)(size - 1));
+                out_.write(raw + 1, (size_t)(size - 1));
+                runningStatus_ = 0;
+            }
+            else if (status >= 0xf0)
+            {
+                // other system messages are escaped
+                out_.writeByte((char)0xf7);
+                writeVariableLength((uint32)size);
+                out_.write(raw, (size_t)size);
+                runningStatus_ = 0;
+            }
+            else
+            {
+                auto skip = status == runningStatus_ ? 1 : 0;
+                out_.write(raw + skip, (size_t)(size - skip));
+                runningStatus_ = status;
+            }
+        }
+        
+        void finish() override
+        {
+            endTrack();
+            
+            auto end = out_.getPosition();
+            out_.setPosition(tracksPosition_);
+            out_.writeShortBigEndian((short)tracks_);
+            out_.setPosition(end);
+        }
+        
+    private:
+        void beginTrack()
+        {
+            out_.write("MTrk", 4);
+            lengthPosition_ = out_.getPosition();
+            out_.writeIntBigEndian(0);
+            trackStart_ = out_.getPosition();
+            lastTime_ = 0;
+            runningStatus_ = 0;
+            ++tracks_;
+        }
+        
+        void endTrack()
+        {
+            const uint8 end_of_track[] = { 0x00, 0xff, 0x2f, 0x00 };
+            out_.write(end_of_track, sizeof(end_of_track));
+            
+            auto end = out_.getPosition();
+            out_.setPosition(lengthPosition_);
+            out_.writeIntBigEndian((int)(end - trackStart_));
+            out_.setPosition(end);
+        }
+        
+        void writeVariableLength(uint32 value)
+        {
+            uint8 bytes[4];
+            auto size = 0;
+            bytes[size++] = (uint8)(value & 0x7f);
+            while ((value >>= 7) != 0)
+            {
+                bytes[size++] = (uint8)((value & 0x7f) | 0x80);
+            }
+            while (size > 0)
+            {
+                out_.writeByte((char)bytes[--size]);
+            }
+        }
+        
+        FileOutputStream& out_;
+        const int64 maxTrackSize_;
+        int64 tracksPosition_ { 0 };
+        int64 lengthPosition_ { 0 };
+        int64 trackStart_ { 0 };
+        int64 lastTime_ { 0 };
+        uint8 runningStatus_ { 0 };
+        int tracks_ { 0 };
+    };
+    
+    /** A row per event with the time in milliseconds, the channel, the type, the number and value, and the bytes. */
+    class CsvWriter : public EventWriter
+    {
+    public:
+        CsvWriter(FileOutputStream& out) :
+        out_(out)
+        {
+            out_ << "time_ms,channel,type,number,value,bytes\n";
+        }
+        
+        void write(const MidiMessage& msg, int64 time) override
+        {
+            String channel, type, number, value;
+            if (msg.getChannel() > 0)
+            {
+                channel = String(msg.getChannel());
+            }
+            
+            if (msg.isNoteOn())
+            {
+                type = "note_on";
+                number = String(msg.getNoteNumber());
+                value = String(msg.getVelocity());
+            }
+            else if (msg.isNoteOff())
+            {
+                type = "note_off";
+                number = String(msg.getNoteNumber());
+                value = String(msg.getVelocity());
+            }
+            else if (msg.isAftertouch())
+            {
+                type = "poly_pressure";
+                number = String(msg.getNoteNumber());
+                value = String(msg.getAfterTouchValue());
+            }
+            else if (msg.isController())
+            {
+                type = "control_change";
+                number = String(msg.getControllerNumber());
+                value = String(msg.getControllerValue());
+            }
+            else if (msg.isProgramChange())
+            {
+                type = "program_change";
+                number = String(msg.getProgramChangeNumber());
+            }
+            else if (msg.isChannelPressure())
+            {
+                type = "channel_pressure";
+                value = String(msg.getChannelPressureValue());
+            }
+            else if (msg.isPitchWheel())
+            {
+                type = "pitch_bend";
+                value = String(msg.getPitchWheelValue());
+            }
+            else if (msg.isSysEx())
+            {
+                type = "sysex";
+                value = String(msg.getSysExDataSize());
+            }
+            else if (msg.isMidiClock())
+            {
+                type = "clock";
+            }
+            else if (msg.isMidiStart())
+            {
+                type = "start";
+            }
+            else if (msg.isMidiContinue())
+            {
+                type = "continue";
+            }
+            else if (msg.isMidiStop())
+            {
+                type = "stop";
+            }
+            else
+            {
+                type = "other";
+            }
+            
+            out_ << String(time) << "," << channel << "," << type << "," << number << "," << value << ","
+                 << String::toHexString(msg.getRawData(), msg.getRawDataSize()) << "\n";
+        }
+        
+        void finish() override
+        {
+        }
+        
+    private:
+        FileOutputStream& out_;
+    };
+}
+
+std::unique_ptr<MidiExport::Source> MidiExport::createLogSource(const MidiEventLog& log)
+{
+    return std::make_unique<LogSource>(log);
+}
+
+std::unique_ptr<MidiExport::Source> MidiExport::createCaptureSource(const File& file)
+{
+    return std::make_unique<CaptureSource>(file);
+}
+
+String MidiExport::getFileExtension(Format format)
+{
+    return format == formatCsv ? ".csv" : ".mid";
+}
+
+Result MidiExport::write(Source& source, Format format, const File& file, std::function<bool(double)> progress, int64 maxTrackSize)
+{
+    // the target is only replaced once the export completed
+    TemporaryFile temporary(file);
+    {
+        FileOutputStream out(temporary.getFile(), CHUNK_SIZE);
+        if (out.failedToOpen())
+        {
+            return Result::fail("Can't write " + file.getFullPathName());
+        }
+        
+        std::unique_ptr<EventWriter> writer;
+        if (format == formatCsv)
+        {
+            writer = std::make_unique<CsvWriter>(out);
+        }
+        else
+        {
+            writer = std::make_unique<StandardMidiFileWriter>(out, maxTrackSize);
+        }
+        
+        MidiMessage msg;
+        int64 time;
+        int64 first = 0;
+        auto count = 0;
+        while (source.next(msg, time))
+        {
+            if (count == 0)
+            {
+                first = time;
+            }
+            writer->write(msg, time - first);
+            
+            if (++count % PROGRESS_INTERVAL == 0 && !progress(source.getProgress()))
+            {
+                return Result::fail("The export was cancelled");
+            }
+        }
+        writer->finish();
+        progress(1.0);
+        
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            return out.getStatus();
+        }
+    }
+    
+    if (!temporary.overwriteTargetFileWithTemporary())
+    {
+        return Result::fail("Can't write " + file.getFullPathName());
+    }
+    return Result::ok();
+}
+
+MidiExportJob::MidiExportJob(std::unique_ptr<MidiExport::Source> source, MidiExport::Format format, const File& file, std::function<void()> onComplete) :
+    ThreadWithProgressWindow("Exporting " + file.getFileName(), true, true),
+    source_(std::move(source)),
+    format_(format),
+    file_(file),
+    onComplete_(std::move(onComplete))
+{
+    launchThread();
+}
+
+MidiExportJob::~MidiExportJob()
+{
+    // the source may read from a device that's going away
+    stopThread(-1);
+}
+
+void MidiExportJob::run()
+{
+    result_ = MidiExport::write(*source_, format_, file_, [this] (double progress) {
+        setProgress(progress);
+        return !threadShouldExit();
+    });
+}
+
+void MidiExportJob::threadComplete(bool userPressedCancel)
+{
+    if (!userPressedCancel && result_.failed())
+    {
+        AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon, "Export failed", result_.getErrorMessage());
+    }
+    
+    // the callback deletes this job, keep it alive until it returns
+    auto on_complete = onComplete_;
+    on_complete();
+}
+}
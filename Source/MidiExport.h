@@ -0,0 +1,94 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    class MidiEventLog;
+    
+    /**
+     * Exports the events of a device to a standard MIDI file or to CSV.
+     *
+     * The events are read, converted and written a chunk at a time, so the memory that's used
+     * doesn't depend on the number of events. Buffered events come from the event log of a
+     * device, which only keeps the first bytes of sysex messages, those are left out. Recorded
+     * events come from a capture and are exported completely.
+     */
+    class MidiExport
+    {
+    public:
+        enum Format
+        {
+            formatStandardMidiFile = 0,
+            formatCsv
+        };
+        
+        static constexpr int CHUNK_SIZE = 65536;
+        /** The exported files have a tempo of one quarter note per second, so a tick is a millisecond. */
+        static constexpr int TICKS_PER_QUARTER = 1000;
+        /** A standard MIDI file continues in another track before a track gets this large. */
+        static constexpr int64 MAX_TRACK_SIZE = (int64)1024 * 1024 * 1024;
+        
+        /** The events to export, in the order they arrived. */
+        class Source
+        {
+        public:
+            virtual ~Source() = default;
+            
+            /** Returns false after the last event. */
+            virtual bool next(MidiMessage&, int64& time) = 0;
+            /** How much of the events was read, from 0 to 1. */
+            virtual double getProgress() const = 0;
+        };
+        
+        /** The events that are in the log when the export starts. */
+        static std::unique_ptr<Source> createLogSource(const MidiEventLog&);
+        static std::unique_ptr<Source> createCaptureSource(const File&);
+        
+        static String getFileExtension(Format);
+        
+        /**
+         * Writes the events to a file, calling back with the progress after every chunk.
+         * The export stops when the callback returns false.
+         */
+        static Result write(Source&, Format, const File&, std::function<bool(double)> progress, int64 maxTrackSize = MAX_TRACK_SIZE);
+    };
+    
+    /** Exports on a background thread while a window shows the progress, a failure is reported when it's done. */
+    class MidiExportJob : public ThreadWithProgressWindow
+    {
+    public:
+        /** The completion callback is responsible for deleting the job, deleting it earlier cancels the export. */
+        MidiExportJob(std::unique_ptr<MidiExport::Source>, MidiExport::Format, const File&, std::function<void()>);
+        ~MidiExportJob() override;
+        
+        void run() override;
+        void threadComplete(bool userPressedCancel) override;
+        
+    private:
+        std::unique_ptr<MidiExport::Source> source_;
+        const MidiExport::Format format_;
+        const File file_;
+        std::function<void()> onComplete_;
+        Result result_ { Result::ok() };
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiExportJob)
+    };
+}
@@ -0,0 +1,391 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiFileReplay.h"
+
+namespace showmidi
+{
+const String MidiFileReplay::COMMAND_LINE_OPTION = { "--replay" };
+const String MidiFileReplay::SPEED_COMMAND_LINE_OPTION = { "--replay-speed" };
+
+namespace
+{
+    constexpr int SMF_HEADER_SIZE = 14;
+    constexpr int CHUNK_HEADER_SIZE = 8;
+    constexpr double DEFAULT_MS_PER_QUARTER = 500.0;
+    // the replay thread checks whether it should stop this often while playing as fast as possible
+    constexpr int EXIT_CHECK_INTERVAL = 1024;
+    constexpr int MAX_WAIT_MS = 100;
+    
+    /** Runs the jobs on the pool and waits for them, or runs them one after the other without a pool. */
+    void runInParallel(ThreadPool* pool, int count, const std::function<void(int)>& job)
+    {
+        if (pool == nullptr || count <= 1)
+        {
+            for (auto i = 0; i < count; ++i)
+            {
+                job(i);
+            }
+            return;
+        }
+        
+        std::atomic<int> remaining { count };
+        WaitableEvent done;
+        for (auto i = 0; i < count; ++i)
+        {
+            pool->addJob([&job, &remaining, &done, i] {
+                job(i);
+                if (--remaining == 0)
+                {
+                    done.signal();
+                }
+            });
+        }
+        done.wait();
+    }
+    
+    /** Splits a standard MIDI file into a single track file per track, so that each can be parsed on its own. */
+    bool splitTracks(const MemoryBlock& data, int& division, std::vector<MemoryBlock>& tracks)
+    {
+        auto bytes = static_cast<const uint8*>(data.getData());
+        auto size = data.getSize();
+        if (size < (size_t)SMF_HEADER_SIZE || memcmp(bytes, "MThd", 4) != 0)
+        {
+            return false;
+        }
+        
+        auto header_size = ByteOrder::bigEndianInt(bytes + 4);
+        division = (int16)ByteOrder::bigEndianShort(bytes + 12);
+        
+        auto offset = (size_t)8 + header_size;
+        while (offset + CHUNK_HEADER_SIZE <= size)
+        {
+            auto chunk_size = jmin((size_t)ByteOrder::bigEndianInt(bytes + offset + 4), size - offset - CHUNK_HEADER_SIZE);
+            if (memcmp(bytes + offset, "MTrk", 4) == 0)
+            {
+                const uint8 header[SMF_HEADER_SIZE] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, bytes[12], bytes[13] };
+                MemoryBlock track(header, SMF_HEADER_SIZE);
+                track.append(bytes + offset, CHUNK_HEADER_SIZE + chunk_size);
+                // a truncated track keeps the size it claims, the chunk header is corrected to what's there
+                ByteOrder::writeBigEndianInt(static_cast<uint8*>(track.getData()) + SMF_HEADER_SIZE + 4, (uint32)chunk_size);
+                tracks.push_back(std::move(track));
+            }
+            offset += CHUNK_HEADER_SIZE + chunk_size;
+        }
+        return true;
+    }
+    
+    /** Converts ticks to milliseconds, following the tempo changes of all the tracks. */
+    class TempoMap
+    {
+    public:
+        TempoMap(int division, const std::vector<MidiMessageSequence>& sequences)
+        {
+            if (division < 0)
+            {
+                // SMPTE timing has a fixed number of ticks per frame, 29 stands for 29.97 frames per second
+                auto fps = (double)(-(division >> 8));
+                if (fps == 29.0)
+                {
+                    fps = 29.97;
+                }
+                segments_.push_back({ 0.0, 0.0, 1000.0 / (fps * (double)(division & 0xff)) });
+                return;
+            }
+            
+            auto ticks_per_quarter = (double)jmax(1, division);
+            std::vector<std::pair<double, double>> tempos;
+            for (auto& sequence : sequences)
+            {
+                for (auto event : sequence)
+                {
+                    if (event->message.isTempoMetaEvent())
+                    {
+                        tempos.emplace_back(event->message.getTimeStamp(), event->message.getTempoSecondsPerQuarterNote() * 1000.0);
+                    }
+                }
+            }
+            std::stable_sort(tempos.begin(), tempos.end(), [] (auto& a, auto& b) { return a.first < b.first; });
+            
+            segments_.push_back({ 0.0, 0.0, DEFAULT_MS_PER_QUARTER / ticks_per_quarter });
+            for (auto& tempo : tempos)
+            {
+                segments_.push_back({ tempo.first, toMilliseconds(tempo.first), tempo.second / ticks_per_quarter });
+            }
+        }
+        
+        double toMilliseconds(double tick) const
+        {
+            auto segment = std::upper_bound(segments_.begin(), segments_.end(), tick, [] (double t, const Segment& s) { return t < s.tick_; });
+            if (segment != segments_.begin())
+            {
+                --segment;
+            }
+            return segment->ms_ + (tick - segment->tick_) * segment->msPerTick_;
+        }
+        
+    private:
+        struct Segment
+        {
+            double tick_;
+            double ms_;
+            double msPerTick_;
+        };
+        
+        std::vector<Segment> segments_;
+    };
+    
+    CriticalSection replaysLock;
+    StringArray replayFiles;
+    double replaySpeed = 1.0;
+}
+
+Result MidiFileReplay::load(const File& file, std::vector<MidiMessage>& messages)
+{
+    MemoryBlock data;
+    if (!file.loadFileAsData(data))
+    {
+        return Result::fail("Can't read " + file.getFullPathName());
+    }
+    
+    auto division = 0;
+    std::vector<MemoryBlock> tracks;
+    if (!splitTracks(data, division, tracks) || tracks.empty())
+    {
+        return Result::fail(file.getFileName() + " isn't a standard MIDI file");
+    }
+    
+    std::unique_ptr<ThreadPool> pool;
+    if (tracks.size() > 1 && (int64)data.getSize() >= PARALLEL_MIN_SIZE)
+    {
+        pool = std::make_unique<ThreadPool>(jmin((int)tracks.size(), SystemStats::getNumCpus()));
+    }
+    auto num_tracks = (int)tracks.size();
+    
+    // the events are parsed with their times in ticks
+    std::vector<MidiMessageSequence> sequences((size_t)num_tracks);
+    runInParallel(pool.get(), num_tracks, [&tracks, &sequences] (int i) {
+        MemoryInputStream in(tracks[(size_t)i], false);
+        MidiFile midi_file;
+        if (midi_file.readFrom(in, false) && midi_file.getNumTracks() == 1)
+        {
+            sequences[(size_t)i] = *midi_file.getTrack(0);
+        }
+    });
+    
+    // the tempo changes of every track apply to all of them
+    TempoMap tempo_map(division, sequences);
+    std::vector<std::vector<MidiMessage>> timed((size_t)num_tracks);
+    runInParallel(pool.get(), num_tracks, [&sequences, &timed, &tempo_map] (int i) {
+        auto& sequence = sequences[(size_t)i];
+        auto& track = timed[(size_t)i];
+        track.reserve((size_t)sequence.getNumEvents());
+        for (auto event : sequence)
+        {
+            if (!event->message.isMetaEvent())
+            {
+                track.push_back(event->message);
+                track.back().setTimeStamp(tempo_map.toMilliseconds(event->message.getTimeStamp()));
+            }
+        }
+        MidiMessageSequence().swapWith(sequence);
+    });
+    
+    // pairs of tracks are merged until one is left, earlier tracks go first when events coincide
+    while (timed.size() > 1)
+    {
+        std::vector<std::vector<MidiMessage>> merged((timed.size() + 1) / 2);
+        runInParallel(pool.get(), (int)merged.size(), [&timed, &merged] (int i) {
+            auto first = (size_t)i * 2;
+            if (first + 1 >= timed.size())
+            {
+                merged[(size_t)i] = std::move(timed[first]);
+                return;
+            }
+            
+            auto& a = timed[first];
+            auto& b = timed[first + 1];
+            auto& result = merged[(size_t)i];
+            result.reserve(a.size() + b.size());
+            std::merge(std::make_move_iterator(a.begin()), std::make_move_iterator(a.end()),
+                       std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()),
+                       std::back_inserter(result),
+                       [] (auto& x, auto& y) { return x.getTimeStamp() < y.getTimeStamp(); });
+        });
+        timed = std::move(merged);
+    }
+    
+    messages = std::move(timed.front());
+    return Result::ok();
+}
+
+bool MidiFileReplay::startFromCommandLine(const StringArray& arguments)
+{
+    StringArray files;
+    auto speed = 1.0;
+    for (auto& argument : arguments)
+    {
+        if (argument.startsWith(COMMAND_LINE_OPTION + "="))
+        {
+            auto file = File::getCurrentWorkingDirectory().getChildFile(argument.fromFirstOccurrenceOf("=", false, false).unquoted());
+            if (!file.existsAsFile())
+            {
+                return false;
+            }
+            files.add(file.getFullPathName());
+        }
+        else if (argument.startsWith(SPEED_COMMAND_LINE_OPTION + "="))
+        {
+            auto value = argument.fromFirstOccurrenceOf("=", false, false);
+            speed = value.equalsIgnoreCase("max") ? MAXIMUM_SPEED : value.getDoubleValue();
+            if (speed <= 0.0 && !value.equalsIgnoreCase("max"))
+            {
+                return false;
+            }
+        }
+    }
+    
+    const ScopedLock lock(replaysLock);
+    replayFiles = files;
+    replaySpeed = speed;
+    return true;
+}
+
+void MidiFileReplay::stop()
+{
+    const ScopedLock lock(replaysLock);
+    replayFiles.clear();
+}
+
+Array<MidiDeviceInfo> MidiFileReplay::getAvailableDevices()
+{
+    Array<MidiDeviceInfo> devices;
+    const ScopedLock lock(replaysLock);
+    for (auto& path : replayFiles)
+    {
+        devices.add({ File(path).getFileNameWithoutExtension() + " (replay)", IDENTIFIER_PREFIX + path });
+    }
+    return devices;
+}
+
+bool MidiFileReplay::isReplayDevice(const String& identifier)
+{
+    return identifier.startsWith(IDENTIFIER_PREFIX);
+}
+
+std::unique_ptr<MidiFileReplay> MidiFileReplay::openDevice(const String& identifier, MidiFileReplayCallback* callback)
+{
+    auto speed = 1.0;
+    {
+        const ScopedLock lock(replaysLock);
+        speed = replaySpeed;
+    }
+    
+    std::vector<MidiMessage> messages;
+    if (load(File(identifier.fromFirstOccurrenceOf(IDENTIFIER_PREFIX, false, false)), messages).failed())
+    {
+        return nullptr;
+    }
+    return std::make_unique<MidiFileReplay>(std::move(messages), speed, callback);
+}
+
+struct MidiFileReplay::Pimpl : public Thread
+{
+    Pimpl(std::vector<MidiMessage> messages, double speed, MidiFileReplayCallback* callback) :
+    Thread("MIDI file replay"),
+    messages_(std::move(messages)),
+    speed_(speed),
+    callback_(callback),
+    origin_(Time::currentTimeMillis()),
+    originCounter_(Time::getMillisecondCounterHiRes())
+    {
+        startThread();
+    }
+    
+    ~Pimpl() override
+    {
+        stopThread(MAX_WAIT_MS * 10);
+    }
+    
+    void run() override
+    {
+        auto count = 0;
+        for (auto& message : messages_)
+        {
+            auto offset = message.getTimeStamp();
+            if (speed_ != MAXIMUM_SPEED)
+            {
+                // the message is due once the clock of the replay reached it
+                auto due = originCounter_ + offset / speed_;
+                for (auto remaining = due - Time::getMillisecondCounterHiRes(); remaining >= 1.0; remaining = due - Time::getMillisecondCounterHiRes())
+                {
+                    if (threadShouldExit())
+                    {
+                        return;
+                    }
+                    wait(jmin(MAX_WAIT_MS, (int)remaining));
+                }
+            }
+            if (++count % EXIT_CHECK_INTERVAL == 0 && threadShouldExit())
+            {
+                return;
+            }
+            
+            auto time = origin_ + (int64)offset;
+            MidiMessage msg(message, (double)time * 0.001);
+            playhead_ = offset;
+            callback_->handleReplayedMessage(msg, Time(time));
+        }
+        
+        endCounter_ = Time::getMillisecondCounterHiRes();
+        finished_ = true;
+    }
+    
+    Time getCurrentTime() const
+    {
+        auto now = Time::getMillisecondCounterHiRes();
+        if (finished_)
+        {
+            auto end = speed_ != MAXIMUM_SPEED ? (endCounter_ - originCounter_) * speed_ : playhead_.load();
+            return Time(origin_ + (int64)(end + now - endCounter_));
+        }
+        if (speed_ != MAXIMUM_SPEED)
+        {
+            return Time(origin_ + (int64)((now - originCounter_) * speed_));
+        }
+        return Time(origin_ + (int64)playhead_.load());
+    }
+    
+    const std::vector<MidiMessage> messages_;
+    const double speed_;
+    MidiFileReplayCallback* const callback_;
+    
+    const int64 origin_;
+    const double originCounter_;
+    std::atomic<double> playhead_ { 0.0 };
+    std::atomic<double> endCounter_ { 0.0 };
+    std::atomic_bool finished_ { false };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiFileReplay::MidiFileReplay(std::vector<MidiMessage> m, double s, MidiFileReplayCallback* c) : pimpl_(new Pimpl(std::move(m), s, c)) {}
+MidiFileReplay::~MidiFileReplay() = default;
+
+Time MidiFileReplay::getCurrentTime() const                                     { return pimpl_->getCurrentTime(); }
+bool MidiFileReplay::isFinished() const                                         { return pimpl_->finished_; }
+}
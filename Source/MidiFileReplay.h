@@ -0,0 +1,82 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "TimeSource.h"
+
+namespace showmidi
+{
+    class MidiFileReplayCallback
+    {
+    public:
+        virtual ~MidiFileReplayCallback() = default;
+        
+        /** Called on the replay thread, the time is on the clock of the replay. */
+        virtual void handleReplayedMessage(const MidiMessage&, Time) = 0;
+    };
+    
+    /**
+     * Plays a standard MIDI file into a device, at its own pace, a multiple of it or as fast as possible.
+     *
+     * The replay is its own time source: the messages are timed on a clock that starts when the replay
+     * starts and runs at the speed of the replay, so that a device that looks at its state with that
+     * clock expires values and scrolls graphs as if the file was played in real time. Once the file
+     * ended the clock keeps running in real time. The files on the command line are listed as devices.
+     */
+    class MidiFileReplay : public TimeSource
+    {
+    public:
+        static const String COMMAND_LINE_OPTION;
+        static const String SPEED_COMMAND_LINE_OPTION;
+        static constexpr const char* IDENTIFIER_PREFIX = "replay:";
+        /** The speed that plays the messages as fast as they can be handled. */
+        static constexpr double MAXIMUM_SPEED = 0.0;
+        /** Smaller files aren't worth handing to other threads. */
+        static constexpr int64 PARALLEL_MIN_SIZE = 256 * 1024;
+        
+        /**
+         * Reads the messages of a standard MIDI file, merged in the order they're played and
+         * timestamped in milliseconds from the start. The meta events are left out. The tracks
+         * of large files are parsed, timed and merged in parallel.
+         */
+        static Result load(const File&, std::vector<MidiMessage>& messages);
+        
+        /** Lists the files of every --replay=<file> option, returns false when one doesn't exist or the speed is invalid. */
+        static bool startFromCommandLine(const StringArray& arguments);
+        static void stop();
+        static Array<MidiDeviceInfo> getAvailableDevices();
+        static bool isReplayDevice(const String& identifier);
+        
+        /** Loads the file of a replay device and starts playing it, returns nullptr when it can't be read. */
+        static std::unique_ptr<MidiFileReplay> openDevice(const String& identifier, MidiFileReplayCallback*);
+        
+        MidiFileReplay(std::vector<MidiMessage> messages, double speed, MidiFileReplayCallback*);
+        ~MidiFileReplay() override;
+        
+        Time getCurrentTime() const override;
+        bool isFinished() const;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiFileReplay)
+    };
+}
@@ -0,0 +1,763 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MidiTimeline.h"
+
+#include "MidiCapture.h"
+#include "MidiEventLog.h"
+#include "StateStreamProtocol.h"
+
+namespace showmidi
+{
+namespace
+{
+    static_assert(std::is_trivially_copyable<NoteHeat>::value, "the heat of a channel is stored as it is");
+    
+    /**
+     * Encodes the channels of a keyframe.
+     *
+     * Numbers are varints, differences zigzag encoded. Times are stored relative to the keyframe,
+     * plus one so that 0 remains the time that was never set, the times of a history and of a
+     * note span relative to the time before. Only the channels, notes and controllers that were
+     * ever set are written, each prefixed with its number.
+     */
+    struct KeyframeWriter
+    {
+        KeyframeWriter(MemoryOutputStream& out, int64 base, int64 horizon) :
+        out_(out),
+        base_(base),
+        horizon_(horizon)
+        {
+        }
+        
+        void writeVarint(uint64 value)
+        {
+            StateStreamProtocol::writeVarint(out_, value);
+        }
+        
+        void writeValue(int value)
+        {
+            writeVarint((uint32)value);
+        }
+        
+        void writeDifference(int64 value)
+        {
+            writeVarint(MidiCapture::zigzag(value));
+        }
+        
+        void writeTime(int64 time)
+        {
+            writeVarint(time == 0 ? 0 : MidiCapture::zigzag(base_ - time) + 1);
+        }
+        
+        void writeMessage(const ChannelMessage& message)
+        {
+            writeTime(message.current_.time_.toMilliseconds());
+            writeValue(message.current_.value_);
+            
+            // the history is ordered from new to old, views carry the first value they don't show to their left edge
+            auto& history = message.history_;
+            size_t size = 0;
+            while (size < history.size() && history[size].time_.toMilliseconds() >= horizon_)
+            {
+                ++size;
+            }
+            size = std::min(size + 1, history.size());
+            
+            writeVarint(size);
+            auto previous = base_;
+            for (size_t i = 0; i < size; ++i)
+            {
+                auto time = history[i].time_.toMilliseconds();
+                writeDifference(previous - time);
+                writeValue(history[i].value_);
+                previous = time;
+            }
+        }
+        
+        void writeParameters(const Parameters& parameters)
+        {
+            writeTime(parameters.time_.toMilliseconds());
+            writeVarint(parameters.param_.size());
+            for (auto& param : parameters.param_)
+            {
+                writeVarint((uint64)param.first);
+                writeMessage(param.second);
+            }
+        }
+        
+        void writeNotes(const ActiveChannel& channel)
+        {
+            auto& notes = channel.notes_;
+            writeTime(notes.time_.toMilliseconds());
+            
+            auto count = 0;
+            for (auto i = 0; i < 128; ++i)
+            {
+                count += isSet(notes, i) ? 1 : 0;
+            }
+            writeVarint((uint64)count);
+            for (auto i = 0; i < 128; ++i)
+            {
+                if (isSet(notes, i))
+                {
+                    writeVarint((uint64)i);
+                    writeMessage(notes.noteOn_[i]);
+                    writeMessage(notes.noteOn_[i].polyPressure_);
+                    writeMessage(notes.noteOff_[i]);
+                }
+            }
+            
+            spans_.clear();
+            channel.noteSpans_.forEachSince(horizon_, [this] (const NoteSpan& span) { spans_.push_back(span); });
+            writeVarint(spans_.size());
+            for (auto& span : spans_)
+            {
+                writeVarint(span.number_);
+                writeVarint(span.velocity_);
+                writeTime(span.end_);
+                writeDifference((span.end_ != 0 ? span.end_ : base_) - span.start_);
+            }
+            
+            auto has_heat = channel.noteHeat_.getLastUpdate() != 0;
+            writeVarint(has_heat ? 1 : 0);
+            if (has_heat)
+            {
+                out_.write(&channel.noteHeat_, sizeof(NoteHeat));
+            }
+        }
+        
+        void writeControlChanges(const ControlChanges& controlChanges)
+        {
+            writeTime(controlChanges.time_.toMilliseconds());
+            
+            auto count = 0;
+            for (auto i = 0; i < 128; ++i)
+            {
+                count += isSet(controlChanges.controlChange_[i]) ? 1 : 0;
+            }
+            writeVarint((uint64)count);
+            for (auto i = 0; i < 128; ++i)
+            {
+                if (isSet(controlChanges.controlChange_[i]))
+                {
+                    writeVarint((uint64)i);
+                    writeMessage(controlChanges.controlChange_[i]);
+                }
+            }
+        }
+        
+        void writeChannel(const ActiveChannel& channel)
+        {
+            writeTime(channel.time_.toMilliseconds());
+            writeVarint(channel.mpeManager_ ? 1 : 0);
+            writeVarint((uint64)channel.mpeMember_);
+            writeVarint((uint64)channel.lastRpnMsb_);
+            writeVarint((uint64)channel.lastRpnLsb_);
+            writeVarint((uint64)channel.lastNrpnMsb_);
+            writeVarint((uint64)channel.lastNrpnLsb_);
+            
+            writeNotes(channel);
+            writeControlChanges(channel.controlChanges_);
+            writeMessage(channel.programChange_);
+            writeMessage(channel.channelPressure_);
+            writeMessage(channel.pitchBend_);
+            writeParameters(channel.hrccs_);
+            writeParameters(channel.rpns_);
+            writeParameters(channel.nrpns_);
+        }
+        
+        void writeChannels(const ActiveChannels& channels, const std::deque<double>& clockTimeStamps)
+        {
+            auto& sysex = channels.sysex_;
+            writeTime(sysex.time_.toMilliseconds());
+            writeVarint((uint64)sysex.length_);
+            out_.write(sysex.data_, Sysex::MAX_SYSEX_DATA);
+            
+            auto& clock = channels.clock_;
+            writeTime(clock.timeBpm_.toMilliseconds());
+            writeTime(clock.timeStart_.toMilliseconds());
+            writeTime(clock.timeContinue_.toMilliseconds());
+            writeTime(clock.timeStop_.toMilliseconds());
+            out_.write(&clock.bpm_, sizeof(double));
+            
+            writeVarint(clockTimeStamps.size());
+            for (auto time_stamp : clockTimeStamps)
+            {
+                out_.write(&time_stamp, sizeof(double));
+            }
+            
+            auto count = 0;
+            for (auto& channel : channels.channel_)
+            {
+                count += channel.time_.toMilliseconds() != 0 ? 1 : 0;
+            }
+            writeVarint((uint64)count);
+            for (auto& channel : channels.channel_)
+            {
+                if (channel.time_.toMilliseconds() != 0)
+                {
+                    writeVarint((uint64)channel.number_);
+                    writeChannel(channel);
+                }
+            }
+        }
+        
+        static bool isSet(const ChannelMessage& message)
+        {
+            return message.current_.time_.toMilliseconds() != 0 || message.current_.value_ != 0 || !message.history_.empty();
+        }
+        
+        static bool isSet(const Notes& notes, int number)
+        {
+            return isSet(notes.noteOn_[number]) || isSet(notes.noteOn_[number].polyPressure_) || isSet(notes.noteOff_[number]);
+        }
+        
+        MemoryOutputStream& out_;
+        const int64 base_;
+        const int64 horizon_;
+        std::vector<NoteSpan> spans_;
+    };
+    
+    /** Decodes what the writer encoded into channels that were reset, any inconsistency marks the keyframe as invalid. */
+    struct KeyframeReader
+    {
+        KeyframeReader(const MemoryBlock& block, int64 base) :
+        data_((const uint8*)block.getData()),
+        end_(data_ + block.getSize()),
+        base_(base)
+        {
+        }
+        
+        uint64 readVarint()
+        {
+            uint64 value = 0;
+            valid_ = StateStreamProtocol::readVarint(data_, end_, value) && valid_;
+            return value;
+        }
+        
+        int readValue()
+        {
+            return (int)(uint32)readVarint();
+        }
+        
+        int64 readDifference()
+        {
+            return MidiCapture::unzigzag(readVarint());
+        }
+        
+        int64 readTime()
+        {
+            auto value = readVarint();
+            return value == 0 ? 0 : base_ - MidiCapture::unzigzag(value - 1);
+        }
+        
+        /** Reads a number that indexes an array of a size, 0 when it's out of range. */
+        int readIndex(int size)
+        {
+            auto value = readVarint();
+            if (value >= (uint64)size)
+            {
+                valid_ = false;
+                return 0;
+            }
+            return (int)value;
+        }
+        
+        void readBytes(void* destination, size_t size)
+        {
+            if (size > (size_t)(end_ - data_))
+            {
+                valid_ = false;
+                return;
+            }
+            memcpy(destination, data_, size);
+            data_ += size;
+        }
+        
+        void readMessage(ChannelMessage& message)
+        {
+            message.current_.time_ = Time(readTime());
+            message.current_.value_ = readValue();
+            
+            auto size = readVarint();
+            if (size > (uint64)(end_ - data_))
+            {
+                valid_ = false;
+                return;
+            }
+            message.history_.resize((size_t)size);
+            auto time = base_;
+            for (auto& value : message.history_)
+            {
+                time -= readDifference();
+                value.time_ = Time(time);
+                value.value_ = readValue();
+            }
+        }
+        
+        void readParameters(Parameters& parameters)
+        {
+            parameters.time_ = Time(readTime());
+            auto count = readVarint();
+            for (uint64 i = 0; i < count && valid_; ++i)
+            {
+                auto number = readIndex(1 << 14);
+                readMessage(parameters.param_[number]);
+            }
+        }
+        
+        void readNotes(ActiveChannel& channel)
+        {
+            auto& notes = channel.notes_;
+            notes.time_ = Time(readTime());
+            
+            auto count = readVarint();
+            for (uint64 i = 0; i < count && valid_; ++i)
+            {
+                auto number = readIndex(128);
+                readMessage(notes.noteOn_[number]);
+                readMessage(notes.noteOn_[number].polyPressure_);
+                readMessage(notes.noteOff_[number]);
+            }
+            
+            // the finished spans come first and in order, replaying them rebuilds the same spans
+            auto spans = readVarint();
+            for (uint64 i = 0; i < spans && valid_; ++i)
+            {
+                auto number = readIndex(128);
+                auto velocity = readIndex(128);
+                auto end = readTime();
+                auto start = (end != 0 ? end : base_) - readDifference();
+                channel.noteSpans_.noteOn(number, velocity, start);
+                if (end != 0)
+                {
+                    channel.noteSpans_.noteOff(number, end);
+                }
+            }
+            
+            if (readVarint() != 0)
+            {
+                readBytes(&channel.noteHeat_, sizeof(NoteHeat));
+            }
+        }
+        
+        void readControlChanges(ControlChanges& controlChanges)
+        {
+            controlChanges.time_ = Time(readTime());
+            
+            auto count = readVarint();
+            for (uint64 i = 0; i < count && valid_; ++i)
+            {
+                readMessage(controlChanges.controlChange_[readIndex(128)]);
+            }
+        }
+        
+        void readChannel(ActiveChannel& channel)
+        {
+            channel.time_ = Time(readTime());
+            channel.mpeManager_ = readVarint() != 0;
+            channel.mpeMember_ = (MpeMember)readIndex(MpeMember::mpeUpper + 1);
+            channel.lastRpnMsb_ = readIndex(128);
+            channel.lastRpnLsb_ = readIndex(128);
+            channel.lastNrpnMsb_ = readIndex(128);
+            channel.lastNrpnLsb_ = readIndex(128);
+            
+            readNotes(channel);
+            readControlChanges(channel.controlChanges_);
+            readMessage(channel.programChange_);
+            readMessage(channel.channelPressure_);
+            readMessage(channel.pitchBend_);
+            readParameters(channel.hrccs_);
+            readParameters(channel.rpns_);
+            readParameters(channel.nrpns_);
+        }
+        
+        bool readChannels(ActiveChannels& channels, std::deque<double>& clockTimeStamps)
+        {
+            channels.reset();
+            clockTimeStamps.clear();
+            
+            auto& sysex = channels.sysex_;
+            sysex.time_ = Time(readTime());
+            sysex.length_ = (int)readVarint();
+            readBytes(sysex.data_, Sysex::MAX_SYSEX_DATA);
+            
+            auto& clock = channels.clock_;
+            clock.timeBpm_ = Time(readTime());
+            clock.timeStart_ = Time(readTime());
+            clock.timeContinue_ = Time(readTime());
+            clock.timeStop_ = Time(readTime());
+            readBytes(&clock.bpm_, sizeof(double));
+            
+            auto time_stamps = readVarint();
+            for (uint64 i = 0; i < time_stamps && valid_; ++i)
+            {
+                auto time_stamp = 0.0;
+                readBytes(&time_stamp, sizeof(double));
+                clockTimeStamps.push_back(time_stamp);
+            }
+            
+            auto count = readVarint();
+            for (uint64 i = 0; i < count && valid_; ++i)
+            {
+                readChannel(channels.channel_[readIndex(16)]);
+            }
+            
+            return valid_;
+        }
+        
+        const uint8* data_;
+        const uint8* const end_;
+        const int64 base_;
+        bool valid_ { true };
+    };
+}
+
+struct MidiTimeline::Pimpl
+{
+    static constexpr int REPLAY_BATCH = 256;
+    
+    /** The channels after the messages before a position, without the tempos at it. */
+    struct Keyframe
+    {
+        uint64 sequence_ { 0 };
+        int64 time_ { 0 };
+        MemoryBlock data_;
+    };
+    
+    /** What the event log doesn't keep of the messages that need it: the first bytes of sysex, the timestamps of clocks. */
+    struct Payload
+    {
+        uint64 sequence_ { 0 };
+        double timeStamp_ { 0.0 };
+        uint8 data_[Sysex::MAX_SYSEX_DATA] {};
+    };
+    
+    /** A tempo that isn't in the log, it applies before the message at its position. */
+    struct Tempo
+    {
+        uint64 sequence_ { 0 };
+        int64 time_ { 0 };
+        double bpm_ { 0.0 };
+    };
+    
+    /** A keyframe that's asked for, to be built by replaying the log up to its position. */
+    struct Request
+    {
+        uint64 sequence_ { 0 };
+        int64 time_ { 0 };
+    };
+    
+    Pimpl(const MidiEventLog& events) : events_(events)
+    {
+    }
+    
+    bool needsKeyframe(int64 time, uint32 generation) const
+    {
+        return requestedGeneration_ != generation ||
+               eventsSinceKeyframe_ >= KEYFRAME_EVENTS ||
+               time - lastKeyframeTime_ >= KEYFRAME_INTERVAL_MS;
+    }
+    
+    void requestKeyframe(uint64 sequence, int64 time)
+    {
+        // a clear is only seen through the generation, the first request after it starts over
+        auto generation = generation_.load();
+        if (!needsKeyframe(time, generation))
+        {
+            return;
+        }
+        
+        // keyframes are looked up by time, keep them ordered when messages arrive out of order
+        auto keyframe_time = requestedGeneration_ == generation ? std::max(time, lastKeyframeTime_) : time;
+        requestedGeneration_ = generation;
+        eventsSinceKeyframe_ = 0;
+        lastKeyframeTime_ = keyframe_time;
+        
+        const SpinLock::ScopedLockType lock(lock_);
+        // cleared meanwhile, the next message asks again
+        if (generation == generation_)
+        {
+            requests_.push_back({ sequence, keyframe_time });
+        }
+    }
+    
+    void add(const MidiMessage& msg, int64 time)
+    {
+        auto sequence = events_.getEnd();
+        requestKeyframe(sequence, time);
+        ++eventsSinceKeyframe_;
+        
+        if (msg.isSysEx() || msg.isMidiClock())
+        {
+            Payload payload;
+            payload.sequence_ = sequence;
+            payload.timeStamp_ = msg.getTimeStamp();
+            if (msg.isSysEx())
+            {
+                memcpy(payload.data_, msg.getSysExData(), (size_t)std::min(msg.getSysExDataSize(), Sysex::MAX_SYSEX_DATA));
+            }
+            
+            const SpinLock::ScopedLockType lock(lock_);
+            payloads_.push_back(payload);
+        }
+    }
+    
+    void addTempo(double bpm, int64 time)
+    {
+        auto sequence = events_.getEnd();
+        requestKeyframe(sequence, time);
+        
+        const SpinLock::ScopedLockType lock(lock_);
+        tempos_.push_back({ sequence, time, bpm });
+    }
+    
+    void clear()
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        keyframes_.clear();
+        keyframeBytes_ = 0;
+        payloads_.clear();
+        tempos_.clear();
+        requests_.clear();
+        // a keyframe that's being built from before is dropped
+        ++generation_;
+    }
+    
+    void buildKeyframes(ActiveChannels& channels, std::deque<double>& clockTimeStamps, MidiTimelineCallback& callback)
+    {
+        while (true)
+        {
+            Request request;
+            uint32 generation = 0;
+            auto first = false;
+            {
+                const SpinLock::ScopedLockType lock(lock_);
+                if (requests_.empty())
+                {
+                    return;
+                }
+                request = requests_.front();
+                requests_.pop_front();
+                generation = generation_;
+                first = keyframes_.empty();
+            }
+            
+            if (first)
+            {
+                // the timeline starts along with the channels
+                channels.reset();
+                clockTimeStamps.clear();
+            }
+            else if (!replay(std::numeric_limits<int64>::max(), request.sequence_, false, channels, clockTimeStamps, callback))
+            {
+                // the messages since the keyframe before are gone, seeks past it fail until the window moved on
+                continue;
+            }
+            
+            auto keyframe = std::make_shared<Keyframe>();
+            keyframe->sequence_ = request.sequence_;
+            keyframe->time_ = request.time_;
+            {
+                MemoryOutputStream out(keyframe->data_, false);
+                KeyframeWriter writer(out, keyframe->time_, keyframe->time_ - historyMs_);
+                writer.writeChannels(channels, clockTimeStamps);
+            }
+            
+            const SpinLock::ScopedLockType lock(lock_);
+            if (generation != generation_)
+            {
+                continue;
+            }
+            keyframeBytes_ += keyframe->data_.getSize();
+            keyframes_.push_back(std::move(keyframe));
+            prune(request.time_);
+        }
+    }
+    
+    /** Drops what's outside of the window, the first keyframe left is the one that starts it. */
+    void prune(int64 time)
+    {
+        auto begin = events_.getBegin();
+        while (keyframes_.size() > 1 &&
+               (keyframes_[1]->time_ <= time - WINDOW_MS ||
+                keyframes_.front()->sequence_ < begin ||
+                keyframeBytes_ > MAX_KEYFRAME_BYTES))
+        {
+            keyframeBytes_ -= keyframes_.front()->data_.getSize();
+            keyframes_.pop_front();
+        }
+        
+        auto first = keyframes_.front()->sequence_;
+        while (!payloads_.empty() && payloads_.front().sequence_ < first)
+        {
+            payloads_.pop_front();
+        }
+        while (!tempos_.empty() && tempos_.front().sequence_ < first)
+        {
+            tempos_.pop_front();
+        }
+    }
+    
+    int64 getBeginTime() const
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        return keyframes_.empty() ? 0 : keyframes_.front()->time_;
+    }
+    
+    /**
+     * Decodes the last keyframe at a moment that doesn't include messages past the end, and replays
+     * the messages since up to the moment. The tempos at the end itself are only replayed when asked.
+     */
+    bool replay(int64 time, uint64 end, bool temposAtEnd, ActiveChannels& channels, std::deque<double>& clockTimeStamps, MidiTimelineCallback& callback) const
+    {
+        std::shared_ptr<const Keyframe> keyframe;
+        std::vector<Payload> payloads;
+        std::vector<Tempo> tempos;
+        {
+            const SpinLock::ScopedLockType lock(lock_);
+            
+            auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), time,
+                                         [] (int64 moment, const std::shared_ptr<const Keyframe>& stored) { return moment < stored->time_; });
+            while (next != keyframes_.begin())
+            {
+                --next;
+                if ((*next)->sequence_ <= end)
+                {
+                    keyframe = *next;
+                    break;
+                }
+            }
+            if (keyframe == nullptr)
+            {
+                return false;
+            }
+            
+            auto from = std::lower_bound(payloads_.begin(), payloads_.end(), keyframe->sequence_,
+                                         [] (const Payload& payload, uint64 sequence) { return payload.sequence_ < sequence; });
+            for (auto it = from; it != payloads_.end() && it->sequence_ < end; ++it)
+            {
+                payloads.push_back(*it);
+            }
+            
+            auto tempo_from = std::lower_bound(tempos_.begin(), tempos_.end(), keyframe->sequence_,
+                                               [] (const Tempo& tempo, uint64 sequence) { return tempo.sequence_ < sequence; });
+            for (auto it = tempo_from; it != tempos_.end() && (it->sequence_ < end || (temposAtEnd && it->sequence_ == end)); ++it)
+            {
+                tempos.push_back(*it);
+            }
+        }
+        
+        KeyframeReader reader(keyframe->data_, keyframe->time_);
+        if (!reader.readChannels(channels, clockTimeStamps))
+        {
+            return false;
+        }
+        
+        auto tempo = tempos.cbegin();
+        auto replay_tempos = [&] (uint64 sequence)
+        {
+            while (tempo != tempos.cend() && tempo->sequence_ <= sequence && tempo->time_ <= time)
+            {
+                callback.handleTimelineTempo(tempo->bpm_, Time(tempo->time_));
+                ++tempo;
+            }
+        };
+        
+        static const uint8 no_data[Sysex::MAX_SYSEX_DATA] {};
+        LoggedEvent batch[REPLAY_BATCH];
+        auto payload = payloads.cbegin();
+        auto sequence = keyframe->sequence_;
+        while (sequence < end)
+        {
+            auto first = sequence;
+            auto count = events_.read(first, batch, (int)std::min((uint64)REPLAY_BATCH, end - sequence));
+            if (first != sequence || count == 0)
+            {
+                // the messages after the keyframe were overwritten meanwhile
+                return false;
+            }
+            
+            for (auto i = 0; i < count; ++i, ++sequence)
+            {
+                replay_tempos(sequence);
+                
+                auto& event = batch[i];
+                if (event.time_ > time)
+                {
+                    return true;
+                }
+                
+                while (payload != payloads.cend() && payload->sequence_ < sequence)
+                {
+                    ++payload;
+                }
+                auto has_payload = payload != payloads.cend() && payload->sequence_ == sequence;
+                
+                if (event.isSysEx())
+                {
+                    callback.handleTimelineSysex(has_payload ? payload->data_ : no_data, (int)event.length_, Time(event.time_));
+                }
+                else
+                {
+                    auto msg = event.toMidiMessage();
+                    if (has_payload)
+                    {
+                        msg.setTimeStamp(payload->timeStamp_);
+                    }
+                    callback.handleTimelineMessage(msg, Time(event.time_));
+                }
+            }
+        }
+        replay_tempos(end);
+        
+        return true;
+    }
+    
+    const MidiEventLog& events_;
+    std::atomic<int64> historyMs_ { DEFAULT_HISTORY_MS };
+    
+    // only touched by the thread that adds messages, the first generation starts without a request
+    uint32 requestedGeneration_ { 0 };
+    int eventsSinceKeyframe_ { 0 };
+    int64 lastKeyframeTime_ { 0 };
+    
+    mutable SpinLock lock_;
+    std::deque<std::shared_ptr<const Keyframe>> keyframes_;
+    size_t keyframeBytes_ { 0 };
+    std::deque<Payload> payloads_;
+    std::deque<Tempo> tempos_;
+    std::deque<Request> requests_;
+    // changed under the lock by clear, read by the threads that add messages and build keyframes
+    std::atomic<uint32> generation_ { 1 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+MidiTimeline::MidiTimeline(const MidiEventLog& l) : pimpl_(new Pimpl(l)) {}
+MidiTimeline::~MidiTimeline() = default;
+
+void MidiTimeline::setHistory(int64 h)                                      { pimpl_->historyMs_ = std::max(h, (int64)0); }
+void MidiTimeline::add(const MidiMessage& m, int64 t)                       { pimpl_->add(m, t); }
+void MidiTimeline::addTempo(double b, int64 t)                              { pimpl_->addTempo(b, t); }
+void MidiTimeline::clear()                                                  { pimpl_->clear(); }
+void MidiTimeline::buildKeyframes(ActiveChannels& c, std::deque<double>& s, MidiTimelineCallback& cb) { pimpl_->buildKeyframes(c, s, cb); }
+int64 MidiTimeline::getBeginTime() const                                    { return pimpl_->getBeginTime(); }
+uint64 MidiTimeline::getEnd() const                                         { return pimpl_->events_.getEnd(); }
+bool MidiTimeline::seek(int64 t, uint64 e, ActiveChannels& c, std::deque<double>& s, MidiTimelineCallback& cb) const { return pimpl_->replay(t, e, true, c, s, cb); }
+}
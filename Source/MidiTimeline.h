@@ -0,0 +1,107 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ChannelState.h"
+
+namespace showmidi
+{
+    class MidiEventLog;
+    
+    /** Receives the messages a timeline replays to reconstruct a moment. */
+    class MidiTimelineCallback
+    {
+    public:
+        virtual ~MidiTimelineCallback() = default;
+        
+        virtual void handleTimelineMessage(const MidiMessage&, Time) = 0;
+        /** Sysex messages only come with the data the channels keep, and the size they had. */
+        virtual void handleTimelineSysex(const uint8* data, int size, Time) = 0;
+        /** A tempo that didn't arrive as a message, like the one of a streamed device. */
+        virtual void handleTimelineTempo(double bpm, Time) = 0;
+    };
+    
+    /**
+     * The recent past of a device, to look at the channels as they were at any moment of it.
+     *
+     * The messages are read from the event log of the device, the timeline only keeps what the
+     * log doesn't, and every so often the channels as a keyframe: a compact encoding of only the
+     * values that were ever set, with the graph and piano roll history that a view is able to
+     * paint. A moment is reconstructed by decoding the last keyframe before it and replaying the
+     * messages since, which the device state does with the same code that ingests the live messages.
+     *
+     * Keyframes are asked for after KEYFRAME_EVENTS messages or KEYFRAME_INTERVAL_MS, whichever
+     * comes first, so the work of a seek is bounded however busy the device is. The thread that
+     * adds messages only notes the position, the keyframes are built later on another thread by
+     * replaying the messages since the keyframe before, from the first one of empty channels.
+     */
+    class MidiTimeline
+    {
+    public:
+        static constexpr int64 WINDOW_MS = 10 * 60 * 1000;
+        static constexpr int KEYFRAME_EVENTS = 4096;
+        static constexpr int64 KEYFRAME_INTERVAL_MS = 5000;
+        /** The history that's kept when no view said how much it paints. */
+        static constexpr int64 DEFAULT_HISTORY_MS = 10000;
+        /** Older keyframes are dropped when they take more, which shortens the window. */
+        static constexpr size_t MAX_KEYFRAME_BYTES = (size_t)64 * 1024 * 1024;
+        
+        /** The log is owned and filled by the device state, which keeps it enabled. */
+        MidiTimeline(const MidiEventLog&);
+        ~MidiTimeline();
+        
+        /** How much graph and piano roll history keyframes keep, in milliseconds. */
+        void setHistory(int64);
+        
+        /**
+         * Keeps what the log doesn't of a message, and asks for a keyframe when it's time.
+         * Called before the message is appended to the log, from the thread that appends it.
+         */
+        void add(const MidiMessage&, int64 time);
+        /** Keeps a tempo that didn't arrive as a message, from the thread that adds messages. */
+        void addTempo(double bpm, int64 time);
+        /** Forgets everything from any thread, the channels are expected to be reset too. */
+        void clear();
+        
+        /**
+         * Encodes the keyframes that were asked for, replaying the messages since the keyframe
+         * before into the channels through the callback. Only to be called from a single thread.
+         */
+        void buildKeyframes(ActiveChannels&, std::deque<double>& clockTimeStamps, MidiTimelineCallback&);
+        
+        /** The earliest moment that can be reconstructed, 0 when there's none. */
+        int64 getBeginTime() const;
+        /** The position that the next message will get. */
+        uint64 getEnd() const;
+        
+        /**
+         * Reconstructs the channels at a moment, from the messages before an end position.
+         * The channels and the timestamps are set to the keyframe, then the messages up to the
+         * moment are replayed through the callback. Returns false when the moment isn't available.
+         */
+        bool seek(int64 time, uint64 end, ActiveChannels&, std::deque<double>& clockTimeStamps, MidiTimelineCallback&) const;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiTimeline)
+    };
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+namespace showmidi
+{
+    /**
+     * Decaying per key and per velocity accumulators of the note ons of a channel.
+     *
+     * Both are contiguous arrays of 128 floats, so the decay and the normalization are
+     * single vectorized passes over them.
+     */
+    class NoteHeat
+    {
+    public:
+        static constexpr int NUM_BINS = 128;
+        static constexpr double HALF_LIFE_MS = 10000.0;
+        
+        void noteOn(int number, int velocity, int64 time)
+        {
+            decay(time);
+            keys_[number & 0x7f] += 1.0f;
+            velocities_[velocity & 0x7f] += 1.0f;
+        }
+        
+        /** The time of the last note on, 0 when there's none. */
+        int64 getLastUpdate() const
+        {
+            return updated_;
+        }
+        
+        /**
+         * Writes the levels at a point in time to arrays of NUM_BINS, between 0 and 1.
+         * Each array is normalized against its own peak, which fades out once it decayed below a single note.
+         */
+        void getLevels(int64 time, float* keyLevels, float* velocityLevels) const
+        {
+            auto factor = getDecayFactor(time);
+            normalize(keyLevels, keys_, factor);
+            normalize(velocityLevels, velocities_, factor);
+        }
+        
+        void reset()
+        {
+            FloatVectorOperations::clear(keys_, NUM_BINS);
+            FloatVectorOperations::clear(velocities_, NUM_BINS);
+            updated_ = 0;
+        }
+        
+    private:
+        float getDecayFactor(int64 time) const
+        {
+            if (updated_ == 0 || time <= updated_)
+            {
+                return 1.0f;
+            }
+            return (float)std::exp2(-(double)(time - updated_) / HALF_LIFE_MS);
+        }
+        
+        void decay(int64 time)
+        {
+            auto factor = getDecayFactor(time);
+            if (factor < 1.0f)
+            {
+                FloatVectorOperations::multiply(keys_, factor, NUM_BINS);
+                FloatVectorOperations::multiply(velocities_, factor, NUM_BINS);
+            }
+            updated_ = std::max(updated_, time);
+        }
+        
+        static void normalize(float* levels, const float* accumulators, float factor)
+        {
+            auto peak = FloatVectorOperations::findMaximum(accumulators, NUM_BINS) * factor;
+            FloatVectorOperations::multiply(levels, accumulators, factor / std::max(peak, 1.0f), NUM_BINS);
+        }
+        
+        float keys_[NUM_BINS] {};
+        float velocities_[NUM_BINS] {};
+        int64 updated_ { 0 };
+    };
+}
@@ -0,0 +1,175 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+namespace showmidi
+{
+    /** A note from its note on until its note off, in milliseconds. */
+    struct NoteSpan
+    {
+        int64 start_ { 0 };
+        int64 end_ { 0 };
+        uint8 number_ { 0 };
+        uint8 velocity_ { 0 };
+    };
+    
+    /**
+     * The recent note spans of a channel, indexed for time window queries.
+     *
+     * Finished spans are appended at their note off, which keeps them ordered by end time.
+     * The longest retained duration bounds how long before its end a span can have started,
+     * so the spans that overlap a window are found with two binary searches, and only those
+     * are visited. Held notes are kept apart until they're released.
+     */
+    class NoteSpans
+    {
+    public:
+        static constexpr int64 RETENTION_MS = 60000;
+        
+        void noteOn(int number, int velocity, int64 time)
+        {
+            // a retriggered note ends its previous span
+            noteOff(number, time);
+            
+            auto& held = held_[number & 0x7f];
+            held.start_ = time;
+            held.end_ = 0;
+            held.number_ = (uint8)(number & 0x7f);
+            held.velocity_ = (uint8)velocity;
+            ++heldCount_;
+        }
+        
+        void noteOff(int number, int64 time)
+        {
+            auto& held = held_[number & 0x7f];
+            if (held.start_ == 0)
+            {
+                return;
+            }
+            
+            held.end_ = std::max(time, held.start_);
+            finished_.push_back(held);
+            maxDuration_ = std::max(maxDuration_, held.end_ - held.start_);
+            
+            held.start_ = 0;
+            --heldCount_;
+            
+            prune(time);
+        }
+        
+        bool hasHeldNotes() const
+        {
+            return heldCount_ > 0;
+        }
+        
+        /** The end of the most recently released note, 0 when there's none. */
+        int64 getLastEnd() const
+        {
+            return finished_.empty() ? 0 : finished_.back().end_;
+        }
+        
+        /** Calls the function with every span that overlaps [from, to], held notes end at 'to'. */
+        template <typename Function>
+        void forEachInWindow(int64 from, int64 to, Function function) const
+        {
+            auto first = std::lower_bound(finished_.begin(), finished_.end(), from,
+                                          [] (const NoteSpan& span, int64 time) { return span.end_ < time; });
+            // spans that end later than this started after the window
+            auto last = std::upper_bound(first, finished_.end(), to + maxDuration_,
+                                         [] (int64 time, const NoteSpan& span) { return time < span.end_; });
+            for (auto it = first; it != last; ++it)
+            {
+                if (it->start_ <= to)
+                {
+                    function(*it);
+                }
+            }
+            
+            if (heldCount_ > 0)
+            {
+                for (auto& held : held_)
+                {
+                    if (held.start_ != 0 && held.start_ <= to)
+                    {
+                        function(NoteSpan { held.start_, to, held.number_, held.velocity_ });
+                    }
+                }
+            }
+        }
+        
+        /** Calls the function with every span that ended at or after a time, and then with the held notes, which end at 0. */
+        template <typename Function>
+        void forEachSince(int64 from, Function function) const
+        {
+            auto first = std::lower_bound(finished_.begin(), finished_.end(), from,
+                                          [] (const NoteSpan& span, int64 time) { return span.end_ < time; });
+            for (auto it = first; it != finished_.end(); ++it)
+            {
+                function(*it);
+            }
+        
+            if (heldCount_ > 0)
+            {
+                for (auto& held : held_)
+                {
+                    if (held.start_ != 0)
+                    {
+                        function(held);
+                    }
+                }
+            }
+        }
+        
+        void reset()
+        {
+            finished_.clear();
+            for (auto& held : held_)
+            {
+                held.start_ = 0;
+            }
+            heldCount_ = 0;
+            maxDuration_ = 0;
+        }
+        
+    private:
+        void prune(int64 now)
+        {
+            auto recalculate = false;
+            while (!finished_.empty() && finished_.front().end_ < now - RETENTION_MS)
+            {
+                recalculate = recalculate || finished_.front().end_ - finished_.front().start_ >= maxDuration_;
+                finished_.pop_front();
+            }
+            
+            // the longest note left, keeps the windows tight once a long note is gone
+            if (recalculate)
+            {
+                maxDuration_ = 0;
+                for (auto& span : finished_)
+                {
+                    maxDuration_ = std::max(maxDuration_, span.end_ - span.start_);
+                }
+            }
+        }
+        
+        std::deque<NoteSpan> finished_;
+        int64 maxDuration_ { 0 };
+        NoteSpan held_[128];
+        int heldCount_ { 0 };
+    };
+}
@@ -58,10 +58,10 @@ namespace showmidi
                    justificationType);
     }
     
-    void PaintedButton::drawDrawable(Graphics& g, Drawable& drawable)
+    void PaintedButton::drawDrawable(Graphics& g, const ThemedDrawables::Asset& asset, Colour colour)
     {
         auto touchOutset = sm::scaled(sm::layout::BUTTON_DEFAULT_TOUCH_OUTSET, *this);
         auto bounds = getBounds().reduced(touchOutset);
-        drawable.drawAt(g, (float)bounds.getX(), (float)bounds.getY(), 1.0f);
+        drawables_->drawAt(g, asset, colour, (float)bounds.getX(), (float)bounds.getY());
     }
 }
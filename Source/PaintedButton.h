@@ -21,6 +21,7 @@
 
 #include "DpiScaling.h"
 #include "Theme.h"
+#include "ThemedDrawables.h"
 
 namespace showmidi
 {
@@ -36,12 +37,14 @@ namespace showmidi
         Rectangle<float> getBoundsForDrawing();
 
         void drawName(Graphics&, Justification);
-        void drawDrawable(Graphics&, Drawable&);
+        void drawDrawable(Graphics&, const ThemedDrawables::Asset&, Colour);
         
     private:
         void setBounds(Rectangle<int>);
         void setBounds(int, int, int, int);
         
+        SharedResourcePointer<ThemedDrawables> drawables_;
+        
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PaintedButton)
     };
 }
@@ -17,8 +17,10 @@
  */
 #include "PluginEditor.h"
 
+#include "FramePacer.h"
 #include "MainLayoutComponent.h"
 #include "MidiDeviceComponent.h"
+#include "MidiDeviceState.h"
 #include "PluginProcessor.h"
 #include "PluginSettings.h"
 #include "SettingsManager.h"
@@ -35,8 +37,7 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
     
     enum Timers
     {
-        RenderDevices = 1,
-        GrabKeyboardFocus
+        GrabKeyboardFocus = 1
     };
     
     Pimpl(ShowMIDIPluginAudioProcessorEditor* owner, ShowMIDIPluginAudioProcessor* p) :
@@ -45,7 +46,8 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
     {
         Desktop::getInstance().setDefaultLookAndFeel(&lookAndFeel_);
         
-        midiDevice_ = std::make_unique<MidiDeviceComponent>(this, "ShowMIDI");
+        midiDeviceState_ = std::make_unique<MidiDeviceState>("ShowMIDI");
+        midiDevice_ = std::make_unique<MidiDeviceComponent>(this, *midiDeviceState_);
         layout_ = std::make_unique<MainLayoutComponent>(this, this, MainLayoutType::layoutPlugin, midiDevice_.get());
         
         owner_->setResizable(true, true);
@@ -60,8 +62,8 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
         owner_->setSize(layout_->getWidth(), sm::scaled(DEFAULT_EDITOR_HEIGHT, *owner_));
         owner_->setWantsKeyboardFocus(true);
         
-        // 30Hz
-        startTimer(RenderDevices, 1000 / 30);
+        framePacer_ = std::make_unique<FramePacer>(owner_, this, [this] { return renderDevices(); });
+        midiDeviceState_->setFramePacer(framePacer_.get());
         
         startTimer(GrabKeyboardFocus, 100);
 #if SHOW_TEST_DATA
@@ -71,12 +73,12 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
     
     ~Pimpl()
     {
-        stopTimer(RenderDevices);
+        midiDeviceState_->setFramePacer(nullptr);
     }
     
     void handleIncomingMidiMessage(const MidiMessage& msg)
     {
-        midiDevice_->handleIncomingMidiMessage(msg);
+        midiDeviceState_->handleIncomingMidiMessage(msg);
     }
     
     bool isPaused() override
@@ -90,9 +92,19 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
         deviceListeners_.broadcastPauseChange(paused_);
     }
     
+    int64 getScrubLength() override
+    {
+        return midiDeviceState_->getTimelineLength();
+    }
+    
+    void scrubTo(int64 offset) override
+    {
+        midiDeviceState_->scrubTo(offset);
+    }
+    
     void resetChannelData() override
     {
-        midiDevice_->resetChannelData();
+        midiDeviceState_->resetChannelData();
     }
     
     DeviceListeners& getDeviceListeners() override
@@ -104,19 +116,13 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
     {
         paused_ = paused;
         
-        midiDevice_->setPaused(paused);
+        midiDeviceState_->setPaused(paused);
     }
     
     void timerCallback(int timerID) override
     {
         switch (timerID)
         {
-            case RenderDevices:
-            {
-                renderDevices();
-                break;
-            }
-                
             case GrabKeyboardFocus:
             {
                 if (owner_->isVisible())
@@ -129,7 +135,7 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
         }
     }
     
-    void renderDevices()
+    int renderDevices()
     {
         int height;
         if (owner_->getParentComponent())
@@ -140,9 +146,11 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
         {
             height = owner_->getHeight();
         }
-        midiDevice_->render();
+        auto next_frame = midiDevice_->render();
         height = std::max(height, midiDevice_->getVisibleHeight());
         midiDevice_->setSize(midiDevice_->getStandardWidth(), height);
+        
+        return next_frame;
     }
     
     void paint(Graphics& g)
@@ -185,9 +193,9 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
         owner_->repaint();
     }
     
-    MidiDevicesListeners& getMidiDevicesListeners() override
+    MidiDeviceRegistry& getMidiDeviceRegistry() override
     {
-        return midiDevicesListeners_;
+        return midiDeviceRegistry_;
     }
     
     UwynLookAndFeel lookAndFeel_;
@@ -195,10 +203,13 @@ struct ShowMIDIPluginAudioProcessorEditor::Pimpl : public MultiTimer, public Set
     ShowMIDIPluginAudioProcessorEditor* const owner_;
     ShowMIDIPluginAudioProcessor* const audioProcessor_;
     
+    std::unique_ptr<MidiDeviceState> midiDeviceState_;
     std::unique_ptr<MidiDeviceComponent> midiDevice_;
     std::unique_ptr<MainLayoutComponent> layout_;
+    std::unique_ptr<FramePacer> framePacer_;
     
-    MidiDevicesListeners midiDevicesListeners_;
+    // the plugin only shows its own input, the registry is never started
+    MidiDeviceRegistry midiDeviceRegistry_;
     
     bool paused_ { false };
     DeviceListeners deviceListeners_;
@@ -28,6 +28,8 @@ namespace showmidi
         settings_.setProperty(PropertiesSettings::NOTE_FORMAT, properties_settings.getNoteFormat(), nullptr);
         settings_.setProperty(PropertiesSettings::NUMBER_FORMAT, properties_settings.getNumberFormat(), nullptr);
         settings_.setProperty(PropertiesSettings::TIMEOUT_DELAY, properties_settings.getTimeoutDelay(), nullptr);
+        settings_.setProperty(PropertiesSettings::FRAME_RATE_LIMIT, properties_settings.getFrameRateLimit(), nullptr);
+        settings_.setProperty(PropertiesSettings::NOTES_VIEW, properties_settings.getNotesView(), nullptr);
         
         theme_ = properties_settings.getTheme();
         settings_.setProperty(PropertiesSettings::THEME, theme_.generateXml(), nullptr);
@@ -106,6 +108,26 @@ namespace showmidi
     {
         settings_.setProperty(PropertiesSettings::CONTROL_GRAPH_HEIGHT, height, nullptr);
     }
+    
+    int PluginSettings::getFrameRateLimit()
+    {
+        return settings_.getProperty(PropertiesSettings::FRAME_RATE_LIMIT, PropertiesSettings::DEFAULT_FRAME_RATE_LIMIT);
+    }
+    
+    void PluginSettings::setFrameRateLimit(int fps)
+    {
+        settings_.setProperty(PropertiesSettings::FRAME_RATE_LIMIT, fps, nullptr);
+    }
+
+    NotesView PluginSettings::getNotesView()
+    {
+        return (NotesView)(int)settings_.getProperty(PropertiesSettings::NOTES_VIEW, PropertiesSettings::DEFAULT_NOTES_VIEW);
+    }
+
+    void PluginSettings::setNotesView(NotesView view)
+    {
+        settings_.setProperty(PropertiesSettings::NOTES_VIEW, view, nullptr);
+    }
 
     Theme& PluginSettings::getTheme()
     {
@@ -126,6 +148,17 @@ namespace showmidi
     {
         // no-op
     }
+    
+    String PluginSettings::getMidiThruOutput(const String&)
+    {
+        // the host routes the plugin's MIDI
+        return {};
+    }
+    
+    void PluginSettings::setMidiThruOutput(const String&, const String&)
+    {
+        // no-op
+    }
 
     ValueTree& PluginSettings::getValueTree()
     {
@@ -49,12 +49,20 @@ namespace showmidi
         
         int getControlGraphHeight();
         void setControlGraphHeight(int);
+        
+        int getFrameRateLimit();
+        void setFrameRateLimit(int);
+
+        NotesView getNotesView();
+        void setNotesView(NotesView);
 
         Theme& getTheme();
         void storeTheme();
         
         bool isMidiDeviceVisible(const String&);
         void setMidiDeviceVisible(const String&, bool);
+        String getMidiThruOutput(const String&);
+        void setMidiThruOutput(const String&, const String&);
 
         ValueTree& getValueTree();
         void copyValueTree(ValueTree&);
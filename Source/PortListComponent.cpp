@@ -19,10 +19,10 @@
 
 #include "AboutComponent.h"
 #include "DpiScaling.h"
-#include "MidiDeviceInfoComparator.h"
 #include "MidiDevicesListener.h"
 #include "PaintedButton.h"
 #include "SettingsComponent.h"
+#include "ThemedDrawables.h"
 
 namespace showmidi
 {
@@ -33,12 +33,14 @@ namespace showmidi
             manager_(manager)
         {
             owner_->addMouseListener(this, false);
-            manager_->getMidiDevicesListeners().add(this);
+            manager_->getMidiDeviceRegistry().addListener(this);
+            
+            midiDevices_ = manager_->getMidiDeviceRegistry().getDevices();
         }
         
         ~Pimpl()
         {
-            manager_->getMidiDevicesListeners().remove(this);
+            manager_->getMidiDeviceRegistry().removeListener(this);
             owner_->removeMouseListener(this);
         }
         
@@ -54,34 +56,22 @@ namespace showmidi
             auto& theme = settings.getTheme();
             g.setFont(theme.fontLabel());
             
-            auto hidden_svg = hiddenSvg_->createCopy();
-            hidden_svg->replaceColour(Colours::black, theme.colorLabel);
-            auto visible_svg = visibleSvg_->createCopy();
-            visible_svg->replaceColour(Colours::black, theme.colorData);
-            
             int y_offset = 0;
             
-            auto devices = MidiInput::getAvailableDevices();
-            
-            MidiDeviceInfoComparator comparator;
-            devices.sort(comparator);
-            {
-                ScopedLock guard(midiDevicesLock_);
-                midiDevices_ = devices;
-            }
+            ScopedLock guard(midiDevicesLock_);
             
-            for (int i = 0; i < devices.size(); ++i)
+            for (int i = 0; i < midiDevices_.size(); ++i)
             {
-                auto info = devices[i];
+                auto& info = midiDevices_.getReference(i);
                 if (settings.isMidiDeviceVisible(info.identifier))
                 {
                     g.setColour(theme.colorData);
-                    visible_svg->drawAt(g, X_VISIBILITY, (float)y_offset + Y_VISIBILITY, 1.0);
+                    drawables_->drawAt(g, {BinaryData::visible_svg, BinaryData::visible_svgSize}, theme.colorData, X_VISIBILITY, (float)y_offset + Y_VISIBILITY);
                 }
                 else
                 {
                     g.setColour(theme.colorLabel);
-                    hidden_svg->drawAt(g, X_VISIBILITY, (float)y_offset + Y_VISIBILITY, 1.0);
+                    drawables_->drawAt(g, {BinaryData::hidden_svg, BinaryData::hidden_svgSize}, theme.colorLabel, X_VISIBILITY, (float)y_offset + Y_VISIBILITY);
                 }
                 g.drawText(info.name,
                            X_PORT, y_offset,
@@ -98,6 +88,11 @@ namespace showmidi
         
         void refreshMidiDevices()
         {
+            {
+                ScopedLock guard(midiDevicesLock_);
+                midiDevices_ = manager_->getMidiDeviceRegistry().getDevices();
+            }
+            
             if (owner_->isVisible())
             {
                 owner_->repaint();
@@ -130,7 +125,9 @@ namespace showmidi
                 {
                     settings.setMidiDeviceVisible(port_info.identifier, visible);
                 }
-                owner_->repaint();
+                
+                // the devices view shows or hides the device, this list repaints as a listener too
+                manager_->getMidiDeviceRegistry().refreshListeners();
             }
         }
 
@@ -145,8 +142,7 @@ namespace showmidi
         Array<MidiDeviceInfo> midiDevices_;
         CriticalSection midiDevicesLock_;
 
-        std::unique_ptr<Drawable> hiddenSvg_ = Drawable::createFromImageData(BinaryData::hidden_svg, BinaryData::hidden_svgSize);
-        std::unique_ptr<Drawable> visibleSvg_ = Drawable::createFromImageData(BinaryData::visible_svg, BinaryData::visible_svgSize);
+        SharedResourcePointer<ThemedDrawables> drawables_;
         
         int lastHeight_ { 0 };
 
@@ -17,6 +17,8 @@
  */
 #include "PropertiesSettings.h"
 
+#include "RawMidiInput.h"
+
 namespace showmidi
 {
     const String PropertiesSettings::VISUALIZATION = { "visualization" };
@@ -26,9 +28,81 @@ namespace showmidi
     const String PropertiesSettings::TIMEOUT_DELAY = { "timeoutDelay" };
     const String PropertiesSettings::WINDOW_POSITION = { "windowPosition" };
     const String PropertiesSettings::CONTROL_GRAPH_HEIGHT = { "controlGraphHeight" };
+    const String PropertiesSettings::FRAME_RATE_LIMIT = { "frameRateLimit" };
+    const String PropertiesSettings::NOTES_VIEW = { "notesView" };
     const String PropertiesSettings::MIDI_DEVICE_VISIBLE_PREFIX = { "midiDevice:visible:" };
+    const String PropertiesSettings::MIDI_THRU_OUTPUT_PREFIX = { "midiDevice:thruOutput:" };
     const String PropertiesSettings::THEME = { "theme" };
 
+    /**
+     * Writes snapshots of the properties on a thread of its own.
+     *
+     * Only the most recent snapshot is kept, snapshots that are superseded before the
+     * thread gets to them are never written.
+     */
+    class PropertiesSettings::Writer : public Thread
+    {
+    public:
+        Writer(const PropertiesFile::Options& options) :
+        Thread("Settings writer"),
+        file_(options)
+        {
+            startThread(Thread::Priority::low);
+        }
+        
+        ~Writer()
+        {
+            stopThread(STOP_TIMEOUT_MS);
+        }
+        
+        void submit(const StringPairArray& properties)
+        {
+            {
+                const ScopedLock lock(pendingLock_);
+                pending_ = std::make_unique<StringPairArray>(properties);
+            }
+            notify();
+        }
+        
+        /** Writes the pending snapshot on the calling thread, after a write that's in progress finished. */
+        void writePending()
+        {
+            const ScopedLock lock(writeLock_);
+            
+            std::unique_ptr<StringPairArray> properties;
+            {
+                const ScopedLock pending_lock(pendingLock_);
+                properties = std::move(pending_);
+            }
+            
+            if (properties != nullptr)
+            {
+                file_.getAllProperties() = *properties;
+                file_.setNeedsToBeSaved(true);
+                file_.save();
+            }
+        }
+        
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                wait(-1);
+                writePending();
+            }
+        }
+        
+    private:
+        static constexpr int STOP_TIMEOUT_MS = 10000;
+        
+        PropertiesFile file_;
+        CriticalSection writeLock_;
+        CriticalSection pendingLock_;
+        std::unique_ptr<StringPairArray> pending_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Writer)
+    };
+    
     PropertiesSettings::PropertiesSettings()
     {
         reload();
@@ -47,7 +121,7 @@ namespace showmidi
     void PropertiesSettings::setVisualization(Visualization visualization)
     {
         getGlobalProperties().setValue(VISUALIZATION, visualization);
-        flush();
+        scheduleSave();
     }
 
     int PropertiesSettings::getOctaveMiddleC()
@@ -58,7 +132,7 @@ namespace showmidi
     void PropertiesSettings::setOctaveMiddleC(int octave)
     {
         getGlobalProperties().setValue(OCTAVE_MIDDLE_C, octave);
-        flush();
+        scheduleSave();
     }
     
     NoteFormat PropertiesSettings::getNoteFormat()
@@ -69,7 +143,7 @@ namespace showmidi
     void PropertiesSettings::setNoteFormat(NoteFormat format)
     {
         getGlobalProperties().setValue(NOTE_FORMAT, format);
-        flush();
+        scheduleSave();
     }
     
     NumberFormat PropertiesSettings::getNumberFormat()
@@ -80,7 +154,7 @@ namespace showmidi
     void PropertiesSettings::setNumberFormat(NumberFormat format)
     {
         getGlobalProperties().setValue(NUMBER_FORMAT, format);
-        flush();
+        scheduleSave();
     }
     
     int PropertiesSettings::getTimeoutDelay()
@@ -91,7 +165,7 @@ namespace showmidi
     void PropertiesSettings::setTimeoutDelay(int delay)
     {
         getGlobalProperties().setValue(TIMEOUT_DELAY, delay);
-        flush();
+        scheduleSave();
     }
     
     WindowPosition PropertiesSettings::getWindowPosition()
@@ -102,7 +176,7 @@ namespace showmidi
     void PropertiesSettings::setWindowPosition(WindowPosition position)
     {
         getGlobalProperties().setValue(WINDOW_POSITION, position);
-        flush();
+        scheduleSave();
     }
     
     int PropertiesSettings::getControlGraphHeight()
@@ -113,7 +187,29 @@ namespace showmidi
     void PropertiesSettings::setControlGraphHeight(int height)
     {
         getGlobalProperties().setValue(CONTROL_GRAPH_HEIGHT, height);
-        flush();
+        scheduleSave();
+    }
+    
+    int PropertiesSettings::getFrameRateLimit()
+    {
+        return getGlobalProperties().getIntValue(FRAME_RATE_LIMIT, DEFAULT_FRAME_RATE_LIMIT);
+    }
+    
+    void PropertiesSettings::setFrameRateLimit(int fps)
+    {
+        getGlobalProperties().setValue(FRAME_RATE_LIMIT, fps);
+        scheduleSave();
+    }
+
+    NotesView PropertiesSettings::getNotesView()
+    {
+        return (NotesView)getGlobalProperties().getIntValue(NOTES_VIEW, DEFAULT_NOTES_VIEW);
+    }
+
+    void PropertiesSettings::setNotesView(NotesView view)
+    {
+        getGlobalProperties().setValue(NOTES_VIEW, view);
+        scheduleSave();
     }
 
     Theme& PropertiesSettings::getTheme()
@@ -123,18 +219,32 @@ namespace showmidi
     
     void PropertiesSettings::storeTheme()
     {
-        getGlobalProperties().setValue(THEME, theme_.generateXml());
+        // the theme is only serialized when the settings are written
+        themeChanged_ = true;
+        scheduleSave();
     }
     
     bool PropertiesSettings::isMidiDeviceVisible(const String& identifier)
     {
-        return getGlobalProperties().getBoolValue(MIDI_DEVICE_VISIBLE_PREFIX + identifier, true);
+        // the raw devices duplicate sequencer ports, they have to be picked explicitly
+        return getGlobalProperties().getBoolValue(MIDI_DEVICE_VISIBLE_PREFIX + identifier, !RawMidiInput::isRawMidiDevice(identifier));
     }
     
     void PropertiesSettings::setMidiDeviceVisible(const String& identifier, bool visible)
     {
         getGlobalProperties().setValue(MIDI_DEVICE_VISIBLE_PREFIX + identifier, visible);
-        flush();
+        scheduleSave();
+    }
+    
+    String PropertiesSettings::getMidiThruOutput(const String& identifier)
+    {
+        return getGlobalProperties().getValue(MIDI_THRU_OUTPUT_PREFIX + identifier);
+    }
+    
+    void PropertiesSettings::setMidiThruOutput(const String& identifier, const String& output)
+    {
+        getGlobalProperties().setValue(MIDI_THRU_OUTPUT_PREFIX + identifier, output);
+        scheduleSave();
     }
 
     PropertiesFile& PropertiesSettings::getGlobalProperties()
@@ -142,7 +252,7 @@ namespace showmidi
         return *propertyFile_;
     }
     
-    static PropertiesFile* createPropsFile(const String& filename)
+    static PropertiesFile::Options createPropsOptions(const String& filename)
     {
         PropertiesFile::Options options;
         options.applicationName = filename;
@@ -153,18 +263,52 @@ namespace showmidi
 #else
         options.folderName = ProjectInfo::projectName;
 #endif
+        // the files are never saved by themselves, the writer takes care of that
+        options.millisecondsBeforeSaving = -1;
         
-        return new PropertiesFile(options);
+        return options;
+    }
+    
+    /** Changes are coalesced until no other change happened for a while. */
+    void PropertiesSettings::scheduleSave()
+    {
+        startTimer(SAVE_DELAY_MS);
+    }
+    
+    void PropertiesSettings::timerCallback()
+    {
+        stopTimer();
+        writer_->submit(takeSnapshot());
+    }
+    
+    StringPairArray PropertiesSettings::takeSnapshot()
+    {
+        if (themeChanged_)
+        {
+            themeChanged_ = false;
+            getGlobalProperties().setValue(THEME, theme_.generateXml());
+        }
+        
+        // the snapshot will be written, the file itself has nothing left to save
+        propertyFile_->setNeedsToBeSaved(false);
+        return getGlobalProperties().getAllProperties();
     }
     
     void PropertiesSettings::flush()
     {
-        propertyFile_->saveIfNeeded();
+        stopTimer();
+        if (themeChanged_ || propertyFile_->needsToBeSaved())
+        {
+            writer_->submit(takeSnapshot());
+        }
+        writer_->writePending();
     }
     
     void PropertiesSettings::reload()
     {
-        propertyFile_.reset(createPropsFile(ProjectInfo::projectName));
+        auto options = createPropsOptions(ProjectInfo::projectName);
+        propertyFile_ = std::make_unique<PropertiesFile>(options);
+        writer_ = std::make_unique<Writer>(options);
         
         auto& props = getGlobalProperties();
         if (!props.containsKey(THEME))
@@ -23,7 +23,13 @@
 
 namespace showmidi
 {
-    class PropertiesSettings : public Settings
+    /**
+     * Settings that are stored in the properties file of the standalone app.
+     *
+     * Changes are written behind, on a background thread once they stopped coming in for
+     * a moment. Flushing writes whatever is still pending right away.
+     */
+    class PropertiesSettings : public Settings, private Timer
     {
     public:
         static const String VISUALIZATION;
@@ -33,7 +39,10 @@ namespace showmidi
         static const String TIMEOUT_DELAY;
         static const String WINDOW_POSITION;
         static const String CONTROL_GRAPH_HEIGHT;
+        static const String FRAME_RATE_LIMIT;
+        static const String NOTES_VIEW;
         static const String MIDI_DEVICE_VISIBLE_PREFIX;
+        static const String MIDI_THRU_OUTPUT_PREFIX;
         static const String THEME;
         
         PropertiesSettings();
@@ -59,23 +68,41 @@ namespace showmidi
         
         int getControlGraphHeight();
         void setControlGraphHeight(int);
+        
+        int getFrameRateLimit();
+        void setFrameRateLimit(int);
+
+        NotesView getNotesView();
+        void setNotesView(NotesView);
 
         Theme& getTheme();
         void storeTheme();
         
         bool isMidiDeviceVisible(const String&);
         void setMidiDeviceVisible(const String&, bool);
+        String getMidiThruOutput(const String&);
+        void setMidiThruOutput(const String&, const String&);
 
+        /** Writes the pending changes before returning, for instance when shutting down. */
         void flush();
         
     private:
+        static constexpr int SAVE_DELAY_MS = 500;
+        
+        class Writer;
+        
         std::unique_ptr<PropertiesFile> propertyFile_;
+        std::unique_ptr<Writer> writer_;
         
         PropertiesFile& getGlobalProperties();        
         void updateGlobalProps();
         void reload();
+        void scheduleSave();
+        void timerCallback() override;
+        StringPairArray takeSnapshot();
 
         Theme theme_;
+        bool themeChanged_ { false };
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PropertiesSettings)
     };
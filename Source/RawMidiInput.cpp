@@ -0,0 +1,328 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "RawMidiInput.h"
+
+#if JUCE_LINUX && JUCE_ALSA
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <time.h>
+#endif
+
+namespace showmidi
+{
+void MidiByteParser::parse(const uint8* data, int size, Time t, RawMidiInputCallback& callback)
+{
+    for (auto i = 0; i < size; ++i)
+    {
+        auto byte = data[i];
+        
+        // real-time messages can appear anywhere, even in the middle of other messages
+        if (byte >= 0xf8)
+        {
+            callback.handleRawMidiMessage(MidiMessage(byte), t);
+            continue;
+        }
+        
+        if (byte == 0xf0)
+        {
+            inSysex_ = true;
+            sysex_.clear();
+            sysex_.push_back(byte);
+            messageTime_ = t;
+            status_ = 0;
+            continue;
+        }
+        
+        if (byte == 0xf7)
+        {
+            if (inSysex_)
+            {
+                sysex_.push_back(byte);
+                callback.handleRawMidiMessage(MidiMessage(sysex_.data(), (int)sysex_.size()), messageTime_);
+                inSysex_ = false;
+            }
+            status_ = 0;
+            continue;
+        }
+        
+        if (byte >= 0x80)
+        {
+            // any other status byte ends an unterminated sysex, which is dropped
+            inSysex_ = false;
+            
+            status_ = byte;
+            received_ = 0;
+            expected_ = MidiMessage::getMessageLengthFromFirstByte(byte) - 1;
+            messageTime_ = t;
+            if (expected_ == 0)
+            {
+                callback.handleRawMidiMessage(MidiMessage(byte), t);
+                status_ = 0;
+            }
+            continue;
+        }
+        
+        if (inSysex_)
+        {
+            sysex_.push_back(byte);
+            continue;
+        }
+        
+        // data without a status, for instance when the stream was picked up halfway
+        if (status_ == 0)
+        {
+            continue;
+        }
+        
+        if (received_ == 0)
+        {
+            messageTime_ = t;
+        }
+        data_[received_++] = byte;
+        if (received_ == expected_)
+        {
+            if (expected_ == 1)
+            {
+                callback.handleRawMidiMessage(MidiMessage(status_, data_[0]), messageTime_);
+            }
+            else
+            {
+                callback.handleRawMidiMessage(MidiMessage(status_, data_[0], data_[1]), messageTime_);
+            }
+            received_ = 0;
+            
+            // system common messages don't support running status
+            if (status_ >= 0xf0)
+            {
+                status_ = 0;
+            }
+        }
+    }
+}
+
+void MidiByteParser::reset()
+{
+    status_ = 0;
+    received_ = 0;
+    expected_ = 0;
+    inSysex_ = false;
+    sysex_.clear();
+}
+
+#if JUCE_LINUX && JUCE_ALSA
+struct RawMidiInput::Pimpl : public Thread
+{
+    static constexpr int POLL_TIMEOUT_MS = 200;
+    static constexpr int READ_BUFFER_SIZE = 256;
+    
+    Pimpl(snd_rawmidi_t* rawmidi, RawMidiInputCallback* callback) :
+    Thread("Raw MIDI input"),
+    rawmidi_(rawmidi),
+    callback_(callback)
+    {
+    }
+    
+    ~Pimpl()
+    {
+        stop();
+        snd_rawmidi_close(rawmidi_);
+    }
+    
+    static std::unique_ptr<Pimpl> open(const String& device, RawMidiInputCallback* callback)
+    {
+        snd_rawmidi_t* rawmidi = nullptr;
+        if (snd_rawmidi_open(&rawmidi, nullptr, device.toRawUTF8(), SND_RAWMIDI_NONBLOCK) < 0)
+        {
+            return nullptr;
+        }
+        
+        auto pimpl = std::make_unique<Pimpl>(rawmidi, callback);
+        
+#if SND_LIB_VERSION >= 0x010206
+        // have the kernel stamp the bytes as they arrive, rather than when this thread gets to read them
+        snd_rawmidi_params_t* params;
+        snd_rawmidi_params_alloca(&params);
+        if (snd_rawmidi_params_current(rawmidi, params) == 0 &&
+            snd_rawmidi_params_set_read_mode(rawmidi, params, SND_RAWMIDI_READ_TSTAMP) == 0 &&
+            snd_rawmidi_params_set_clock_type(rawmidi, params, SND_RAWMIDI_CLOCK_MONOTONIC) == 0 &&
+            snd_rawmidi_params(rawmidi, params) == 0)
+        {
+            pimpl->kernelTimestamps_ = true;
+        }
+#endif
+        
+        return pimpl;
+    }
+    
+    void start()
+    {
+        startThread(Thread::Priority::highest);
+    }
+    
+    void stop()
+    {
+        stopThread(POLL_TIMEOUT_MS * 5);
+    }
+    
+    void run() override
+    {
+        std::vector<pollfd> descriptors((size_t)snd_rawmidi_poll_descriptors_count(rawmidi_));
+        snd_rawmidi_poll_descriptors(rawmidi_, descriptors.data(), (unsigned int)descriptors.size());
+        
+        uint8 buffer[READ_BUFFER_SIZE];
+        while (!threadShouldExit())
+        {
+            // the timeout only serves to notice that the thread should exit
+            if (poll(descriptors.data(), (nfds_t)descriptors.size(), POLL_TIMEOUT_MS) <= 0)
+            {
+                continue;
+            }
+            
+            while (!threadShouldExit())
+            {
+                Time t;
+                ssize_t count;
+#if SND_LIB_VERSION >= 0x010206
+                if (kernelTimestamps_)
+                {
+                    // all the bytes that are returned at once arrived at the same time
+                    timespec timestamp {};
+                    count = snd_rawmidi_tread(rawmidi_, &timestamp, buffer, sizeof(buffer));
+                    t = toTime(timestamp);
+                }
+                else
+#endif
+                {
+                    count = snd_rawmidi_read(rawmidi_, buffer, sizeof(buffer));
+                    t = Time::getCurrentTime();
+                }
+                
+                if (count <= 0)
+                {
+                    break;
+                }
+                
+                parser_.parse(buffer, (int)count, t, *callback_);
+            }
+        }
+    }
+    
+    /** Converts a monotonic kernel timestamp to the wall clock that the state is kept in. */
+    static Time toTime(const timespec& timestamp)
+    {
+        timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        auto age_ms = (int64)(now.tv_sec - timestamp.tv_sec) * 1000 + (now.tv_nsec - timestamp.tv_nsec) / 1000000;
+        return Time(Time::currentTimeMillis() - std::max<int64>(0, age_ms));
+    }
+    
+    snd_rawmidi_t* const rawmidi_;
+    RawMidiInputCallback* const callback_;
+    bool kernelTimestamps_ { false };
+    MidiByteParser parser_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+Array<MidiDeviceInfo> RawMidiInput::getAvailableDevices()
+{
+    Array<MidiDeviceInfo> devices;
+    
+    auto card = -1;
+    while (snd_card_next(&card) == 0 && card >= 0)
+    {
+        auto hw = "hw:" + String(card);
+        snd_ctl_t* ctl = nullptr;
+        if (snd_ctl_open(&ctl, hw.toRawUTF8(), 0) < 0)
+        {
+            continue;
+        }
+        
+        snd_rawmidi_info_t* info;
+        snd_rawmidi_info_alloca(&info);
+        
+        auto device = -1;
+        while (snd_ctl_rawmidi_next_device(ctl, &device) == 0 && device >= 0)
+        {
+            snd_rawmidi_info_set_device(info, (unsigned int)device);
+            snd_rawmidi_info_set_stream(info, SND_RAWMIDI_STREAM_INPUT);
+            snd_rawmidi_info_set_subdevice(info, 0);
+            if (snd_ctl_rawmidi_info(ctl, info) < 0)
+            {
+                continue;
+            }
+            
+            auto subdevices = (int)snd_rawmidi_info_get_subdevices_count(info);
+            for (auto subdevice = 0; subdevice < subdevices; ++subdevice)
+            {
+                snd_rawmidi_info_set_subdevice(info, (unsigned int)subdevice);
+                if (snd_ctl_rawmidi_info(ctl, info) < 0)
+                {
+                    continue;
+                }
+                
+                String name(snd_rawmidi_info_get_subdevice_name(info));
+                if (name.isEmpty())
+                {
+                    name = snd_rawmidi_info_get_name(info);
+                }
+                devices.add({ name + " (raw)", IDENTIFIER_PREFIX + hw + "," + String(device) + "," + String(subdevice) });
+            }
+        }
+        
+        snd_ctl_close(ctl);
+    }
+    
+    return devices;
+}
+
+std::unique_ptr<RawMidiInput> RawMidiInput::openDevice(const String& identifier, RawMidiInputCallback* callback)
+{
+    if (!isRawMidiDevice(identifier))
+    {
+        return nullptr;
+    }
+    
+    auto pimpl = Pimpl::open(identifier.fromFirstOccurrenceOf(IDENTIFIER_PREFIX, false, false), callback);
+    if (pimpl == nullptr)
+    {
+        return nullptr;
+    }
+    
+    return std::unique_ptr<RawMidiInput>(new RawMidiInput(std::move(pimpl)));
+}
+
+void RawMidiInput::start()                                      { pimpl_->start(); }
+void RawMidiInput::stop()                                       { pimpl_->stop(); }
+#else
+struct RawMidiInput::Pimpl
+{
+};
+
+Array<MidiDeviceInfo> RawMidiInput::getAvailableDevices()       { return {}; }
+std::unique_ptr<RawMidiInput> RawMidiInput::openDevice(const String&, RawMidiInputCallback*) { return nullptr; }
+
+void RawMidiInput::start()                                      {}
+void RawMidiInput::stop()                                       {}
+#endif
+
+RawMidiInput::RawMidiInput(std::unique_ptr<Pimpl> pimpl) : pimpl_(std::move(pimpl)) {}
+RawMidiInput::~RawMidiInput() = default;
+
+bool RawMidiInput::isRawMidiDevice(const String& identifier)    { return identifier.startsWith(IDENTIFIER_PREFIX); }
+}
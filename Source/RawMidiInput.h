@@ -0,0 +1,83 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    class RawMidiInputCallback
+    {
+    public:
+        virtual ~RawMidiInputCallback() = default;
+        
+        /** Called on the reading thread, the time is when the kernel received the first byte of the message. */
+        virtual void handleRawMidiMessage(const MidiMessage&, Time) = 0;
+    };
+    
+    /**
+     * Reads a MIDI input straight from an ALSA rawmidi device, bypassing the sequencer.
+     *
+     * The bytes are read on a dedicated thread with the kernel timestamps, and parsed in the
+     * order they arrived: running status is expanded and real-time bytes that are interleaved
+     * with other messages are delivered before the message they interrupted. The raw devices
+     * are only available on Linux, they're listed next to the sequencer ports.
+     */
+    class RawMidiInput
+    {
+    public:
+        static constexpr const char* IDENTIFIER_PREFIX = "rawmidi:";
+        
+        ~RawMidiInput();
+        
+        static Array<MidiDeviceInfo> getAvailableDevices();
+        static bool isRawMidiDevice(const String& identifier);
+        /** Returns nullptr when the device can't be opened, for instance when the sequencer already uses it. */
+        static std::unique_ptr<RawMidiInput> openDevice(const String& identifier, RawMidiInputCallback*);
+        
+        void start();
+        void stop();
+        
+        struct Pimpl;
+    private:
+        RawMidiInput(std::unique_ptr<Pimpl>);
+        
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RawMidiInput)
+    };
+    
+    /** Turns a MIDI byte stream into messages. */
+    class MidiByteParser
+    {
+    public:
+        /** Parses the bytes that arrived at the same time, calls back for every complete message. */
+        void parse(const uint8* data, int size, Time, RawMidiInputCallback&);
+        void reset();
+        
+    private:
+        uint8 status_ { 0 };
+        uint8 data_[2] {};
+        int received_ { 0 };
+        int expected_ { 0 };
+        
+        bool inSysex_ { false };
+        std::vector<uint8> sysex_;
+        Time messageTime_;
+    };
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Worker threads that rasterize device views into images, away from the message thread.
+     * One thread is left for the message thread, and the pool is kept small since each
+     * worker only paints a single device at a time.
+     */
+    class RenderWorkers : public ThreadPool
+    {
+    public:
+        static constexpr int MAX_WORKERS = 8;
+        
+        RenderWorkers() : ThreadPool(getNumWorkers()) {}
+        
+        static int getNumWorkers()
+        {
+            return jlimit(1, MAX_WORKERS, SystemStats::getNumCpus() - 1);
+        }
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderWorkers)
+    };
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ScrubBarComponent.h"
+
+#include "DpiScaling.h"
+#include "LayoutConstants.h"
+
+namespace showmidi
+{
+struct ScrubBarComponent::Pimpl
+{
+    Pimpl(ScrubBarComponent* owner, SettingsManager* settings, DeviceManager* deviceManager) :
+    owner_(owner),
+    settingsManager_(settings),
+    deviceManager_(deviceManager)
+    {
+    }
+    
+    void reset()
+    {
+        length_ = deviceManager_->getScrubLength();
+        offset_ = 0;
+        owner_->repaint();
+    }
+    
+    void setOffset(int64 offset)
+    {
+        offset = jlimit(-length_, (int64)0, offset);
+        if (offset == offset_)
+        {
+            return;
+        }
+        
+        offset_ = offset;
+        deviceManager_->scrubTo(offset_);
+        owner_->repaint();
+    }
+    
+    Rectangle<int> getTrackArea() const
+    {
+        auto margin = sm::scaled(layout::SCRUB_BAR_MARGIN, *owner_);
+        auto x = sm::scaled(layout::SCRUB_BAR_X_TRACK, *owner_);
+        auto height = sm::scaled(layout::SCRUB_BAR_TRACK_HEIGHT, *owner_);
+        return { x, (owner_->getHeight() - height) / 2, std::max(owner_->getWidth() - x - margin, 1), height };
+    }
+    
+    void scrubToPosition(int x)
+    {
+        if (length_ <= 0)
+        {
+            return;
+        }
+        
+        // the pause is at the right end of the track
+        auto track = getTrackArea();
+        auto proportion = jlimit(0.0, 1.0, (double)(x - track.getX()) / track.getWidth());
+        setOffset((int64)((proportion - 1.0) * length_));
+    }
+    
+    void paint(Graphics& g)
+    {
+        auto& theme = settingsManager_->getSettings().getTheme();
+        
+        g.fillAll(theme.colorSidebar);
+        
+        auto margin = sm::scaled(layout::SCRUB_BAR_MARGIN, *owner_);
+        auto track = getTrackArea();
+        
+        g.setFont(theme.fontLabel());
+        g.setColour(theme.colorLabel);
+        g.drawText(String(offset_ / 1000.0, 1) + " s", margin, 0, track.getX() - 2 * margin, owner_->getHeight(), Justification::centredRight);
+        
+        g.setColour(theme.colorTrack);
+        g.fillRect(track);
+        
+        if (length_ > 0)
+        {
+            auto playhead_width = sm::scaled(layout::SCRUB_BAR_PLAYHEAD_WIDTH, *owner_);
+            auto playhead_x = track.getRight() - (int)(track.getWidth() * (double)-offset_ / length_);
+            g.setColour(theme.colorData);
+            g.fillRect(playhead_x - playhead_width / 2, track.getY() - track.getHeight(), playhead_width, track.getHeight() * 3);
+        }
+    }
+    
+    ScrubBarComponent* const owner_;
+    SettingsManager* const settingsManager_;
+    DeviceManager* const deviceManager_;
+    
+    int64 length_ { 0 };
+    int64 offset_ { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+ScrubBarComponent::ScrubBarComponent(SettingsManager* s, DeviceManager* d) : pimpl_(new Pimpl(this, s, d)) {}
+ScrubBarComponent::~ScrubBarComponent() = default;
+
+void ScrubBarComponent::reset()                             { pimpl_->reset(); }
+void ScrubBarComponent::step(int64 s)                       { pimpl_->setOffset(pimpl_->offset_ + s); }
+void ScrubBarComponent::paint(Graphics& g)                  { pimpl_->paint(g); }
+void ScrubBarComponent::mouseDown(const MouseEvent& e)      { pimpl_->scrubToPosition(e.x); }
+void ScrubBarComponent::mouseDrag(const MouseEvent& e)      { pimpl_->scrubToPosition(e.x); }
+}
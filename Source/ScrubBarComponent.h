@@ -0,0 +1,54 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "DeviceManager.h"
+#include "SettingsManager.h"
+
+namespace showmidi
+{
+    /**
+     * A bar below the paused devices to look back at the moments before the pause.
+     *
+     * The track spans the timeline the devices kept, with the pause at its right end. Clicking
+     * or dragging moves the playhead there and the devices show the channels as they were.
+     */
+    class ScrubBarComponent : public Component
+    {
+    public:
+        ScrubBarComponent(SettingsManager*, DeviceManager*);
+        ~ScrubBarComponent() override;
+        
+        /** Moves the playhead back to the pause, with the timeline that's available now. */
+        void reset();
+        /** Moves the playhead by a number of milliseconds, negative values go back in time. */
+        void step(int64);
+        
+        void paint(Graphics&) override;
+        void mouseDown(const MouseEvent&) override;
+        void mouseDrag(const MouseEvent&) override;
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScrubBarComponent)
+    };
+}
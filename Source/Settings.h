@@ -41,6 +41,13 @@ namespace showmidi
         formatHexadecimal
     };
     
+    enum NotesView
+    {
+        notesViewList = 1,
+        notesViewPianoRoll,
+        notesViewHeatmap
+    };
+    
     enum WindowPosition
     {
         windowRegular = 1,
@@ -57,6 +64,8 @@ namespace showmidi
         static constexpr int DEFAULT_TIMEOUT_DELAY { 2 };
         static constexpr int DEFAULT_CONTROL_GRAPH_HEIGHT { 1 };
         static constexpr WindowPosition DEFAULT_WINDOW_POSITION { windowRegular };
+        static constexpr int DEFAULT_FRAME_RATE_LIMIT { 60 };
+        static constexpr NotesView DEFAULT_NOTES_VIEW { notesViewList };
 
         Settings() {};
         virtual ~Settings() {};
@@ -81,11 +90,23 @@ namespace showmidi
         
         virtual int getControlGraphHeight() = 0;
         virtual void setControlGraphHeight(int) = 0;
+        
+        /** Maximum number of frames per second while rendering, 0 follows the display refresh rate. */
+        virtual int getFrameRateLimit() = 0;
+        virtual void setFrameRateLimit(int) = 0;
+
+        /** How the notes of a channel are shown, as rows of active notes, as a piano roll of the recent notes, or as a key heatmap and velocity histogram. */
+        virtual NotesView getNotesView() = 0;
+        virtual void setNotesView(NotesView) = 0;
 
         virtual Theme& getTheme() = 0;
         virtual void storeTheme() = 0;
         
         virtual bool isMidiDeviceVisible(const String&) = 0;
         virtual void setMidiDeviceVisible(const String&, bool) = 0;
+        
+        /** The identifier of the output a device forwards its input to, empty when there's no thru. */
+        virtual String getMidiThruOutput(const String&) = 0;
+        virtual void setMidiThruOutput(const String&, const String&) = 0;
     };
 }
@@ -47,6 +47,12 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         graphHeight1Button_ = std::make_unique<PaintedButton>("compact");
         graphHeight2Button_ = std::make_unique<PaintedButton>("medium");
         graphHeight3Button_ = std::make_unique<PaintedButton>("large");
+        frameRate30Button_ = std::make_unique<PaintedButton>("30fps");
+        frameRate60Button_ = std::make_unique<PaintedButton>("60fps");
+        frameRateDisplayButton_ = std::make_unique<PaintedButton>("display");
+        notesListButton_ = std::make_unique<PaintedButton>("list");
+        notesPianoRollButton_ = std::make_unique<PaintedButton>("piano roll");
+        notesHeatmapButton_ = std::make_unique<PaintedButton>("heatmap");
         loadThemeButton_ = std::make_unique<PaintedButton>("load");
         saveThemeButton_ = std::make_unique<PaintedButton>("save");
         randomThemeButton_ = std::make_unique<PaintedButton>("random");
@@ -78,6 +84,12 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         graphHeight1Button_->addListener(this);
         graphHeight2Button_->addListener(this);
         graphHeight3Button_->addListener(this);
+        frameRate30Button_->addListener(this);
+        frameRate60Button_->addListener(this);
+        frameRateDisplayButton_->addListener(this);
+        notesListButton_->addListener(this);
+        notesPianoRollButton_->addListener(this);
+        notesHeatmapButton_->addListener(this);
         loadThemeButton_->addListener(this);
         saveThemeButton_->addListener(this);
         randomThemeButton_->addListener(this);
@@ -122,6 +134,12 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         owner_->addAndMakeVisible(graphHeight1Button_.get());
         owner_->addAndMakeVisible(graphHeight2Button_.get());
         owner_->addAndMakeVisible(graphHeight3Button_.get());
+        owner_->addAndMakeVisible(frameRate30Button_.get());
+        owner_->addAndMakeVisible(frameRate60Button_.get());
+        owner_->addAndMakeVisible(frameRateDisplayButton_.get());
+        owner_->addAndMakeVisible(notesListButton_.get());
+        owner_->addAndMakeVisible(notesPianoRollButton_.get());
+        owner_->addAndMakeVisible(notesHeatmapButton_.get());
         owner_->addAndMakeVisible(loadThemeButton_.get());
         owner_->addAndMakeVisible(saveThemeButton_.get());
         owner_->addAndMakeVisible(randomThemeButton_.get());
@@ -181,11 +199,11 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         int height;
         if (manager_->isPlugin() || SystemStats::getOperatingSystemType() == SystemStats::iOS)
         {
-            height = sm::scaled(theme.linePosition(22.5), *owner_);
+            height = sm::scaled(theme.linePosition(28.5), *owner_);
         }
         else
         {
-            height = sm::scaled(theme.linePosition(25.5), *owner_);
+            height = sm::scaled(theme.linePosition(31.5), *owner_);
         }
         
         // Settings box overlays the MIDI device viewport area
@@ -302,6 +320,36 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         x += graphHeight2Width + button_gap;
         graphHeight3Button_->setBoundsForTouch(x, y_offset, graphHeight3Width, labelHeight);
         
+        // frame rate
+        
+        y_offset += theme.linePosition(3);
+        
+        auto frameRate30Width = calculateButtonWidth("30fps");
+        auto frameRate60Width = calculateButtonWidth("60fps");
+        auto frameRateDisplayWidth = calculateButtonWidth("display");
+        
+        x = left_margin;
+        frameRate30Button_->setBoundsForTouch(x, y_offset, frameRate30Width, labelHeight);
+        x += frameRate30Width + button_gap;
+        frameRate60Button_->setBoundsForTouch(x, y_offset, frameRate60Width, labelHeight);
+        x += frameRate60Width + button_gap;
+        frameRateDisplayButton_->setBoundsForTouch(x, y_offset, frameRateDisplayWidth, labelHeight);
+        
+        // notes view
+        
+        y_offset += theme.linePosition(3);
+        
+        auto notesListWidth = calculateButtonWidth("list");
+        auto notesPianoRollWidth = calculateButtonWidth("piano roll");
+        auto notesHeatmapWidth = calculateButtonWidth("heatmap");
+        
+        x = left_margin;
+        notesListButton_->setBoundsForTouch(x, y_offset, notesListWidth, labelHeight);
+        x += notesListWidth + button_gap;
+        notesPianoRollButton_->setBoundsForTouch(x, y_offset, notesPianoRollWidth, labelHeight);
+        x += notesPianoRollWidth + button_gap;
+        notesHeatmapButton_->setBoundsForTouch(x, y_offset, notesHeatmapWidth, labelHeight);
+        
         // active theme NB: uses 4-column gap!
         
         y_offset += theme.linePosition(3);
@@ -479,6 +527,44 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         setSettingOptionFont(g, [&settings] () { return settings.getControlGraphHeight() == 3; });
         graphHeight3Button_->drawName(g, Justification::centredLeft);
         
+        // frame rate
+        
+        y_offset += theme.linePosition(3);
+        
+        g.setColour(theme.colorData);
+        g.setFont(theme.fontLabel());
+        g.drawText("Frame Rate",
+                   sm::scaled(sm::layout::SETTINGS_LEFT_MARGIN), y_offset,
+                   getWidth(), theme.labelHeight(),
+                   Justification::centredLeft, true);
+        
+        g.setColour(theme.colorData.withAlpha(0.7f));
+        setSettingOptionFont(g, [&settings] () { return settings.getFrameRateLimit() == 30; });
+        frameRate30Button_->drawName(g, Justification::centredLeft);
+        setSettingOptionFont(g, [&settings] () { return settings.getFrameRateLimit() == 60; });
+        frameRate60Button_->drawName(g, Justification::centredLeft);
+        setSettingOptionFont(g, [&settings] () { return settings.getFrameRateLimit() == 0; });
+        frameRateDisplayButton_->drawName(g, Justification::centredLeft);
+        
+        // notes view
+        
+        y_offset += theme.linePosition(3);
+        
+        g.setColour(theme.colorData);
+        g.setFont(theme.fontLabel());
+        g.drawText("Notes",
+                   sm::scaled(sm::layout::SETTINGS_LEFT_MARGIN), y_offset,
+                   getWidth(), theme.labelHeight(),
+                   Justification::centredLeft, true);
+        
+        g.setColour(theme.colorData.withAlpha(0.7f));
+        setSettingOptionFont(g, [&settings] () { return settings.getNotesView() == NotesView::notesViewList; });
+        notesListButton_->drawName(g, Justification::centredLeft);
+        setSettingOptionFont(g, [&settings] () { return settings.getNotesView() == NotesView::notesViewPianoRoll; });
+        notesPianoRollButton_->drawName(g, Justification::centredLeft);
+        setSettingOptionFont(g, [&settings] () { return settings.getNotesView() == NotesView::notesViewHeatmap; });
+        notesHeatmapButton_->drawName(g, Justification::centredLeft);
+        
         // active theme
         
         y_offset += theme.linePosition(3);
@@ -555,9 +641,7 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
         
         // close button
         
-        auto close_svg = closeSvg_->createCopy();
-        close_svg->replaceColour(Colours::black, theme.colorController);
-        closeButton_->drawDrawable(g, *close_svg);
+        closeButton_->drawDrawable(g, {BinaryData::close_svg, BinaryData::close_svgSize}, theme.colorController);
     }
     
     void buttonClicked(Button* buttonThatWasClicked)
@@ -645,6 +729,36 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
             settings.setControlGraphHeight(3);
             repaint();
         }
+        else if (buttonThatWasClicked == frameRate30Button_.get())
+        {
+            settings.setFrameRateLimit(30);
+            repaint();
+        }
+        else if (buttonThatWasClicked == frameRate60Button_.get())
+        {
+            settings.setFrameRateLimit(60);
+            repaint();
+        }
+        else if (buttonThatWasClicked == frameRateDisplayButton_.get())
+        {
+            settings.setFrameRateLimit(0);
+            repaint();
+        }
+        else if (buttonThatWasClicked == notesListButton_.get())
+        {
+            settings.setNotesView(NotesView::notesViewList);
+            repaint();
+        }
+        else if (buttonThatWasClicked == notesPianoRollButton_.get())
+        {
+            settings.setNotesView(NotesView::notesViewPianoRoll);
+            repaint();
+        }
+        else if (buttonThatWasClicked == notesHeatmapButton_.get())
+        {
+            settings.setNotesView(NotesView::notesViewHeatmap);
+            repaint();
+        }
         else if (buttonThatWasClicked == loadThemeButton_.get())
         {
             loadThemeChooser_->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [this] (const FileChooser& chooser)
@@ -809,6 +923,12 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
     std::unique_ptr<PaintedButton> graphHeight1Button_;
     std::unique_ptr<PaintedButton> graphHeight2Button_;
     std::unique_ptr<PaintedButton> graphHeight3Button_;
+    std::unique_ptr<PaintedButton> frameRate30Button_;
+    std::unique_ptr<PaintedButton> frameRate60Button_;
+    std::unique_ptr<PaintedButton> frameRateDisplayButton_;
+    std::unique_ptr<PaintedButton> notesListButton_;
+    std::unique_ptr<PaintedButton> notesPianoRollButton_;
+    std::unique_ptr<PaintedButton> notesHeatmapButton_;
     std::unique_ptr<PaintedButton> loadThemeButton_;
     std::unique_ptr<PaintedButton> saveThemeButton_;
     std::unique_ptr<PaintedButton> randomThemeButton_;
@@ -837,8 +957,6 @@ struct SettingsComponent::Pimpl : public Button::Listener, public Value::Listene
     std::unique_ptr<FileChooser> loadThemeChooser_;
     std::unique_ptr<FileChooser> saveThemeChooser_;
     
-    std::unique_ptr<Drawable> closeSvg_ = Drawable::createFromImageData(BinaryData::close_svg, BinaryData::close_svgSize);
-    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
 };
 
@@ -19,7 +19,7 @@
 
 #include <JuceHeader.h>
 
-#include "MidiDevicesListener.h"
+#include "MidiDeviceRegistry.h"
 #include "Settings.h"
 
 namespace showmidi
@@ -36,6 +36,6 @@ namespace showmidi
         virtual void applySettings() = 0;
         virtual void storeSettings() = 0;
         
-        virtual MidiDevicesListeners& getMidiDevicesListeners() = 0;
+        virtual MidiDeviceRegistry& getMidiDeviceRegistry() = 0;
     };
 }
@@ -0,0 +1,442 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SharedStatePublisher.h"
+
+#include "MidiDeviceState.h"
+#include "ShowMidiSharedState.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SHOWMIDI_SHARED_MEMORY 1
+#else
+#define SHOWMIDI_SHARED_MEMORY 0
+#endif
+
+namespace showmidi
+{
+const String SharedStatePublisher::COMMAND_LINE_OPTION = { "--publish-state" };
+
+/** The mapped segment, the slots keep it alive. Its thread publishes the channels that were marked. */
+class SharedStateSegment : public ReferenceCountedObject, public Thread
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<SharedStateSegment>;
+    
+    SharedStateSegment(const String& name) :
+    Thread("Shared state publisher"),
+    name_(name)
+    {
+#if SHOWMIDI_SHARED_MEMORY
+        // another instance keeps the segment it created, this one publishes under a name of its own
+        auto fd = createSegment(name_);
+        if (fd < 0 && errno == EEXIST)
+        {
+            name_ = name + "-" + String(getpid());
+            fd = createSegment(name_);
+        }
+        if (fd < 0)
+        {
+            return;
+        }
+        
+        if (ftruncate(fd, sizeof(showmidi_state)) == 0)
+        {
+            auto memory = mmap(nullptr, sizeof(showmidi_state), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory != MAP_FAILED)
+            {
+                state_ = static_cast<showmidi_state*>(memory);
+            }
+        }
+        close(fd);
+        
+        if (state_ != nullptr)
+        {
+            // readers check the header first, it's only filled in once the slots are cleared
+            memset(state_, 0, sizeof(showmidi_state));
+            state_->max_devices = SHOWMIDI_STATE_MAX_DEVICES;
+            state_->size = sizeof(showmidi_state);
+            state_->version = SHOWMIDI_STATE_VERSION;
+            __atomic_store_n(&state_->magic, SHOWMIDI_STATE_MAGIC, __ATOMIC_RELEASE);
+            startThread();
+        }
+#endif
+    }
+    
+    ~SharedStateSegment() override
+    {
+        stopThread(SharedStatePublisher::PUBLISH_INTERVAL_MS * 100);
+#if SHOWMIDI_SHARED_MEMORY
+        if (state_ != nullptr)
+        {
+            __atomic_store_n(&state_->magic, 0u, __ATOMIC_RELEASE);
+            munmap(state_, sizeof(showmidi_state));
+            shm_unlink(name_.toRawUTF8());
+        }
+#endif
+    }
+    
+    bool isMapped() const
+    {
+        return state_ != nullptr;
+    }
+    
+    const String& getName() const
+    {
+        return name_;
+    }
+    
+    showmidi_device* acquire(SharedStatePublisher::Slot::Pimpl* publisher)
+    {
+        const ScopedLock lock(slotsLock_);
+        for (auto i = 0; i < SHOWMIDI_STATE_MAX_DEVICES; ++i)
+        {
+            if (!taken_[i])
+            {
+                taken_[i] = true;
+                publishers_[i] = publisher;
+                return &state_->device[i];
+            }
+        }
+        return nullptr;
+    }
+    
+    /** Waits until the thread is done publishing the slot, it isn't published anymore afterwards. */
+    void stopPublishing(showmidi_device* device)
+    {
+        const ScopedLock lock(slotsLock_);
+        publishers_[device - state_->device] = nullptr;
+    }
+    
+    void release(showmidi_device* device)
+    {
+        const ScopedLock lock(slotsLock_);
+        taken_[device - state_->device] = false;
+    }
+    
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // a slot notifies once after its first change since the last batch
+            wait(-1);
+            publishChannels();
+            
+            // the changes that arrive meanwhile are published together with the next batch
+            sleep(SharedStatePublisher::PUBLISH_INTERVAL_MS);
+        }
+    }
+    
+    static Ptr& getStarted()
+    {
+        static Ptr started;
+        return started;
+    }
+    
+    static CriticalSection& getStartedLock()
+    {
+        static CriticalSection lock;
+        return lock;
+    }
+    
+private:
+#if SHOWMIDI_SHARED_MEMORY
+    static int createSegment(const String& name)
+    {
+        return shm_open(name.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+#endif
+    
+    void publishChannels();
+    
+    String name_;
+    showmidi_state* state_ { nullptr };
+    CriticalSection slotsLock_;
+    bool taken_[SHOWMIDI_STATE_MAX_DEVICES] {};
+    SharedStatePublisher::Slot::Pimpl* publishers_[SHOWMIDI_STATE_MAX_DEVICES] {};
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedStateSegment)
+};
+
+bool SharedStatePublisher::start(const String& name)
+{
+    SharedStateSegment::Ptr segment = new SharedStateSegment(name);
+    if (!segment->isMapped())
+    {
+        return false;
+    }
+    
+    const ScopedLock lock(SharedStateSegment::getStartedLock());
+    SharedStateSegment::getStarted() = segment;
+    return true;
+}
+
+String SharedStatePublisher::getName()
+{
+    const ScopedLock lock(SharedStateSegment::getStartedLock());
+    auto& started = SharedStateSegment::getStarted();
+    return started != nullptr ? started->getName() : String();
+}
+
+void SharedStatePublisher::stop()
+{
+    const ScopedLock lock(SharedStateSegment::getStartedLock());
+    SharedStateSegment::getStarted() = nullptr;
+}
+
+bool SharedStatePublisher::startFromCommandLine(const StringArray& arguments)
+{
+    for (auto& argument : arguments)
+    {
+        if (argument == COMMAND_LINE_OPTION)
+        {
+            return start(SHOWMIDI_STATE_DEFAULT_NAME);
+        }
+        if (argument.startsWith(COMMAND_LINE_OPTION + "="))
+        {
+            return start(argument.fromFirstOccurrenceOf("=", false, false));
+        }
+    }
+    return true;
+}
+
+struct SharedStatePublisher::Slot::Pimpl
+{
+    Pimpl(const MidiDeviceInfo& info)
+    {
+        {
+            const ScopedLock lock(SharedStateSegment::getStartedLock());
+            segment_ = SharedStateSegment::getStarted();
+        }
+        
+        if (segment_ != nullptr)
+        {
+            device_ = segment_->acquire(this);
+        }
+        
+        if (device_ != nullptr)
+        {
+            publishReset();
+            
+            beginWrite();
+            memset(device_->identifier, 0, SHOWMIDI_STATE_IDENTIFIER_SIZE);
+            memset(device_->name, 0, SHOWMIDI_STATE_NAME_SIZE);
+            info.identifier.copyToUTF8(device_->identifier, SHOWMIDI_STATE_IDENTIFIER_SIZE);
+            info.name.copyToUTF8(device_->name, SHOWMIDI_STATE_NAME_SIZE);
+            device_->active = 1;
+            endWrite();
+        }
+    }
+    
+    ~Pimpl()
+    {
+        if (device_ != nullptr)
+        {
+            segment_->stopPublishing(device_);
+            
+            beginWrite();
+            device_->active = 0;
+            endWrite();
+            
+            segment_->release(device_);
+        }
+    }
+    
+    std::atomic<uint32_t>& getSequence()
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The sequence is shared with C readers");
+        return *reinterpret_cast<std::atomic<uint32_t>*>(&device_->sequence);
+    }
+    
+    /** The sequence is odd while writing, readers retry when it changed while they were copying. */
+    void beginWrite()
+    {
+        writeLock_.enter();
+        auto& sequence = getSequence();
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    void endWrite()
+    {
+        device_->update_count++;
+        device_->update_time_ms = Time::currentTimeMillis();
+        
+        auto& sequence = getSequence();
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        writeLock_.exit();
+    }
+    
+    void stageChannel(const ActiveChannel& channel)
+    {
+        auto number = channel.number_;
+        if (device_ == nullptr || number < 0 || number >= 16)
+        {
+            return;
+        }
+        
+        {
+            const SpinLock::ScopedLockType lock(stagedLock_);
+            writeChannel(channel, staged_[number]);
+        }
+        
+        if (changed_.fetch_or(1u << number) == 0)
+        {
+            segment_->notify();
+        }
+    }
+    
+    /** Runs on the publisher thread, writes the copies of the channels that changed since the last batch at once. */
+    void publishChanged()
+    {
+        auto changed = changed_.exchange(0);
+        if (changed == 0)
+        {
+            return;
+        }
+        
+        beginWrite();
+        {
+            const SpinLock::ScopedLockType lock(stagedLock_);
+            for (auto i = 0; i < 16; ++i)
+            {
+                if ((changed & (1u << i)) != 0)
+                {
+                    device_->channel[i] = staged_[i];
+                }
+            }
+        }
+        endWrite();
+    }
+    
+    static void writeChannel(const ActiveChannel& channel, showmidi_channel& target)
+    {
+        for (auto i = 0; i < 128; ++i)
+        {
+            auto& note_on = channel.notes_.noteOn_[i];
+            target.note_velocity[i] = (uint8_t)(MidiDeviceState::isHeld(note_on, channel.notes_.noteOff_[i]) ? note_on.current_.value_ : 0);
+            
+            auto& control_change = channel.controlChanges_.controlChange_[i].current_;
+            target.controller[i] = (uint8_t)control_change.value_;
+            if (control_change.time_.toMilliseconds() != 0)
+            {
+                target.controller_set[i / 8] |= (uint8_t)(1 << (i % 8));
+            }
+        }
+        
+        auto& pitch_bend = channel.pitchBend_.current_;
+        target.pitch_bend = (uint16_t)(pitch_bend.time_.toMilliseconds() != 0 ? pitch_bend.value_ : 8192);
+        auto& program = channel.programChange_.current_;
+        target.program = (int16_t)(program.time_.toMilliseconds() != 0 ? program.value_ : -1);
+        target.channel_pressure = (uint8_t)channel.channelPressure_.current_.value_;
+        
+        uint8_t flags = 0;
+        if (channel.time_.toMilliseconds() != 0)
+        {
+            flags |= SHOWMIDI_CHANNEL_ACTIVE;
+        }
+        if (channel.mpeManager_)
+        {
+            flags |= SHOWMIDI_CHANNEL_MPE_MANAGER;
+        }
+        if (channel.mpeMember_ == MpeMember::mpeLower)
+        {
+            flags |= SHOWMIDI_CHANNEL_MPE_LOWER;
+        }
+        else if (channel.mpeMember_ == MpeMember::mpeUpper)
+        {
+            flags |= SHOWMIDI_CHANNEL_MPE_UPPER;
+        }
+        target.flags = flags;
+    }
+    
+    void publishTempo(double bpm)
+    {
+        if (device_ == nullptr)
+        {
+            return;
+        }
+        
+        beginWrite();
+        device_->bpm = bpm;
+        endWrite();
+    }
+    
+    void publishReset()
+    {
+        if (device_ == nullptr)
+        {
+            return;
+        }
+        
+        // a batch that's published meanwhile doesn't bring back the copies from before
+        beginWrite();
+        device_->bpm = 0.0;
+        {
+            const SpinLock::ScopedLockType lock(stagedLock_);
+            for (auto i = 0; i < 16; ++i)
+            {
+                resetChannel(device_->channel[i]);
+                resetChannel(staged_[i]);
+            }
+        }
+        endWrite();
+    }
+    
+    static void resetChannel(showmidi_channel& channel)
+    {
+        memset(&channel, 0, sizeof(showmidi_channel));
+        channel.pitch_bend = 8192;
+        channel.program = -1;
+    }
+    
+    // only the copies are read by the publisher thread, the ingest thread writes them
+    SpinLock stagedLock_;
+    showmidi_channel staged_[16] {};
+    std::atomic<uint32> changed_ { 0 };
+    
+    SharedStateSegment::Ptr segment_;
+    showmidi_device* device_ { nullptr };
+    // the message thread resets the state while the publisher thread may be writing it
+    SpinLock writeLock_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+void SharedStateSegment::publishChannels()
+{
+    const ScopedLock lock(slotsLock_);
+    for (auto publisher : publishers_)
+    {
+        if (publisher != nullptr)
+        {
+            publisher->publishChanged();
+        }
+    }
+}
+
+SharedStatePublisher::Slot::Slot(const MidiDeviceInfo& i) : pimpl_(new Pimpl(i)) {}
+SharedStatePublisher::Slot::~Slot() = default;
+
+bool SharedStatePublisher::Slot::isPublishing() const                           { return pimpl_->device_ != nullptr; }
+void SharedStatePublisher::Slot::stageChannel(const ActiveChannel& c)           { pimpl_->stageChannel(c); }
+void SharedStatePublisher::Slot::publishTempo(double b)                         { pimpl_->publishTempo(b); }
+void SharedStatePublisher::Slot::publishReset()                                 { pimpl_->publishReset(); }
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ChannelState.h"
+
+namespace showmidi
+{
+    /**
+     * Publishes the live state of the MIDI devices in POSIX shared memory.
+     *
+     * The layout of the segment is described by ShowMidiSharedState.h, so that other local
+     * processes can read the notes, controllers and tempo without any MIDI routing. Publishing
+     * is off until it's started, the devices that are created after that get a slot.
+     *
+     * The thread that ingests the messages copies the channels they changed, a publisher thread
+     * writes the copies in one batch, at most once every PUBLISH_INTERVAL_MS. The live channels
+     * are never read by it, so it doesn't race with the ingest.
+     */
+    class SharedStatePublisher
+    {
+    public:
+        static const String COMMAND_LINE_OPTION;
+        static constexpr int PUBLISH_INTERVAL_MS = 1;
+        
+        /**
+         * Creates the segment, returns false when shared memory isn't available. A segment that
+         * another instance created is left alone, the name is then followed by the process id.
+         */
+        static bool start(const String& name);
+        /** The name of the segment that's published, empty when publishing isn't started. */
+        static String getName();
+        /** The segment stays mapped until the last device released its slot. */
+        static void stop();
+        /** Starts publishing when the option is present, optionally followed by =name, returns false when that failed. */
+        static bool startFromCommandLine(const StringArray& arguments);
+        
+        /** The slot of a device, it does nothing when publishing isn't started or all slots are taken. */
+        class Slot
+        {
+        public:
+            Slot(const MidiDeviceInfo&);
+            ~Slot();
+            
+            bool isPublishing() const;
+            
+            /** Called from the thread that ingests the messages, after they changed the state. */
+            void stageChannel(const ActiveChannel&);
+            void publishTempo(double bpm);
+            void publishReset();
+            
+            struct Pimpl;
+        private:
+            std::unique_ptr<Pimpl> pimpl_;
+            
+            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Slot)
+        };
+    };
+}
@@ -17,27 +17,18 @@
  */
 #include "ShowMidiApplication.h"
 
+#include "MidiCaptureRecorder.h"
+#include "MidiFileReplay.h"
+#include "SharedStatePublisher.h"
 #include "StandaloneWindow.h"
+#include "StateStreamServer.h"
+#include "StateStreamViewer.h"
 
 namespace showmidi
 {
-    struct ShowMidiApplication::Pimpl : public Timer
+    struct ShowMidiApplication::Pimpl
     {
-        Pimpl()
-        {
-            // poll for MIDI devices refresh
-            startTimerHz(5);
-        }
-        
-        ~Pimpl()
-        {
-            stopTimer();
-        }
-        
-        void timerCallback()
-        {
-            midiDevicesListeners_.broadcast();
-        }
+        Pimpl() = default;
         
         void setWindowTitle(const String& title)
         {
@@ -63,16 +54,15 @@ namespace showmidi
         void storeSettings()
         {
             settings_.storeTheme();
-            settings_.flush();
             
             mainWindow_->repaint();
         }
-
+        
         UwynLookAndFeel lookAndFeel_;
         std::unique_ptr<StandaloneWindow> mainWindow_;
         PropertiesSettings settings_;
-        MidiDevicesListeners midiDevicesListeners_;
-
+        MidiDeviceRegistry midiDeviceRegistry_;
+        
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
     };
     
@@ -96,8 +86,37 @@ namespace showmidi
         return pimpl_->lookAndFeel_;
     }
     
-    void ShowMidiApplication::initialise(const String&)
+    void ShowMidiApplication::initialise(const String& commandLine)
     {
+        // the devices are only published, streamed and recorded when that started before they're created
+        auto arguments = StringArray::fromTokens(commandLine, true);
+        if (!SharedStatePublisher::startFromCommandLine(arguments))
+        {
+            std::cerr << "The MIDI state couldn't be published in shared memory" << std::endl;
+        }
+        else if (SharedStatePublisher::getName().isNotEmpty())
+        {
+            std::cerr << "The MIDI state is published in shared memory as " << SharedStatePublisher::getName() << std::endl;
+        }
+        if (!StateStreamServer::startFromCommandLine(arguments))
+        {
+            std::cerr << "The MIDI state couldn't be streamed" << std::endl;
+        }
+        if (!StateStreamViewer::startFromCommandLine(arguments))
+        {
+            std::cerr << "State streams can't be viewed on this platform" << std::endl;
+        }
+        if (!MidiCaptureRecorder::startFromCommandLine(arguments))
+        {
+            std::cerr << "The MIDI data couldn't be recorded" << std::endl;
+        }
+        if (!MidiFileReplay::startFromCommandLine(arguments))
+        {
+            std::cerr << "The MIDI files to replay couldn't be found" << std::endl;
+        }
+        
+        pimpl_->midiDeviceRegistry_.startWatching();
+        
         pimpl_->mainWindow_.reset(new StandaloneWindow(getApplicationName()));
         
         applySettings();
@@ -106,6 +125,15 @@ namespace showmidi
     void ShowMidiApplication::shutdown()
     {
         pimpl_->mainWindow_ = nullptr;
+        pimpl_->midiDeviceRegistry_.stopWatching();
+        SharedStatePublisher::stop();
+        StateStreamServer::stop();
+        StateStreamViewer::stop();
+        MidiCaptureRecorder::stop();
+        MidiFileReplay::stop();
+        
+        // the settings are written behind, nothing that's still pending may get lost
+        pimpl_->settings_.flush();
     }
     
     void ShowMidiApplication::systemRequestedQuit()
@@ -126,7 +154,7 @@ namespace showmidi
     {
         return nullptr;
     }
-
+    
     Settings& ShowMidiApplication::getSettings()
     {
         return pimpl_->settings_;
@@ -138,16 +166,16 @@ namespace showmidi
         pimpl_->mainWindow_->repaint();
     }
     
-    MidiDevicesListeners& ShowMidiApplication::getMidiDevicesListeners()
+    MidiDeviceRegistry& ShowMidiApplication::getMidiDeviceRegistry()
     {
-        return pimpl_->midiDevicesListeners_;
+        return pimpl_->midiDeviceRegistry_;
     }
     
     ShowMidiApplication::ShowMidiApplication() : pimpl_(new Pimpl())
     {
         Desktop::getInstance().setDefaultLookAndFeel(&pimpl_->lookAndFeel_);
     }
-
+    
     void ShowMidiApplication::setWindowTitle(const String& title)    { pimpl_->setWindowTitle(title); }
     void ShowMidiApplication::setWindowWidthForMainLayout(int width) { pimpl_->setWindowWidthForMainLayout(width); }
     void ShowMidiApplication::storeSettings()                        { pimpl_->storeSettings(); }
@@ -19,7 +19,7 @@
 
 #include <JuceHeader.h>
 
-#include "MidiDevicesListener.h"
+#include "MidiDeviceRegistry.h"
 #include "PropertiesSettings.h"
 #include "SettingsManager.h"
 #include "UwynLookAndFeel.h"
@@ -66,7 +66,7 @@ namespace showmidi
         void applySettings() override;
         void storeSettings() override;
         
-        MidiDevicesListeners& getMidiDevicesListeners() override;
+        MidiDeviceRegistry& getMidiDeviceRegistry() override;
         
         struct Pimpl;
     private:
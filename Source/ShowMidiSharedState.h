@@ -0,0 +1,132 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * The layout of the live MIDI state that ShowMIDI publishes in POSIX shared memory when it's
+ * started with --publish-state. This header is plain C and has no other dependencies, it can be
+ * copied into any tool that wants to read the state.
+ *
+ * The segment holds a fixed number of device slots. Each slot is protected by a sequence lock:
+ * the sequence is odd while ShowMIDI is writing the slot, and is incremented again when it's done.
+ * A reader copies the slot and only uses the copy when the sequence was even and didn't change,
+ * showmidi_read_device() does exactly that. Reading never blocks ShowMIDI and involves no system
+ * calls once the segment is mapped. When another instance already publishes under the name, the
+ * process id is appended to it, ShowMIDI prints the name it publishes under at startup:
+ *
+ *     int fd = shm_open(SHOWMIDI_STATE_DEFAULT_NAME, O_RDONLY, 0);
+ *     const showmidi_state* state = mmap(NULL, sizeof(showmidi_state), PROT_READ, MAP_SHARED, fd, 0);
+ *     showmidi_device device;
+ *     if (showmidi_is_compatible(state) && showmidi_read_device(state, 0, &device) && device.active)
+ *     {
+ *         ...
+ *     }
+ */
+#ifndef SHOWMIDI_SHARED_STATE_H
+#define SHOWMIDI_SHARED_STATE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHOWMIDI_STATE_DEFAULT_NAME     "/showmidi"
+#define SHOWMIDI_STATE_MAGIC            0x534d4944u /* "SMID" */
+#define SHOWMIDI_STATE_VERSION          1u
+
+#define SHOWMIDI_STATE_MAX_DEVICES      32
+#define SHOWMIDI_STATE_IDENTIFIER_SIZE  128
+#define SHOWMIDI_STATE_NAME_SIZE        64
+
+/* showmidi_channel.flags */
+#define SHOWMIDI_CHANNEL_ACTIVE         0x01u   /* the channel received at least one message */
+#define SHOWMIDI_CHANNEL_MPE_MANAGER    0x02u
+#define SHOWMIDI_CHANNEL_MPE_LOWER      0x04u   /* member or manager of the lower zone */
+#define SHOWMIDI_CHANNEL_MPE_UPPER      0x08u   /* member or manager of the upper zone */
+
+typedef struct showmidi_channel
+{
+    uint8_t note_velocity[128];     /* the velocity of the held notes, 0 for notes that aren't held */
+    uint8_t controller[128];        /* the latest value of each control change */
+    uint8_t controller_set[16];     /* bit (n % 8) of byte (n / 8) is set once control change n was received */
+    uint16_t pitch_bend;            /* 0 to 16383, 8192 is centered */
+    int16_t program;                /* -1 until a program change was received */
+    uint8_t channel_pressure;
+    uint8_t flags;                  /* SHOWMIDI_CHANNEL_* */
+    uint8_t reserved[2];
+} showmidi_channel;
+
+typedef struct showmidi_device
+{
+    uint32_t sequence;              /* odd while the slot is being written */
+    uint32_t active;                /* 0 for slots that aren't used */
+    uint64_t update_count;          /* incremented with every update */
+    int64_t update_time_ms;         /* milliseconds since the epoch of the last update */
+    double bpm;                     /* 0 without MIDI clock */
+    char identifier[SHOWMIDI_STATE_IDENTIFIER_SIZE];   /* zero terminated */
+    char name[SHOWMIDI_STATE_NAME_SIZE];               /* zero terminated */
+    showmidi_channel channel[16];
+} showmidi_device;
+
+typedef struct showmidi_state
+{
+    uint32_t magic;                 /* SHOWMIDI_STATE_MAGIC */
+    uint32_t version;               /* SHOWMIDI_STATE_VERSION, changes when the layout changes */
+    uint32_t size;                  /* sizeof(showmidi_state) */
+    uint32_t max_devices;           /* SHOWMIDI_STATE_MAX_DEVICES */
+    showmidi_device device[SHOWMIDI_STATE_MAX_DEVICES];
+} showmidi_state;
+
+static inline int showmidi_is_compatible(const showmidi_state* state)
+{
+    return state->magic == SHOWMIDI_STATE_MAGIC &&
+           state->version == SHOWMIDI_STATE_VERSION &&
+           state->size == sizeof(showmidi_state);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+/* Copies a consistent image of a device slot, returns 0 when it kept changing while being read. */
+static inline int showmidi_read_device(const showmidi_state* state, int index, showmidi_device* target)
+{
+    const showmidi_device* device = &state->device[index];
+    int attempt;
+    for (attempt = 0; attempt < 1000; ++attempt)
+    {
+        uint32_t before = __atomic_load_n(&device->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u)
+        {
+            continue;
+        }
+        
+        memcpy(target, device, sizeof(showmidi_device));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        
+        if (__atomic_load_n(&device->sequence, __ATOMIC_RELAXED) == before)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -212,62 +212,44 @@ namespace showmidi
 
             if (collapsedButton_->isVisible())
             {
-                auto collapsed_svg = collapsedSvg_->createCopy();
-                collapsed_svg->replaceColour(Colours::black, theme.colorData);
-                collapsedButton_->drawDrawable(g, *collapsed_svg);
+                collapsedButton_->drawDrawable(g, {BinaryData::collapsed_svg, BinaryData::collapsed_svgSize}, theme.colorData);
             }
 
             if (expandedButton_->isVisible())
             {
-                auto expanded_svg = expandedSvg_->createCopy();
-                expanded_svg->replaceColour(Colours::black, theme.colorData);
-                expandedButton_->drawDrawable(g, *expanded_svg);
+                expandedButton_->drawDrawable(g, {BinaryData::expanded_svg, BinaryData::expanded_svgSize}, theme.colorData);
             }
 
             if (playButton_->isVisible())
             {
-                auto play_svg = playSvg_->createCopy();
-                play_svg->replaceColour(Colours::black, theme.colorData);
-                playButton_->drawDrawable(g, *play_svg);
+                playButton_->drawDrawable(g, {BinaryData::play_svg, BinaryData::play_svgSize}, theme.colorData);
             }
 
             if (pauseButton_->isVisible())
             {
-                auto pause_svg = pauseSvg_->createCopy();
-                pause_svg->replaceColour(Colours::black, theme.colorData);
-                pauseButton_->drawDrawable(g, *pause_svg);
+                pauseButton_->drawDrawable(g, {BinaryData::pause_svg, BinaryData::pause_svgSize}, theme.colorData);
             }
 
             if (barButton_->isVisible())
             {
-                auto bar_svg = barSvg_->createCopy();
-                bar_svg->replaceColour(Colours::black, theme.colorData);
-                barButton_->drawDrawable(g, *bar_svg);
+                barButton_->drawDrawable(g, {BinaryData::bar_svg, BinaryData::bar_svgSize}, theme.colorData);
             }
 
             if (graphButton_->isVisible())
             {
-                auto graph_svg = graphSvg_->createCopy();
-                graph_svg->replaceColour(Colours::black, theme.colorData);
-                graphButton_->drawDrawable(g, *graph_svg);
+                graphButton_->drawDrawable(g, {BinaryData::graph_svg, BinaryData::graph_svgSize}, theme.colorData);
             }
 
             if (resetButton_->isVisible())
             {
-                auto reset_svg = resetSvg_->createCopy();
-                reset_svg->replaceColour(Colours::black, theme.colorData);
-                resetButton_->drawDrawable(g, *reset_svg);
+                resetButton_->drawDrawable(g, {BinaryData::reset_svg, BinaryData::reset_svgSize}, theme.colorData);
             }
 
-            auto help_svg = helpSvg_->createCopy();
-            help_svg->replaceColour(Colours::black, theme.colorData);
-            helpButton_->drawDrawable(g, *help_svg);
+            helpButton_->drawDrawable(g, {BinaryData::help_svg, BinaryData::help_svgSize}, theme.colorData);
 
             if (settingsButton_->isVisible())
             {
-                auto settings_svg = settingsSvg_->createCopy();
-                settings_svg->replaceColour(Colours::black, theme.colorData);
-                settingsButton_->drawDrawable(g, *settings_svg);
+                settingsButton_->drawDrawable(g, {BinaryData::settings_svg, BinaryData::settings_svgSize}, theme.colorData);
             }
         }
         
@@ -352,16 +334,6 @@ namespace showmidi
         SidebarListener* const listener_;
         
         bool expanded_ = false;
-        
-        std::unique_ptr<Drawable> collapsedSvg_ = Drawable::createFromImageData(BinaryData::collapsed_svg, BinaryData::collapsed_svgSize);
-        std::unique_ptr<Drawable> expandedSvg_ = Drawable::createFromImageData(BinaryData::expanded_svg, BinaryData::expanded_svgSize);
-        std::unique_ptr<Drawable> helpSvg_ = Drawable::createFromImageData(BinaryData::help_svg, BinaryData::help_svgSize);
-        std::unique_ptr<Drawable> settingsSvg_ = Drawable::createFromImageData(BinaryData::settings_svg, BinaryData::settings_svgSize);
-        std::unique_ptr<Drawable> playSvg_ = Drawable::createFromImageData(BinaryData::play_svg, BinaryData::play_svgSize);
-        std::unique_ptr<Drawable> pauseSvg_ = Drawable::createFromImageData(BinaryData::pause_svg, BinaryData::pause_svgSize);
-        std::unique_ptr<Drawable> barSvg_ = Drawable::createFromImageData(BinaryData::bar_svg, BinaryData::bar_svgSize);
-        std::unique_ptr<Drawable> graphSvg_ = Drawable::createFromImageData(BinaryData::graph_svg, BinaryData::graph_svgSize);
-        std::unique_ptr<Drawable> resetSvg_ = Drawable::createFromImageData(BinaryData::reset_svg, BinaryData::reset_svgSize);
 
         std::unique_ptr<PaintedButton> collapsedButton_;
         std::unique_ptr<PaintedButton> expandedButton_;
@@ -17,33 +17,45 @@
  */
 #include "StandaloneDevicesComponent.h"
 
+#include "FramePacer.h"
+#include "LatencyComponent.h"
+#include "MessageLogComponent.h"
 #include "MidiDeviceComponent.h"
-#include "MidiDeviceInfoComparator.h"
+#include "MidiDeviceState.h"
+#include "MidiEventLog.h"
+#include "MidiExport.h"
 #include "MidiDevicesListener.h"
+#include "RenderWorkers.h"
 #include "ShowMidiApplication.h"
 #include "DpiScaling.h"
 
 namespace showmidi
 {
-struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevicesListener
+struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevicesListener, public MouseListener
 {
     static constexpr int MIN_MIDI_DEVICES_AUTO_SHOWN = 1;
     static constexpr int MAX_MIDI_DEVICES_AUTO_SHOWN = 6;
+    // devices next to the visible area already get a view, this avoids them popping in while scrolling
+    static constexpr int OVERSCAN_DEVICES = 1;
+    static constexpr int DEVICE_ANIMATION_MS = 200;
+    // the context menu item IDs, offset by the index of the output
+    static constexpr int THRU_MENU_ID = 2;
+    static constexpr int LATENCY_MENU_ID = 1000;
+    static constexpr int EXPORT_MENU_ID = 2000;
     
     enum Timers
     {
-        RenderDevices = 1,
-        GrabKeyboardFocus
+        GrabKeyboardFocus = 1
     };
     
     Pimpl(StandaloneDevicesComponent* owner) : owner_(owner)
     {
-        SMApp.getMidiDevicesListeners().add(this);
+        framePacer_ = std::make_unique<FramePacer>(owner_, &SMApp, [this] { return renderDevices(); });
         
-        refreshMidiDevices();
+        SMApp.getMidiDeviceRegistry().addListener(this);
+        owner_->addMouseListener(this, true);
         
-        // 30Hz
-        startTimer(RenderDevices, 1000 / 30);
+        refreshMidiDevices();
         
         startTimer(GrabKeyboardFocus, 100);
 #if SHOW_TEST_DATA
@@ -53,15 +65,20 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
     
     ~Pimpl()
     {
-        SMApp.getMidiDevicesListeners().remove(this);
-        
-        stopTimer(RenderDevices);
+        SMApp.getMidiDeviceRegistry().removeListener(this);
+        owner_->removeMouseListener(this);
         
         {
             ScopedLock g(midiDevicesLock_);
-            for (HashMap<const String, MidiDeviceComponent*>::Iterator i(midiDevices_); i.next();)
+            for (auto& identifier : midiDeviceOrder_)
+            {
+                closeMessageLog(identifier);
+                closeLatency(identifier);
+                closeExport(identifier);
+                removeView(identifier);
+            }
+            for (HashMap<const String, MidiDeviceState*>::Iterator i(midiDevices_); i.next();)
             {
-                owner_->removeChildComponent(i.getValue());
                 delete i.getValue();
             }
         }
@@ -100,10 +117,30 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
         deviceListeners_.broadcastPauseChange(paused_);
     }
     
+    int64 getScrubLength()
+    {
+        ScopedLock g(midiDevicesLock_);
+        int64 length = 0;
+        for (HashMap<const String, MidiDeviceState*>::Iterator i(midiDevices_); i.next();)
+        {
+            length = std::max(length, i.getValue()->getTimelineLength());
+        }
+        return length;
+    }
+    
+    void scrubTo(int64 offset)
+    {
+        ScopedLock g(midiDevicesLock_);
+        for (HashMap<const String, MidiDeviceState*>::Iterator i(midiDevices_); i.next();)
+        {
+            i.getValue()->scrubTo(offset);
+        }
+    }
+    
     void resetChannelData()
     {
         ScopedLock g(midiDevicesLock_);
-        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(midiDevices_); i.next();)
+        for (HashMap<const String, MidiDeviceState*>::Iterator i(midiDevices_); i.next();)
         {
             i.getValue()->resetChannelData();
         }
@@ -120,7 +157,7 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
         paused_ = paused;
         
         ScopedLock g(midiDevicesLock_);
-        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(midiDevices_); i.next();)
+        for (HashMap<const String, MidiDeviceState*>::Iterator i(midiDevices_); i.next();)
         {
             i.getValue()->setPaused(paused);
         }
@@ -130,12 +167,6 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
     {
         switch (timerID)
         {
-            case RenderDevices:
-            {
-                renderDevices();
-                break;
-            }
-                
             case GrabKeyboardFocus:
             {
                 if (owner_->isVisible())
@@ -148,15 +179,17 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
         }
     }
     
-    void renderDevices()
+    int renderDevices()
     {
         ScopedLock g(midiDevicesLock_);
         
+        // only the devices with a view are rendered, the others keep ingesting MIDI data without any cost
+        auto next_frame = FramePacer::IDLE;
         auto height = owner_->getParentHeight();
-        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(midiDevices_); i.next();)
+        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(deviceViews_); i.next();)
         {
             auto c = i.getValue();
-            c->render();
+            next_frame = FramePacer::earliest(next_frame, c->render());
             height = std::max(height, c->getVisibleHeight());
         }
         
@@ -164,95 +197,408 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
         auto width = std::max(owner_->getParentWidth(), midiDevices_.size() * (deviceWidth + showmidi::layout::MIDI_DEVICE_SPACING) - showmidi::layout::MIDI_DEVICE_SPACING);
         owner_->setSize(width, height);
         
-        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(midiDevices_); i.next();)
+        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(deviceViews_); i.next();)
         {
             i.getValue()->setSize(i.getValue()->getStandardWidth(), height);
         }
+        
+        return next_frame;
     }
     
-    void refreshMidiDevices() override
+    /** The part of the strip that is shown by the viewport this component is placed in. */
+    Rectangle<int> getVisibleArea() const
     {
-        auto& settings = SMApp.getSettings();
+        auto parent = owner_->getParentComponent();
+        if (parent == nullptr)
+        {
+            return owner_->getLocalBounds();
+        }
         
-        ScopedLock g(midiDevicesLock_);
+        return owner_->getLocalArea(parent, parent->getLocalBounds()).getIntersection(owner_->getLocalBounds());
+    }
+    
+    /**
+     * Creates the views of the devices that intersect the visible area and destroys the others.
+     *
+     * When animated, the existing views slide to their new position and the new ones fade in.
+     */
+    void updateVisibleDevices(bool animate = false)
+    {
+        auto pitch = getStandardWidth() + showmidi::layout::MIDI_DEVICE_SPACING;
+        auto visible = getVisibleArea();
+        auto first = visible.getX() / pitch - OVERSCAN_DEVICES;
+        auto last = visible.getRight() / pitch + OVERSCAN_DEVICES;
+        
+        Array<String> missing;
+        {
+            ScopedLock g(midiDevicesLock_);
+            for (int position = 0; position < midiDeviceOrder_.size(); ++position)
+            {
+                auto& identifier = midiDeviceOrder_.getReference(position);
+                if (position < first || position > last)
+                {
+                    removeView(identifier);
+                }
+                else if (!deviceViews_.contains(identifier))
+                {
+                    missing.add(identifier);
+                }
+            }
+        }
         
-        auto devices = MidiInput::getAvailableDevices();
+        // the views are constructed without holding the lock, so that rendering isn't held up,
+        // the devices themselves are only ever changed from the message thread
+        for (auto& identifier : missing)
+        {
+            auto state = midiDevices_[identifier];
+            auto component = new MidiDeviceComponent(&SMApp, *state);
+            component->setRenderWorkers(&renderWorkers_);
+            owner_->addAndMakeVisible(component);
+            
+            ScopedLock g(midiDevicesLock_);
+            deviceViews_.set(identifier, component);
+            state->setFramePacer(framePacer_.get());
+        }
         
-        MidiDeviceInfoComparator comparator;
-        devices.sort(comparator);
+        auto& animator = Desktop::getInstance().getAnimator();
         
-        // detect the previous devices that have now disappeared
-        Array<String> devices_to_remove;
-        for (HashMap<const String, MidiDeviceComponent*>::Iterator it(midiDevices_); it.next();)
+        ScopedLock g(midiDevicesLock_);
+        for (int position = std::max(0, first); position <= last && position < midiDeviceOrder_.size(); ++position)
         {
-            auto identifier = it.getKey();
-            bool found = false;
-            for (int i = 0; i < devices.size(); ++i)
+            auto& identifier = midiDeviceOrder_.getReference(position);
+            auto component = deviceViews_[identifier];
+            auto bounds = Rectangle<int>(showmidi::layout::MIDI_DEVICE_SPACING + position * pitch, 0,
+                                         component->getStandardWidth(), std::max(owner_->getHeight(), owner_->getParentHeight()));
+            
+            if (!animate)
             {
-                if (devices[i].identifier == identifier && settings.isMidiDeviceVisible(identifier))
+                // a view that is still sliding already knows where to go
+                if (!animator.isAnimating(component))
                 {
-                    found = true;
-                    break;
+                    component->setBounds(bounds);
                 }
             }
+            else if (missing.contains(identifier))
+            {
+                component->setBounds(bounds);
+                component->setAlpha(0.0f);
+                animator.animateComponent(component, bounds, 1.0f, DEVICE_ANIMATION_MS, false, 1.0, 1.0);
+            }
+            else if (component->getBounds() != bounds)
+            {
+                animator.animateComponent(component, bounds, 1.0f, DEVICE_ANIMATION_MS, false, 1.0, 0.0);
+            }
+        }
+        
+        if (!missing.isEmpty())
+        {
+            framePacer_->wake();
+        }
+    }
+    
+    void removeView(const String& identifier)
+    {
+        auto component = deviceViews_[identifier];
+        if (component == nullptr)
+        {
+            return;
+        }
+        
+        midiDevices_[identifier]->setFramePacer(nullptr);
+        owner_->removeChildComponent(component);
+        deviceViews_.remove(identifier);
+        delete component;
+    }
+    
+    /** Double-clicking a device opens the log of its messages. */
+    void mouseDoubleClick(const MouseEvent& event) override
+    {
+        ScopedLock g(midiDevicesLock_);
+        
+        auto identifier = findDevice(event);
+        if (identifier.isNotEmpty())
+        {
+            openMessageLog(identifier);
+        }
+    }
+    
+    /** The context menu of a device selects the output its input is forwarded to, the output to measure its latency through, and exports its messages. */
+    void mouseDown(const MouseEvent& event) override
+    {
+        if (!event.mods.isPopupMenu())
+        {
+            return;
+        }
+        
+        ScopedLock g(midiDevicesLock_);
+        
+        auto identifier = findDevice(event);
+        if (identifier.isNotEmpty())
+        {
+            showDeviceMenu(identifier);
+        }
+    }
+    
+    String findDevice(const MouseEvent& event)
+    {
+        for (HashMap<const String, MidiDeviceComponent*>::Iterator i(deviceViews_); i.next();)
+        {
+            auto view = i.getValue();
+            if (view == event.eventComponent || view->isParentOf(event.eventComponent))
+            {
+                return i.getKey();
+            }
+        }
+        return {};
+    }
+    
+    void showDeviceMenu(const String& identifier)
+    {
+        auto state = midiDevices_[identifier];
+        if (state == nullptr)
+        {
+            return;
+        }
+        
+        auto current = state->getThruOutput();
+        auto outputs = MidiOutput::getAvailableDevices();
+        
+        PopupMenu menu;
+        menu.addSectionHeader("MIDI thru");
+        menu.addItem(1, "Off", true, current.isEmpty());
+        for (int i = 0; i < outputs.size(); ++i)
+        {
+            menu.addItem(THRU_MENU_ID + i, outputs[i].name, true, outputs[i].identifier == current);
+        }
+        
+        // the probes are sent to the output and are expected back on this device, through a loopback
+        PopupMenu latency;
+        for (int i = 0; i < outputs.size(); ++i)
+        {
+            latency.addItem(LATENCY_MENU_ID + i, outputs[i].name);
+        }
+        menu.addSeparator();
+        menu.addSubMenu("Measure latency", latency, !outputs.isEmpty());
+        
+        // the buffered messages are in the event log, the recorded ones in the capture of the device
+        auto& log = state->getEventLog();
+        auto buffered = log.getEnd() > log.getBegin();
+        auto recorded = state->getCaptureFile() != File();
+        PopupMenu exports;
+        exports.addItem(EXPORT_MENU_ID + exportBufferedMidiFile, "Buffered messages as MIDI file...", buffered);
+        exports.addItem(EXPORT_MENU_ID + exportBufferedCsv, "Buffered messages as CSV...", buffered);
+        exports.addItem(EXPORT_MENU_ID + exportRecordedMidiFile, "Recorded messages as MIDI file...", recorded);
+        exports.addItem(EXPORT_MENU_ID + exportRecordedCsv, "Recorded messages as CSV...", recorded);
+        menu.addSubMenu("Export", exports, exports_[identifier] == nullptr && (buffered || recorded));
+        
+        Component::SafePointer<StandaloneDevicesComponent> owner(owner_);
+        menu.showMenuAsync(PopupMenu::Options(), [this, owner, identifier, outputs] (int result) {
+            if (owner == nullptr || result == 0)
+            {
+                return;
+            }
             
-            if (!found)
+            ScopedLock g(midiDevicesLock_);
+            if (result >= EXPORT_MENU_ID)
+            {
+                chooseExportFile(identifier, (ExportChoice)(result - EXPORT_MENU_ID));
+                return;
+            }
+            if (result >= LATENCY_MENU_ID)
+            {
+                openLatency(identifier, outputs[result - LATENCY_MENU_ID]);
+                return;
+            }
+            
+            auto output = result == 1 ? String() : outputs[result - THRU_MENU_ID].identifier;
+            SMApp.getSettings().setMidiThruOutput(identifier, output);
+            
+            if (auto device = midiDevices_[identifier])
+            {
+                device->setThruOutput(output);
+            }
+        });
+    }
+    
+    void openMessageLog(const String& identifier)
+    {
+        if (auto window = messageLogs_[identifier])
+        {
+            window->toFront(true);
+            return;
+        }
+        
+        auto state = midiDevices_[identifier];
+        if (state == nullptr)
+        {
+            return;
+        }
+        
+        messageLogs_.set(identifier, new MessageLogWindow(&SMApp, *state, [this, identifier] { closeMessageLog(identifier); }));
+    }
+    
+    void closeMessageLog(String identifier)
+    {
+        auto window = messageLogs_[identifier];
+        messageLogs_.remove(identifier);
+        delete window;
+    }
+    
+    /** A device is measured through one output at a time, choosing another output starts over. */
+    void openLatency(const String& identifier, const MidiDeviceInfo& output)
+    {
+        auto state = midiDevices_[identifier];
+        if (state == nullptr)
+        {
+            return;
+        }
+        
+        closeLatency(identifier);
+        latencies_.set(identifier, new LatencyWindow(&SMApp, *state, output, deviceViews_[identifier], [this, identifier] { closeLatency(identifier); }));
+    }
+    
+    void closeLatency(String identifier)
+    {
+        auto window = latencies_[identifier];
+        latencies_.remove(identifier);
+        delete window;
+    }
+    
+    enum ExportChoice
+    {
+        exportBufferedMidiFile = 0,
+        exportBufferedCsv,
+        exportRecordedMidiFile,
+        exportRecordedCsv
+    };
+    
+    void chooseExportFile(const String& identifier, ExportChoice choice)
+    {
+        auto state = midiDevices_[identifier];
+        if (state == nullptr)
+        {
+            return;
+        }
+        
+        auto format = (choice == exportBufferedCsv || choice == exportRecordedCsv) ? MidiExport::formatCsv : MidiExport::formatStandardMidiFile;
+        auto extension = MidiExport::getFileExtension(format);
+        auto initial = File::getSpecialLocation(File::userDocumentsDirectory).getChildFile(File::createLegalFileName(state->getDeviceInfo().name) + extension);
+        exportChooser_.reset(new FileChooser("Please choose where to export the messages...", initial, "*" + extension, true, false, owner_));
+        
+        Component::SafePointer<StandaloneDevicesComponent> owner(owner_);
+        exportChooser_->launchAsync(FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles | FileBrowserComponent::warnAboutOverwriting, [this, owner, identifier, choice, format] (const FileChooser& chooser) {
+            auto file = chooser.getResult();
+            if (owner == nullptr || file == File())
             {
-                devices_to_remove.add(identifier);
+                return;
             }
+            
+            ScopedLock g(midiDevicesLock_);
+            openExport(identifier, choice, format, file);
+        });
+    }
+    
+    /** A device exports one file at a time, the export is cancelled when the device goes away. */
+    void openExport(const String& identifier, ExportChoice choice, MidiExport::Format format, const File& file)
+    {
+        auto state = midiDevices_[identifier];
+        if (state == nullptr || exports_[identifier] != nullptr)
+        {
+            return;
         }
         
-        // check if all the devices are already present
-        bool new_devices_preset = false;
-        for (int i = 0; i < devices.size(); ++i)
+        auto recorded = choice == exportRecordedMidiFile || choice == exportRecordedCsv;
+        auto source = recorded ? MidiExport::createCaptureSource(state->getCaptureFile()) : MidiExport::createLogSource(state->getEventLog());
+        exports_.set(identifier, new MidiExportJob(std::move(source), format, file, [this, identifier] { closeExport(identifier); }));
+    }
+    
+    void closeExport(String identifier)
+    {
+        auto job = exports_[identifier];
+        exports_.remove(identifier);
+        delete job;
+    }
+    
+    /** Only applies the difference with the devices that are shown, the other devices and their views are left alone. */
+    void refreshMidiDevices() override
+    {
+        auto& settings = SMApp.getSettings();
+        
+        // the devices that should be shown, they're ordered alphabetically and the views are positioned accordingly
+        Array<String> order;
+        Array<MidiDeviceInfo> added;
+        for (auto& info : SMApp.getMidiDeviceRegistry().getDevices())
         {
-            auto identifier = devices[i].identifier;
-            if (!midiDevices_.contains(identifier) && settings.isMidiDeviceVisible(identifier))
+            if (settings.isMidiDeviceVisible(info.identifier))
             {
-                new_devices_preset = true;
-                break;
+                order.add(info.identifier);
+                if (!midiDevices_.contains(info.identifier))
+                {
+                    added.add(info);
+                }
             }
         }
         
-        if (devices_to_remove.size() > 0 || new_devices_preset)
+        if (order == midiDeviceOrder_)
         {
-            owner_->removeAllChildren();
+            return;
+        }
+        
+        // the states open their devices in the background, they're only added under the lock
+        Array<MidiDeviceState*> added_states;
+        for (auto& info : added)
+        {
+            auto state = new MidiDeviceState(info);
+            state->setPaused(paused_);
             
-            // remove the devices that disappeared
-            for (int i = 0; i < devices_to_remove.size(); ++i)
+            auto thru = settings.getMidiThruOutput(info.identifier);
+            if (thru.isNotEmpty())
             {
-                auto identifier = devices_to_remove[i];
-                auto component = midiDevices_.getReference(identifier);
-                delete component;
-                
-                midiDevices_.remove(identifier);
+                state->setThruOutput(thru);
             }
+            added_states.add(state);
+        }
+        
+        auto& animator = Desktop::getInstance().getAnimator();
+        
+        Array<MidiDeviceState*> removed_states;
+        {
+            ScopedLock g(midiDevicesLock_);
             
-            // create the new devices and reuse the existing ones
-            // lay them out in alpabetical order
-            int position = 0;
-            for (int i = 0; i < devices.size(); ++i)
+            for (auto& identifier : midiDeviceOrder_)
             {
-                auto info = devices[i];
-                if (!devices_to_remove.contains(info.identifier) && settings.isMidiDeviceVisible(info.identifier))
+                if (!order.contains(identifier))
                 {
-                    MidiDeviceComponent* component = midiDevices_.getReference(info.identifier);
-                    if (component == nullptr)
+                    if (auto view = deviceViews_[identifier])
                     {
-                        component = new MidiDeviceComponent(&SMApp, info);
-                        component->setPaused(paused_);
-                        midiDevices_.set(info.identifier, component);
+                        animator.fadeOut(view, DEVICE_ANIMATION_MS);
                     }
+                    closeMessageLog(identifier);
+                    closeLatency(identifier);
+                    closeExport(identifier);
+                    removeView(identifier);
                     
-                    component->setBounds(showmidi::layout::MIDI_DEVICE_SPACING + position++ * (component->getStandardWidth() + showmidi::layout::MIDI_DEVICE_SPACING), 0,
-                                         component->getStandardWidth(), owner_->getParentHeight());
-                    
-                    owner_->addAndMakeVisible(component);
+                    removed_states.add(midiDevices_[identifier]);
+                    midiDevices_.remove(identifier);
                 }
             }
             
-            updateWindowSize();
+            for (auto state : added_states)
+            {
+                midiDevices_.set(state->getDeviceInfo().identifier, state);
+            }
+            
+            midiDeviceOrder_.swapWith(order);
         }
+        
+        for (auto state : removed_states)
+        {
+            delete state;
+        }
+        
+        updateVisibleDevices(true);
+        updateWindowSize();
+        framePacer_->wake();
     }
     
     void updateWindowSize()
@@ -270,17 +616,25 @@ struct StandaloneDevicesComponent::Pimpl : public MultiTimer, public MidiDevices
     // Helper to get standard width without direct sm:: dependency
     int getStandardWidth() const
     {
-        if (midiDevices_.size() > 0)
+        if (deviceViews_.size() > 0)
         {
-            return midiDevices_.begin().getValue()->getStandardWidth();
+            return deviceViews_.begin().getValue()->getStandardWidth();
         }
-        // Fallback: use the scaling utility directly when no devices exist yet
+        // Fallback: use the scaling utility directly when no views exist yet
         return sm::getStandardWidth();
     }
     
     StandaloneDevicesComponent* const owner_;
+    std::unique_ptr<FramePacer> framePacer_;
+    RenderWorkers renderWorkers_;
     
-    HashMap<const String, MidiDeviceComponent*> midiDevices_;
+    HashMap<const String, MidiDeviceState*> midiDevices_;
+    Array<String> midiDeviceOrder_;
+    HashMap<const String, MidiDeviceComponent*> deviceViews_;
+    HashMap<const String, MessageLogWindow*> messageLogs_;
+    HashMap<const String, LatencyWindow*> latencies_;
+    HashMap<const String, MidiExportJob*> exports_;
+    std::unique_ptr<FileChooser> exportChooser_;
     CriticalSection midiDevicesLock_;
     
     bool paused_ { false };
@@ -293,8 +647,13 @@ StandaloneDevicesComponent::StandaloneDevicesComponent() : pimpl_(new Pimpl(this
 StandaloneDevicesComponent::~StandaloneDevicesComponent() = default;
 
 void StandaloneDevicesComponent::paint(Graphics& g)                 { pimpl_->paint(g); }
+void StandaloneDevicesComponent::resized()                          { pimpl_->updateVisibleDevices(); }
+void StandaloneDevicesComponent::moved()                            { pimpl_->updateVisibleDevices(); }
+void StandaloneDevicesComponent::parentSizeChanged()                { pimpl_->updateVisibleDevices(); }
 bool StandaloneDevicesComponent::isPaused()                         { return pimpl_->isPaused(); }
 void StandaloneDevicesComponent::togglePaused()                     { pimpl_->togglePaused(); }
+int64 StandaloneDevicesComponent::getScrubLength()                  { return pimpl_->getScrubLength(); }
+void StandaloneDevicesComponent::scrubTo(int64 o)                   { pimpl_->scrubTo(o); }
 DeviceListeners& StandaloneDevicesComponent::getDeviceListeners()   { return pimpl_->getDeviceListeners(); }
 void StandaloneDevicesComponent::resetChannelData()                 { pimpl_->resetChannelData(); }
 }
@@ -31,9 +31,14 @@ namespace showmidi
         ~StandaloneDevicesComponent() override;
         
         void paint(Graphics&) override;
+        void resized() override;
+        void moved() override;
+        void parentSizeChanged() override;
         
         bool isPaused() override;
         void togglePaused() override;
+        int64 getScrubLength() override;
+        void scrubTo(int64) override;
         DeviceListeners& getDeviceListeners() override;
         void resetChannelData() override;
 
@@ -0,0 +1,314 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "StateStreamProtocol.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SHOWMIDI_STATE_STREAM 1
+#else
+#define SHOWMIDI_STATE_STREAM 0
+#endif
+
+namespace showmidi
+{
+int StateStreamProtocol::toSlot(const MidiMessage& msg, uint32& value)
+{
+    if (msg.isMidiStart() || msg.isMidiContinue() || msg.isMidiStop())
+    {
+        value = 0;
+        return msg.isMidiStart() ? SLOT_START : msg.isMidiContinue() ? SLOT_CONTINUE : SLOT_STOP;
+    }
+    
+    if (msg.getChannel() <= 0)
+    {
+        return -1;
+    }
+    
+    auto channel_slot = (msg.getChannel() - 1) * SLOTS_PER_CHANNEL;
+    if (msg.isNoteOn())
+    {
+        value = (uint32)msg.getVelocity();
+        return channel_slot + SLOT_NOTE_ON + msg.getNoteNumber();
+    }
+    if (msg.isNoteOff())
+    {
+        value = (uint32)msg.getVelocity();
+        return channel_slot + SLOT_NOTE_OFF + msg.getNoteNumber();
+    }
+    if (msg.isAftertouch())
+    {
+        value = (uint32)msg.getAfterTouchValue();
+        return channel_slot + SLOT_POLY_PRESSURE + msg.getNoteNumber();
+    }
+    if (msg.isController())
+    {
+        value = (uint32)msg.getControllerValue();
+        return channel_slot + SLOT_CONTROL_CHANGE + msg.getControllerNumber();
+    }
+    if (msg.isProgramChange())
+    {
+        value = (uint32)msg.getProgramChangeNumber();
+        return channel_slot + SLOT_PROGRAM_CHANGE;
+    }
+    if (msg.isChannelPressure())
+    {
+        value = (uint32)msg.getChannelPressureValue();
+        return channel_slot + SLOT_CHANNEL_PRESSURE;
+    }
+    if (msg.isPitchWheel())
+    {
+        value = (uint32)msg.getPitchWheelValue();
+        return channel_slot + SLOT_PITCH_BEND;
+    }
+    
+    return -1;
+}
+
+MidiMessage StateStreamProtocol::toMessage(int slot, uint32 value)
+{
+    switch (slot)
+    {
+        case SLOT_START:
+            return MidiMessage::midiStart();
+        case SLOT_CONTINUE:
+            return MidiMessage::midiContinue();
+        case SLOT_STOP:
+            return MidiMessage::midiStop();
+        default:
+            break;
+    }
+    
+    auto channel = slot / SLOTS_PER_CHANNEL + 1;
+    auto offset = slot % SLOTS_PER_CHANNEL;
+    auto data = (int)(value & 0x7f);
+    if (offset < SLOT_NOTE_OFF)
+    {
+        return MidiMessage::noteOn(channel, offset - SLOT_NOTE_ON, (uint8)data);
+    }
+    if (offset < SLOT_POLY_PRESSURE)
+    {
+        return MidiMessage::noteOff(channel, offset - SLOT_NOTE_OFF, (uint8)data);
+    }
+    if (offset < SLOT_CONTROL_CHANGE)
+    {
+        return MidiMessage::aftertouchChange(channel, offset - SLOT_POLY_PRESSURE, data);
+    }
+    if (offset < SLOT_PROGRAM_CHANGE)
+    {
+        return MidiMessage::controllerEvent(channel, offset - SLOT_CONTROL_CHANGE, data);
+    }
+    if (offset == SLOT_PROGRAM_CHANGE)
+    {
+        return MidiMessage::programChange(channel, data);
+    }
+    if (offset == SLOT_CHANNEL_PRESSURE)
+    {
+        return MidiMessage::channelPressureChange(channel, data);
+    }
+    return MidiMessage::pitchWheel(channel, (int)(value & 0x3fff));
+}
+
+void StateStreamProtocol::writeVarint(MemoryOutputStream& out, uint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.writeByte((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.writeByte((char)value);
+}
+
+void StateStreamProtocol::writeString(MemoryOutputStream& out, const String& text)
+{
+    auto utf8 = text.toUTF8();
+    auto size = utf8.sizeInBytes() - 1;
+    writeVarint(out, (uint64)size);
+    out.write(utf8.getAddress(), size);
+}
+
+bool StateStreamProtocol::readVarint(const uint8*& data, const uint8* end, uint64& value)
+{
+    value = 0;
+    for (auto shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        auto byte = *data++;
+        value |= (uint64)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StateStreamProtocol::readString(const uint8*& data, const uint8* end, String& text)
+{
+    uint64 size;
+    if (!readVarint(data, end, size) || size > (uint64)(end - data))
+    {
+        return false;
+    }
+    
+    text = String::fromUTF8((const char*)data, (int)size);
+    data += size;
+    return true;
+}
+
+bool StateStreamProtocol::isAvailable()
+{
+    return SHOWMIDI_STATE_STREAM;
+}
+
+#if SHOWMIDI_STATE_STREAM
+/** Calls back with the socket addresses an address string resolves to, until the callback returns a socket. */
+static int withAddress(const String& address, bool passive, std::function<int(int, const sockaddr*, socklen_t)> use)
+{
+    if (address.startsWith("unix:"))
+    {
+        sockaddr_un unix_address {};
+        unix_address.sun_family = AF_UNIX;
+        auto path = address.fromFirstOccurrenceOf("unix:", false, false);
+        if (path.isEmpty() || (size_t)path.getNumBytesAsUTF8() >= sizeof(unix_address.sun_path))
+        {
+            return -1;
+        }
+        path.copyToUTF8(unix_address.sun_path, sizeof(unix_address.sun_path));
+        return use(AF_UNIX, (const sockaddr*)&unix_address, (socklen_t)sizeof(unix_address));
+    }
+    
+    auto host_port = address.fromFirstOccurrenceOf("tcp:", false, false);
+    auto host = host_port.upToLastOccurrenceOf(":", false, false);
+    auto port = host_port.fromLastOccurrenceOf(":", false, false);
+    
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.isEmpty() ? nullptr : host.toRawUTF8(), port.toRawUTF8(), &hints, &results) != 0)
+    {
+        return -1;
+    }
+    
+    auto result = -1;
+    for (auto info = results; info != nullptr && result < 0; info = info->ai_next)
+    {
+        result = use(info->ai_family, info->ai_addr, info->ai_addrlen);
+    }
+    freeaddrinfo(results);
+    return result;
+}
+
+static int createSocket(int family)
+{
+    auto fd = socket(family, SOCK_STREAM, 0);
+#ifdef SO_NOSIGPIPE
+    if (fd >= 0)
+    {
+        // a viewer that went away mustn't take the app down
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    }
+#endif
+    return fd;
+}
+#endif
+
+int StateStreamProtocol::listenTo(const String& address)
+{
+#if SHOWMIDI_STATE_STREAM
+    return withAddress(address, true, [] (int family, const sockaddr* socketAddress, socklen_t length) {
+        auto fd = createSocket(family);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        
+        if (family == AF_UNIX)
+        {
+            // a socket file that was left behind would make binding fail
+            unlink(((const sockaddr_un*)socketAddress)->sun_path);
+        }
+        else
+        {
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        }
+        
+        if (bind(fd, socketAddress, length) < 0 || listen(fd, 4) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    });
+#else
+    ignoreUnused(address);
+    return -1;
+#endif
+}
+
+int StateStreamProtocol::connectTo(const String& address)
+{
+#if SHOWMIDI_STATE_STREAM
+    return withAddress(address, false, [] (int family, const sockaddr* socketAddress, socklen_t length) {
+        auto fd = createSocket(family);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        
+        if (connect(fd, socketAddress, length) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        
+        if (family != AF_UNIX)
+        {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        return fd;
+    });
+#else
+    ignoreUnused(address);
+    return -1;
+#endif
+}
+
+void StateStreamProtocol::closeSocket(int fd)
+{
+#if SHOWMIDI_STATE_STREAM
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#else
+    ignoreUnused(fd);
+#endif
+}
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * The wire format of the state streams.
+     *
+     * The stream is a sequence of frames, each prefixed with its size as a varint. A frame starts
+     * with the time it was sent in milliseconds since the epoch, which lets viewers compensate for
+     * the difference between the clocks. Records follow, they start with a varint tag of the device
+     * index shifted left by two and the record type:
+     *
+     *  - recordDeviceAdded: the identifier and the name of the device, as varint sized UTF-8
+     *  - recordDeviceRemoved: nothing else
+     *  - recordDeviceReset: nothing else, the state of the device is cleared
+     *  - recordChanges: the number of changes and the time of the first change, then for each change
+     *    the slot, the value and the time since the previous change, ordered by time
+     *
+     * A slot is a single value of the state: a note, a controller, the tempo, and so on. Only the
+     * latest value of a slot is ever sent, which keeps the bandwidth bounded no matter how much
+     * MIDI data arrives.
+     *
+     * RPNs, NRPNs and high resolution controllers have no slots of their own, they're streamed as
+     * the controllers that they're made of. Viewers only rebuild the parameter that was written
+     * last on a channel, from the latest values of its controllers, the earlier ones are lost.
+     */
+    class StateStreamProtocol
+    {
+    public:
+        static constexpr const char* DEFAULT_ADDRESS = "unix:/tmp/showmidi-state.sock";
+        
+        enum RecordType
+        {
+            recordDeviceAdded = 0,
+            recordDeviceRemoved,
+            recordDeviceReset,
+            recordChanges
+        };
+        
+        static constexpr int SLOT_NOTE_ON = 0;
+        static constexpr int SLOT_NOTE_OFF = 128;
+        static constexpr int SLOT_POLY_PRESSURE = 256;
+        static constexpr int SLOT_CONTROL_CHANGE = 384;
+        static constexpr int SLOT_PROGRAM_CHANGE = 512;
+        static constexpr int SLOT_CHANNEL_PRESSURE = 513;
+        static constexpr int SLOT_PITCH_BEND = 514;
+        static constexpr int SLOTS_PER_CHANNEL = 515;
+        
+        static constexpr int SLOT_TEMPO = 16 * SLOTS_PER_CHANNEL;
+        static constexpr int SLOT_START = SLOT_TEMPO + 1;
+        static constexpr int SLOT_CONTINUE = SLOT_TEMPO + 2;
+        static constexpr int SLOT_STOP = SLOT_TEMPO + 3;
+        static constexpr int NUM_SLOTS = SLOT_TEMPO + 4;
+        
+        /** The tempo is sent in hundredths of beats per minute. */
+        static constexpr double TEMPO_SCALE = 100.0;
+        
+        /** The slot a message changes, -1 for the messages that aren't streamed. */
+        static int toSlot(const MidiMessage&, uint32& value);
+        /** The message that changes a slot to a value, the tempo has no message. */
+        static MidiMessage toMessage(int slot, uint32 value);
+        
+        static void writeVarint(MemoryOutputStream&, uint64);
+        static void writeString(MemoryOutputStream&, const String&);
+        /** Returns false when the data ran out. */
+        static bool readVarint(const uint8*& data, const uint8* end, uint64&);
+        static bool readString(const uint8*& data, const uint8* end, String&);
+        
+        /** Whether the streams are supported on this platform, they rely on POSIX sockets. */
+        static bool isAvailable();
+        /**
+         * Addresses are unix:<path> for Unix domain sockets, or tcp:<host>:<port> for TCP.
+         * The functions return a socket descriptor, or -1 when that failed.
+         */
+        static int listenTo(const String& address);
+        static int connectTo(const String& address);
+        static void closeSocket(int);
+    };
+}
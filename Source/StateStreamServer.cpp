@@ -0,0 +1,597 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "StateStreamServer.h"
+
+#include "StateStreamProtocol.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <cerrno>
+#include <sys/socket.h>
+#endif
+
+namespace showmidi
+{
+using Protocol = StateStreamProtocol;
+
+/** The latest value of every slot of a device, and the slots that changed since they were last collected. */
+struct StreamedDevice
+{
+    StreamedDevice(int index, const MidiDeviceInfo& info) :
+    index_(index),
+    info_(info),
+    values_(Protocol::NUM_SLOTS),
+    times_(Protocol::NUM_SLOTS),
+    changed_(Protocol::NUM_SLOTS)
+    {
+    }
+    
+    void set(int slot, uint32 value, int64 time)
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        values_[(size_t)slot] = value;
+        times_[(size_t)slot] = time;
+        if (!changed_[(size_t)slot])
+        {
+            changed_[(size_t)slot] = true;
+            changes_.push_back(slot);
+        }
+    }
+    
+    void reset()
+    {
+        const SpinLock::ScopedLockType lock(lock_);
+        std::fill(values_.begin(), values_.end(), 0);
+        std::fill(times_.begin(), times_.end(), 0);
+        std::fill(changed_.begin(), changed_.end(), false);
+        changes_.clear();
+        reset_ = true;
+    }
+    
+    const int index_;
+    const MidiDeviceInfo info_;
+    
+    SpinLock lock_;
+    std::vector<uint32> values_;
+    // slots that were never set have no time
+    std::vector<int64> times_;
+    std::vector<bool> changed_;
+    std::vector<int> changes_;
+    bool reset_ { false };
+    
+    // guarded by the lock of the devices
+    bool removed_ { false };
+};
+
+/** A viewer, with the slots of every device that it still has to be sent. */
+struct StreamConnection
+{
+    struct DeviceView
+    {
+        DeviceView() : dirty_(Protocol::NUM_SLOTS)
+        {
+        }
+        
+        void markDirty(int slot)
+        {
+            if (!dirty_[(size_t)slot])
+            {
+                dirty_[(size_t)slot] = true;
+                dirtySlots_.push_back(slot);
+            }
+        }
+        
+        void clearDirty()
+        {
+            std::fill(dirty_.begin(), dirty_.end(), false);
+            dirtySlots_.clear();
+        }
+        
+        // the records that still have to be sent
+        bool announce_ { false };
+        bool remove_ { false };
+        bool reset_ { false };
+        std::vector<bool> dirty_;
+        std::vector<int> dirtySlots_;
+    };
+    
+    StreamConnection(int fd) : fd_(fd)
+    {
+    }
+    
+    ~StreamConnection()
+    {
+        Protocol::closeSocket(fd_);
+    }
+    
+    const int fd_;
+    std::map<int, DeviceView> devices_;
+    MemoryBlock unsent_;
+    size_t unsentOffset_ { 0 };
+};
+
+/** Accepts the viewers and sends them a frame of changes at a steady rate. */
+class StateStreamHub : public ReferenceCountedObject, public Thread
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<StateStreamHub>;
+    
+    // the time of the frame, and the removal, reset and header of the changes of a device
+    static constexpr int RECORD_RESERVE = 32;
+    
+    StateStreamHub(int listener) :
+    Thread("State stream server"),
+    listener_(listener)
+    {
+        startThread();
+    }
+    
+    ~StateStreamHub() override
+    {
+        stopThread(StateStreamServer::FRAME_INTERVAL_MS * 10);
+        connections_.clear();
+        Protocol::closeSocket(listener_);
+    }
+    
+    StreamedDevice* addDevice(const MidiDeviceInfo& info)
+    {
+        const ScopedLock lock(devicesLock_);
+        
+        // viewers identify the devices by their index, indices are reused once a removal was sent
+        auto index = 0;
+        while (std::any_of(devices_.begin(), devices_.end(), [index] (StreamedDevice* d) { return d->index_ == index; }))
+        {
+            ++index;
+        }
+        return devices_.add(new StreamedDevice(index, info));
+    }
+    
+    void removeDevice(StreamedDevice* device)
+    {
+        const ScopedLock lock(devicesLock_);
+        device->removed_ = true;
+    }
+    
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            acceptConnections();
+            sendFrames();
+            wait(StateStreamServer::FRAME_INTERVAL_MS);
+        }
+    }
+    
+    static Ptr& getStarted()
+    {
+        static Ptr started;
+        return started;
+    }
+    
+    static CriticalSection& getStartedLock()
+    {
+        static CriticalSection lock;
+        return lock;
+    }
+    
+private:
+    void acceptConnections()
+    {
+#if JUCE_LINUX || JUCE_MAC
+        int fd;
+        while ((fd = accept(listener_, nullptr, nullptr)) >= 0)
+        {
+            connections_.add(new StreamConnection(fd));
+        }
+#endif
+    }
+    
+    /** The changes of every device are collected once and handed to every connection. */
+    void sendFrames()
+    {
+        const ScopedLock lock(devicesLock_);
+        
+        for (auto device : devices_)
+        {
+            std::vector<int> changes;
+            bool reset;
+            {
+                const SpinLock::ScopedLockType device_lock(device->lock_);
+                changes.swap(device->changes_);
+                for (auto slot : changes)
+                {
+                    device->changed_[(size_t)slot] = false;
+                }
+                reset = device->reset_;
+                device->reset_ = false;
+            }
+            
+            for (auto connection : connections_)
+            {
+                updateView(*connection, *device, changes, reset);
+            }
+        }
+        
+        for (auto i = devices_.size(); --i >= 0;)
+        {
+            if (devices_[i]->removed_)
+            {
+                devices_.remove(i);
+            }
+        }
+        
+        for (auto i = connections_.size(); --i >= 0;)
+        {
+            if (!send(*connections_[i]))
+            {
+                connections_.remove(i);
+            }
+        }
+    }
+    
+    void updateView(StreamConnection& connection, StreamedDevice& device, const std::vector<int>& changes, bool reset)
+    {
+        auto existing = connection.devices_.find(device.index_);
+        if (device.removed_)
+        {
+            // the viewer is told with the next frame, unless it never heard of the device
+            if (existing != connection.devices_.end())
+            {
+                auto& view = existing->second;
+                if (view.announce_ && !view.remove_)
+                {
+                    connection.devices_.erase(existing);
+                    return;
+                }
+                view.clearDirty();
+                view.reset_ = false;
+                view.remove_ = true;
+                view.announce_ = false;
+            }
+            return;
+        }
+        
+        if (existing == connection.devices_.end() || existing->second.remove_)
+        {
+            // a new viewer or a new device, possibly reusing the index of a removed one, gets the whole state
+            auto& view = connection.devices_[device.index_];
+            view.announce_ = true;
+            
+            const SpinLock::ScopedLockType device_lock(device.lock_);
+            for (auto slot = 0; slot < Protocol::NUM_SLOTS; ++slot)
+            {
+                if (device.times_[(size_t)slot] != 0)
+                {
+                    view.markDirty(slot);
+                }
+            }
+            return;
+        }
+        
+        auto& view = existing->second;
+        if (reset)
+        {
+            view.clearDirty();
+            view.reset_ = true;
+        }
+        for (auto slot : changes)
+        {
+            view.markDirty(slot);
+        }
+    }
+    
+    /** Encodes what fits in a frame and sends it, returns false when the viewer went away. */
+    bool send(StreamConnection& connection)
+    {
+        // a viewer that doesn't keep up gets the latest values once it caught up
+        if (connection.unsentOffset_ >= connection.unsent_.getSize())
+        {
+            connection.unsent_.reset();
+            connection.unsentOffset_ = 0;
+            
+            MemoryOutputStream records;
+            encodeRecords(connection, records);
+            if (records.getDataSize() > 0)
+            {
+                auto now = (uint64)Time::currentTimeMillis();
+                MemoryOutputStream frame(connection.unsent_, false);
+                Protocol::writeVarint(frame, (uint64)records.getDataSize() + varintSize(now));
+                Protocol::writeVarint(frame, now);
+                frame.write(records.getData(), records.getDataSize());
+            }
+        }
+        
+#if JUCE_LINUX || JUCE_MAC
+        while (connection.unsentOffset_ < connection.unsent_.getSize())
+        {
+#ifdef MSG_NOSIGNAL
+            const int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+            const int flags = MSG_DONTWAIT;
+#endif
+            auto sent = ::send(connection.fd_, addBytesToPointer(connection.unsent_.getData(), connection.unsentOffset_),
+                               connection.unsent_.getSize() - connection.unsentOffset_, flags);
+            if (sent < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            connection.unsentOffset_ += (size_t)sent;
+        }
+#endif
+        return true;
+    }
+    
+    void encodeRecords(StreamConnection& connection, MemoryOutputStream& records)
+    {
+        const ScopedLock lock(devicesLock_);
+        
+        for (auto i = connection.devices_.begin(); i != connection.devices_.end();)
+        {
+            auto index = i->first;
+            auto& view = i->second;
+            auto device = findDevice(index);
+            
+            // the frame stays within its limit, the records of the other devices follow with the next one
+            auto announce_size = view.announce_ && device != nullptr ? getAnnounceSize(index, *device) : 0;
+            if (records.getDataSize() > 0 &&
+                records.getDataSize() + announce_size + RECORD_RESERVE > (size_t)StateStreamServer::MAX_FRAME_BYTES)
+            {
+                break;
+            }
+            
+            if (view.remove_)
+            {
+                Protocol::writeVarint(records, tag(index, Protocol::recordDeviceRemoved));
+                view.remove_ = false;
+                
+                // unless another device took its index
+                if (!view.announce_)
+                {
+                    i = connection.devices_.erase(i);
+                    continue;
+                }
+            }
+            
+            if (device == nullptr)
+            {
+                i = connection.devices_.erase(i);
+                continue;
+            }
+            
+            if (view.announce_)
+            {
+                Protocol::writeVarint(records, tag(index, Protocol::recordDeviceAdded));
+                Protocol::writeString(records, device->info_.identifier);
+                Protocol::writeString(records, device->info_.name);
+                view.announce_ = false;
+            }
+            
+            if (view.reset_)
+            {
+                Protocol::writeVarint(records, tag(index, Protocol::recordDeviceReset));
+                view.reset_ = false;
+            }
+            
+            encodeChanges(*device, view, records);
+            ++i;
+        }
+    }
+    
+    void encodeChanges(StreamedDevice& device, StreamConnection::DeviceView& view, MemoryOutputStream& records)
+    {
+        if (view.dirtySlots_.empty())
+        {
+            return;
+        }
+        
+        struct Change
+        {
+            int slot_;
+            uint32 value_;
+            int64 time_;
+        };
+        
+        std::vector<Change> changes;
+        changes.reserve(view.dirtySlots_.size());
+        {
+            const SpinLock::ScopedLockType device_lock(device.lock_);
+            for (auto slot : view.dirtySlots_)
+            {
+                changes.push_back({ slot, device.values_[(size_t)slot], device.times_[(size_t)slot] });
+            }
+        }
+        std::stable_sort(changes.begin(), changes.end(), [] (const Change& a, const Change& b) { return a.time_ < b.time_; });
+        
+        // the oldest changes go first, the others wait for the next frame
+        auto budget = (int64)StateStreamServer::MAX_FRAME_BYTES - (int64)records.getDataSize();
+        MemoryOutputStream entries;
+        size_t count = 0;
+        auto previous_time = changes.front().time_;
+        for (auto& change : changes)
+        {
+            auto size = varintSize((uint64)change.slot_) + varintSize(change.value_) + varintSize((uint64)(change.time_ - previous_time));
+            if ((int64)(entries.getDataSize() + size) > budget - RECORD_RESERVE)
+            {
+                break;
+            }
+            
+            Protocol::writeVarint(entries, (uint64)change.slot_);
+            Protocol::writeVarint(entries, change.value_);
+            Protocol::writeVarint(entries, (uint64)(change.time_ - previous_time));
+            previous_time = change.time_;
+            ++count;
+        }
+        
+        if (count == 0)
+        {
+            return;
+        }
+        
+        Protocol::writeVarint(records, tag(device.index_, Protocol::recordChanges));
+        Protocol::writeVarint(records, (uint64)count);
+        Protocol::writeVarint(records, (uint64)changes.front().time_);
+        records.write(entries.getData(), entries.getDataSize());
+        
+        view.clearDirty();
+        for (auto i = count; i < changes.size(); ++i)
+        {
+            view.markDirty(changes[i].slot_);
+        }
+    }
+    
+    StreamedDevice* findDevice(int index)
+    {
+        for (auto device : devices_)
+        {
+            if (device->index_ == index)
+            {
+                return device;
+            }
+        }
+        return nullptr;
+    }
+    
+    static uint64 tag(int index, Protocol::RecordType type)
+    {
+        return ((uint64)index << 2) | (uint64)type;
+    }
+    
+    static size_t getAnnounceSize(int index, const StreamedDevice& device)
+    {
+        auto identifier_size = device.info_.identifier.getNumBytesAsUTF8();
+        auto name_size = device.info_.name.getNumBytesAsUTF8();
+        return varintSize(tag(index, Protocol::recordDeviceAdded)) +
+               varintSize(identifier_size) + identifier_size +
+               varintSize(name_size) + name_size;
+    }
+    
+    static size_t varintSize(uint64 value)
+    {
+        size_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            ++size;
+        }
+        return size;
+    }
+    
+    const int listener_;
+    CriticalSection devicesLock_;
+    OwnedArray<StreamedDevice> devices_;
+    OwnedArray<StreamConnection> connections_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StateStreamHub)
+};
+
+bool StateStreamServer::start(const String& address)
+{
+    auto listener = Protocol::listenTo(address);
+    if (listener < 0)
+    {
+        return false;
+    }
+    
+    const ScopedLock lock(StateStreamHub::getStartedLock());
+    StateStreamHub::getStarted() = new StateStreamHub(listener);
+    return true;
+}
+
+void StateStreamServer::stop()
+{
+    const ScopedLock lock(StateStreamHub::getStartedLock());
+    StateStreamHub::getStarted() = nullptr;
+}
+
+bool StateStreamServer::startFromCommandLine(const StringArray& arguments)
+{
+    for (auto& argument : arguments)
+    {
+        if (argument == COMMAND_LINE_OPTION)
+        {
+            return start(Protocol::DEFAULT_ADDRESS);
+        }
+        if (argument.startsWith(String(COMMAND_LINE_OPTION) + "="))
+        {
+            return start(argument.fromFirstOccurrenceOf("=", false, false));
+        }
+    }
+    return true;
+}
+
+struct StateStreamServer::Tap::Pimpl
+{
+    Pimpl(const MidiDeviceInfo& info)
+    {
+        {
+            const ScopedLock lock(StateStreamHub::getStartedLock());
+            hub_ = StateStreamHub::getStarted();
+        }
+        
+        if (hub_ != nullptr)
+        {
+            device_ = hub_->addDevice(info);
+        }
+    }
+    
+    ~Pimpl()
+    {
+        if (device_ != nullptr)
+        {
+            hub_->removeDevice(device_);
+        }
+    }
+    
+    void add(const MidiMessage& msg, Time t)
+    {
+        uint32 value;
+        auto slot = Protocol::toSlot(msg, value);
+        if (device_ != nullptr && slot >= 0)
+        {
+            device_->set(slot, value, t.toMilliseconds());
+        }
+    }
+    
+    void addTempo(double bpm, Time t)
+    {
+        if (device_ != nullptr)
+        {
+            device_->set(Protocol::SLOT_TEMPO, (uint32)std::round(bpm * Protocol::TEMPO_SCALE), t.toMilliseconds());
+        }
+    }
+    
+    void reset()
+    {
+        if (device_ != nullptr)
+        {
+            device_->reset();
+        }
+    }
+    
+    StateStreamHub::Ptr hub_;
+    StreamedDevice* device_ { nullptr };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+StateStreamServer::Tap::Tap(const MidiDeviceInfo& i) : pimpl_(new Pimpl(i)) {}
+StateStreamServer::Tap::~Tap() = default;
+
+void StateStreamServer::Tap::add(const MidiMessage& m, Time t)          { pimpl_->add(m, t); }
+void StateStreamServer::Tap::addTempo(double b, Time t)                 { pimpl_->addTempo(b, t); }
+void StateStreamServer::Tap::reset()                                    { pimpl_->reset(); }
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Streams the changes to the state of the MIDI devices to viewers on other machines or processes.
+     *
+     * The changes are coalesced per slot and sent as compact deltas once per frame, a frame never
+     * exceeds MAX_FRAME_BYTES per viewer. Under a flood of MIDI data the slots that didn't fit are
+     * sent with the next frame, with their latest value, so the bandwidth stays bounded. Viewers
+     * that connect receive the current state first.
+     */
+    class StateStreamServer
+    {
+    public:
+        static constexpr const char* COMMAND_LINE_OPTION = "--stream-state";
+        static constexpr int FRAME_INTERVAL_MS = 33;
+        static constexpr int MAX_FRAME_BYTES = 2048;
+        
+        /** Listens for viewers, returns false when the address can't be listened to. */
+        static bool start(const String& address);
+        static void stop();
+        /** Starts streaming when the option is present, optionally followed by =address, returns false when that failed. */
+        static bool startFromCommandLine(const StringArray& arguments);
+        
+        /** Streams a device, it does nothing when streaming isn't started. */
+        class Tap
+        {
+        public:
+            Tap(const MidiDeviceInfo&);
+            ~Tap();
+            
+            /** Called from the thread that ingests the messages. */
+            void add(const MidiMessage&, Time);
+            void addTempo(double bpm, Time);
+            void reset();
+            
+            struct Pimpl;
+        private:
+            std::unique_ptr<Pimpl> pimpl_;
+            
+            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Tap)
+        };
+    };
+}
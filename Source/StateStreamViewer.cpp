@@ -0,0 +1,429 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "StateStreamViewer.h"
+
+#include "StateStreamProtocol.h"
+#include "StateStreamServer.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace showmidi
+{
+using Protocol = StateStreamProtocol;
+
+static CriticalSection devicesChangedLock;
+static std::function<void()> devicesChanged;
+
+/** Connects to a state stream and calls back the devices that are open. */
+class StateStreamClient : public ReferenceCountedObject, public Thread
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<StateStreamClient>;
+    
+    static constexpr int POLL_TIMEOUT_MS = 200;
+    static constexpr int READ_SIZE = 16384;
+    static constexpr int MAX_VARINT_SIZE = 10;
+    
+    StateStreamClient(const String& address) :
+    Thread("State stream viewer"),
+    address_(address)
+    {
+        startThread();
+    }
+    
+    ~StateStreamClient() override
+    {
+        stopThread(POLL_TIMEOUT_MS * 5);
+    }
+    
+    Array<MidiDeviceInfo> getDevices()
+    {
+        const ScopedLock lock(devicesLock_);
+        Array<MidiDeviceInfo> devices;
+        for (auto& device : devices_)
+        {
+            devices.add(device.second);
+        }
+        return devices;
+    }
+    
+    void setCallback(const String& identifier, StateStreamCallback* callback)
+    {
+        const ScopedLock lock(callbacksLock_);
+        if (callback != nullptr)
+        {
+            callbacks_[identifier] = callback;
+        }
+        else
+        {
+            callbacks_.erase(identifier);
+        }
+    }
+    
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            auto fd = Protocol::connectTo(address_);
+            if (fd < 0)
+            {
+                wait(StateStreamViewer::RECONNECT_INTERVAL_MS);
+                continue;
+            }
+            
+            receive(fd);
+            Protocol::closeSocket(fd);
+            
+            // the server sends everything again after reconnecting
+            received_.clear();
+            setDevices({});
+        }
+    }
+    
+    std::atomic<int64> bytesReceived_ { 0 };
+    std::atomic<int64> framesReceived_ { 0 };
+    
+private:
+    void receive(int fd)
+    {
+#if JUCE_LINUX || JUCE_MAC
+        uint8 buffer[READ_SIZE];
+        while (!threadShouldExit())
+        {
+            // the timeout only serves to notice that the thread should exit
+            pollfd descriptor { fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, POLL_TIMEOUT_MS) <= 0)
+            {
+                continue;
+            }
+            
+            auto count = read(fd, buffer, sizeof(buffer));
+            if (count <= 0)
+            {
+                return;
+            }
+            bytesReceived_ += count;
+            
+            received_.insert(received_.end(), buffer, buffer + count);
+            if (!parseFrames())
+            {
+                return;
+            }
+        }
+#else
+        ignoreUnused(fd);
+#endif
+    }
+    
+    /** Handles the frames that were received completely, returns false when the stream is corrupt. */
+    bool parseFrames()
+    {
+        auto data = (const uint8*)received_.data();
+        auto end = data + received_.size();
+        while (data < end)
+        {
+            auto frame = data;
+            uint64 size;
+            if (!Protocol::readVarint(frame, end, size))
+            {
+                break;
+            }
+            // the server never sends larger frames, a larger size is a corrupt or hostile stream
+            if (size > (uint64)StateStreamServer::MAX_FRAME_BYTES)
+            {
+                return false;
+            }
+            if (size > (uint64)(end - frame))
+            {
+                break;
+            }
+            
+            if (!parseFrame(frame, frame + size))
+            {
+                return false;
+            }
+            ++framesReceived_;
+            data = frame + size;
+        }
+        
+        // what's left is the start of a frame, which can't be longer than its size and the largest frame
+        if (end - data > StateStreamServer::MAX_FRAME_BYTES + MAX_VARINT_SIZE)
+        {
+            return false;
+        }
+        
+        received_.erase(received_.begin(), received_.begin() + (data - received_.data()));
+        return true;
+    }
+    
+    bool parseFrame(const uint8* data, const uint8* end)
+    {
+        uint64 sent;
+        if (!Protocol::readVarint(data, end, sent))
+        {
+            return false;
+        }
+        // the clocks of both machines don't need to agree, the times are relative to when the frame was sent
+        auto now = Time::currentTimeMillis();
+        auto clock_offset = now - (int64)sent;
+        
+        auto devices = devices_;
+        while (data < end)
+        {
+            uint64 tag;
+            if (!Protocol::readVarint(data, end, tag))
+            {
+                return false;
+            }
+            auto index = (int)(tag >> 2);
+            
+            switch ((Protocol::RecordType)(tag & 3))
+            {
+                case Protocol::recordDeviceAdded:
+                {
+                    String identifier, name;
+                    if (!Protocol::readString(data, end, identifier) || !Protocol::readString(data, end, name))
+                    {
+                        return false;
+                    }
+                    devices[index] = { name + " (remote)", StateStreamViewer::IDENTIFIER_PREFIX + identifier };
+                    
+                    // the complete state follows
+                    const ScopedLock lock(callbacksLock_);
+                    if (auto callback = findCallback(devices[index].identifier))
+                    {
+                        callback->handleStreamedReset();
+                    }
+                    break;
+                }
+                case Protocol::recordDeviceRemoved:
+                    devices.erase(index);
+                    break;
+                case Protocol::recordDeviceReset:
+                {
+                    const ScopedLock lock(callbacksLock_);
+                    if (auto callback = findCallback(getIdentifier(devices, index)))
+                    {
+                        callback->handleStreamedReset();
+                    }
+                    break;
+                }
+                case Protocol::recordChanges:
+                    if (!parseChanges(data, end, getIdentifier(devices, index), clock_offset, now))
+                    {
+                        return false;
+                    }
+                    break;
+            }
+        }
+        
+        setDevices(devices);
+        return true;
+    }
+    
+    bool parseChanges(const uint8*& data, const uint8* end, const String& identifier, int64 clockOffset, int64 now)
+    {
+        uint64 count, time;
+        if (!Protocol::readVarint(data, end, count) || !Protocol::readVarint(data, end, time))
+        {
+            return false;
+        }
+        
+        const ScopedLock lock(callbacksLock_);
+        auto callback = findCallback(identifier);
+        for (uint64 i = 0; i < count; ++i)
+        {
+            uint64 slot, value, delta;
+            if (!Protocol::readVarint(data, end, slot) || !Protocol::readVarint(data, end, value) || !Protocol::readVarint(data, end, delta) ||
+                slot >= (uint64)Protocol::NUM_SLOTS)
+            {
+                return false;
+            }
+            time += delta;
+            
+            if (callback == nullptr)
+            {
+                continue;
+            }
+            
+            auto t = Time(std::min(now, (int64)time + clockOffset));
+            if (slot == (uint64)Protocol::SLOT_TEMPO)
+            {
+                callback->handleStreamedTempo((double)value / Protocol::TEMPO_SCALE, t);
+            }
+            else
+            {
+                callback->handleStreamedMessage(Protocol::toMessage((int)slot, (uint32)value), t);
+            }
+        }
+        return true;
+    }
+    
+    static String getIdentifier(const std::map<int, MidiDeviceInfo>& devices, int index)
+    {
+        auto device = devices.find(index);
+        return device != devices.end() ? device->second.identifier : String();
+    }
+    
+    StateStreamCallback* findCallback(const String& identifier)
+    {
+        auto callback = callbacks_.find(identifier);
+        return callback != callbacks_.end() ? callback->second : nullptr;
+    }
+    
+    void setDevices(const std::map<int, MidiDeviceInfo>& devices)
+    {
+        {
+            const ScopedLock lock(devicesLock_);
+            if (devices == devices_)
+            {
+                return;
+            }
+            devices_ = devices;
+        }
+        
+        const ScopedLock lock(devicesChangedLock);
+        if (devicesChanged)
+        {
+            devicesChanged();
+        }
+    }
+    
+    const String address_;
+    std::vector<uint8> received_;
+    
+    CriticalSection devicesLock_;
+    std::map<int, MidiDeviceInfo> devices_;
+    
+    // held while calling back, so that an input that's destroyed is never called again
+    CriticalSection callbacksLock_;
+    std::map<String, StateStreamCallback*> callbacks_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StateStreamClient)
+};
+
+static CriticalSection startedLock;
+static StateStreamClient::Ptr started;
+
+static StateStreamClient::Ptr getStarted()
+{
+    const ScopedLock lock(startedLock);
+    return started;
+}
+
+bool StateStreamViewer::start(const String& address)
+{
+    if (!Protocol::isAvailable())
+    {
+        return false;
+    }
+    
+    const ScopedLock lock(startedLock);
+    started = new StateStreamClient(address);
+    return true;
+}
+
+void StateStreamViewer::stop()
+{
+    StateStreamClient::Ptr client;
+    {
+        const ScopedLock lock(startedLock);
+        client.swap(started);
+    }
+}
+
+bool StateStreamViewer::startFromCommandLine(const StringArray& arguments)
+{
+    for (auto& argument : arguments)
+    {
+        if (argument == COMMAND_LINE_OPTION)
+        {
+            return start(Protocol::DEFAULT_ADDRESS);
+        }
+        if (argument.startsWith(String(COMMAND_LINE_OPTION) + "="))
+        {
+            return start(argument.fromFirstOccurrenceOf("=", false, false));
+        }
+    }
+    return true;
+}
+
+Array<MidiDeviceInfo> StateStreamViewer::getAvailableDevices()
+{
+    auto client = getStarted();
+    return client != nullptr ? client->getDevices() : Array<MidiDeviceInfo>();
+}
+
+bool StateStreamViewer::isStreamDevice(const String& identifier)
+{
+    return identifier.startsWith(IDENTIFIER_PREFIX);
+}
+
+void StateStreamViewer::setDevicesChangedCallback(std::function<void()> callback)
+{
+    const ScopedLock lock(devicesChangedLock);
+    devicesChanged = std::move(callback);
+}
+
+StateStreamViewer::Statistics StateStreamViewer::getStatistics()
+{
+    Statistics statistics;
+    if (auto client = getStarted())
+    {
+        statistics.bytesReceived_ = client->bytesReceived_;
+        statistics.framesReceived_ = client->framesReceived_;
+    }
+    return statistics;
+}
+
+struct StateStreamViewer::Input::Pimpl
+{
+    Pimpl(StateStreamClient::Ptr client, const String& identifier, StateStreamCallback* callback) :
+    client_(client),
+    identifier_(identifier)
+    {
+        client_->setCallback(identifier_, callback);
+    }
+    
+    ~Pimpl()
+    {
+        client_->setCallback(identifier_, nullptr);
+    }
+    
+    StateStreamClient::Ptr client_;
+    const String identifier_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+StateStreamViewer::Input::Input(std::unique_ptr<Pimpl> pimpl) : pimpl_(std::move(pimpl)) {}
+StateStreamViewer::Input::~Input() = default;
+
+std::unique_ptr<StateStreamViewer::Input> StateStreamViewer::openDevice(const String& identifier, StateStreamCallback* callback)
+{
+    auto client = getStarted();
+    if (client == nullptr)
+    {
+        return nullptr;
+    }
+    return std::make_unique<Input>(std::make_unique<Input::Pimpl>(client, identifier, callback));
+}
+}
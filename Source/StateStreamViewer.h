@@ -0,0 +1,85 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    class StateStreamCallback
+    {
+    public:
+        virtual ~StateStreamCallback() = default;
+        
+        /** Called on the viewer thread, the time is translated to the local clock. */
+        virtual void handleStreamedMessage(const MidiMessage&, Time) = 0;
+        virtual void handleStreamedTempo(double bpm, Time) = 0;
+        virtual void handleStreamedReset() = 0;
+    };
+    
+    /**
+     * Receives the state stream of another ShowMIDI and lists its devices next to the local ones.
+     *
+     * The changes are turned back into the messages that caused them, so that the device state
+     * reconstructs the channels the same way it does for a MIDI input. The viewer keeps trying
+     * to connect until it's stopped, and the remote devices disappear while it's disconnected.
+     */
+    class StateStreamViewer
+    {
+    public:
+        static constexpr const char* COMMAND_LINE_OPTION = "--view-stream";
+        static constexpr const char* IDENTIFIER_PREFIX = "stream:";
+        static constexpr int RECONNECT_INTERVAL_MS = 1000;
+        
+        /** Starts connecting in the background, returns false when streams aren't supported. */
+        static bool start(const String& address);
+        static void stop();
+        /** Starts viewing when the option is present, optionally followed by =address, returns false when that failed. */
+        static bool startFromCommandLine(const StringArray& arguments);
+        
+        static Array<MidiDeviceInfo> getAvailableDevices();
+        static bool isStreamDevice(const String& identifier);
+        /** Called on the viewer thread when remote devices appeared or disappeared. */
+        static void setDevicesChangedCallback(std::function<void()>);
+        
+        struct Statistics
+        {
+            int64 bytesReceived_ { 0 };
+            int64 framesReceived_ { 0 };
+        };
+        static Statistics getStatistics();
+        
+        /** A remote device that calls back with its changes until it's destroyed. */
+        class Input
+        {
+        public:
+            ~Input();
+            
+            struct Pimpl;
+            Input(std::unique_ptr<Pimpl>);
+            
+        private:
+            std::unique_ptr<Pimpl> pimpl_;
+            
+            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Input)
+        };
+        
+        /** Returns nullptr when the viewer isn't started. */
+        static std::unique_ptr<Input> openDevice(const String& identifier, StateStreamCallback*);
+    };
+}
@@ -177,6 +177,24 @@ namespace showmidi
         float y = 0.0f, i = 0.0f, q = 0.0f, alpha = 0.0f;
     };
 
+    bool Theme::operator==(const Theme& other) const
+    {
+        return colorBackground == other.colorBackground &&
+               colorSidebar == other.colorSidebar &&
+               colorSeperator == other.colorSeperator &&
+               colorTrack == other.colorTrack &&
+               colorLabel == other.colorLabel &&
+               colorData == other.colorData &&
+               colorPositive == other.colorPositive &&
+               colorNegative == other.colorNegative &&
+               colorController == other.colorController;
+    }
+    
+    bool Theme::operator!=(const Theme& other) const
+    {
+        return !(*this == other);
+    }
+    
     void Theme::randomize()
     {
         colorBackground = randomColor();
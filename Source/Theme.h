@@ -41,6 +41,9 @@ namespace showmidi
         void reset();
         
         static String convertSvgColor(const String&);
+        
+        bool operator==(const Theme&) const;
+        bool operator!=(const Theme&) const;
 
         Colour colorBackground;
         Colour colorSidebar;
@@ -0,0 +1,119 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ThemedDrawables.h"
+
+namespace showmidi
+{
+struct ThemedDrawables::Pimpl
+{
+    // colour pickers and scale changes only ever leave a handful of stale entries behind each,
+    // start over when they add up
+    static constexpr size_t MAX_ENTRIES = 256;
+    // scales are matched to a hundredth
+    static constexpr float SCALE_PRECISION = 100.0f;
+    
+    using Key = std::tuple<const char*, uint32, int>;
+    
+    Pimpl() = default;
+    
+    void drawAt(Graphics& g, const Asset& asset, Colour colour, float x, float y)
+    {
+        auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        
+        Image image;
+        {
+            const ScopedLock lock(lock_);
+            image = getImage(asset, colour, scale);
+        }
+        
+        if (image.isValid())
+        {
+            g.drawImageTransformed(image, AffineTransform::scale(1.0f / scale).translated(x, y));
+        }
+    }
+    
+    Image getImage(const Asset& asset, Colour colour, float scale)
+    {
+        Key key { asset.data_, colour.getARGB(), roundToInt(scale * SCALE_PRECISION) };
+        auto it = images_.find(key);
+        if (it != images_.end())
+        {
+            return it->second;
+        }
+        
+        if (images_.size() >= MAX_ENTRIES)
+        {
+            images_.clear();
+        }
+        
+        auto image = rasterize(asset, colour, scale);
+        images_[key] = image;
+        return image;
+    }
+    
+    Image rasterize(const Asset& asset, Colour colour, float scale)
+    {
+        auto& source = drawables_[asset.data_];
+        if (source == nullptr)
+        {
+            source = Drawable::createFromImageData(asset.data_, (size_t)asset.size_);
+            if (source == nullptr)
+            {
+                return {};
+            }
+        }
+        
+        auto drawable = source->createCopy();
+        drawable->replaceColour(Colours::black, colour);
+        
+        // the image starts at the drawable's origin, this keeps the position identical to drawAt
+        auto bounds = drawable->getDrawableBounds();
+        auto width = (int)std::ceil(bounds.getRight() * scale);
+        auto height = (int)std::ceil(bounds.getBottom() * scale);
+        if (width <= 0 || height <= 0)
+        {
+            return {};
+        }
+        
+        Image image(Image::ARGB, width, height, true);
+        Graphics g(image);
+        g.addTransform(AffineTransform::scale(scale));
+        drawable->draw(g, 1.0f);
+        
+        return image;
+    }
+    
+    void clear()
+    {
+        const ScopedLock lock(lock_);
+        images_.clear();
+    }
+    
+    CriticalSection lock_;
+    std::map<const char*, std::unique_ptr<Drawable>> drawables_;
+    std::map<Key, Image> images_;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+ThemedDrawables::ThemedDrawables() : pimpl_(new Pimpl()) {}
+ThemedDrawables::~ThemedDrawables() = default;
+
+void ThemedDrawables::drawAt(Graphics& g, const Asset& a, Colour c, float x, float y)  { pimpl_->drawAt(g, a, c, x, y); }
+void ThemedDrawables::clear()                                                           { pimpl_->clear(); }
+}
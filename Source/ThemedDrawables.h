@@ -0,0 +1,56 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Process-wide cache of the SVG assets, recoloured and rasterized for the display scale.
+     *
+     * Use it through SharedResourcePointer, all components and plugin instances then share the
+     * same entries. Entries are keyed by asset, colour and scale, so theme and DPI changes simply
+     * lead to new entries. The cache starts over once too many stale entries have piled up.
+     */
+    class ThemedDrawables
+    {
+    public:
+        /** An SVG asset in BinaryData, black is replaced by the requested colour. */
+        struct Asset
+        {
+            const char* data_;
+            int size_;
+        };
+        
+        ThemedDrawables();
+        ~ThemedDrawables();
+        
+        /** Draws an asset with its origin at the position, at the physical scale of the graphics context. */
+        void drawAt(Graphics&, const Asset&, Colour, float, float);
+        
+        /** Discards all the recoloured and rasterized assets. */
+        void clear();
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThemedDrawables)
+    };
+}
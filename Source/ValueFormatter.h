@@ -0,0 +1,107 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "Settings.h"
+
+namespace showmidi
+{
+    /**
+     * Formats MIDI numbers and notes as the settings ask for, so that the device views,
+     * the message log and the terminal all present them the same way.
+     *
+     * It's a plain copy of the settings, it can be handed to threads that mustn't read them live.
+     */
+    struct ValueFormatter
+    {
+        NumberFormat numberFormat_ { Settings::DEFAULT_NUMBER_FORMAT };
+        NoteFormat noteFormat_ { Settings::DEFAULT_NOTE_FORMAT };
+        int octaveMiddleC_ { Settings::DEFAULT_OCTAVE_MIDDLE_C };
+        
+        static ValueFormatter fromSettings(Settings& settings)
+        {
+            ValueFormatter formatter;
+            formatter.numberFormat_ = settings.getNumberFormat();
+            formatter.noteFormat_ = settings.getNoteFormat();
+            formatter.octaveMiddleC_ = settings.getOctaveMiddleC();
+            return formatter;
+        }
+        
+        static String output7BitAsHex(int v)
+        {
+            return String::toHexString(v).paddedLeft('0', 2).toUpperCase() + "H";
+        }
+        
+        static String output14BitAsHex(int v)
+        {
+            return String::toHexString(v).paddedLeft('0', 4).toUpperCase() + "H";
+        }
+        
+        static String outputBpm(double bpm)
+        {
+            return String(bpm, 1);
+        }
+        
+        String output7Bit(int v) const
+        {
+            if (numberFormat_ == NumberFormat::formatHexadecimal)
+            {
+                return output7BitAsHex(v);
+            }
+            else
+            {
+                return String(v);
+            }
+        }
+        
+        String output14Bit(int v) const
+        {
+            if (numberFormat_ == NumberFormat::formatHexadecimal)
+            {
+                return output14BitAsHex(v);
+            }
+            else
+            {
+                return String(v);
+            }
+        }
+        
+        String outputNote(int noteNumber) const
+        {
+            if (noteFormat_ == NoteFormat::formatNumber)
+            {
+                return output7Bit(noteNumber);
+            }
+            else
+            {
+                return MidiMessage::getMidiNoteName(noteNumber, true, true, octaveMiddleC_);
+            }
+        }
+        
+        bool operator==(const ValueFormatter& other) const
+        {
+            return numberFormat_ == other.numberFormat_ &&
+                   noteFormat_ == other.noteFormat_ &&
+                   octaveMiddleC_ == other.octaveMiddleC_;
+        }
+        
+        bool operator!=(const ValueFormatter& other) const { return !(*this == other); }
+    };
+}
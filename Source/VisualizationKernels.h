@@ -0,0 +1,254 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ChannelState.h"
+#include "LayoutConstants.h"
+
+namespace showmidi
+{
+    /**
+     * Rectangles collected per layer and colour, so that a whole frame of indicators and
+     * graphs is filled with a single call per colour.
+     *
+     * Layers are filled from the bottom up, whatever the order the rectangles were added in.
+     * Within a layer, colours are filled in the order they were first added, rectangles of
+     * different colours in the same layer are expected not to overlap.
+     */
+    class RectangleBatch
+    {
+    public:
+        enum Layer
+        {
+            /** The backgrounds of bars, graphs and rolls. */
+            layerTrack = 0,
+            /** The values, over the tracks. */
+            layerIndicator,
+            /** The center lines of bidirectional graphs, over the values. */
+            layerSeparator,
+            numLayers
+        };
+        
+        void add(Layer layer, Colour colour, int x, int y, int width, int height)
+        {
+            if (width <= 0 || height <= 0)
+            {
+                return;
+            }
+            
+            getRectangles(layer, colour).addWithoutMerging({ x, y, width, height });
+        }
+        
+        void fill(Graphics& g) const
+        {
+            for (auto& layer : layers_)
+            {
+                for (size_t i = 0; i < layer.used_; ++i)
+                {
+                    g.setColour(layer.spans_[i].colour_);
+                    g.fillRectList(layer.spans_[i].rectangles_);
+                }
+            }
+        }
+        
+        /** Empties the batch, the storage is kept for the next frame. */
+        void clear()
+        {
+            for (auto& layer : layers_)
+            {
+                for (size_t i = 0; i < layer.used_; ++i)
+                {
+                    layer.spans_[i].rectangles_.clear();
+                }
+                layer.used_ = 0;
+            }
+        }
+        
+        int getNumRectangles() const
+        {
+            int result = 0;
+            for (auto& layer : layers_)
+            {
+                for (size_t i = 0; i < layer.used_; ++i)
+                {
+                    result += layer.spans_[i].rectangles_.getNumRectangles();
+                }
+            }
+            return result;
+        }
+        
+    private:
+        RectangleList<int>& getRectangles(Layer layerIndex, Colour colour)
+        {
+            auto& layer = layers_[layerIndex];
+            
+            // only a handful of colours are in use, a linear search is the fastest
+            for (size_t i = 0; i < layer.used_; ++i)
+            {
+                if (layer.spans_[i].colour_ == colour)
+                {
+                    return layer.spans_[i].rectangles_;
+                }
+            }
+            
+            if (layer.used_ == layer.spans_.size())
+            {
+                layer.spans_.emplace_back();
+            }
+            
+            auto& span = layer.spans_[layer.used_++];
+            span.colour_ = colour;
+            return span.rectangles_;
+        }
+        
+        struct Span
+        {
+            Colour colour_;
+            RectangleList<int> rectangles_;
+        };
+        
+        struct Spans
+        {
+            std::vector<Span> spans_;
+            size_t used_ { 0 };
+        };
+        
+        Spans layers_[numLayers];
+    };
+    
+    /** How a value is visualized, shared by all the kernels. */
+    struct VisualizationStyle
+    {
+        int centerValue_;
+        int maxValue_;
+        Colour colourPositive_;
+        Colour colourNegative_;
+        Colour colourTrack_;
+        Colour colourSeparator_;
+        // graphs scroll by one pixel per time unit
+        int timeUnitMs_;
+    };
+    
+    /** Batches the indicator of a bar, bidirectional bars grow from the center. */
+    template <bool Bidirectional>
+    struct BarKernel
+    {
+        static void batch(RectangleBatch& batch, const VisualizationStyle& style, const Rectangle<int>& area, int value)
+        {
+            constexpr int height = layout::HEIGHT_INDICATOR;
+            
+            auto left = area.getX();
+            auto top = area.getY();
+            auto width = area.getWidth();
+            
+            batch.add(RectangleBatch::layerTrack, style.colourTrack_, left, top, width, height);
+            
+            if constexpr (Bidirectional)
+            {
+                auto range = width / 2;
+                auto indicator_width = (range * (value - style.centerValue_)) / style.centerValue_;
+                if (value >= style.centerValue_)
+                {
+                    batch.add(RectangleBatch::layerIndicator, style.colourPositive_, left + range + 1, top, indicator_width, height);
+                }
+                else
+                {
+                    batch.add(RectangleBatch::layerIndicator, style.colourNegative_, left + range + indicator_width, top, -indicator_width, height);
+                }
+            }
+            else
+            {
+                auto indicator_width = (width * value) / style.maxValue_;
+                batch.add(RectangleBatch::layerIndicator, value >= style.centerValue_ ? style.colourPositive_ : style.colourNegative_,
+                          left, top, indicator_width, height);
+            }
+        }
+    };
+    
+    /**
+     * Batches the history graph of a value, from the current value back in time until
+     * the graph is filled. Bidirectional graphs grow from a center line.
+     */
+    template <bool Bidirectional>
+    struct GraphKernel
+    {
+        static void batch(RectangleBatch& batch, const VisualizationStyle& style, const Rectangle<int>& area, int64 graphTime,
+                          const TimedValue& current, const std::vector<TimedValue>& history)
+        {
+            batch.add(RectangleBatch::layerTrack, style.colourTrack_, area.getX(), area.getY(), area.getWidth(), area.getHeight());
+            
+            auto total_width = 0;
+            auto center_line = false;
+            batchEntry(batch, style, area, graphTime, current, total_width, center_line);
+            for (auto& tv : history)
+            {
+                if (total_width >= area.getWidth())
+                {
+                    break;
+                }
+                batchEntry(batch, style, area, graphTime, tv, total_width, center_line);
+            }
+        }
+        
+        static void batchEntry(RectangleBatch& batch, const VisualizationStyle& style, const Rectangle<int>& area, int64 graphTime,
+                               const TimedValue& tv, int& totalWidth, bool& centerLine)
+        {
+            auto graph_left = area.getX();
+            auto graph_top = area.getY();
+            auto graph_width = area.getWidth();
+            auto graph_height = area.getHeight();
+            
+            auto entry_width = std::min(graph_width - totalWidth, int(graphTime - tv.time_.toMilliseconds()) / style.timeUnitMs_ - totalWidth);
+            if (entry_width <= 0)
+            {
+                return;
+            }
+            
+            auto entry_left = graph_left + graph_width - entry_width - totalWidth;
+            totalWidth += entry_width;
+            
+            if constexpr (Bidirectional)
+            {
+                auto range = graph_height / 2;
+                if (!centerLine)
+                {
+                    batch.add(RectangleBatch::layerSeparator, style.colourSeparator_, graph_left, graph_top + range, graph_width, layout::HEIGHT_INDICATOR);
+                    centerLine = true;
+                }
+                
+                auto entry_height = std::abs(graph_height * (tv.value_ - style.centerValue_)) / (style.maxValue_ - 1);
+                if (tv.value_ >= style.centerValue_)
+                {
+                    batch.add(RectangleBatch::layerIndicator, style.colourPositive_, entry_left, graph_top + range - entry_height, entry_width, entry_height);
+                }
+                else
+                {
+                    batch.add(RectangleBatch::layerIndicator, style.colourNegative_, entry_left, graph_top + range + 1, entry_width, entry_height);
+                }
+            }
+            else
+            {
+                auto entry_height = (graph_height * tv.value_) / style.maxValue_;
+                batch.add(RectangleBatch::layerIndicator, tv.value_ >= style.centerValue_ ? style.colourPositive_ : style.colourNegative_,
+                          entry_left, graph_top + graph_height - entry_height, entry_width, entry_height);
+            }
+        }
+    };
+}
@@ -0,0 +1,354 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "MidiCaptureRecorder.h"
+#include "MidiDeviceInfoComparator.h"
+#include "MidiDeviceState.h"
+#include "MidiFileReplay.h"
+#include "SharedStatePublisher.h"
+#include "StateStreamServer.h"
+#include "StateStreamViewer.h"
+#include "TerminalRenderer.h"
+#include "TerminalScreen.h"
+
+#include <csignal>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace showmidi;
+
+namespace
+{
+    constexpr int FRAME_INTERVAL_MS = 50;
+    constexpr int IDLE_FRAME_INTERVAL_MS = 250;
+    constexpr int DEVICE_SCAN_INTERVAL_MS = 1000;
+    constexpr int MIN_DEVICE_COLUMNS = 40;
+    constexpr int64 SCRUB_STEP_MS = 1000;
+    
+    volatile std::sig_atomic_t quitRequested = 0;
+    volatile std::sig_atomic_t resizeRequested = 0;
+    
+    void handleQuitSignal(int)
+    {
+        quitRequested = 1;
+    }
+    
+    void handleResizeSignal(int)
+    {
+        resizeRequested = 1;
+    }
+    
+    /** Puts the terminal in raw mode for single key presses, and restores it afterwards. */
+    class RawTerminalMode
+    {
+    public:
+        RawTerminalMode()
+        {
+            enabled_ = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &original_) == 0;
+            if (enabled_)
+            {
+                auto raw = original_;
+                raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+                raw.c_cc[VMIN] = 0;
+                raw.c_cc[VTIME] = 0;
+                tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+            }
+        }
+        
+        ~RawTerminalMode()
+        {
+            if (enabled_)
+            {
+                tcsetattr(STDIN_FILENO, TCSANOW, &original_);
+            }
+        }
+        
+    private:
+        termios original_ {};
+        bool enabled_ { false };
+    };
+    
+    struct TerminalDevice
+    {
+        TerminalDevice(const MidiDeviceInfo& info, const TerminalSettings& settings) :
+        state_(info),
+        renderer_(state_, settings)
+        {
+        }
+        
+        MidiDeviceState state_;
+        TerminalRenderer renderer_;
+    };
+    
+    void printUsage()
+    {
+        std::cout << "Usage: showmidi-tui [options]" << std::endl
+                  << std::endl
+                  << "Shows the MIDI activity of all input devices in the terminal." << std::endl
+                  << std::endl
+                  << "Options:" << std::endl
+                  << "  --timeout <seconds>  Hide values that haven't changed for this long, 0 never hides them (default " << Settings::DEFAULT_TIMEOUT_DELAY << ")" << std::endl
+                  << "  --hex                Show numbers as hexadecimal" << std::endl
+                  << "  --note-numbers       Show notes as numbers instead of names" << std::endl
+                  << "  --octave <number>    The octave of middle C (default " << Settings::DEFAULT_OCTAVE_MIDDLE_C << ")" << std::endl
+                  << "  --publish-state      Publish the state in POSIX shared memory as /showmidi, --publish-state=<name> picks another name" << std::endl
+                  << "  --stream-state       Stream the state to viewers, --stream-state=<address> listens to unix:<path> or tcp:<host>:<port>" << std::endl
+                  << "  --view-stream        Show the devices of a state stream, --view-stream=<address> connects to another address" << std::endl
+                  << "  --record             Record every message into a capture file per device, --record=<directory> picks where" << std::endl
+                  << "  --replay=<file>      Play a standard MIDI file as a device, the option can be repeated" << std::endl
+                  << "  --replay-speed=<n>   Replay n times faster, max replays as fast as possible (default 1)" << std::endl
+                  << "  --help               Show this help" << std::endl
+                  << std::endl
+                  << "Keys: p pauses and resumes, [ and ] scrub back and forth while paused, r resets the displayed data, q quits." << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    TerminalSettings settings;
+    
+    StringArray args;
+    for (auto i = 1; i < argc; ++i)
+    {
+        args.add(argv[i]);
+    }
+    for (auto i = 0; i < args.size(); ++i)
+    {
+        auto& arg = args[i];
+        if (arg == "--timeout" && i + 1 < args.size())
+        {
+            settings.timeoutDelay_ = jmax(0, args[++i].getIntValue());
+        }
+        else if (arg == "--hex")
+        {
+            settings.format_.numberFormat_ = NumberFormat::formatHexadecimal;
+        }
+        else if (arg == "--note-numbers")
+        {
+            settings.format_.noteFormat_ = NoteFormat::formatNumber;
+        }
+        else if (arg == "--octave" && i + 1 < args.size())
+        {
+            settings.format_.octaveMiddleC_ = args[++i].getIntValue();
+        }
+        else if (arg.startsWith(SharedStatePublisher::COMMAND_LINE_OPTION) ||
+                 arg.startsWith(StateStreamServer::COMMAND_LINE_OPTION) ||
+                 arg.startsWith(StateStreamViewer::COMMAND_LINE_OPTION) ||
+                 arg.startsWith(MidiCaptureRecorder::COMMAND_LINE_OPTION) ||
+                 arg.startsWith(MidiFileReplay::COMMAND_LINE_OPTION))
+        {
+            // started below, before any device is created
+        }
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    
+    // the MIDI devices deliver on their own threads, no message loop or windowing system is needed
+    ScopedJuceInitialiser_GUI juce_initialiser;
+    
+    if (!SharedStatePublisher::startFromCommandLine(args))
+    {
+        std::cerr << "The MIDI state couldn't be published in shared memory" << std::endl;
+        return 1;
+    }
+    if (SharedStatePublisher::getName().isNotEmpty())
+    {
+        std::cerr << "The MIDI state is published in shared memory as " << SharedStatePublisher::getName() << std::endl;
+    }
+    
+    if (!StateStreamServer::startFromCommandLine(args))
+    {
+        std::cerr << "The MIDI state stream couldn't be started" << std::endl;
+        return 1;
+    }
+    
+    if (!StateStreamViewer::startFromCommandLine(args))
+    {
+        std::cerr << "The MIDI state stream couldn't be viewed" << std::endl;
+        return 1;
+    }
+    
+    if (!MidiCaptureRecorder::startFromCommandLine(args))
+    {
+        std::cerr << "The MIDI data couldn't be recorded" << std::endl;
+        return 1;
+    }
+    
+    if (!MidiFileReplay::startFromCommandLine(args))
+    {
+        std::cerr << "The MIDI files to replay couldn't be found" << std::endl;
+        return 1;
+    }
+    
+    std::signal(SIGINT, handleQuitSignal);
+    std::signal(SIGTERM, handleQuitSignal);
+    std::signal(SIGWINCH, handleResizeSignal);
+    
+    RawTerminalMode raw_mode;
+    TerminalScreen screen;
+    screen.updateSize();
+    screen.open();
+    
+    OwnedArray<TerminalDevice> devices;
+    auto last_scan = (int64)0;
+    auto last_render = (int64)0;
+    auto force_render = true;
+    auto scrub_offset = (int64)0;
+    
+    while (!quitRequested)
+    {
+        auto now = Time::currentTimeMillis();
+        
+        if (now - last_scan >= DEVICE_SCAN_INTERVAL_MS)
+        {
+            last_scan = now;
+            
+            auto available = MidiInput::getAvailableDevices();
+            available.addArray(StateStreamViewer::getAvailableDevices());
+            available.addArray(MidiFileReplay::getAvailableDevices());
+            MidiDeviceInfoComparator comparator;
+            available.sort(comparator);
+            
+            for (auto i = devices.size(); --i >= 0;)
+            {
+                if (!available.contains(devices[i]->state_.getDeviceInfo()))
+                {
+                    devices.remove(i);
+                    force_render = true;
+                }
+            }
+            for (auto i = 0; i < available.size(); ++i)
+            {
+                auto& info = available.getReference(i);
+                auto existing = std::find_if(devices.begin(), devices.end(), [&info] (TerminalDevice* d) { return d->state_.getDeviceInfo() == info; });
+                if (existing == devices.end())
+                {
+                    devices.insert(i, new TerminalDevice(info, settings));
+                    force_render = true;
+                }
+            }
+        }
+        
+        auto visible = jlimit(1, jmax(1, devices.size()), screen.getColumns() / MIN_DEVICE_COLUMNS);
+        for (auto i = 0; i < visible && i < devices.size(); ++i)
+        {
+            force_render |= devices[i]->renderer_.update();
+        }
+        
+        if (resizeRequested)
+        {
+            resizeRequested = 0;
+            force_render |= screen.updateSize();
+        }
+        
+        // timed out values have to disappear too, so idle frames are still rendered at a lower rate
+        if (force_render || now - last_render >= IDLE_FRAME_INTERVAL_MS)
+        {
+            force_render = false;
+            last_render = now;
+            
+            screen.clear(settings.theme_.colorBackground);
+            
+            if (devices.isEmpty())
+            {
+                screen.print(1, 0, screen.getColumns() - 1, "No MIDI input devices", settings.theme_.colorLabel);
+            }
+            else
+            {
+                auto width = screen.getColumns() / visible;
+                for (auto i = 0; i < visible; ++i)
+                {
+                    auto column = i * width;
+                    if (i > 0)
+                    {
+                        for (auto row = 0; row < screen.getRows(); ++row)
+                        {
+                            screen.fill(column - 1, row, 1, 0x2502, settings.theme_.colorSeperator, settings.theme_.colorBackground);
+                        }
+                    }
+                    devices[i]->renderer_.render(screen, column + 1, width - 2);
+                }
+            }
+            
+            screen.flush();
+        }
+        
+        pollfd input { STDIN_FILENO, POLLIN, 0 };
+        if (poll(&input, 1, FRAME_INTERVAL_MS) > 0 && (input.revents & POLLIN))
+        {
+            char key = 0;
+            while (read(STDIN_FILENO, &key, 1) == 1)
+            {
+                switch (key)
+                {
+                    case 'q':
+                    case 'Q':
+                        quitRequested = 1;
+                        break;
+                    case 'p':
+                    case 'P':
+                        for (auto device : devices)
+                        {
+                            device->state_.setPaused(!device->state_.isPaused());
+                        }
+                        scrub_offset = 0;
+                        break;
+                    case '[':
+                    case ']':
+                    {
+                        // while paused, scrub through the timeline a second at a time
+                        auto length = (int64)0;
+                        for (auto device : devices)
+                        {
+                            length = jmax(length, device->state_.getTimelineLength());
+                        }
+                        scrub_offset = jlimit(-length, (int64)0, scrub_offset + (key == '[' ? -SCRUB_STEP_MS : SCRUB_STEP_MS));
+                        for (auto device : devices)
+                        {
+                            device->state_.scrubTo(scrub_offset);
+                        }
+                        break;
+                    }
+                    case 'r':
+                    case 'R':
+                        for (auto device : devices)
+                        {
+                            device->state_.resetChannelData();
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                force_render = true;
+            }
+        }
+    }
+    
+    screen.close();
+    SharedStatePublisher::stop();
+    StateStreamServer::stop();
+    StateStreamViewer::stop();
+    MidiCaptureRecorder::stop();
+    MidiFileReplay::stop();
+    return 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "TerminalRenderer.h"
+
+#include "MidiDeviceState.h"
+#include "TerminalScreen.h"
+
+namespace showmidi
+{
+struct TerminalRenderer::Pimpl
+{
+    static constexpr int X_INDENT = 2;
+    static constexpr int LABEL_WIDTH = 10;
+    static constexpr int DATA_WIDTH = 6;
+    static constexpr int SYSEX_DATA_WIDTH = 4;
+    
+    Pimpl(MidiDeviceState& state, const TerminalSettings& settings) :
+    state_(state),
+    settings_(settings),
+    theme_(settings.theme_),
+    format_(settings.format_)
+    {
+        state_.setTimeoutDelay(settings_.timeoutDelay_);
+    }
+    
+    bool update()
+    {
+        // only take a new snapshot when the state changed, so the locks are rarely contended
+        if (!state_.consumeChange())
+        {
+            return false;
+        }
+        
+        state_.copyChannels(channels_);
+        return true;
+    }
+    
+    void render(TerminalScreen& screen, int column, int width)
+    {
+        screen_ = &screen;
+        column_ = column;
+        width_ = width;
+        row_ = 0;
+        
+        const auto t = state_.getCurrentTime();
+        
+        auto row = nextRow();
+        auto port_name = state_.getDeviceInfo().name + String(state_.isPaused() ? " (paused)" : "");
+        screen_->print(column_, row, width_, port_name, theme_.colorData, true);
+        switch (state_.getDeviceStatus())
+        {
+            case DeviceStatus::deviceOpening:
+                screen_->printRight(column_, row, width_, "OPENING", theme_.colorLabel);
+                break;
+            case DeviceStatus::deviceFailed:
+                screen_->printRight(column_, row, width_, "FAILED TO OPEN", theme_.colorNegative);
+                break;
+            case DeviceStatus::deviceTimedOut:
+                screen_->printRight(column_, row, width_, "NOT RESPONDING", theme_.colorNegative);
+                break;
+            default:
+                break;
+        }
+        
+        renderClock(t, channels_.clock_);
+        
+        if (isLive(t, channels_.sysex_.time_))
+        {
+            renderSysex(channels_.sysex_);
+        }
+        
+        updateChannelOrder(t);
+        for (auto channel_index : channelOrder_)
+        {
+            renderChannel(t, channels_.channel_[channel_index]);
+        }
+    }
+    
+    int nextRow()
+    {
+        return row_++;
+    }
+    
+    bool isLive(const Time& t, const Time& messageTime) const
+    {
+        return messageTime.toMilliseconds() != 0 &&
+               (settings_.timeoutDelay_ == 0 || (t - messageTime).inMilliseconds() < settings_.timeoutDelay_ * 1000);
+    }
+    
+    /** Newly active channels are shown first, like in the device view. */
+    void updateChannelOrder(const Time& t)
+    {
+        for (auto channel_index = 0; channel_index < 16; ++channel_index)
+        {
+            auto& channel = channels_.channel_[channel_index];
+            auto live = isLive(t, channel.time_) || MidiDeviceState::hasHeldNotes(channel);
+            if (live != channelVisible_[channel_index])
+            {
+                if (live)
+                {
+                    channelOrder_.insert(channelOrder_.begin(), channel_index);
+                }
+                else
+                {
+                    channelOrder_.erase(std::find(channelOrder_.begin(), channelOrder_.end(), channel_index));
+                }
+                channelVisible_[channel_index] = live;
+            }
+        }
+    }
+    
+    void renderClock(const Time& t, const Clock& clock)
+    {
+        auto show_bpm = isLive(t, clock.timeBpm_);
+        auto show_start = isLive(t, clock.timeStart_);
+        auto show_continue = isLive(t, clock.timeContinue_);
+        auto show_stop = isLive(t, clock.timeStop_);
+        if (!show_bpm && !show_start && !show_continue && !show_stop)
+        {
+            return;
+        }
+        
+        nextRow();
+        auto row = nextRow();
+        screen_->print(column_, row, width_, "CLOCK", theme_.colorData, true);
+        if (show_bpm)
+        {
+            screen_->print(column_ + LABEL_WIDTH, row, width_ - LABEL_WIDTH, "BPM " + String(clock.bpm_, 1), theme_.colorController);
+        }
+        
+        if (show_start)
+        {
+            screen_->printRight(column_, row, width_, "START", theme_.colorPositive);
+        }
+        else if (show_continue)
+        {
+            screen_->printRight(column_, row, width_, "CONT", theme_.colorPositive);
+        }
+        else if (show_stop)
+        {
+            screen_->printRight(column_, row, width_, "STOP", theme_.colorNegative);
+        }
+    }
+    
+    void renderSysex(const Sysex& sysex)
+    {
+        nextRow();
+        auto row = nextRow();
+        screen_->print(column_, row, width_, "SYSEX", theme_.colorData, true);
+        screen_->printRight(column_, row, width_, format_.output14Bit(sysex.length_), theme_.colorLabel);
+        
+        auto per_row = std::max(1, (width_ - X_INDENT) / SYSEX_DATA_WIDTH);
+        auto length = std::min(sysex.length_, Sysex::MAX_SYSEX_DATA);
+        for (auto i = 0; i < length; i += per_row)
+        {
+            row = nextRow();
+            for (auto j = i; j < i + per_row && j < length; ++j)
+            {
+                screen_->printRight(column_ + X_INDENT + (j - i) * SYSEX_DATA_WIDTH, row, SYSEX_DATA_WIDTH,
+                                    format_.output7Bit(sysex.data_[j]), theme_.colorData);
+            }
+        }
+    }
+    
+    void renderChannel(const Time& t, ActiveChannel& channel)
+    {
+        nextRow();
+        auto row = nextRow();
+        screen_->print(column_, row, width_, "CH " + format_.output7Bit(channel.number_ + 1), theme_.colorData, true);
+        if (channel.mpeMember_ != MpeMember::mpeNone)
+        {
+            String mpe_label = channel.mpeManager_ ? "MGR" : (channel.mpeMember_ == MpeMember::mpeLower ? "LZ" : "UZ");
+            screen_->print(column_ + LABEL_WIDTH, row, width_ - LABEL_WIDTH, "MPE " + mpe_label, theme_.colorLabel);
+        }
+        if (isLive(t, channel.programChange_.current_.time_))
+        {
+            screen_->printRight(column_, row, width_, "PRGM " + format_.output7Bit(channel.programChange_.current_.value_), theme_.colorLabel);
+        }
+        
+        if (isLive(t, channel.pitchBend_.current_.time_))
+        {
+            auto value = channel.pitchBend_.current_.value_;
+            auto colour = value > 0x2000 ? theme_.colorPositive : (value < 0x2000 ? theme_.colorNegative : theme_.colorLabel);
+            renderValue("PB", colour, format_.output14Bit(value), value, 0x2000, 0x3fff, true, theme_.colorPositive, theme_.colorNegative);
+        }
+        
+        renderParameters(t, "HRCC", channel.hrccs_);
+        renderParameters(t, "RPN", channel.rpns_);
+        renderParameters(t, "NRPN", channel.nrpns_);
+        
+        renderNotes(t, channel);
+        
+        if (isLive(t, channel.channelPressure_.current_.time_))
+        {
+            auto value = channel.channelPressure_.current_.value_;
+            renderValue("CP", theme_.colorController, format_.output7Bit(value), value, 0x40, 0x7f, false, theme_.colorController, theme_.colorController);
+        }
+        
+        if (isLive(t, channel.controlChanges_.time_))
+        {
+            for (auto& control_change : channel.controlChanges_.controlChange_)
+            {
+                if (isLive(t, control_change.current_.time_))
+                {
+                    auto value = control_change.current_.value_;
+                    renderValue("CC " + format_.output7Bit(control_change.number_), theme_.colorController, format_.output7Bit(value),
+                                value, 0x40, 0x7f, false, theme_.colorController, theme_.colorController);
+                }
+            }
+        }
+    }
+    
+    void renderParameters(const Time& t, const String& name, Parameters& parameters)
+    {
+        if (!isLive(t, parameters.time_))
+        {
+            return;
+        }
+        
+        for (auto& entry : parameters.param_)
+        {
+            auto& param = entry.second;
+            if (isLive(t, param.current_.time_))
+            {
+                auto value = param.current_.value_;
+                renderValue(name + " " + format_.output14Bit(entry.first), theme_.colorController, format_.output14Bit(value),
+                            value, 0x2000, 0x3fff, false, theme_.colorController, theme_.colorController);
+            }
+        }
+    }
+    
+    void renderNotes(const Time& t, ActiveChannel& channel)
+    {
+        auto& notes = channel.notes_;
+        if (!isLive(t, notes.time_) && !MidiDeviceState::hasHeldNotes(channel))
+        {
+            return;
+        }
+        
+        for (auto i = 0; i < 128; ++i)
+        {
+            auto& note_on = notes.noteOn_[i];
+            auto& note_off = notes.noteOff_[i];
+            
+            // held notes never time out
+            auto note_on_live = MidiDeviceState::isHeld(note_on, note_off) || isLive(t, note_on.current_.time_);
+            auto note_off_live = isLive(t, note_off.current_.time_);
+            auto polypressure_live = isLive(t, note_on.polyPressure_.current_.time_);
+            auto note_colour = note_off_live ? theme_.colorNegative : theme_.colorPositive;
+            
+            if (note_on_live)
+            {
+                auto velocity = note_on.current_.value_;
+                renderValue(format_.outputNote(i) + " ON", note_colour, format_.output7Bit(velocity), velocity, 0, 0x7f, false, theme_.colorPositive, theme_.colorPositive);
+            }
+            if (polypressure_live)
+            {
+                auto value = note_on.polyPressure_.current_.value_;
+                renderValue(format_.outputNote(i) + " PP", theme_.colorLabel, format_.output7Bit(value), value, 0x40, 0x7f, false, note_colour, note_colour);
+            }
+            if (note_off_live)
+            {
+                auto velocity = note_off.current_.value_;
+                renderValue(format_.outputNote(i) + " OFF", note_colour, format_.output7Bit(velocity), velocity, 0, 0x7f, false, theme_.colorNegative, theme_.colorNegative);
+            }
+        }
+    }
+    
+    /** A row with a label, its value, and a bar for the rest of the width. */
+    void renderValue(const String& label, Colour labelColour, const String& data,
+                     int value, int centerValue, int maxValue, bool bidirectional,
+                     Colour colourPositive, Colour colourNegative)
+    {
+        auto row = nextRow();
+        auto x = column_ + X_INDENT;
+        screen_->print(x, row, LABEL_WIDTH, label, labelColour);
+        x += LABEL_WIDTH;
+        screen_->printRight(x, row, DATA_WIDTH, data, theme_.colorData);
+        x += DATA_WIDTH + 1;
+        
+        auto bar_width = column_ + width_ - x;
+        if (bar_width <= 0)
+        {
+            return;
+        }
+        screen_->fill(x, row, bar_width, ' ', theme_.colorTrack, theme_.colorTrack);
+        
+        if (!bidirectional)
+        {
+            renderBar(x, row, bar_width, (float)value / (float)maxValue, colourPositive);
+            return;
+        }
+        
+        auto half = bar_width / 2;
+        if (value >= centerValue)
+        {
+            renderBar(x + half, row, bar_width - half, (float)(value - centerValue) / (float)(maxValue - centerValue), colourPositive);
+        }
+        else
+        {
+            // there are no left aligned partial blocks, negative values grow by half cells
+            auto halves = roundToInt(2.0f * half * (float)(centerValue - value) / (float)centerValue);
+            screen_->fill(x + half - halves / 2, row, halves / 2, 0x2588, colourNegative, theme_.colorTrack);
+            if (halves % 2 == 1)
+            {
+                screen_->fill(x + half - halves / 2 - 1, row, 1, 0x2590, colourNegative, theme_.colorTrack);
+            }
+        }
+    }
+    
+    /** Fills a bar with full blocks and ends it with an eighth block for the remainder. */
+    void renderBar(int x, int row, int width, float level, Colour colour)
+    {
+        auto eighths = roundToInt(jlimit(0.0f, 1.0f, level) * (float)width * 8.0f);
+        screen_->fill(x, row, eighths / 8, 0x2588, colour, theme_.colorTrack);
+        if (eighths % 8 != 0)
+        {
+            // U+2589 is seven eighths, down to U+258F for one eighth
+            screen_->fill(x + eighths / 8, row, 1, (juce_wchar)(0x2590 - eighths % 8), colour, theme_.colorTrack);
+        }
+    }
+    
+    MidiDeviceState& state_;
+    const TerminalSettings settings_;
+    const Theme theme_;
+    const ValueFormatter format_;
+    
+    ActiveChannels channels_;
+    std::vector<int> channelOrder_;
+    bool channelVisible_[16] {};
+    
+    TerminalScreen* screen_ { nullptr };
+    int column_ { 0 };
+    int width_ { 0 };
+    int row_ { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+TerminalRenderer::TerminalRenderer(MidiDeviceState& s, const TerminalSettings& t) : pimpl_(new Pimpl(s, t)) {}
+TerminalRenderer::~TerminalRenderer() = default;
+
+bool TerminalRenderer::update()                                   { return pimpl_->update(); }
+void TerminalRenderer::render(TerminalScreen& s, int c, int w)    { pimpl_->render(s, c, w); }
+}
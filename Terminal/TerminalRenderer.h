@@ -0,0 +1,60 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "Settings.h"
+#include "ValueFormatter.h"
+
+namespace showmidi
+{
+    class MidiDeviceState;
+    class TerminalScreen;
+    
+    /** The display settings of the terminal front end, it doesn't read the settings of the GUI. */
+    struct TerminalSettings
+    {
+        int timeoutDelay_ { Settings::DEFAULT_TIMEOUT_DELAY };
+        ValueFormatter format_;
+        Theme theme_ { THEME_DARK };
+    };
+    
+    /**
+     * Renders the state of a device as text, with the same content as the device view:
+     * clock, sysex, and per channel the program change, pitch bend, parameters, notes,
+     * pressure and control changes. Values are drawn as bars of block characters.
+     */
+    class TerminalRenderer
+    {
+    public:
+        TerminalRenderer(MidiDeviceState&, const TerminalSettings&);
+        ~TerminalRenderer();
+        
+        /** Takes a new snapshot of the state when it changed since the last update, returns true if it did. */
+        bool update();
+        /** Renders the last snapshot into a column of the screen. */
+        void render(TerminalScreen&, int column, int width);
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TerminalRenderer)
+    };
+}
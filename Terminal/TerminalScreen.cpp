@@ -0,0 +1,231 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "TerminalScreen.h"
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace showmidi
+{
+struct TerminalScreen::Pimpl
+{
+    static constexpr int DEFAULT_COLUMNS = 80;
+    static constexpr int DEFAULT_ROWS = 24;
+    
+    Pimpl() = default;
+    
+    void open()
+    {
+        // alternate screen, hidden cursor, no line wrapping
+        output_ += "\x1b[?1049h\x1b[?25l\x1b[?7l";
+        invalidate();
+        write();
+    }
+    
+    void close()
+    {
+        output_ += "\x1b[0m\x1b[?7h\x1b[?25h\x1b[?1049l";
+        write();
+    }
+    
+    bool updateSize()
+    {
+        auto columns = DEFAULT_COLUMNS;
+        auto rows = DEFAULT_ROWS;
+        
+        winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0)
+        {
+            columns = size.ws_col;
+            rows = size.ws_row;
+        }
+        
+        if (columns == columns_ && rows == rows_)
+        {
+            return false;
+        }
+        
+        columns_ = columns;
+        rows_ = rows;
+        cells_.assign((size_t)(columns_ * rows_), TerminalCell());
+        invalidate();
+        return true;
+    }
+    
+    /** Forgets what the terminal shows, the next flush writes every cell. */
+    void invalidate()
+    {
+        shown_.assign(cells_.size(), TerminalCell { 0, 0, 0, false });
+        output_ += "\x1b[0m\x1b[2J";
+        cursorColumn_ = -1;
+        cursorRow_ = -1;
+        styleValid_ = false;
+    }
+    
+    TerminalCell* getCell(int column, int row)
+    {
+        if (column < 0 || row < 0 || column >= columns_ || row >= rows_)
+        {
+            return nullptr;
+        }
+        return &cells_[(size_t)(row * columns_ + column)];
+    }
+    
+    void clear(Colour background)
+    {
+        cells_.assign(cells_.size(), TerminalCell { ' ', background.getARGB(), background.getARGB(), false });
+    }
+    
+    void print(int column, int row, int width, const String& text, Colour foreground, bool bold)
+    {
+        auto characters = text.getCharPointer();
+        for (auto i = 0; i < width && !characters.isEmpty(); ++i)
+        {
+            auto character = characters.getAndAdvance();
+            if (auto cell = getCell(column + i, row))
+            {
+                cell->character_ = character;
+                cell->foreground_ = foreground.getARGB();
+                cell->bold_ = bold;
+            }
+        }
+    }
+    
+    void printRight(int column, int row, int width, const String& text, Colour foreground, bool bold)
+    {
+        auto length = text.length();
+        if (length > width)
+        {
+            print(column, row, width, text.getLastCharacters(width), foreground, bold);
+        }
+        else
+        {
+            print(column + width - length, row, length, text, foreground, bold);
+        }
+    }
+    
+    void fill(int column, int row, int width, juce_wchar character, Colour foreground, Colour background)
+    {
+        for (auto i = 0; i < width; ++i)
+        {
+            if (auto cell = getCell(column + i, row))
+            {
+                *cell = { character, foreground.getARGB(), background.getARGB(), false };
+            }
+        }
+    }
+    
+    void flush()
+    {
+        for (auto row = 0; row < rows_; ++row)
+        {
+            for (auto column = 0; column < columns_; ++column)
+            {
+                auto index = (size_t)(row * columns_ + column);
+                auto& cell = cells_[index];
+                if (cell == shown_[index])
+                {
+                    continue;
+                }
+                
+                if (row != cursorRow_ || column != cursorColumn_)
+                {
+                    output_ += "\x1b[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+                }
+                writeStyle(cell);
+                appendUTF8(cell.character_);
+                
+                shown_[index] = cell;
+                cursorRow_ = row;
+                cursorColumn_ = column + 1;
+            }
+        }
+        
+        write();
+    }
+    
+    void writeStyle(const TerminalCell& cell)
+    {
+        if (styleValid_ && cell.foreground_ == style_.foreground_ && cell.background_ == style_.background_ && cell.bold_ == style_.bold_)
+        {
+            return;
+        }
+        
+        Colour foreground(cell.foreground_);
+        Colour background(cell.background_);
+        output_ += std::string("\x1b[") + (cell.bold_ ? "1" : "22") +
+                   ";38;2;" + std::to_string(foreground.getRed()) + ";" + std::to_string(foreground.getGreen()) + ";" + std::to_string(foreground.getBlue()) +
+                   ";48;2;" + std::to_string(background.getRed()) + ";" + std::to_string(background.getGreen()) + ";" + std::to_string(background.getBlue()) + "m";
+        style_ = cell;
+        styleValid_ = true;
+    }
+    
+    void appendUTF8(juce_wchar character)
+    {
+        char buffer[8];
+        auto length = CharPointer_UTF8::getBytesRequiredFor(character);
+        CharPointer_UTF8 pointer(buffer);
+        pointer.write(character);
+        output_.append(buffer, length);
+    }
+    
+    void write()
+    {
+        auto data = output_.data();
+        auto remaining = output_.size();
+        while (remaining > 0)
+        {
+            auto written = ::write(STDOUT_FILENO, data, remaining);
+            if (written <= 0)
+            {
+                break;
+            }
+            data += written;
+            remaining -= (size_t)written;
+        }
+        output_.clear();
+    }
+    
+    int columns_ { 0 };
+    int rows_ { 0 };
+    std::vector<TerminalCell> cells_;
+    std::vector<TerminalCell> shown_;
+    std::string output_;
+    
+    int cursorColumn_ { -1 };
+    int cursorRow_ { -1 };
+    TerminalCell style_;
+    bool styleValid_ { false };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
+};
+
+TerminalScreen::TerminalScreen() : pimpl_(new Pimpl()) {}
+TerminalScreen::~TerminalScreen() = default;
+
+void TerminalScreen::open()                                                                         { pimpl_->open(); }
+void TerminalScreen::close()                                                                        { pimpl_->close(); }
+bool TerminalScreen::updateSize()                                                                   { return pimpl_->updateSize(); }
+int TerminalScreen::getColumns() const                                                              { return pimpl_->columns_; }
+int TerminalScreen::getRows() const                                                                 { return pimpl_->rows_; }
+void TerminalScreen::clear(Colour b)                                                                { pimpl_->clear(b); }
+void TerminalScreen::print(int c, int r, int w, const String& t, Colour f, bool b)                  { pimpl_->print(c, r, w, t, f, b); }
+void TerminalScreen::printRight(int c, int r, int w, const String& t, Colour f, bool b)             { pimpl_->printRight(c, r, w, t, f, b); }
+void TerminalScreen::fill(int c, int r, int w, juce_wchar ch, Colour f, Colour b)                   { pimpl_->fill(c, r, w, ch, f, b); }
+void TerminalScreen::flush()                                                                        { pimpl_->flush(); }
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /** A character cell of the terminal with its colours. */
+    struct TerminalCell
+    {
+        juce_wchar character_ { ' ' };
+        uint32 foreground_ { 0 };
+        uint32 background_ { 0 };
+        bool bold_ { false };
+        
+        bool operator==(const TerminalCell& other) const
+        {
+            return character_ == other.character_ &&
+                   foreground_ == other.foreground_ &&
+                   background_ == other.background_ &&
+                   bold_ == other.bold_;
+        }
+        
+        bool operator!=(const TerminalCell& other) const { return !(*this == other); }
+    };
+    
+    /**
+     * A grid of character cells that is drawn into and then flushed to the terminal.
+     *
+     * The cells that were written by the previous flush are kept, flushing only moves the
+     * cursor to the cells that changed and only emits the colours when they change, so an
+     * unchanged frame writes nothing at all.
+     */
+    class TerminalScreen
+    {
+    public:
+        TerminalScreen();
+        ~TerminalScreen();
+        
+        /** Switches to the alternate screen and hides the cursor. */
+        void open();
+        /** Restores the screen and the cursor the terminal had before opening. */
+        void close();
+        
+        /** Matches the grid to the size of the terminal, returns true when it changed. */
+        bool updateSize();
+        int getColumns() const;
+        int getRows() const;
+        
+        void clear(Colour background);
+        /** Writes text from a cell onwards, clipped to the given width. */
+        void print(int column, int row, int width, const String& text, Colour foreground, bool bold = false);
+        /** Writes text that ends at the last cell of the given width. */
+        void printRight(int column, int row, int width, const String& text, Colour foreground, bool bold = false);
+        void fill(int column, int row, int width, juce_wchar character, Colour foreground, Colour background);
+        
+        /** Writes the cells that changed since the last flush. */
+        void flush();
+        
+        struct Pimpl;
+    private:
+        std::unique_ptr<Pimpl> pimpl_;
+        
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TerminalScreen)
+    };
+}
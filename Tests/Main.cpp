@@ -0,0 +1,68 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "RawMidiBenchmark.h"
+#include "VisualizationBenchmark.h"
+
+#include <iostream>
+
+using namespace showmidi;
+
+namespace
+{
+    constexpr const char* TEST_CATEGORY = "ShowMIDI";
+}
+
+/**
+ * Runs the unit tests, or the benchmark that is named on the command line.
+ * Returns a non-zero exit code when a test failed, so that ctest reports it.
+ */
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juce_initialiser;
+    
+    StringArray args;
+    for (auto i = 1; i < argc; ++i)
+    {
+        args.add(argv[i]);
+    }
+    
+    if (args.contains(RawMidiBenchmark::COMMAND_LINE_OPTION))
+    {
+        std::cout << RawMidiBenchmark::run();
+        return 0;
+    }
+    
+    if (args.contains(VisualizationBenchmark::COMMAND_LINE_OPTION))
+    {
+        std::cout << VisualizationBenchmark::run();
+        return 0;
+    }
+    
+    UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory(TEST_CATEGORY);
+    
+    auto failures = 0;
+    for (auto i = 0; i < runner.getNumResults(); ++i)
+    {
+        failures += runner.getResult(i)->failures;
+    }
+    return failures > 0 ? 1 : 0;
+}
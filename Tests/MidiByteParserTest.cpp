@@ -0,0 +1,132 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "RawMidiInput.h"
+
+namespace showmidi
+{
+namespace
+{
+    /** Keeps the bytes and the times of the parsed messages. */
+    struct ParsedMessages : public RawMidiInputCallback
+    {
+        void handleRawMidiMessage(const MidiMessage& msg, Time t) override
+        {
+            messages_.push_back(std::vector<uint8>(msg.getRawData(), msg.getRawData() + msg.getRawDataSize()));
+            times_.push_back(t.toMilliseconds());
+        }
+        
+        std::vector<std::vector<uint8>> messages_;
+        std::vector<int64> times_;
+    };
+}
+
+/** Locks in how a raw MIDI byte stream is split into messages. */
+class MidiByteParserTest : public UnitTest
+{
+public:
+    MidiByteParserTest() : UnitTest("MIDI byte parser", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Running status continues across reads");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 0x90, 60, 100, 62 }, 1);
+            parse(parser, parsed, { 90, 64 }, 2);
+            parse(parser, parsed, { 0 }, 3);
+            
+            expectMessages(parsed, { { 0x90, 60, 100 }, { 0x90, 62, 90 }, { 0x90, 64, 0 } });
+            // a message takes the time of its first byte
+            expect(parsed.times_ == std::vector<int64> { 1, 1, 2 });
+        }
+        
+        beginTest("Real-time bytes inside a channel message are delivered before it");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 0xb0, 0xf8, 7, 0xfe, 100, 0xf8, 8, 0xfa, 50 }, 1);
+            
+            expectMessages(parsed, { { 0xf8 }, { 0xfe }, { 0xb0, 7, 100 }, { 0xf8 }, { 0xfa }, { 0xb0, 8, 50 } });
+        }
+        
+        beginTest("Real-time bytes inside a sysex leave it intact");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 0xf0, 0x7e, 0xf8, 0x7f }, 1);
+            parse(parser, parsed, { 0x06, 0xfe, 0x01, 0xf7 }, 2);
+            
+            expectMessages(parsed, { { 0xf8 }, { 0xfe }, { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 } });
+            expectEquals(parsed.times_.back(), (int64)1);
+        }
+        
+        beginTest("A sysex that is cut off by a status byte is dropped");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 0xf0, 0x7e, 0x7f, 0x80, 60, 0, 0xf7, 0x90, 61, 90 }, 1);
+            
+            expectMessages(parsed, { { 0x80, 60, 0 }, { 0x90, 61, 90 } });
+        }
+        
+        beginTest("System common messages are complete after one or two bytes and cancel running status");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 0x90, 60, 100, 0xf6, 61, 90 }, 1);
+            parse(parser, parsed, { 0xf1, 0x23, 0x45, 0xf3, 5, 6 }, 2);
+            parse(parser, parsed, { 0xf2, 0x10, 0x20, 0x30 }, 3);
+            
+            expectMessages(parsed, { { 0x90, 60, 100 }, { 0xf6 }, { 0xf1, 0x23 }, { 0xf3, 5 }, { 0xf2, 0x10, 0x20 } });
+        }
+        
+        beginTest("Data without a status is ignored, also after a reset");
+        {
+            MidiByteParser parser;
+            ParsedMessages parsed;
+            parse(parser, parsed, { 60, 100, 0xc0, 5, 6 }, 1);
+            parser.reset();
+            parse(parser, parsed, { 7, 0xe0, 0x00, 0x40 }, 2);
+            
+            expectMessages(parsed, { { 0xc0, 5 }, { 0xc0, 6 }, { 0xe0, 0x00, 0x40 } });
+        }
+    }
+    
+private:
+    static void parse(MidiByteParser& parser, ParsedMessages& parsed, std::vector<uint8> bytes, int64 time)
+    {
+        parser.parse(bytes.data(), (int)bytes.size(), Time(time), parsed);
+    }
+    
+    void expectMessages(const ParsedMessages& parsed, const std::vector<std::vector<uint8>>& expected)
+    {
+        expectEquals((int)parsed.messages_.size(), (int)expected.size());
+        for (size_t i = 0; i < jmin(expected.size(), parsed.messages_.size()); ++i)
+        {
+            expect(parsed.messages_[i] == expected[i],
+                   "Message " + String((int)i) + " is " + String::toHexString(parsed.messages_[i].data(), (int)parsed.messages_[i].size()) +
+                   " instead of " + String::toHexString(expected[i].data(), (int)expected[i].size()));
+        }
+    }
+};
+
+static MidiByteParserTest midiByteParserTest;
+}
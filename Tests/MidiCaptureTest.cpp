@@ -0,0 +1,214 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "MidiCapture.h"
+#include "MidiCaptureRecorder.h"
+
+namespace showmidi
+{
+namespace
+{
+    struct Event
+    {
+        MidiMessage message_;
+        int64 time_;
+    };
+    
+    /** The events of a capture, and whether it ended in the middle of one. */
+    struct Capture
+    {
+        Capture(const File& file)
+        {
+            MidiCaptureReader reader(file);
+            valid_ = reader.isValid();
+            
+            MidiMessage msg;
+            int64 time;
+            while (reader.next(msg, time))
+            {
+                events_.push_back({ msg, time });
+                progress_.push_back(reader.getProgress());
+            }
+            truncated_ = reader.isTruncated();
+        }
+        
+        bool valid_ { false };
+        bool truncated_ { false };
+        std::vector<Event> events_;
+        std::vector<double> progress_;
+    };
+    
+    bool isSameMessage(const MidiMessage& a, const MidiMessage& b)
+    {
+        return a.getRawDataSize() == b.getRawDataSize() &&
+               std::memcmp(a.getRawData(), b.getRawData(), (size_t)a.getRawDataSize()) == 0;
+    }
+}
+
+/** Records a capture and reads it back whole, cut off and partially written. */
+class MidiCaptureTest : public UnitTest
+{
+public:
+    MidiCaptureTest() : UnitTest("MIDI capture", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Varints and zigzag encoding round trip");
+        {
+            const uint64 values[] = { 0, 1, 0x7f, 0x80, 0x3fff, 0x4000, (uint64)1 << 35, std::numeric_limits<uint64>::max() };
+            for (auto value : values)
+            {
+                uint8 bytes[10];
+                auto size = MidiCapture::writeVarint(bytes, value);
+                const uint8* data = bytes;
+                uint64 read;
+                expect(MidiCapture::readVarint(data, bytes + size, read) && read == value && data == bytes + size,
+                       String((int64)value) + " doesn't round trip");
+                
+                // a cut off varint isn't read
+                data = bytes;
+                expect(size == 1 || !MidiCapture::readVarint(data, bytes + size - 1, read));
+            }
+            
+            const int64 deltas[] = { 0, 1, -1, 1000, -1000, std::numeric_limits<int64>::max(), std::numeric_limits<int64>::min() };
+            for (auto delta : deltas)
+            {
+                expectEquals(MidiCapture::unzigzag(MidiCapture::zigzag(delta)), delta);
+            }
+            // small deltas of either sign take a single byte
+            expect(MidiCapture::zigzag(-63) < 0x80 && MidiCapture::zigzag(63) < 0x80);
+        }
+        
+        auto directory = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("showmidi-test", "");
+        if (!MidiCaptureRecorder::start(directory))
+        {
+            logMessage("Captures aren't available on this platform");
+            return;
+        }
+        
+        const uint8 sysex[] = { 0x7e, 0x7f, 0x06, 0x01 };
+        auto start = Time::currentTimeMillis() + 1000;
+        // irregular deltas, time going backwards and a gap of ten hours
+        const std::vector<Event> events = {
+            { MidiMessage::noteOn(1, 60, (uint8)100), start },
+            { MidiMessage::noteOn(1, 62, (uint8)90), start },
+            { MidiMessage::noteOn(1, 64, (uint8)80), start + 1 },
+            { MidiMessage::midiClock(), start + 2 },
+            { MidiMessage::noteOn(1, 65, (uint8)70), start + 7 },
+            { MidiMessage::createSysExMessage(sysex, (int)sizeof(sysex)), start + 1007 },
+            { MidiMessage::noteOff(1, 60, (uint8)0), start + 1005 },
+            { MidiMessage::controllerEvent(2, 7, 100), start + 1005 + (int64)10 * 60 * 60 * 1000 },
+            { MidiMessage::pitchWheel(3, 0x1234), start + 1006 + (int64)10 * 60 * 60 * 1000 }
+        };
+        
+        File file;
+        {
+            MidiCaptureRecorder::Track track(MidiDeviceInfo("Test", "showmidi-test"));
+            expect(track.isRecording());
+            file = track.getFile();
+            for (auto& event : events)
+            {
+                track.add(event.message_, Time(event.time_));
+            }
+        }
+        MidiCaptureRecorder::stop();
+        
+        MemoryBlock recorded;
+        file.loadFileAsData(recorded);
+        
+        beginTest("The delta-of-delta timestamps and running status are decoded");
+        {
+            Capture capture(file);
+            expect(capture.valid_);
+            expect(!capture.truncated_);
+            expectEvents(capture, events, events.size());
+            
+            MidiCaptureReader reader(file);
+            expectEquals(reader.getDeviceInfo().identifier, String("showmidi-test"));
+            expectEquals(reader.getDeviceInfo().name, String("Test"));
+        }
+        
+        // where each event ends, the events follow the header
+        auto header_size = MidiCapture::createHeader(MidiDeviceInfo("Test", "showmidi-test"), 0).getSize();
+        std::vector<size_t> ends;
+        for (auto progress : Capture(file).progress_)
+        {
+            ends.push_back(header_size + (size_t)std::round(progress * (double)(recorded.getSize() - header_size)));
+        }
+        
+        beginTest("A truncated capture is read up to its last complete event");
+        {
+            for (auto size = header_size; size < recorded.getSize(); ++size)
+            {
+                auto capture = readCopy(recorded, size, 0);
+                auto complete = (size_t)(std::upper_bound(ends.begin(), ends.end(), size) - ends.begin());
+                auto at_end = complete == 0 ? size == header_size : ends[complete - 1] == size;
+                
+                expect(capture.valid_);
+                expect(capture.truncated_ == !at_end, "A cut after " + String((int)size) + " bytes");
+                expectEvents(capture, events, complete);
+            }
+        }
+        
+        beginTest("A capture that was never closed ends at the first zero byte");
+        {
+            // the space that was preallocated and not written to yet
+            auto capture = readCopy(recorded, recorded.getSize(), 4096);
+            expect(!capture.truncated_);
+            expectEvents(capture, events, events.size());
+            
+            // the first byte of an event is written last, an event that is being written is left out
+            MemoryBlock partial(recorded);
+            partial[ends[ends.size() - 2]] = 0;
+            TemporaryFile copy(MidiCapture::FILE_EXTENSION);
+            copy.getFile().replaceWithData(partial.getData(), partial.getSize());
+            Capture partial_capture(copy.getFile());
+            expect(!partial_capture.truncated_);
+            expectEvents(partial_capture, events, events.size() - 1);
+        }
+        
+        directory.deleteRecursively();
+    }
+    
+private:
+    /** Reads a copy of the start of a capture, followed by zeros. */
+    static Capture readCopy(const MemoryBlock& data, size_t size, size_t zeros)
+    {
+        MemoryBlock copy(data.getData(), size);
+        copy.setSize(size + zeros, true);
+        
+        TemporaryFile file(MidiCapture::FILE_EXTENSION);
+        file.getFile().replaceWithData(copy.getData(), copy.getSize());
+        return Capture(file.getFile());
+    }
+    
+    void expectEvents(const Capture& capture, const std::vector<Event>& expected, size_t count)
+    {
+        expectEquals((int)capture.events_.size(), (int)count);
+        for (size_t i = 0; i < jmin(count, capture.events_.size()); ++i)
+        {
+            expect(isSameMessage(capture.events_[i].message_, expected[i].message_),
+                   capture.events_[i].message_.getDescription() + " was read instead of " + expected[i].message_.getDescription());
+            expectEquals(capture.events_[i].time_, expected[i].time_);
+        }
+    }
+};
+
+static MidiCaptureTest midiCaptureTest;
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "MidiEventLog.h"
+
+namespace showmidi
+{
+namespace
+{
+    /** The event with a sequence number can be recognized from its time and controller. */
+    MidiMessage createMessage(uint64 sequence)
+    {
+        return MidiMessage::controllerEvent(1 + (int)(sequence % 16), (int)(sequence / 16 % 128), (int)(sequence / 2048 % 128));
+    }
+}
+
+/** Locks in how the event log wraps around, clears and reads back what's left. */
+class MidiEventLogTest : public UnitTest
+{
+public:
+    MidiEventLogTest() : UnitTest("MIDI event log", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Nothing is logged until the log is enabled");
+        {
+            MidiEventLog log;
+            log.add(createMessage(0), 0);
+            expectEquals(log.getEnd(), (uint64)0);
+            
+            log.setEnabled(true);
+            log.add(createMessage(0), 0);
+            expectEquals(log.getEnd(), (uint64)1);
+        }
+        
+        auto log = std::make_unique<MidiEventLog>();
+        log->setEnabled(true);
+        
+        beginTest("The oldest events are overwritten once the capacity is used up");
+        {
+            const uint64 overwritten = 1000;
+            for (uint64 sequence = 0; sequence < MidiEventLog::CAPACITY + overwritten; ++sequence)
+            {
+                log->add(createMessage(sequence), (int64)sequence);
+            }
+            expectEquals(log->getEnd(), MidiEventLog::CAPACITY + overwritten);
+            expectEquals(log->getBegin(), overwritten);
+            
+            // a read of events that are gone starts at the oldest one that's left
+            expectRead(*log, 0, 10, overwritten, 10);
+            // across the end of the ring
+            expectRead(*log, MidiEventLog::CAPACITY - 5, 10, MidiEventLog::CAPACITY - 5, 10);
+            // up to the newest event
+            expectRead(*log, log->getEnd() - 3, 10, log->getEnd() - 3, 3);
+            expectRead(*log, log->getEnd(), 10, log->getEnd(), 0);
+        }
+        
+        beginTest("Clearing drops the events and the sequence numbers keep increasing");
+        {
+            auto end = log->getEnd();
+            log->clear();
+            expectEquals(log->getBegin(), end);
+            expectEquals(log->getEnd(), end);
+            expectRead(*log, 0, 10, end, 0);
+            
+            log->add(createMessage(end), (int64)end);
+            expectEquals(log->getBegin(), end);
+            expectRead(*log, 0, 10, end, 1);
+        }
+        
+        beginTest("Sysex messages keep their first bytes and their length");
+        {
+            const uint8 sysex[] = { 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00 };
+            log->add(MidiMessage::createSysExMessage(sysex, (int)sizeof(sysex)), 5);
+            
+            auto first = log->getEnd() - 1;
+            LoggedEvent event;
+            expectEquals(log->read(first, &event, 1), 1);
+            expect(event.isSysEx());
+            expectEquals((int)event.length_, (int)sizeof(sysex));
+            expectEquals((int)event.data_[1], 0x43);
+            expectEquals((int)event.data_[2], 0x10);
+            // the data is gone, the message is left out of exports
+            expectEquals(event.toMidiMessage().getSysExDataSize(), 0);
+        }
+    }
+    
+private:
+    /** Reads from a sequence number, and checks where the read started and what it copied. */
+    void expectRead(const MidiEventLog& log, uint64 first, int count, uint64 expectedFirst, int expectedCount)
+    {
+        std::vector<LoggedEvent> events((size_t)count);
+        auto copied = log.read(first, events.data(), count);
+        expectEquals(first, expectedFirst);
+        expectEquals(copied, expectedCount);
+        
+        for (auto i = 0; i < jmin(copied, expectedCount); ++i)
+        {
+            auto sequence = expectedFirst + (uint64)i;
+            expectEquals(events[(size_t)i].time_, (int64)sequence);
+            expect(events[(size_t)i].toMidiMessage().getDescription() == createMessage(sequence).getDescription(),
+                   "Event " + String((int64)sequence) + " was overwritten");
+        }
+    }
+};
+
+static MidiEventLogTest midiEventLogTest;
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "MidiExport.h"
+
+namespace showmidi
+{
+namespace
+{
+    // the largest delta of a standard MIDI file, longer gaps are bridged
+    constexpr int64 MAX_DELTA = 0x0fffffff;
+    
+    struct Event
+    {
+        MidiMessage message_;
+        int64 time_;
+    };
+    
+    class EventSource : public MidiExport::Source
+    {
+    public:
+        EventSource(const std::vector<Event>& events) :
+        events_(events)
+        {
+        }
+        
+        bool next(MidiMessage& msg, int64& time) override
+        {
+            if (next_ >= events_.size())
+            {
+                return false;
+            }
+            
+            msg = events_[next_].message_;
+            time = events_[next_].time_;
+            ++next_;
+            return true;
+        }
+        
+        double getProgress() const override
+        {
+            return events_.empty() ? 1.0 : (double)next_ / (double)events_.size();
+        }
+        
+    private:
+        const std::vector<Event>& events_;
+        size_t next_ { 0 };
+    };
+    
+    bool contains(const MemoryBlock& data, std::initializer_list<uint8> bytes)
+    {
+        std::vector<uint8> pattern(bytes);
+        auto begin = (const uint8*)data.getData();
+        auto end = begin + data.getSize();
+        return std::search(begin, end, pattern.begin(), pattern.end()) != end;
+    }
+}
+
+/** Reads the exported standard MIDI files back with JUCE and checks the bytes the readers are lenient about. */
+class MidiExportTest : public UnitTest
+{
+public:
+    MidiExportTest() : UnitTest("MIDI export", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        const uint8 sysex[] = { 0x7e, 0x7f, 0x06, 0x01 };
+        const int64 start = 1000000;
+        const std::vector<Event> events = {
+            { MidiMessage::noteOn(1, 60, (uint8)100), start },
+            { MidiMessage::noteOn(1, 64, (uint8)90), start + 10 },
+            { MidiMessage::noteOff(1, 60, (uint8)0), start + 20 },
+            { MidiMessage::controllerEvent(2, 7, 100), start + 30 },
+            { MidiMessage::createSysExMessage(sysex, (int)sizeof(sysex)), start + 40 },
+            { MidiMessage::noteOn(1, 67, (uint8)80), start + 50 },
+            { MidiMessage::noteOn(1, 72, (uint8)70), start + 60 + MAX_DELTA + 5 },
+            // JUCE doesn't read escaped system messages, they're last and checked in the bytes
+            { MidiMessage::midiClock(), start + 70 + MAX_DELTA + 5 }
+        };
+        const size_t escaped = 1;
+        
+        beginTest("Running status, sysex and a long gap are read back");
+        {
+            TemporaryFile file(".mid");
+            writeExport(events, file.getFile(), MidiExport::MAX_TRACK_SIZE);
+            MidiFile midi_file;
+            int type = 0;
+            FileInputStream in(file.getFile());
+            expect(midi_file.readFrom(in, false, &type), "The exported file can't be read");
+            expectEquals(type, 1);
+            expectEquals((int)midi_file.getTimeFormat(), MidiExport::TICKS_PER_QUARTER);
+            expectEquals(midi_file.getNumTracks(), 1);
+            
+            auto bridges = 0;
+            std::vector<Event> read;
+            for (auto event : *midi_file.getTrack(0))
+            {
+                auto& message = event->message;
+                if (message.isTextMetaEvent() && message.getTextFromTextMetaEvent().isEmpty())
+                {
+                    ++bridges;
+                }
+                if (!message.isMetaEvent())
+                {
+                    read.push_back({ message, (int64)message.getTimeStamp() });
+                }
+            }
+            expectEquals(bridges, 1);
+            expectEvents(read, events, start, events.size() - escaped);
+        }
+        
+        beginTest("The status is written again after a sysex, a bridge and an escape");
+        {
+            TemporaryFile file(".mid");
+            writeExport(events, file.getFile(), MidiExport::MAX_TRACK_SIZE);
+            MemoryBlock data;
+            file.getFile().loadFileAsData(data);
+            
+            // the note after the bridge of 0x0fffffff ticks and the remaining 15 ticks
+            expect(contains(data, { 0xff, 0xff, 0xff, 0x7f, 0xff, 0x01, 0x00, 0x0f, 0x90, 72, 70 }),
+                   "The running status continued after the bridge");
+            // the note after the sysex
+            expect(contains(data, { 0x06, 0x01, 0xf7, 0x0a, 0x90, 67, 80 }), "The running status continued after the sysex");
+            // the second note shares the status of the first
+            expect(contains(data, { 0x0a, 64, 90 }), "The running status wasn't used");
+            expect(contains(data, { 0x0a, 0xf7, 0x01, 0xf8 }), "The clock isn't escaped");
+        }
+        
+        beginTest("Large exports continue in tracks that count from the start of the file");
+        {
+            std::vector<Event> many;
+            for (auto i = 0; i < 300; ++i)
+            {
+                auto msg = i % 50 == 0 ? MidiMessage::noteOn(1 + i % 16, i % 128, (uint8)100) : MidiMessage::controllerEvent(1, 1, i % 128);
+                many.push_back({ msg, start + i * 3 });
+            }
+            
+            TemporaryFile file(".mid");
+            writeExport(many, file.getFile(), 256);
+            MidiFile midi_file;
+            FileInputStream in(file.getFile());
+            expect(midi_file.readFrom(in, false), "The exported file can't be read");
+            expect(midi_file.getNumTracks() > 2, "The export didn't continue in other tracks");
+            
+            std::vector<Event> read;
+            for (auto track = 0; track < midi_file.getNumTracks(); ++track)
+            {
+                for (auto event : *midi_file.getTrack(track))
+                {
+                    if (!event->message.isMetaEvent())
+                    {
+                        read.push_back({ event->message, (int64)event->message.getTimeStamp() });
+                    }
+                }
+            }
+            expectEvents(read, many, start, many.size());
+        }
+    }
+    
+private:
+    void writeExport(const std::vector<Event>& events, const File& file, int64 maxTrackSize)
+    {
+        EventSource source(events);
+        auto result = MidiExport::write(source, MidiExport::formatStandardMidiFile, file, [] (double) { return true; }, maxTrackSize);
+        expect(result.wasOk(), result.getErrorMessage());
+    }
+    
+    /** The first events that were read have to match the exported ones, relative to the first. */
+    void expectEvents(const std::vector<Event>& read, const std::vector<Event>& exported, int64 start, size_t count)
+    {
+        expect(read.size() >= count, String(read.size()) + " events were read instead of " + String(count));
+        for (size_t i = 0; i < jmin(count, read.size()); ++i)
+        {
+            auto& message = read[i].message_;
+            auto& expected = exported[i].message_;
+            expect(message.getRawDataSize() == expected.getRawDataSize() &&
+                   std::memcmp(message.getRawData(), expected.getRawData(), (size_t)expected.getRawDataSize()) == 0,
+                   message.getDescription() + " was read instead of " + expected.getDescription());
+            expectEquals(read[i].time_, exported[i].time_ - start);
+        }
+    }
+};
+
+static MidiExportTest midiExportTest;
+}
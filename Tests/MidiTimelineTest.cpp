@@ -0,0 +1,404 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "MidiEventLog.h"
+#include "MidiTimeline.h"
+
+namespace showmidi
+{
+namespace
+{
+    constexpr int64 START_MS = 1700000000000;
+    constexpr int CLOCK_QUEUE_SIZE = 48;
+    
+    /** A reduced ingest of the messages, the same code is fed live and through the timeline. */
+    struct Ingest : public MidiTimelineCallback
+    {
+        void apply(const MidiMessage& msg, int64 time)
+        {
+            if (msg.isSysEx())
+            {
+                handleTimelineSysex(msg.getSysExData(), msg.getSysExDataSize(), Time(time));
+            }
+            else
+            {
+                handleTimelineMessage(msg, Time(time));
+            }
+        }
+        
+        void handleTimelineMessage(const MidiMessage& msg, Time t) override
+        {
+            if (msg.isMidiClock())
+            {
+                clockTimeStamps_.push_front(msg.getTimeStamp());
+                while (clockTimeStamps_.size() > (size_t)CLOCK_QUEUE_SIZE)
+                {
+                    clockTimeStamps_.pop_back();
+                }
+                return;
+            }
+            
+            if (msg.getChannel() <= 0)
+            {
+                return;
+            }
+            
+            auto& channel = channels_.channel_[msg.getChannel() - 1];
+            channel.time_ = t;
+            if (msg.isNoteOn())
+            {
+                auto& notes = channel.notes_;
+                notes.time_ = t;
+                notes.noteOff_[msg.getNoteNumber()].current_.time_ = Time();
+                set(notes.noteOn_[msg.getNoteNumber()], msg.getVelocity(), t);
+                channel.noteSpans_.noteOn(msg.getNoteNumber(), msg.getVelocity(), t.toMilliseconds());
+                channel.noteHeat_.noteOn(msg.getNoteNumber(), msg.getVelocity(), t.toMilliseconds());
+            }
+            else if (msg.isNoteOff())
+            {
+                auto& notes = channel.notes_;
+                notes.time_ = t;
+                set(notes.noteOff_[msg.getNoteNumber()], msg.getVelocity(), t);
+                channel.noteSpans_.noteOff(msg.getNoteNumber(), t.toMilliseconds());
+            }
+            else if (msg.isController())
+            {
+                auto number = msg.getControllerNumber();
+                channel.controlChanges_.time_ = t;
+                set(channel.controlChanges_.controlChange_[number], msg.getControllerValue(), t);
+                if (number < 32)
+                {
+                    channel.hrccs_.time_ = t;
+                    set(channel.hrccs_.param_[number], msg.getControllerValue() << 7, t);
+                }
+            }
+            else if (msg.isProgramChange())
+            {
+                set(channel.programChange_, msg.getProgramChangeNumber(), t);
+            }
+            else if (msg.isPitchWheel())
+            {
+                set(channel.pitchBend_, msg.getPitchWheelValue(), t);
+            }
+        }
+        
+        void handleTimelineSysex(const uint8* data, int size, Time t) override
+        {
+            auto& sysex = channels_.sysex_;
+            sysex.time_ = t;
+            sysex.length_ = size;
+            memset(sysex.data_, 0, Sysex::MAX_SYSEX_DATA);
+            memcpy(sysex.data_, data, (size_t)std::min(size, Sysex::MAX_SYSEX_DATA));
+        }
+        
+        void handleTimelineTempo(double bpm, Time t) override
+        {
+            channels_.clock_.timeBpm_ = t;
+            channels_.clock_.bpm_ = bpm;
+        }
+        
+        static void set(ChannelMessage& message, int value, Time t)
+        {
+            if (message.current_.time_.toMilliseconds() != 0)
+            {
+                message.history_.insert(message.history_.begin(), message.current_);
+            }
+            message.current_.time_ = t;
+            message.current_.value_ = value;
+        }
+        
+        ActiveChannels channels_;
+        std::deque<double> clockTimeStamps_;
+    };
+    
+    /** The channels as they were fed live up to a moment. */
+    struct Checkpoint
+    {
+        int64 time_ { 0 };
+        ActiveChannels channels_;
+        std::deque<double> clockTimeStamps_;
+    };
+    
+    /** Every kind of message the ingest keeps, with notes that are retriggered and released. */
+    MidiMessage createMessage(Random& random, int64 time)
+    {
+        auto channel = 1 + random.nextInt(16);
+        auto note = 48 + random.nextInt(24);
+        switch (random.nextInt(8))
+        {
+            case 0:
+                return MidiMessage::noteOn(channel, note, (uint8)(1 + random.nextInt(127)));
+            case 1:
+                return MidiMessage::noteOff(channel, note, (uint8)random.nextInt(128));
+            case 2:
+            case 3:
+                return MidiMessage::controllerEvent(channel, random.nextInt(120), random.nextInt(128));
+            case 4:
+                return MidiMessage::pitchWheel(channel, random.nextInt(0x4000));
+            case 5:
+                return MidiMessage::programChange(channel, random.nextInt(128));
+            case 6:
+            {
+                auto clock = MidiMessage::midiClock();
+                clock.setTimeStamp((double)time / 1000.0);
+                return clock;
+            }
+            default:
+            {
+                // longer than what the channels keep of it
+                uint8 data[40];
+                auto size = 1 + random.nextInt(40);
+                for (auto i = 0; i < size; ++i)
+                {
+                    data[i] = (uint8)random.nextInt(128);
+                }
+                return MidiMessage::createSysExMessage(data, size);
+            }
+        }
+    }
+    
+    std::unique_ptr<Checkpoint> createCheckpoint(int64 time, const Ingest& live)
+    {
+        auto checkpoint = std::make_unique<Checkpoint>();
+        checkpoint->time_ = time;
+        checkpoint->channels_.deepCopy(live.channels_);
+        checkpoint->clockTimeStamps_ = live.clockTimeStamps_;
+        return checkpoint;
+    }
+    
+    void feed(MidiEventLog& log, MidiTimeline& timeline, Ingest& live, const MidiMessage& msg, int64 time)
+    {
+        timeline.add(msg, time);
+        log.add(msg, time);
+        live.apply(msg, time);
+    }
+    
+    std::vector<TimedValue> getRecentHistory(const ChannelMessage& message, int64 horizon)
+    {
+        std::vector<TimedValue> recent;
+        for (auto& value : message.history_)
+        {
+            if (value.time_.toMilliseconds() >= horizon)
+            {
+                recent.push_back(value);
+            }
+        }
+        return recent;
+    }
+    
+    std::vector<NoteSpan> getRecentSpans(const NoteSpans& spans, int64 horizon)
+    {
+        std::vector<NoteSpan> recent;
+        spans.forEachSince(horizon, [&recent] (const NoteSpan& span) { recent.push_back(span); });
+        return recent;
+    }
+}
+
+/** Locks in that a moment of the timeline is rebuilt as the channels were, from keyframes that are built in the background. */
+class MidiTimelineTest : public UnitTest
+{
+public:
+    MidiTimelineTest() : UnitTest("MIDI timeline", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Keyframes decode to the channels they encoded");
+        {
+            MidiEventLog log;
+            log.setEnabled(true);
+            MidiTimeline timeline(log);
+            // the channels are too large for the stack
+            auto live = std::make_unique<Ingest>();
+            auto keyframer = std::make_unique<Ingest>();
+            auto seeker = std::make_unique<Ingest>();
+            Random random(1);
+            
+            // quicker than the keyframe interval, the next message asks for a keyframe by count
+            auto time = START_MS;
+            for (auto i = 0; i < MidiTimeline::KEYFRAME_EVENTS; ++i)
+            {
+                ++time;
+                feed(log, timeline, *live, createMessage(random, time), time);
+            }
+            auto expected = createCheckpoint(time, *live);
+            auto end = log.getEnd();
+            
+            ++time;
+            feed(log, timeline, *live, createMessage(random, time), time);
+            timeline.buildKeyframes(keyframer->channels_, keyframer->clockTimeStamps_, *keyframer);
+            
+            // without the messages, only the keyframe is left to decode
+            log.clear();
+            expect(timeline.seek(std::numeric_limits<int64>::max(), end, seeker->channels_, seeker->clockTimeStamps_, *seeker),
+                   "the keyframe isn't available");
+            expectSameChannels(*expected, *seeker, 0);
+        }
+        
+        beginTest("Seeks across a pruned window match the channels that were fed live");
+        {
+            constexpr int64 STEP_MS = 50;
+            constexpr int64 BUILD_INTERVAL_MS = 1000;
+            constexpr int64 CHECKPOINT_INTERVAL_MS = 90000;
+            constexpr int64 TEMPO_INTERVAL_MS = 7000;
+            constexpr int64 DURATION_MS = MidiTimeline::WINDOW_MS + 2 * 60 * 1000;
+            
+            MidiEventLog log;
+            log.setEnabled(true);
+            MidiTimeline timeline(log);
+            auto live = std::make_unique<Ingest>();
+            auto keyframer = std::make_unique<Ingest>();
+            auto seeker = std::make_unique<Ingest>();
+            Random random(2);
+            
+            std::vector<std::unique_ptr<Checkpoint>> checkpoints;
+            for (int64 elapsed = 0; elapsed < DURATION_MS; elapsed += STEP_MS)
+            {
+                auto time = START_MS + elapsed;
+                if (elapsed % TEMPO_INTERVAL_MS == 0)
+                {
+                    auto bpm = 60.0 + random.nextInt(120);
+                    timeline.addTempo(bpm, time);
+                    live->handleTimelineTempo(bpm, Time(time));
+                }
+                
+                feed(log, timeline, *live, createMessage(random, time), time);
+                
+                // the builder thread lags behind the messages
+                if (elapsed % BUILD_INTERVAL_MS == 0)
+                {
+                    timeline.buildKeyframes(keyframer->channels_, keyframer->clockTimeStamps_, *keyframer);
+                }
+                if (elapsed % CHECKPOINT_INTERVAL_MS == CHECKPOINT_INTERVAL_MS / 2)
+                {
+                    checkpoints.push_back(createCheckpoint(time, *live));
+                }
+            }
+            timeline.buildKeyframes(keyframer->channels_, keyframer->clockTimeStamps_, *keyframer);
+            
+            auto begin = timeline.getBeginTime();
+            expect(begin > START_MS + CHECKPOINT_INTERVAL_MS / 2, "the oldest keyframes weren't pruned");
+            
+            auto end = log.getEnd();
+            for (auto& checkpoint : checkpoints)
+            {
+                auto found = timeline.seek(checkpoint->time_, end, seeker->channels_, seeker->clockTimeStamps_, *seeker);
+                if (checkpoint->time_ < begin)
+                {
+                    expect(!found, "a moment before the window was rebuilt");
+                }
+                else
+                {
+                    expect(found, "a moment in the window isn't available");
+                    expectSameChannels(*checkpoint, *seeker, checkpoint->time_ - MidiTimeline::DEFAULT_HISTORY_MS);
+                }
+            }
+        }
+    }
+    
+private:
+    /** The history older than the horizon isn't kept by keyframes. */
+    void expectSameMessage(const ChannelMessage& expected, const ChannelMessage& actual, int64 horizon, const String& name)
+    {
+        expectEquals(actual.current_.value_, expected.current_.value_, name + " value");
+        expectEquals(actual.current_.time_.toMilliseconds(), expected.current_.time_.toMilliseconds(), name + " time");
+        
+        auto expected_history = getRecentHistory(expected, horizon);
+        auto actual_history = getRecentHistory(actual, horizon);
+        expectEquals((int)actual_history.size(), (int)expected_history.size(), name + " history");
+        for (size_t i = 0; i < std::min(expected_history.size(), actual_history.size()); ++i)
+        {
+            expectEquals(actual_history[i].value_, expected_history[i].value_, name + " history value");
+            expectEquals(actual_history[i].time_.toMilliseconds(), expected_history[i].time_.toMilliseconds(), name + " history time");
+        }
+    }
+    
+    void expectSameSpans(const NoteSpans& expected, const NoteSpans& actual, int64 horizon, const String& name)
+    {
+        auto expected_spans = getRecentSpans(expected, horizon);
+        auto actual_spans = getRecentSpans(actual, horizon);
+        expectEquals((int)actual_spans.size(), (int)expected_spans.size(), name + " spans");
+        for (size_t i = 0; i < std::min(expected_spans.size(), actual_spans.size()); ++i)
+        {
+            expectEquals(actual_spans[i].start_, expected_spans[i].start_, name + " span start");
+            expectEquals(actual_spans[i].end_, expected_spans[i].end_, name + " span end");
+            expectEquals((int)actual_spans[i].number_, (int)expected_spans[i].number_, name + " span number");
+            expectEquals((int)actual_spans[i].velocity_, (int)expected_spans[i].velocity_, name + " span velocity");
+        }
+    }
+    
+    void expectSameHeat(const NoteHeat& expected, const NoteHeat& actual, int64 time, const String& name)
+    {
+        expectEquals(actual.getLastUpdate(), expected.getLastUpdate(), name + " heat update");
+        
+        float expected_keys[NoteHeat::NUM_BINS], expected_velocities[NoteHeat::NUM_BINS];
+        float actual_keys[NoteHeat::NUM_BINS], actual_velocities[NoteHeat::NUM_BINS];
+        expected.getLevels(time, expected_keys, expected_velocities);
+        actual.getLevels(time, actual_keys, actual_velocities);
+        expect(memcmp(actual_keys, expected_keys, sizeof(actual_keys)) == 0, name + " key heat");
+        expect(memcmp(actual_velocities, expected_velocities, sizeof(actual_velocities)) == 0, name + " velocity heat");
+    }
+    
+    void expectSameChannels(const Checkpoint& expected, const Ingest& actual, int64 horizon)
+    {
+        auto& sysex = actual.channels_.sysex_;
+        expectEquals(sysex.time_.toMilliseconds(), expected.channels_.sysex_.time_.toMilliseconds(), "sysex time");
+        expectEquals(sysex.length_, expected.channels_.sysex_.length_, "sysex length");
+        expect(memcmp(sysex.data_, expected.channels_.sysex_.data_, Sysex::MAX_SYSEX_DATA) == 0, "sysex data");
+        
+        expectEquals(actual.channels_.clock_.bpm_, expected.channels_.clock_.bpm_, "tempo");
+        expectEquals(actual.channels_.clock_.timeBpm_.toMilliseconds(), expected.channels_.clock_.timeBpm_.toMilliseconds(), "tempo time");
+        expect(actual.clockTimeStamps_ == expected.clockTimeStamps_, "clock timestamps");
+        
+        for (auto c = 0; c < 16; ++c)
+        {
+            auto& expected_channel = expected.channels_.channel_[c];
+            auto& actual_channel = actual.channels_.channel_[c];
+            auto name = "channel " + String(c + 1);
+            
+            expectEquals(actual_channel.time_.toMilliseconds(), expected_channel.time_.toMilliseconds(), name + " time");
+            expectEquals(actual_channel.notes_.time_.toMilliseconds(), expected_channel.notes_.time_.toMilliseconds(), name + " notes time");
+            expectEquals(actual_channel.controlChanges_.time_.toMilliseconds(), expected_channel.controlChanges_.time_.toMilliseconds(), name + " controllers time");
+            for (auto i = 0; i < 128; ++i)
+            {
+                expectSameMessage(expected_channel.notes_.noteOn_[i], actual_channel.notes_.noteOn_[i], horizon, name + " note on " + String(i));
+                expectSameMessage(expected_channel.notes_.noteOff_[i], actual_channel.notes_.noteOff_[i], horizon, name + " note off " + String(i));
+                expectSameMessage(expected_channel.controlChanges_.controlChange_[i], actual_channel.controlChanges_.controlChange_[i], horizon, name + " CC " + String(i));
+            }
+            expectSameMessage(expected_channel.programChange_, actual_channel.programChange_, horizon, name + " program");
+            expectSameMessage(expected_channel.pitchBend_, actual_channel.pitchBend_, horizon, name + " pitch bend");
+            
+            expectEquals(actual_channel.hrccs_.time_.toMilliseconds(), expected_channel.hrccs_.time_.toMilliseconds(), name + " HRCC time");
+            expectEquals((int)actual_channel.hrccs_.param_.size(), (int)expected_channel.hrccs_.param_.size(), name + " HRCCs");
+            for (auto& param : expected_channel.hrccs_.param_)
+            {
+                auto found = actual_channel.hrccs_.param_.find(param.first);
+                if (found != actual_channel.hrccs_.param_.end())
+                {
+                    expectSameMessage(param.second, found->second, horizon, name + " HRCC " + String(param.first));
+                }
+            }
+            
+            expectSameSpans(expected_channel.noteSpans_, actual_channel.noteSpans_, horizon, name);
+            expectSameHeat(expected_channel.noteHeat_, actual_channel.noteHeat_, expected.time_, name);
+        }
+    }
+};
+
+static MidiTimelineTest midiTimelineTest;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "NoteHeat.h"
+
+namespace showmidi
+{
+namespace
+{
+    constexpr float TOLERANCE = 0.0001f;
+    const int64 HALF_LIFE = (int64)NoteHeat::HALF_LIFE_MS;
+}
+
+/** Locks in how the key and velocity levels decay and are normalized. */
+class NoteHeatTest : public UnitTest
+{
+public:
+    NoteHeatTest() : UnitTest("Note heat", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("A single note halves every half-life");
+        {
+            NoteHeat heat;
+            heat.noteOn(60, 100, 1000);
+            expectEquals(heat.getLastUpdate(), (int64)1000);
+            
+            expectLevels(heat, 1000, { { 60, 1.0f } }, { { 100, 1.0f } });
+            expectLevels(heat, 1000 + HALF_LIFE, { { 60, 0.5f } }, { { 100, 0.5f } });
+            expectLevels(heat, 1000 + 2 * HALF_LIFE, { { 60, 0.25f } }, { { 100, 0.25f } });
+            // no decay before the last note
+            expectLevels(heat, 500, { { 60, 1.0f } }, { { 100, 1.0f } });
+        }
+        
+        beginTest("The histograms are normalized against their own peak");
+        {
+            NoteHeat heat;
+            for (auto i = 0; i < 4; ++i)
+            {
+                heat.noteOn(60, 100, 1000);
+            }
+            heat.noteOn(64, 50, 1000);
+            heat.noteOn(64, 100, 1000);
+            
+            expectLevels(heat, 1000, { { 60, 1.0f }, { 64, 0.5f } }, { { 50, 0.2f }, { 100, 1.0f } });
+            // the peak of 4 notes has decayed to 2 notes
+            expectLevels(heat, 1000 + HALF_LIFE, { { 60, 1.0f }, { 64, 0.5f } }, { { 50, 0.2f }, { 100, 1.0f } });
+            // and below a single note, the levels fade out
+            expectLevels(heat, 1000 + 4 * HALF_LIFE, { { 60, 0.25f }, { 64, 0.125f } }, { { 50, 0.0625f }, { 100, 0.3125f } });
+        }
+        
+        beginTest("Earlier notes decay before a note is added");
+        {
+            NoteHeat heat;
+            heat.noteOn(60, 100, 1000);
+            heat.noteOn(60, 100, 1000 + HALF_LIFE);
+            heat.noteOn(62, 100, 1000 + HALF_LIFE);
+            
+            expectEquals(heat.getLastUpdate(), 1000 + HALF_LIFE);
+            expectLevels(heat, 1000 + HALF_LIFE, { { 60, 1.0f }, { 62, 1.0f / 1.5f } }, { { 100, 1.0f } });
+            
+            heat.reset();
+            expectEquals(heat.getLastUpdate(), (int64)0);
+            expectLevels(heat, 1000 + HALF_LIFE, {}, {});
+        }
+    }
+    
+private:
+    /** The listed bins have a level, every other bin is zero. */
+    void expectLevels(const NoteHeat& heat, int64 time, const std::map<int, float>& keys, const std::map<int, float>& velocities)
+    {
+        float key_levels[NoteHeat::NUM_BINS];
+        float velocity_levels[NoteHeat::NUM_BINS];
+        heat.getLevels(time, key_levels, velocity_levels);
+        
+        for (auto bin = 0; bin < NoteHeat::NUM_BINS; ++bin)
+        {
+            auto key = keys.find(bin);
+            expectWithinAbsoluteError(key_levels[bin], key != keys.end() ? key->second : 0.0f, TOLERANCE,
+                                      "Key " + String(bin) + " at " + String(time));
+            auto velocity = velocities.find(bin);
+            expectWithinAbsoluteError(velocity_levels[bin], velocity != velocities.end() ? velocity->second : 0.0f, TOLERANCE,
+                                      "Velocity " + String(bin) + " at " + String(time));
+        }
+    }
+};
+
+static NoteHeatTest noteHeatTest;
+}
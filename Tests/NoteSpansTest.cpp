@@ -0,0 +1,153 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "NoteSpans.h"
+
+namespace showmidi
+{
+namespace
+{
+    using Spans = std::vector<std::tuple<int64, int64, int, int>>;
+    
+    template <typename Function>
+    Spans collect(Function forEach)
+    {
+        Spans spans;
+        forEach([&spans] (const NoteSpan& span) { spans.emplace_back(span.start_, span.end_, (int)span.number_, (int)span.velocity_); });
+        std::sort(spans.begin(), spans.end());
+        return spans;
+    }
+}
+
+/** Checks the window queries of the note spans against a plain scan of every span. */
+class NoteSpansTest : public UnitTest
+{
+public:
+    NoteSpansTest() : UnitTest("Note spans", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Window queries visit the spans that overlap the window, held notes end at the window");
+        {
+            NoteSpans spans;
+            // every span that was played, and the held notes by number
+            std::vector<NoteSpan> finished;
+            std::map<int, NoteSpan> held;
+            
+            Random random(1);
+            int64 time = 1000;
+            while (time < NoteSpans::RETENTION_MS)
+            {
+                time += random.nextInt(20);
+                auto number = random.nextInt(128);
+                if (random.nextInt(3) > 0)
+                {
+                    // retriggering a held note ends its span first
+                    auto velocity = 1 + random.nextInt(127);
+                    spans.noteOn(number, velocity, time);
+                    if (held.count(number) > 0)
+                    {
+                        held[number].end_ = time;
+                        finished.push_back(held[number]);
+                    }
+                    held[number] = { time, 0, (uint8)number, (uint8)velocity };
+                }
+                else
+                {
+                    spans.noteOff(number, time);
+                    if (held.count(number) > 0)
+                    {
+                        held[number].end_ = time;
+                        finished.push_back(held[number]);
+                        held.erase(number);
+                    }
+                }
+                
+                if (random.nextInt(50) == 0)
+                {
+                    // windows before, around and after the played spans
+                    auto from = (int64)random.nextInt((int)time + 2000) - 1000;
+                    auto to = from + random.nextInt(5000);
+                    
+                    Spans expected;
+                    for (auto& span : finished)
+                    {
+                        if (span.end_ >= from && span.start_ <= to)
+                        {
+                            expected.emplace_back(span.start_, span.end_, (int)span.number_, (int)span.velocity_);
+                        }
+                    }
+                    for (auto& [number, span] : held)
+                    {
+                        if (span.start_ <= to)
+                        {
+                            expected.emplace_back(span.start_, to, number, (int)span.velocity_);
+                        }
+                    }
+                    std::sort(expected.begin(), expected.end());
+                    
+                    expect(collect([&spans, from, to] (auto function) { spans.forEachInWindow(from, to, function); }) == expected,
+                           "The window from " + String(from) + " to " + String(to) + " doesn't have the overlapping spans");
+                }
+            }
+            
+            expect(spans.hasHeldNotes() == !held.empty());
+            expectEquals(spans.getLastEnd(), finished.back().end_);
+        }
+        
+        beginTest("A long note keeps being found until it's pruned");
+        {
+            NoteSpans spans;
+            spans.noteOn(60, 100, 1000);
+            spans.noteOff(60, 31000);
+            spans.noteOn(62, 90, 40000);
+            spans.noteOff(62, 40010);
+            
+            // the long note started well before its end
+            expect(collect([&spans] (auto function) { spans.forEachInWindow(2000, 2100, function); }) == Spans { { 1000, 31000, 60, 100 } });
+            expectEquals(spans.getLastEnd(), (int64)40010);
+            
+            // once the retention has passed, only the later note is left
+            spans.noteOn(64, 80, 31000 + NoteSpans::RETENTION_MS + 1);
+            spans.noteOff(64, 31000 + NoteSpans::RETENTION_MS + 2);
+            expect(collect([&spans] (auto function) { spans.forEachSince(0, function); }) ==
+                   Spans { { 40000, 40010, 62, 90 }, { 31000 + NoteSpans::RETENTION_MS + 1, 31000 + NoteSpans::RETENTION_MS + 2, 64, 80 } });
+        }
+        
+        beginTest("Held notes are listed until they're released or reset");
+        {
+            NoteSpans spans;
+            spans.noteOff(60, 500);
+            expect(!spans.hasHeldNotes());
+            expectEquals(spans.getLastEnd(), (int64)0);
+            
+            spans.noteOn(60, 100, 1000);
+            expect(spans.hasHeldNotes());
+            expect(collect([&spans] (auto function) { spans.forEachSince(0, function); }) == Spans { { 1000, 0, 60, 100 } });
+            expect(collect([&spans] (auto function) { spans.forEachInWindow(0, 999, function); }).empty());
+            
+            spans.reset();
+            expect(!spans.hasHeldNotes());
+            expect(collect([&spans] (auto function) { spans.forEachInWindow(0, 5000, function); }).empty());
+        }
+    }
+};
+
+static NoteSpansTest noteSpansTest;
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "RawMidiBenchmark.h"
+
+#include "RawMidiInput.h"
+
+#if JUCE_LINUX && JUCE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+namespace showmidi
+{
+#if JUCE_LINUX && JUCE_ALSA
+namespace
+{
+    constexpr int MESSAGES = 1000;
+    constexpr int RECEIVE_TIMEOUT_MS = 100;
+    constexpr int MESSAGE_INTERVAL_MS = 1;
+    
+    /** Records when the messages arrive, on whichever thread the input delivers them. */
+    struct ArrivalRecorder : public MidiInputCallback, public RawMidiInputCallback
+    {
+        void handleIncomingMidiMessage(MidiInput*, const MidiMessage& msg) override
+        {
+            arrived(msg);
+        }
+        
+        void handleRawMidiMessage(const MidiMessage& msg, Time) override
+        {
+            arrived(msg);
+        }
+        
+        void arrived(const MidiMessage& msg)
+        {
+            if (msg.isNoteOn())
+            {
+                arrival_ = Time::getMillisecondCounterHiRes();
+                received_.signal();
+            }
+        }
+        
+        std::atomic<double> arrival_ { 0.0 };
+        WaitableEvent received_;
+    };
+    
+    String describe(const String& path, std::vector<double>& latencies, int lost)
+    {
+        if (latencies.empty())
+        {
+            return path + ": nothing arrived\n";
+        }
+        
+        std::sort(latencies.begin(), latencies.end());
+        auto at = [&latencies] (double fraction) { return latencies[(size_t)(fraction * (double)(latencies.size() - 1))] * 1000.0; };
+        
+        return path + ": min " + String(at(0.0), 1) + "us" +
+               ", median " + String(at(0.5), 1) + "us" +
+               ", p99 " + String(at(0.99), 1) + "us" +
+               ", max " + String(at(1.0), 1) + "us" +
+               (lost > 0 ? ", " + String(lost) + " lost" : String()) + "\n";
+    }
+    
+    /** Sends the messages one at a time and waits for each of them to arrive. */
+    String measure(const String& path, ArrivalRecorder& recorder, std::function<void(const uint8*)> send)
+    {
+        std::vector<double> latencies;
+        auto lost = 0;
+        for (auto i = 0; i < MESSAGES; ++i)
+        {
+            const uint8 note_on[3] = { 0x90, (uint8)(i % 128), (uint8)(1 + i % 127) };
+            
+            recorder.received_.reset();
+            auto sent = Time::getMillisecondCounterHiRes();
+            send(note_on);
+            if (recorder.received_.wait(RECEIVE_TIMEOUT_MS))
+            {
+                latencies.push_back(recorder.arrival_.load() - sent);
+            }
+            else
+            {
+                ++lost;
+            }
+            
+            Thread::sleep(MESSAGE_INTERVAL_MS);
+        }
+        
+        return describe(path, latencies, lost);
+    }
+}
+
+String RawMidiBenchmark::run()
+{
+    // a virmidi device connects its raw MIDI end to its sequencer port
+    MidiDeviceInfo raw_device;
+    for (auto& device : RawMidiInput::getAvailableDevices())
+    {
+        if (device.name.containsIgnoreCase("virmidi"))
+        {
+            raw_device = device;
+            break;
+        }
+    }
+    if (raw_device.identifier.isEmpty())
+    {
+        return "No virmidi device was found, load the module with: sudo modprobe snd-virmidi\n";
+    }
+    
+    auto port_name = raw_device.name.upToLastOccurrenceOf(" (raw)", false, false);
+    MidiDeviceInfo seq_input;
+    for (auto& device : MidiInput::getAvailableDevices())
+    {
+        if (device.name.equalsIgnoreCase(port_name))
+        {
+            seq_input = device;
+        }
+    }
+    MidiDeviceInfo seq_output;
+    for (auto& device : MidiOutput::getAvailableDevices())
+    {
+        if (device.name.equalsIgnoreCase(port_name))
+        {
+            seq_output = device;
+        }
+    }
+    if (seq_input.identifier.isEmpty() || seq_output.identifier.isEmpty())
+    {
+        return "The sequencer port of " + port_name + " was not found\n";
+    }
+    
+    String report;
+    report << "Raw MIDI benchmark over " << port_name << ", " << MESSAGES << " note on messages\n";
+    
+    // sequencer input: written to the raw device, read from the sequencer port
+    {
+        snd_rawmidi_t* raw_output = nullptr;
+        auto device = raw_device.identifier.fromFirstOccurrenceOf(RawMidiInput::IDENTIFIER_PREFIX, false, false);
+        if (snd_rawmidi_open(nullptr, &raw_output, device.toRawUTF8(), 0) < 0)
+        {
+            report << "sequencer input: can't open " << device << " for output\n";
+        }
+        else
+        {
+            ArrivalRecorder recorder;
+            auto input = MidiInput::openDevice(seq_input.identifier, &recorder);
+            if (input == nullptr)
+            {
+                report << "sequencer input: can't open " << seq_input.name << "\n";
+            }
+            else
+            {
+                input->start();
+                report << measure("sequencer input", recorder, [raw_output] (const uint8* data) {
+                    snd_rawmidi_write(raw_output, data, 3);
+                    snd_rawmidi_drain(raw_output);
+                });
+                input->stop();
+            }
+            snd_rawmidi_close(raw_output);
+        }
+    }
+    
+    // raw MIDI input: sent to the sequencer port, read from the raw device
+    {
+        auto output = MidiOutput::openDevice(seq_output.identifier);
+        ArrivalRecorder recorder;
+        auto input = RawMidiInput::openDevice(raw_device.identifier, &recorder);
+        if (output == nullptr || input == nullptr)
+        {
+            report << "raw MIDI input: can't open " << raw_device.name << "\n";
+        }
+        else
+        {
+            input->start();
+            report << measure("raw MIDI input", recorder, [&output] (const uint8* data) {
+                output->sendMessageNow(MidiMessage(data, 3));
+            });
+            input->stop();
+        }
+    }
+    
+    return report;
+}
+#else
+String RawMidiBenchmark::run()
+{
+    return "Raw MIDI is only available on Linux\n";
+}
+#endif
+}
@@ -0,0 +1,244 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "StateStreamProtocol.h"
+#include "StateStreamServer.h"
+#include "StateStreamViewer.h"
+
+namespace showmidi
+{
+namespace
+{
+    constexpr int FLOOD_MS = 500;
+    constexpr int CONNECT_TIMEOUT_MS = 5000;
+    constexpr int DRAIN_TIMEOUT_MS = 5000;
+    constexpr int POLL_INTERVAL_MS = 10;
+    // a frame has a few bytes of size and time on top of its records
+    constexpr int FRAME_OVERHEAD = 16;
+    
+    const String DEVICE_IDENTIFIER = "showmidi-test";
+    
+    /** The controller values and the note velocities, per channel. */
+    struct ChannelValues
+    {
+        ChannelValues()
+        {
+            for (auto& channel : controllers_)
+            {
+                std::fill(std::begin(channel), std::end(channel), -1);
+            }
+            for (auto& channel : notes_)
+            {
+                std::fill(std::begin(channel), std::end(channel), -1);
+            }
+        }
+        
+        void apply(const MidiMessage& msg)
+        {
+            auto channel = msg.getChannel() - 1;
+            if (msg.isController())
+            {
+                controllers_[channel][msg.getControllerNumber()] = msg.getControllerValue();
+            }
+            else if (msg.isNoteOn())
+            {
+                notes_[channel][msg.getNoteNumber()] = msg.getVelocity();
+            }
+        }
+        
+        bool operator==(const ChannelValues& other) const
+        {
+            for (auto channel = 0; channel < 16; ++channel)
+            {
+                if (!std::equal(std::begin(controllers_[channel]), std::end(controllers_[channel]), std::begin(other.controllers_[channel])) ||
+                    !std::equal(std::begin(notes_[channel]), std::end(notes_[channel]), std::begin(other.notes_[channel])))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        int controllers_[16][128];
+        int notes_[16][128];
+    };
+    
+    /** Keeps what the viewer reconstructed, on the viewer thread. */
+    struct StreamRecorder : public StateStreamCallback
+    {
+        void handleStreamedMessage(const MidiMessage& msg, Time) override
+        {
+            const ScopedLock lock(lock_);
+            values_.apply(msg);
+            ++messages_;
+        }
+        
+        void handleStreamedTempo(double, Time) override
+        {
+        }
+        
+        void handleStreamedReset() override
+        {
+            const ScopedLock lock(lock_);
+            values_ = ChannelValues();
+        }
+        
+        bool matches(const ChannelValues& expected)
+        {
+            const ScopedLock lock(lock_);
+            return values_ == expected;
+        }
+        
+        CriticalSection lock_;
+        ChannelValues values_;
+        std::atomic<int64> messages_ { 0 };
+    };
+    
+    template<typename Condition>
+    bool waitFor(int timeoutMs, Condition condition)
+    {
+        auto deadline = Time::getMillisecondCounter() + (uint32)timeoutMs;
+        while (!condition())
+        {
+            if (Time::getMillisecondCounter() > deadline)
+            {
+                return false;
+            }
+            Thread::sleep(POLL_INTERVAL_MS);
+        }
+        return true;
+    }
+}
+
+/**
+ * Streams a flood of MIDI data to a viewer over loopback sockets and checks that the viewer
+ * ends up with the same state while the bandwidth stays within the frame budget.
+ */
+class StateStreamLoopbackTest : public UnitTest
+{
+public:
+    StateStreamLoopbackTest() : UnitTest("State stream loopback", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        if (!StateStreamProtocol::isAvailable())
+        {
+            logMessage("State streams aren't available on this platform");
+            return;
+        }
+        
+        beginTest("A flood over a Unix domain socket");
+        {
+            auto socket = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("showmidi-test", ".sock");
+            auto address = "unix:" + socket.getFullPathName();
+            auto started = StateStreamServer::start(address);
+            expect(started, "Can't stream over " + address);
+            if (started)
+            {
+                flood(address);
+            }
+            socket.deleteFile();
+        }
+        
+        beginTest("A flood over TCP");
+        {
+            // another process might hold a port, a few are tried
+            Random random;
+            String address;
+            for (auto attempt = 0; attempt < 10 && address.isEmpty(); ++attempt)
+            {
+                auto candidate = "tcp:127.0.0.1:" + String(40000 + random.nextInt(20000));
+                if (StateStreamServer::start(candidate))
+                {
+                    address = candidate;
+                }
+            }
+            expect(address.isNotEmpty(), "Can't listen to a TCP port");
+            if (address.isNotEmpty())
+            {
+                flood(address);
+            }
+        }
+    }
+    
+private:
+    /** Floods a device of the started server and stops the server. */
+    void flood(const String& address)
+    {
+        expect(StateStreamViewer::start(address), "Can't view " + address);
+        {
+            StateStreamServer::Tap tap(MidiDeviceInfo("Test", DEVICE_IDENTIFIER));
+            auto remote_identifier = StateStreamViewer::IDENTIFIER_PREFIX + DEVICE_IDENTIFIER;
+            auto connected = waitFor(CONNECT_TIMEOUT_MS, [&remote_identifier] {
+                for (auto& device : StateStreamViewer::getAvailableDevices())
+                {
+                    if (device.identifier == remote_identifier)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            });
+            
+            StreamRecorder recorder;
+            auto input = connected ? StateStreamViewer::openDevice(remote_identifier, &recorder) : nullptr;
+            expect(input != nullptr, "The viewer didn't see the device");
+            if (input != nullptr)
+            {
+                // every controller and note of every channel keeps changing, far more than a frame can hold
+                ChannelValues expected;
+                Random random(1);
+                auto sent = (int64)0;
+                auto start = Time::getMillisecondCounterHiRes();
+                auto before = StateStreamViewer::getStatistics();
+                while (Time::getMillisecondCounterHiRes() - start < FLOOD_MS)
+                {
+                    for (auto i = 0; i < 1000; ++i)
+                    {
+                        auto channel = 1 + random.nextInt(16);
+                        auto msg = random.nextBool() ? MidiMessage::controllerEvent(channel, random.nextInt(128), random.nextInt(128))
+                                                     : MidiMessage::noteOn(channel, random.nextInt(128), (uint8)(1 + random.nextInt(127)));
+                        tap.add(msg, Time::getCurrentTime());
+                        expected.apply(msg);
+                        ++sent;
+                    }
+                }
+                
+                auto drained = waitFor(DRAIN_TIMEOUT_MS, [&recorder, &expected] { return recorder.matches(expected); });
+                auto after = StateStreamViewer::getStatistics();
+                auto bytes = after.bytesReceived_ - before.bytesReceived_;
+                auto frames = jmax((int64)1, after.framesReceived_ - before.framesReceived_);
+                auto bytes_per_frame = (double)bytes / (double)frames;
+                
+                logMessage(String(sent) + " messages sent, " + String(recorder.messages_.load()) + " changes received, " +
+                           String(bytes) + " bytes in " + String(frames) + " frames");
+                
+                expect(drained, "The viewer state doesn't match the sent state");
+                expect(bytes_per_frame <= StateStreamServer::MAX_FRAME_BYTES + FRAME_OVERHEAD,
+                       "The frames exceed the budget of " + String(StateStreamServer::MAX_FRAME_BYTES) + " bytes");
+            }
+        }
+        
+        StateStreamViewer::stop();
+        StateStreamServer::stop();
+    }
+};
+
+static StateStreamLoopbackTest stateStreamLoopbackTest;
+}
@@ -0,0 +1,353 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "StateStreamProtocol.h"
+#include "StateStreamServer.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace showmidi
+{
+using Protocol = StateStreamProtocol;
+
+namespace
+{
+    // the server sends a frame every interval while it has changes, a quiet stream has caught up
+    constexpr int IDLE_MS = 20 * StateStreamServer::FRAME_INTERVAL_MS;
+    
+    /** Connects to the server like a viewer does and keeps what the frames it receives decode to. */
+    class FrameReader
+    {
+    public:
+        FrameReader(const String& address) : fd_(Protocol::connectTo(address))
+        {
+        }
+        
+        ~FrameReader()
+        {
+            Protocol::closeSocket(fd_);
+        }
+        
+        bool isConnected() const
+        {
+            return fd_ >= 0;
+        }
+        
+        /** Decodes the frames until nothing arrived for a while, returns false when the stream is corrupt. */
+        bool readUntilIdle()
+        {
+#if JUCE_LINUX || JUCE_MAC
+            uint8 buffer[4096];
+            while (true)
+            {
+                pollfd descriptor { fd_, POLLIN, 0 };
+                if (poll(&descriptor, 1, IDLE_MS) <= 0)
+                {
+                    return true;
+                }
+                
+                auto count = read(fd_, buffer, sizeof(buffer));
+                if (count <= 0)
+                {
+                    return false;
+                }
+                
+                received_.insert(received_.end(), buffer, buffer + count);
+                if (!decodeFrames())
+                {
+                    return false;
+                }
+            }
+#else
+            return false;
+#endif
+        }
+        
+        StringArray names_;
+        int resets_ { 0 };
+        int changes_ { 0 };
+        Array<int> frameSizes_;
+        std::map<int, uint32> values_;
+        
+    private:
+        bool decodeFrames()
+        {
+            auto data = (const uint8*)received_.data();
+            auto end = data + received_.size();
+            while (data < end)
+            {
+                auto frame = data;
+                uint64 size;
+                if (!Protocol::readVarint(frame, end, size) || size > (uint64)(end - frame))
+                {
+                    break;
+                }
+                
+                if (!decodeFrame(frame, frame + size))
+                {
+                    return false;
+                }
+                frameSizes_.add((int)size);
+                data = frame + size;
+            }
+            
+            received_.erase(received_.begin(), received_.begin() + (data - received_.data()));
+            return true;
+        }
+        
+        bool decodeFrame(const uint8* data, const uint8* end)
+        {
+            uint64 sent;
+            if (!Protocol::readVarint(data, end, sent))
+            {
+                return false;
+            }
+            
+            while (data < end)
+            {
+                uint64 tag;
+                if (!Protocol::readVarint(data, end, tag))
+                {
+                    return false;
+                }
+                
+                switch ((Protocol::RecordType)(tag & 3))
+                {
+                    case Protocol::recordDeviceAdded:
+                    {
+                        String identifier, name;
+                        if (!Protocol::readString(data, end, identifier) || !Protocol::readString(data, end, name))
+                        {
+                            return false;
+                        }
+                        names_.add(name);
+                        values_.clear();
+                        break;
+                    }
+                    case Protocol::recordDeviceRemoved:
+                        names_.clear();
+                        break;
+                    case Protocol::recordDeviceReset:
+                        ++resets_;
+                        values_.clear();
+                        break;
+                    case Protocol::recordChanges:
+                    {
+                        uint64 count, time;
+                        if (!Protocol::readVarint(data, end, count) || !Protocol::readVarint(data, end, time))
+                        {
+                            return false;
+                        }
+                        for (uint64 i = 0; i < count; ++i)
+                        {
+                            uint64 slot, value, delta;
+                            if (!Protocol::readVarint(data, end, slot) ||
+                                !Protocol::readVarint(data, end, value) ||
+                                !Protocol::readVarint(data, end, delta) ||
+                                slot >= (uint64)Protocol::NUM_SLOTS)
+                            {
+                                return false;
+                            }
+                            values_[(int)slot] = (uint32)value;
+                            ++changes_;
+                        }
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+        
+        const int fd_;
+        std::vector<uint8> received_;
+    };
+}
+
+/** Locks in which messages the state streams carry, and what the server sends of them. */
+class StateStreamProtocolTest : public UnitTest
+{
+public:
+    StateStreamProtocolTest() : UnitTest("State stream protocol", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Streamed messages are rebuilt from their slot");
+        {
+            const MidiMessage messages[] = {
+                MidiMessage::noteOn(1, 60, (uint8)100),
+                MidiMessage::noteOff(2, 61, (uint8)64),
+                MidiMessage::aftertouchChange(3, 62, 90),
+                MidiMessage::controllerEvent(4, 74, 127),
+                MidiMessage::programChange(5, 12),
+                MidiMessage::channelPressureChange(6, 40),
+                MidiMessage::pitchWheel(16, 0x3fff),
+                MidiMessage::midiStart(),
+                MidiMessage::midiContinue(),
+                MidiMessage::midiStop()
+            };
+            
+            for (auto& message : messages)
+            {
+                uint32 value;
+                auto slot = Protocol::toSlot(message, value);
+                expect(slot >= 0 && slot < Protocol::NUM_SLOTS, message.getDescription() + " has no slot");
+                expect(Protocol::toMessage(slot, value).getDescription() == message.getDescription(),
+                       message.getDescription() + " isn't rebuilt from its slot");
+            }
+        }
+        
+        if (!Protocol::isAvailable())
+        {
+            logMessage("State streams aren't available on this platform");
+            return;
+        }
+        
+        auto socket = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("showmidi-test", ".sock");
+        auto address = "unix:" + socket.getFullPathName();
+        
+        beginTest("Earlier RPN values are lost when a later parameter is written");
+        {
+            // the pitch bend range, then the fine tuning
+            auto reader = streamControllers(address, { { 101, 0 }, { 100, 0 }, { 6, 12 }, { 38, 0 },
+                                                       { 101, 0 }, { 100, 1 }, { 6, 64 }, { 38, 0 } });
+            
+            expectEquals(reader->names_.joinIntoString(","), String("Test"));
+            expectEquals(reader->changes_, 4);
+            expectEquals((int)reader->values_[controllerSlot(100)], 1);
+            expectEquals((int)reader->values_[controllerSlot(6)], 64);
+        }
+        
+        beginTest("High resolution controllers are streamed as the latest values of their two controllers");
+        {
+            auto reader = streamControllers(address, { { 7, 64 }, { 39, 32 }, { 7, 10 }, { 39, 5 } });
+            
+            expectEquals(reader->changes_, 2);
+            expectEquals((int)reader->values_[controllerSlot(7)], 10);
+            expectEquals((int)reader->values_[controllerSlot(39)], 5);
+        }
+        
+        beginTest("Changes between frames are coalesced and a reset clears the state");
+        {
+            expect(StateStreamServer::start(address), "Can't stream over " + address);
+            {
+                StateStreamServer::Tap tap(MidiDeviceInfo("Test", "showmidi-test"));
+                FrameReader reader(address);
+                expect(reader.isConnected() && reader.readUntilIdle());
+                expectEquals(reader.names_.joinIntoString(","), String("Test"));
+                
+                auto time = Time::getCurrentTime();
+                for (auto value = 0; value < 1000; ++value)
+                {
+                    tap.add(MidiMessage::controllerEvent(1, 1, value % 128), time + RelativeTime::milliseconds(value));
+                }
+                expect(reader.readUntilIdle());
+                
+                // a frame carries a slot at most once, with its latest value
+                expect(reader.changes_ <= reader.frameSizes_.size(), "The changes weren't coalesced");
+                expectEquals((int)reader.values_[controllerSlot(1)], 999 % 128);
+                
+                tap.reset();
+                expect(reader.readUntilIdle());
+                expectEquals(reader.resets_, 1);
+                expect(reader.values_.empty());
+            }
+            StateStreamServer::stop();
+        }
+        
+        beginTest("The frames stay within their budget and the state catches up");
+        {
+            std::map<int, uint32> expected;
+            auto reader = stream(address, [&expected] (StateStreamServer::Tap& tap) {
+                // every note and controller of every channel, far more than a frame can hold
+                auto time = Time::getCurrentTime();
+                for (auto channel = 1; channel <= 16; ++channel)
+                {
+                    for (auto number = 0; number < 128; ++number)
+                    {
+                        const MidiMessage messages[] = {
+                            MidiMessage::controllerEvent(channel, number, (number + channel) % 128),
+                            MidiMessage::noteOn(channel, number, (uint8)(1 + (number + channel) % 127))
+                        };
+                        for (auto& message : messages)
+                        {
+                            tap.add(message, time);
+                            uint32 value;
+                            auto slot = Protocol::toSlot(message, value);
+                            expected[slot] = value;
+                        }
+                    }
+                }
+            });
+            
+            expect(reader->frameSizes_.size() > 1, "The state should be spread over several frames");
+            for (auto size : reader->frameSizes_)
+            {
+                expect(size <= StateStreamServer::MAX_FRAME_BYTES, "A frame of " + String(size) + " bytes exceeds the budget");
+            }
+            expect(reader->values_ == expected, "The decoded state doesn't match the sent state");
+        }
+        
+        socket.deleteFile();
+    }
+    
+private:
+    static int controllerSlot(int number)
+    {
+        return Protocol::SLOT_CONTROL_CHANGE + number;
+    }
+    
+    /** Feeds a tap before a viewer connects, the viewer then receives the latest values. */
+    template<typename Feed>
+    std::unique_ptr<FrameReader> stream(const String& address, Feed feed)
+    {
+        expect(StateStreamServer::start(address), "Can't stream over " + address);
+        
+        std::unique_ptr<FrameReader> reader;
+        {
+            StateStreamServer::Tap tap(MidiDeviceInfo("Test", "showmidi-test"));
+            feed(tap);
+            
+            reader = std::make_unique<FrameReader>(address);
+            expect(reader->isConnected(), "Can't connect to " + address);
+            expect(reader->readUntilIdle(), "The stream is corrupt");
+        }
+        
+        StateStreamServer::stop();
+        return reader;
+    }
+    
+    /** Streams controller numbers and values on channel 1. */
+    std::unique_ptr<FrameReader> streamControllers(const String& address, const std::vector<std::pair<int, int>>& controllers)
+    {
+        return stream(address, [&controllers] (StateStreamServer::Tap& tap) {
+            auto time = Time::getCurrentTime();
+            for (auto& controller : controllers)
+            {
+                tap.add(MidiMessage::controllerEvent(1, controller.first, controller.second), time);
+                time += RelativeTime::milliseconds(1);
+            }
+        });
+    }
+};
+
+static StateStreamProtocolTest stateStreamProtocolTest;
+}
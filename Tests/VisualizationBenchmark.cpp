@@ -0,0 +1,230 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "VisualizationBenchmark.h"
+
+#include "VisualizationKernels.h"
+
+namespace showmidi
+{
+namespace
+{
+    constexpr int TIME_UNIT_MS = 50;
+    constexpr int GRAPH_WIDTH = 130;
+    constexpr int GRAPH_HEIGHT = 24;
+    constexpr int GRAPH_COUNT = 64;
+    constexpr int ITERATIONS = 200;
+    
+    struct Graph
+    {
+        Rectangle<int> area_;
+        TimedValue current_;
+        std::vector<TimedValue> history_;
+    };
+    
+    /** The per-rectangle path the kernels replaced, one fillRect per bar and history segment. */
+    struct ReferencePainter
+    {
+        static void paintEntry(Graphics& g, const VisualizationStyle& style, const TimedValue& tv, int64 graphTime, int& totalWidth,
+                               bool bidirectional, const Rectangle<int>& area)
+        {
+            auto graph_right = area.getRight();
+            auto entry_width = std::min(area.getWidth() - totalWidth, int(graphTime - tv.time_.toMilliseconds()) / TIME_UNIT_MS - totalWidth);
+            if (entry_width > 0)
+            {
+                auto entry_left = graph_right - entry_width - totalWidth;
+                auto entry_height = (area.getHeight() * tv.value_) / style.maxValue_;
+                auto entry_top = area.getY() + area.getHeight() - entry_height;
+                int entry_range = area.getHeight() / 2;
+                if (bidirectional)
+                {
+                    g.setColour(style.colourSeparator_);
+                    g.fillRect(area.getX(), area.getY() + entry_range, area.getWidth(), layout::HEIGHT_INDICATOR);
+                    
+                    entry_height = abs(area.getHeight() * (tv.value_ - style.centerValue_)) / (style.maxValue_ - 1);
+                }
+                
+                if (tv.value_ >= style.centerValue_)
+                {
+                    g.setColour(style.colourPositive_);
+                    if (bidirectional)
+                    {
+                        entry_top = area.getY() + entry_range - entry_height;
+                    }
+                }
+                else
+                {
+                    g.setColour(style.colourNegative_);
+                    if (bidirectional)
+                    {
+                        entry_top = area.getY() + entry_range + 1;
+                    }
+                }
+                
+                g.fillRect(entry_left, entry_top, entry_width, entry_height);
+                totalWidth += entry_width;
+            }
+        }
+        
+        static void paintGraph(Graphics& g, const VisualizationStyle& style, const Graph& graph, int64 graphTime, bool bidirectional)
+        {
+            g.setColour(style.colourTrack_);
+            g.fillRect(graph.area_);
+            
+            auto total_width = 0;
+            paintEntry(g, style, graph.current_, graphTime, total_width, bidirectional, graph.area_);
+            for (auto& tv : graph.history_)
+            {
+                paintEntry(g, style, tv, graphTime, total_width, bidirectional, graph.area_);
+            }
+        }
+        
+        static void paintBar(Graphics& g, const VisualizationStyle& style, const Graph& graph, bool bidirectional)
+        {
+            auto& area = graph.area_;
+            auto value = graph.current_.value_;
+            
+            g.setColour(style.colourTrack_);
+            g.fillRect(area.getX(), area.getY(), area.getWidth(), layout::HEIGHT_INDICATOR);
+            
+            int indicator_x = area.getX();
+            int indicator_width = (area.getWidth() * value) / style.maxValue_;
+            int indicator_range = area.getWidth() / 2;
+            if (bidirectional)
+            {
+                indicator_x = area.getX() + indicator_range + 1;
+                indicator_width = (indicator_range * (value - style.centerValue_)) / style.centerValue_;
+            }
+            
+            if (value >= style.centerValue_)
+            {
+                g.setColour(style.colourPositive_);
+            }
+            else
+            {
+                g.setColour(style.colourNegative_);
+                if (bidirectional)
+                {
+                    indicator_x = area.getX() + indicator_range + indicator_width;
+                    indicator_width = abs(indicator_width);
+                }
+            }
+            
+            g.fillRect(indicator_x, area.getY(), indicator_width, layout::HEIGHT_INDICATOR);
+        }
+    };
+    
+    std::vector<Graph> createGraphs(int64 graphTime, int maxValue)
+    {
+        Random random(42);
+        
+        std::vector<Graph> graphs;
+        for (int i = 0; i < GRAPH_COUNT; ++i)
+        {
+            Graph graph;
+            graph.area_ = { 10, 4 + i * (GRAPH_HEIGHT + 4), GRAPH_WIDTH, GRAPH_HEIGHT };
+            graph.current_ = { Time(graphTime - TIME_UNIT_MS), random.nextInt(maxValue + 1) };
+            
+            // a change every time unit fills the graph with one pixel wide segments, the worst case
+            for (int j = 2; j <= GRAPH_WIDTH + 1; ++j)
+            {
+                graph.history_.push_back({ Time(graphTime - j * TIME_UNIT_MS), random.nextInt(maxValue + 1) });
+            }
+            graphs.push_back(graph);
+        }
+        return graphs;
+    }
+    
+    template <typename Function>
+    double measureMicroseconds(Function function)
+    {
+        // warm up the caches and the renderer
+        function();
+        
+        auto start = Time::getHighResolutionTicks();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            function();
+        }
+        auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+        return elapsed * 1000000.0 / ITERATIONS;
+    }
+    
+    template <bool Bidirectional>
+    String runVariant(bool graphVisualization)
+    {
+        const int max_value = Bidirectional ? 0x3FFF : 0x7f;
+        const int center_value = Bidirectional ? 0x2000 : 0x40;
+        const int64 graph_time = 1000000;
+        
+        VisualizationStyle style { center_value, max_value, Colour(0xFF66ADF3), Colour(0xFFD8414E),
+                                   Colour(0xFF201E21), Colour(0xFF66606B), TIME_UNIT_MS };
+        auto graphs = createGraphs(graph_time, max_value);
+        
+        Image image(Image::RGB, GRAPH_WIDTH + 20, GRAPH_COUNT * (GRAPH_HEIGHT + 4) + 8, true);
+        Graphics g(image);
+        
+        auto reference = measureMicroseconds([&] {
+            for (auto& graph : graphs)
+            {
+                if (graphVisualization)
+                {
+                    ReferencePainter::paintGraph(g, style, graph, graph_time, Bidirectional);
+                }
+                else
+                {
+                    ReferencePainter::paintBar(g, style, graph, Bidirectional);
+                }
+            }
+        });
+        
+        RectangleBatch batch;
+        auto batched = measureMicroseconds([&] {
+            batch.clear();
+            for (auto& graph : graphs)
+            {
+                if (graphVisualization)
+                {
+                    GraphKernel<Bidirectional>::batch(batch, style, graph.area_, graph_time, graph.current_, graph.history_);
+                }
+                else
+                {
+                    BarKernel<Bidirectional>::batch(batch, style, graph.area_, graph.current_.value_);
+                }
+            }
+            batch.fill(g);
+        });
+        
+        return String(graphVisualization ? "graph" : "bar  ") + (Bidirectional ? " bidirectional " : " unidirectional") +
+               "  per-rect " + String(reference, 1) + "us" +
+               "  batched " + String(batched, 1) + "us" +
+               "  speedup " + String(reference / batched, 2) + "x" +
+               "  (" + String(batch.getNumRectangles()) + " rectangles)\n";
+    }
+}
+
+String VisualizationBenchmark::run()
+{
+    String report;
+    report << "Visualization kernels, " << GRAPH_COUNT << " visualizations per frame, " << ITERATIONS << " frames\n";
+    report << runVariant<false>(false);
+    report << runVariant<true>(false);
+    report << runVariant<false>(true);
+    report << runVariant<true>(true);
+    return report;
+}
+}
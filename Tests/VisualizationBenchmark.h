@@ -0,0 +1,36 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace showmidi
+{
+    /**
+     * Compares the batched visualization kernels against painting every bar and history
+     * segment with its own fillRect. Run showmidi-tests with --benchmark-visualization.
+     */
+    class VisualizationBenchmark
+    {
+    public:
+        static constexpr const char* COMMAND_LINE_OPTION = "--benchmark-visualization";
+        
+        /** Runs all the variants and returns a report. */
+        static String run();
+    };
+}
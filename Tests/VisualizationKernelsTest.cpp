@@ -0,0 +1,152 @@
+/*
+ * This file is part of ShowMIDI.
+ * Copyright (command) 2023 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ShowMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ShowMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <JuceHeader.h>
+
+#include "VisualizationKernels.h"
+
+namespace showmidi
+{
+namespace
+{
+    const Colour COLOUR_TRACK { 0xFF201E21 };
+    const Colour COLOUR_SEPARATOR { 0xFF66606B };
+    const Colour COLOUR_POSITIVE { 0xFF66ADF3 };
+    const Colour COLOUR_NEGATIVE { 0xFFD8414E };
+    
+    constexpr int WIDTH = 100;
+    constexpr int HEIGHT = 40;
+}
+
+/** Locks in the order the batched rectangles are filled in, whatever the order they were added in. */
+class VisualizationKernelsTest : public UnitTest
+{
+public:
+    VisualizationKernelsTest() : UnitTest("Visualization kernels", "ShowMIDI") {}
+    
+    void runTest() override
+    {
+        beginTest("Tracks are filled under the indicators that were added before them");
+        {
+            RectangleBatch batch;
+            // an earlier item registers the indicator colour first
+            batch.add(RectangleBatch::layerIndicator, COLOUR_POSITIVE, 0, 0, 10, 10);
+            BarKernel<false>::batch(batch, makeStyle(false), { 0, 20, WIDTH, 4 }, 0x7f);
+            
+            auto image = fill(batch);
+            expectColour(image, 5, 5, COLOUR_POSITIVE);
+            expectColour(image, WIDTH / 2, 20, COLOUR_POSITIVE);
+        }
+        
+        beginTest("Bidirectional bars keep their indicator over the track");
+        {
+            RectangleBatch batch;
+            batch.add(RectangleBatch::layerIndicator, COLOUR_NEGATIVE, 0, 0, 10, 10);
+            batch.add(RectangleBatch::layerIndicator, COLOUR_POSITIVE, 10, 0, 10, 10);
+            BarKernel<true>::batch(batch, makeStyle(true), { 0, 20, WIDTH, 4 }, 0);
+            
+            auto image = fill(batch);
+            expectColour(image, WIDTH / 4, 20, COLOUR_NEGATIVE);
+            expectColour(image, WIDTH - 2, 20, COLOUR_TRACK);
+        }
+        
+        beginTest("Graph entries are filled over their track");
+        {
+            RectangleBatch batch;
+            batch.add(RectangleBatch::layerIndicator, COLOUR_POSITIVE, 0, 0, 10, 10);
+            
+            const int64 graph_time = 100000;
+            std::vector<TimedValue> history;
+            GraphKernel<false>::batch(batch, makeStyle(false), { 0, 10, WIDTH, 30 }, graph_time,
+                                      { Time(graph_time - WIDTH * TIME_UNIT_MS), 0x7f }, history);
+            
+            auto image = fill(batch);
+            expectColour(image, WIDTH / 2, HEIGHT - 2, COLOUR_POSITIVE);
+        }
+        
+        beginTest("Piano rolls and heatmaps above a bar don't cover its indicator");
+        {
+            RectangleBatch batch;
+            // the roll's background, a full velocity note, and a hot key of the heatmap
+            batch.add(RectangleBatch::layerTrack, COLOUR_TRACK.withAlpha(0.3f), 0, 0, WIDTH, 10);
+            batch.add(RectangleBatch::layerIndicator, COLOUR_TRACK.interpolatedWith(COLOUR_POSITIVE, 1.0f), 0, 2, 20, 2);
+            batch.add(RectangleBatch::layerIndicator, COLOUR_TRACK.interpolatedWith(COLOUR_POSITIVE, 0.5f), 20, 2, 10, 2);
+            BarKernel<false>::batch(batch, makeStyle(false), { 0, 20, WIDTH, 4 }, 0x40);
+            BarKernel<true>::batch(batch, makeStyle(true), { 0, 30, WIDTH, 4 }, 0x3FFF);
+            
+            auto image = fill(batch);
+            expectColour(image, 10, 2, COLOUR_POSITIVE);
+            expectColour(image, 10, 20, COLOUR_POSITIVE);
+            expectColour(image, WIDTH - 2, 20, COLOUR_TRACK);
+            expectColour(image, WIDTH - 2, 30, COLOUR_POSITIVE);
+            expectColour(image, 10, 30, COLOUR_TRACK);
+        }
+        
+        beginTest("Separators are filled over the indicators");
+        {
+            RectangleBatch batch;
+            batch.add(RectangleBatch::layerSeparator, COLOUR_SEPARATOR, 0, 20, WIDTH, 1);
+            batch.add(RectangleBatch::layerIndicator, COLOUR_NEGATIVE, 0, 10, WIDTH, 20);
+            batch.add(RectangleBatch::layerTrack, COLOUR_TRACK, 0, 0, WIDTH, HEIGHT);
+            
+            auto image = fill(batch);
+            expectColour(image, WIDTH / 2, 20, COLOUR_SEPARATOR);
+            expectColour(image, WIDTH / 2, 15, COLOUR_NEGATIVE);
+            expectColour(image, WIDTH / 2, 5, COLOUR_TRACK);
+        }
+        
+        beginTest("Clearing empties every layer");
+        {
+            RectangleBatch batch;
+            batch.add(RectangleBatch::layerTrack, COLOUR_TRACK, 0, 0, WIDTH, HEIGHT);
+            batch.add(RectangleBatch::layerIndicator, COLOUR_POSITIVE, 0, 0, 10, 10);
+            batch.add(RectangleBatch::layerSeparator, COLOUR_SEPARATOR, 0, 20, WIDTH, 1);
+            expectEquals(batch.getNumRectangles(), 3);
+            
+            batch.clear();
+            expectEquals(batch.getNumRectangles(), 0);
+        }
+    }
+    
+private:
+    static constexpr int TIME_UNIT_MS = 50;
+    
+    static VisualizationStyle makeStyle(bool bidirectional)
+    {
+        return { bidirectional ? 0x2000 : 0x40, bidirectional ? 0x3FFF : 0x7f, COLOUR_POSITIVE, COLOUR_NEGATIVE,
+                 COLOUR_TRACK, COLOUR_SEPARATOR, TIME_UNIT_MS };
+    }
+    
+    static Image fill(const RectangleBatch& batch)
+    {
+        Image image(Image::RGB, WIDTH, HEIGHT, true);
+        Graphics g(image);
+        batch.fill(g);
+        return image;
+    }
+    
+    void expectColour(const Image& image, int x, int y, Colour expected)
+    {
+        auto actual = image.getPixelAt(x, y);
+        expect(actual.getARGB() == expected.getARGB(),
+               "pixel " + String(x) + "," + String(y) + " is " + actual.toDisplayString(false) +
+               " instead of " + expected.toDisplayString(false));
+    }
+};
+
+static VisualizationKernelsTest visualizationKernelsTest;
+}